@@ -3,18 +3,88 @@
  * @date 2025-07-31
  * @brief Header file for AFSK (Audio Frequency-Shift Keying) decoder functions.
  *
- * This file declares functions for initializing and processing AFSK decoding using the Goertzel algorithm.
+ * Every receive channel captured by the audio HAL gets an afskDemod instance,
+ * squelch and FreeRTOS task for each modem profile in RX_MODES, so a gateway
+ * can hear 1200 baud VHF and 300 baud HF packet on the same audio input. The
+ * first profile reports channel n as KISS port n, the next one continues after
+ * the last channel. The profiles share the audio blocks through audio readers,
+ * and the tasks are spread over both cores.
  *
  * Functions:
- * - setupAFSKdecoder(): Initializes the Goertzel filter coefficients. Should be called in the setup() function.
- * - receiveAFSK(): Processes a single audio sample through the Goertzel filter. Should be called in the loop() function.
+ * - setupAFSKdecoder(): Start the decoder tasks. Call in setup() after audioBegin().
+ * - setReceiveSquelchMode(): Gate the demodulators with an energy detector and drop the CPU clock while all ports are idle.
+ * - getReceivePowerStats() / printReceivePowerStats(): Wake counts, missed preambles, estimated current and CPU load per port,
+ *   and the receive stage latencies (frameTrace.h).
+ * - getReceiveDcd(): Data carrier detect on any port, the channel busy signal for transmit.
+ * - getReceiveEye() / resetReceiveEye(): Eye diagram and bit timing of a port (RX_EYE_MONITOR).
+ * - setReceiveSelfTest(): Count decoded frames without forwarding them, for stored test audio.
+ * - sendKISSpacket(): Send a received frame to the host on a KISS port.
+ * - sendKISSack(): Acknowledge a transmitted ACKMODE frame to the host.
+ * - sendKISShardware(): Send a SETHARDWARE reply to the host.
+ * - pollDigipeater(): Queue frames the digipeater repeats (FEATURE_DIGIPEATER). Call in loop().
  */
 #ifndef AFSK_DECODE_H
 #define AFSK_DECODE_H
 
 #include <Arduino.h>
+#include "eyeMonitor.h"
 
-void setupAFSKdecoder(); // Call in setup() to initialize Goertzel filter coefficients
-void receiveAFSK();		 // Call in loop() to process a single sample through the Goertzel filter
+// Squelch-gated low-power receive
+#define RX_SQUELCH_DECIMATION 3	  // Energy detector uses every 3rd sample (3200 Hz)
+#define RX_SQUELCH_OPEN_DB 6.0f	  // Open at 6 dB above the noise floor
+#define RX_SQUELCH_CLOSE_DB 3.0f  // Close below 3 dB above the noise floor...
+#define RX_SQUELCH_HANG_BLOCKS 20 // ...for 20 blocks of 96 samples (200 ms)
+#define RX_SQUELCH_MIN_LEVEL 64	  // Lowest noise floor (16-bit sample units)
+#define RX_IDLE_CPU_MHZ 80		  // CPU clock while the squelch is closed
+#define RX_ACTIVE_CPU_MHZ 240	  // CPU clock while demodulating
+#define RX_IDLE_CURRENT_MA 45	  // Board current estimate at RX_IDLE_CPU_MHZ, calibrate with a meter
+#define RX_ACTIVE_CURRENT_MA 70	  // Board current estimate at RX_ACTIVE_CPU_MHZ
+
+// Decoder tasks
+#define RX_TASK_STACK 3072	// Demodulator state is static, the stack only holds call frames
+#define RX_TASK_PRIORITY 3	// Above loop(), below the audio capture task
+#define RX_BLOCK_TIMEOUT_MS 100 // Longest wait for audio before re-checking
+#define RX_DEADLINE_US 50000	// Capture to demodulated, half the block pool of a two-channel build
+#define RX_SHED_HOLD_MS 30000	// On time this long before shed cascade variants come back
+
+// Modem profiles for RX_MODES, decoded on every channel
+#define RX_MODE_1200 0x01 // Bell 202, 1200/2200 Hz at 1200 baud
+#define RX_MODE_300 0x02  // HF packet, 1600/1800 Hz at 300 baud
+
+// Receive squelch modes
+typedef enum
+{
+	RX_SQUELCH_OFF = 0, // Demodulate every block at full clock
+	RX_SQUELCH_GATED,	// Demodulate only while the energy detector is open, idle at low clock
+	RX_SQUELCH_SHADOW	// Demodulate every block but account as if gated, to measure missed preambles
+} rx_squelch_mode_t;
+
+// Receive power and CPU accounting per port since boot
+typedef struct
+{
+	uint32_t wakes;			  // Squelch openings
+	uint32_t falseWakes;	  // Openings that closed without a decoded frame
+	uint32_t frames;		  // Frames with a valid CRC
+	uint32_t missedPreambles; // Frames whose opening flag arrived while the squelch was closed
+	uint64_t idleUs;		  // Time with the squelch closed
+	uint64_t activeUs;		  // Time with the squelch open
+	uint64_t busyUs;		  // CPU time spent in the squelch and demodulator
+	uint32_t blocks;		  // Audio blocks processed
+	uint32_t lostBlocks;	  // Sequence gaps, audio dropped before reaching this port
+} rx_power_stats_t;
+
+void setupAFSKdecoder(); // Call in setup() after audioBegin() to start one decoder task per channel and profile
+
+void setReceiveSquelchMode(rx_squelch_mode_t mode);				   // Select OFF, GATED or SHADOW
+bool getReceivePowerStats(uint8_t port, rx_power_stats_t *stats); // Copy the accounting counters of one port
+void printReceivePowerStats();									   // Print counters, current and CPU load per port to Serial
+bool getReceiveDcd();											   // true while any port hears a packet signal
+const eye_monitor_t *getReceiveEye(uint8_t port);				   // Live eye diagram of a port, NULL if none
+void resetReceiveEye(uint8_t port);								   // Start a new eye diagram on a port
+void setReceiveSelfTest(bool on);								   // Count frames but keep them from the host and digipeater
+void sendKISSpacket(uint8_t port, const uint8_t *data, size_t len); // Send a data frame to the host on a KISS port
+void sendKISSack(uint8_t port, uint16_t tag);						   // Acknowledge a transmitted ACKMODE frame
+void sendKISShardware(uint8_t port, const uint8_t *data, size_t len); // Send a SETHARDWARE reply to the host
+void pollDigipeater();											   // Call in loop() to queue frames the digipeater repeats
 
 #endif // AFSK_DECODE_H
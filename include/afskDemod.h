@@ -0,0 +1,190 @@
+/**
+ * @file afskDemod.h
+ * @date 2025-09-11
+ * @brief Per-channel AFSK demodulator: tone discriminator, bit clock recovery and HDLC deframing.
+ *
+ * Each instance keeps all of its state in an afsk_demod_t, so several radio
+ * ports or modem profiles can be decoded side by side. The profile selects the
+ * front end that turns audio into mark/space decisions:
+ * - AFSK_FRONT_END_GOERTZEL: a sliding one-bit Goertzel (single-bin DFT)
+ *   correlator per tone, kept in integer running sums so it never drifts. The
+ *   normalized mark/space difference is the decision. Best sensitivity.
+ * - AFSK_FRONT_END_DELAY_LINE: delay-and-multiply quadrature detector. The
+ *   product of a sample with one a few samples older has a mean of
+ *   cos(2 pi f delay), of opposite sign for the two tones; a 3/4-bit moving
+ *   sum removes the double-frequency term. One multiply per sample.
+ * - AFSK_FRONT_END_ZERO_CROSSING: interpolated time between zero crossings,
+ *   compared with the midpoint of the two tones' half periods and smoothed by
+ *   a half-bit moving sum. One divide per crossing, no multiply per sample.
+ * The decisions drive a digital PLL that samples the bit center and measures
+ * transition timing for carrier detect (DCD). Recovered bits go to an HDLC
+ * deframer. The code has no Arduino dependency so it can also be built for the
+ * host, where "program demod" compares the front ends' packet error rate and
+ * CPU time.
+ *
+ * Functions:
+ * - afskDemodInit(): Configure an instance for a modem profile and KISS port.
+ * - afskDemodProcess(): Demodulate a block of signed 16-bit samples.
+ * - afskDemodClock(): Feed one mark/space decision from an external correlator.
+ * - afskDemodSetSlicer(): Move the Goertzel mark/space decision toward one tone.
+ * - afskDemodSetErrorCallback(): Also receive frames that failed the FCS check.
+ * - afskDemodSetEyeMonitor(): Accumulate an eye diagram and bit timing statistics.
+ * - afskDemodDcd(): Data carrier detect state.
+ * - afskFrontEndName(): Short name of a front end for logs and options.
+ */
+#ifndef AFSK_DEMOD_H
+#define AFSK_DEMOD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "eyeMonitor.h"
+#include "hdlc.h"
+
+#define AFSK_DEMOD_MAX_WINDOW 64 // Longest correlator window (samples per bit)
+#define AFSK_DEMOD_MAX_DELAY 16	 // Longest delay-line discriminator delay (samples)
+
+typedef enum
+{
+	AFSK_FRONT_END_GOERTZEL = 0, // Tone correlators, the default
+	AFSK_FRONT_END_DELAY_LINE,	 // Delay-and-multiply discriminator
+	AFSK_FRONT_END_ZERO_CROSSING // Zero-crossing interval discriminator
+} afsk_front_end_t;
+
+// Modem profile
+typedef struct
+{
+	uint16_t markFreq;	 // Hz
+	uint16_t spaceFreq;	 // Hz
+	uint16_t baudRate;	 // Bits per second
+	uint32_t sampleRate; // Input sample rate (Hz)
+	afsk_front_end_t frontEnd; // Zero, the Goertzel correlator, when left out of an initializer
+} afsk_profile_t;
+
+// Called for every frame that passed the FCS check, FCS removed
+typedef void (*afsk_frame_cb)(void *ctx, uint8_t port, const uint8_t *frame, size_t len);
+
+typedef struct
+{
+	afsk_profile_t profile;
+	uint8_t port; // KISS port reported with decoded frames
+
+	// Goertzel correlator, one-bit sliding window per tone
+	uint32_t markPhase;
+	uint32_t spacePhase;
+	uint32_t markStep;
+	uint32_t spaceStep;
+	int32_t markI, markQ, spaceI, spaceQ;
+	int16_t history[4][AFSK_DEMOD_MAX_WINDOW]; // Products leaving the window
+	uint8_t window;
+	uint8_t pos;
+	float slicerLevel; // Mark when (m - s) / (m + s) is above this, 0 after init
+
+	// Delay-line and zero-crossing discriminators, a moving sum after either
+	bool markPositive;						 // Discriminator sign for the mark tone
+	int16_t delayLine[AFSK_DEMOD_MAX_DELAY]; // Delay line: past samples
+	uint8_t delay;
+	uint8_t delayPos;
+	int32_t dcQ8;		  // Zero crossing: input DC estimate, 1/256 units
+	int32_t lastSample;	  // Zero crossing: previous sample, DC removed
+	int32_t sinceCrossQ8; // Zero crossing: time since the last crossing, 1/256 samples
+	int32_t intervalQ8;	  // Zero crossing: last half period, held until the next crossing
+	int32_t thresholdQ8;  // Zero crossing: midpoint of the mark and space half periods
+	int32_t filterSum;
+	int16_t filterHistory[AFSK_DEMOD_MAX_WINDOW];
+	uint8_t filterLen;
+	uint8_t filterPos;
+
+	// Bit clock recovery, full bit = 2^32
+	int32_t pllPhase;
+	uint32_t pllStep;
+	bool lastLevel;
+
+	// Carrier detect from transition timing
+	uint8_t dcdScore;
+	bool dcd;
+
+	hdlc_deframer_t hdlc;
+	afsk_frame_cb onFrame;
+	afsk_frame_cb onBadFrame; // Frames with a bad FCS, FCS included; NULL for none
+	void *ctx;
+	eye_monitor_t *eye; // Fed while DCD is up; NULL for none
+} afsk_demod_t;
+
+/**
+ * @brief Configure a demodulator instance
+ * @param d Demodulator state
+ * @param profile Tone frequencies, baud rate and sample rate
+ * @param port KISS port number passed to onFrame
+ * @param onFrame Callback for decoded frames
+ * @param ctx Passed back to onFrame
+ * @return true on success, false if the profile does not fit AFSK_DEMOD_MAX_WINDOW or
+ *         the front end cannot tell its tones apart
+ */
+bool afskDemodInit(afsk_demod_t *d, const afsk_profile_t *profile, uint8_t port,
+				   afsk_frame_cb onFrame, void *ctx);
+
+/**
+ * @brief Demodulate a block of samples
+ * @param d Demodulator state
+ * @param samples Signed 16-bit samples at profile.sampleRate
+ * @param count Number of samples
+ */
+void afskDemodProcess(afsk_demod_t *d, const int16_t *samples, size_t count);
+
+/**
+ * @brief Advance the bit clock by one sample of an externally computed level
+ *
+ * Lets a vectorized correlator running many lanes at once reuse the per-lane
+ * clock recovery, DCD and HDLC of this module.
+ *
+ * @param d Demodulator state, its correlator fields are not used
+ * @param level true for mark (mark energy above space energy)
+ */
+void afskDemodClock(afsk_demod_t *d, bool level);
+
+/**
+ * @brief Move the Goertzel front end's mark/space decision
+ *
+ * Receivers with de-emphasis, or transmitters without pre-emphasis, deliver
+ * one tone much weaker than the other; a level toward the strong tone
+ * decodes such audio better. Other front ends ignore it.
+ *
+ * @param d Demodulator state
+ * @param level Mark when (m - s) / (m + s) is above level, -1 to 1, 0 after afskDemodInit()
+ */
+void afskDemodSetSlicer(afsk_demod_t *d, float level);
+
+/**
+ * @brief Deliver frames that fail the FCS check as well
+ * @param d Demodulator state
+ * @param onBadFrame Called with the frame and its FCS and the onFrame ctx, NULL to stop
+ */
+void afskDemodSetErrorCallback(afsk_demod_t *d, afsk_frame_cb onBadFrame);
+
+/**
+ * @brief Feed an eye monitor from this demodulator while its PLL is locked
+ *
+ * The value plotted is the front end's discriminator before the decision,
+ * minus the slicer level for Goertzel. afskDemodClock() feeds only the timing
+ * statistics, it has no value.
+ *
+ * @param d Demodulator state
+ * @param eye Monitor, reset by the caller; NULL to stop
+ */
+void afskDemodSetEyeMonitor(afsk_demod_t *d, eye_monitor_t *eye);
+
+/**
+ * @brief Get the data carrier detect state
+ * @param d Demodulator state
+ * @return true while transitions line up with the recovered bit clock
+ */
+bool afskDemodDcd(const afsk_demod_t *d);
+
+/**
+ * @brief Get the short name of a front end
+ * @param frontEnd Front end
+ * @return "goertzel", "delay-line", "zero-crossing" or "unknown"
+ */
+const char *afskFrontEndName(afsk_front_end_t frontEnd);
+
+#endif // AFSK_DEMOD_H
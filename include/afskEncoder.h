@@ -7,19 +7,24 @@
  * for transmitting AX.25 protocol frames using the modern Arduino ESP32 framework.
  *
  * Key improvements over legacy version:
- * - Uses modern Arduino ESP32 DAC API (dacWrite) instead of driver/dac.h
+ * - Timer ISR in IRAM that clocks out the bits and writes the DAC, PWM or
+ *   sigma-delta registers directly, so flash writes do not disturb the tones
  * - Improved timer frequency calculations for accurate AFSK generation
  * - Better resource management and error handling
  * - Configurable parameters for different AFSK configurations
+ * - Per-tone amplitude (twist) for flat or pre-emphasized radio inputs
+ * - DAC, LEDC PWM or sigma-delta output with noise-shaped quantization
+ * - Fixed-rate sample-block output (I2S codec) through audioHal.h
  *
  * Hardware Requirements:
- * - ESP32 with DAC capability (GPIO25 or GPIO26)
+ * - ESP32 with DAC capability (GPIO25 or GPIO26), or any GPIO for PWM/sigma-delta
+ *   output followed by an RC low-pass filter (corner around 5 kHz)
  * - PTT control pin for transmitter keying
  * - Optional PTT LED indicator
  *
  * Usage:
  * 1. Call setupAFSKEncoder() during Arduino setup() to initialize hardware
- * 2. Use transmitAX25() to send KISS frames as AX.25 packets via AFSK
+ * 2. Use transmitAX25() to send AX.25 frames (KISS data payloads) via AFSK
  * 3. Use afskSend() for raw bit transmission (testing purposes)
  * 4. Call cleanupAFSKEncoder() when done to free resources
  *
@@ -32,6 +37,7 @@
 #define AFSK_ENCODER_H
 
 #include <Arduino.h>
+#include <soc/soc_caps.h> // for SOC_DAC_SUPPORTED
 
 // Configuration constants
 #define AFSK_DAC_PIN 25			  // GPIO25 (DAC1) - can be changed to 26 (DAC2)
@@ -42,6 +48,17 @@
 #define AFSK_AMPLITUDE 0.8f		  // Amplitude (0.0 to 1.0)
 #define AFSK_DAC_MAX_VALUE 255	  // 8-bit DAC maximum value
 #define AFSK_TIMER_DIVIDER 8	  // 80MHz / 8 = 10MHz timer frequency for finer control
+#define AFSK_PWM_CHANNEL 0		  // LEDC channel for AFSK_OUTPUT_PWM
+#define AFSK_PWM_RESOLUTION 10	  // LEDC duty resolution (bits)
+#define AFSK_PWM_FREQ 78125		  // 80MHz / 2^10, highest carrier at 10-bit resolution
+#define AFSK_SIGMA_DELTA_CHANNEL 0 // Sigma-delta channel for AFSK_OUTPUT_SIGMA_DELTA
+#define AFSK_SIGMA_DELTA_FREQ 312500 // Sigma-delta modulator clock (Hz)
+#define AFSK_NOISE_SHAPING_ORDER 2 // Default noise shaping order (0 = plain rounding)
+#define AFSK_TWIST_DB 0.0f		  // Default mark level relative to space (dB), positive = mark louder
+#define AFSK_TWIST_MAX_DB 12.0f	  // Largest twist accepted by setAFSKTwist()
+#define AFSK_PREEMPHASIS_DB 5.3f  // 6 dB/octave from 1200 to 2200 Hz = 20*log10(2200/1200)
+#define AFSK_TXDELAY_FLAGS 32	  // Default flags before each frame, 213 ms at 1200 baud
+#define AFSK_TIMER_TICKS_PER_US (APB_CLK_FREQ / AFSK_TIMER_DIVIDER / 1000000) // For afsk_timing_stats_t
 
 // Error codes
 typedef enum
@@ -52,9 +69,51 @@ typedef enum
 	AFSK_ERROR_DAC_INIT,
 	AFSK_ERROR_INVALID_PARAMS,
 	AFSK_ERROR_NOT_INITIALIZED,
-	AFSK_ERROR_BUFFER_OVERFLOW
+	AFSK_ERROR_BUFFER_OVERFLOW,
+	AFSK_ERROR_TX_TIMEOUT
 } afsk_status_t;
 
+// Sample timing of the timer ISR: latency is from the alarm to the output write
+typedef struct
+{
+	uint32_t samples;
+	uint32_t lateSamples;		// Written more than half a sample period after the alarm
+	uint32_t maxLatencyTicks;	// Timer ticks, AFSK_TIMER_TICKS_PER_US per microsecond
+	uint64_t totalLatencyTicks;
+} afsk_timing_stats_t;
+
+// micros() at the steps of the last transmission, 0 for a step not reached.
+// With AFSK_OUTPUT_BLOCK the bits are timed as they are handed to the audio output.
+typedef struct
+{
+	uint32_t pttOnUs;
+	uint32_t firstBitUs; // Start of TXDELAY flags
+	uint32_t lastBitUs;	 // Last level sent
+	uint32_t pttOffUs;
+} afsk_tx_times_t;
+
+// Audio output backends
+typedef enum
+{
+	AFSK_OUTPUT_DAC = 0,	 // 8-bit DAC on GPIO25/26
+	AFSK_OUTPUT_PWM,		 // LEDC PWM at AFSK_PWM_RESOLUTION bits, any GPIO
+	AFSK_OUTPUT_SIGMA_DELTA, // 8-bit sigma-delta modulator, any GPIO
+	AFSK_OUTPUT_BLOCK		 // 16-bit blocks through audioWriteBlock(), e.g. an I2S codec
+} afsk_output_t;
+
+#if SOC_DAC_SUPPORTED
+#define AFSK_DEFAULT_OUTPUT AFSK_OUTPUT_DAC
+#else
+#define AFSK_DEFAULT_OUTPUT AFSK_OUTPUT_PWM // Variants without a DAC (S3, C3)
+#endif
+
+// Transmit twist profiles, selected by how the radio treats its audio input
+typedef enum
+{
+	AFSK_TWIST_PREEMPHASIZED_INPUT = 0, // Mic input: the radio pre-emphasizes, send equal tones
+	AFSK_TWIST_FLAT_INPUT				// Flat data port: emulate pre-emphasis, twist -5.3 dB (space louder)
+} afsk_twist_profile_t;
+
 /**
  * @brief Initialize the AFSK encoder with default settings
  * @param dacPin DAC output pin (25 or 26)
@@ -83,22 +142,97 @@ afsk_status_t setAFSKParameters(uint16_t markFreq, uint16_t spaceFreq,
 								uint16_t baudRate, float amplitude,
 								uint8_t samplesPerCycle);
 
+/**
+ * @brief Select the audio output backend
+ *
+ * Samples are rendered at 16 bits and reduced to the backend's resolution by an
+ * error-feedback noise shaper, giving roughly 10-12 effective bits in the audio
+ * band after the external RC filter. Must be called before setupAFSKEncoder().
+ *
+ * AFSK_OUTPUT_BLOCK renders fixed-rate blocks with afskModulator.h instead of the
+ * timer ISR and needs audioBegin() with a block-capable backend first.
+ *
+ * @param output AFSK_OUTPUT_DAC, AFSK_OUTPUT_PWM, AFSK_OUTPUT_SIGMA_DELTA or AFSK_OUTPUT_BLOCK
+ * @param pin Audio output pin (25 or 26 for the DAC, ignored for blocks)
+ * @param shapingOrder Noise shaping order, 0 to NOISE_SHAPER_MAX_ORDER
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKOutput(afsk_output_t output, uint8_t pin, uint8_t shapingOrder);
+
+/**
+ * @brief Set the mark-to-space level difference (twist) of the transmitted tones
+ *
+ * Mark and space are rendered from separate wave tables, so twist costs nothing
+ * per sample. The louder tone is scaled to the configured amplitude and the other
+ * tone is attenuated by the twist. Cannot be changed while transmitting.
+ *
+ * Twist is the mark level relative to space throughout the project, as
+ * "program eye" measures and simulates it, so a measured value can be used here.
+ *
+ * @param twistDb Mark level relative to space in dB (positive = mark louder)
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTwist(float twistDb);
+
+/**
+ * @brief Select a twist preset for the radio's audio input type
+ * @param profile AFSK_TWIST_PREEMPHASIZED_INPUT or AFSK_TWIST_FLAT_INPUT
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTwistProfile(afsk_twist_profile_t profile);
+
+/**
+ * @brief Get the current twist setting
+ * @return Mark level relative to space in dB
+ */
+float getAFSKTwist();
+
+/**
+ * @brief Set the keyup time sent as flags before each frame (KISS TXDELAY)
+ * @param ms Time from PTT on to the frame, rounded up to whole flags (at least one)
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTxDelay(uint16_t ms);
+
 /**
  * @brief Transmit an AX.25 frame using AFSK modulation
- * @param kissFrame Pointer to KISS frame (first byte should be 0x00)
- * @param len Length of KISS frame in bytes
+ *
+ * The frame is checked with ax25Parse() and rejected if malformed, then sent
+ * with the TXDELAY flags, FCS, bit stuffing and NRZI (hdlcEncode()). PTT is
+ * keyed for the whole transmission. Uses a static buffer, not the heap; call
+ * from one task only.
+ *
+ * @param frame AX.25 frame without FCS, e.g. the payload of a KISS data frame
+ * @param len Length of the frame in bytes
  * @return AFSK_SUCCESS on success, error code otherwise
  */
-afsk_status_t transmitAX25(uint8_t *kissFrame, size_t len);
+afsk_status_t transmitAX25(const uint8_t *frame, size_t len);
 
 /**
  * @brief Transmit raw bits using AFSK modulation (for testing)
- * @param bits Pointer to array of bits (each byte should be 0 or 1)
+ * @param bits Pointer to array of bits (each byte should be 0 or 1), in internal RAM
  * @param len Number of bits to transmit
  * @return AFSK_SUCCESS on success, error code otherwise
  */
 afsk_status_t afskSend(uint8_t *bits, size_t len);
 
+/**
+ * @brief Copy the sample timing of the timer ISR since the last reset
+ *
+ * Not updated by AFSK_OUTPUT_BLOCK, which is paced by the audio device.
+ */
+void getAFSKTimingStats(afsk_timing_stats_t *stats);
+
+/**
+ * @brief Clear the sample timing counters
+ */
+void resetAFSKTimingStats();
+
+/**
+ * @brief Copy the PTT and bit times of the last transmission, for frame latency tracing
+ */
+void getAFSKTxTimes(afsk_tx_times_t *times);
+
 /**
  * @brief Check if AFSK encoder is currently transmitting
  * @return true if transmitting, false otherwise
@@ -117,8 +251,4 @@ const char *getAFSKStatusString(afsk_status_t status);
  */
 void cleanupAFSKEncoder();
 
-// Internal functions (not for external use)
-size_t ax25Encode(uint8_t *input, size_t len, uint8_t *output);
-size_t nrziEncode(uint8_t *input, size_t len, uint8_t *output);
-
 #endif // AFSK_ENCODER_H
@@ -0,0 +1,94 @@
+/**
+ * @file afskModulator.h
+ * @date 2025-09-04
+ * @brief Phase-continuous AFSK tone generator for fixed-rate sample-block outputs.
+ *
+ * The timer ISR in afskEncoder.cpp changes its sample rate with the tone, which
+ * only works for outputs written one sample at a time. Block outputs such as an
+ * I2S codec run at a fixed rate, so this renders each bit with a 32-bit phase
+ * accumulator and an interpolated sine table instead. Mark and space keep separate
+ * levels so twist still costs nothing per sample. The code has no Arduino
+ * dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - afskModulatorInit(): Set sample rate, tone frequencies and baud rate.
+ * - afskModulatorSetLevels(): Set the peak level of each tone.
+ * - afskModulatorReset(): Restart phase and bit timing for a new transmission.
+ * - afskModulatorBit(): Render the samples of one bit.
+ * - afskTwistLevels(): Peak level of each tone for a twist.
+ * - afskToneTable(): One sine cycle at a level, for the timer-driven outputs.
+ */
+#ifndef AFSK_MODULATOR_H
+#define AFSK_MODULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+	uint32_t phase;		 // Tone phase, full circle = 2^32
+	uint32_t markStep;	 // Phase increment per sample for mark
+	uint32_t spaceStep;	 // Phase increment per sample for space
+	uint32_t sampleRate; // Output sample rate (Hz)
+	uint32_t baudRate;	 // Bits per second
+	uint32_t bitPhase;	 // Fractional samples carried between bits, in units of 1/baudRate
+	int16_t markLevel;	 // Peak amplitude of mark, 0 to 32767
+	int16_t spaceLevel;	 // Peak amplitude of space, 0 to 32767
+} afsk_modulator_t;
+
+/**
+ * @brief Configure a modulator
+ * @param mod Modulator state
+ * @param sampleRate Output sample rate in Hz
+ * @param markFreq Mark frequency in Hz
+ * @param spaceFreq Space frequency in Hz
+ * @param baudRate Baud rate in bits per second
+ * @return true on success, false if the parameters are out of range
+ */
+bool afskModulatorInit(afsk_modulator_t *mod, uint32_t sampleRate, uint16_t markFreq,
+					   uint16_t spaceFreq, uint16_t baudRate);
+
+/**
+ * @brief Set the peak level of each tone
+ * @param mod Modulator state
+ * @param markLevel Mark peak amplitude, 0 to 32767
+ * @param spaceLevel Space peak amplitude, 0 to 32767
+ */
+void afskModulatorSetLevels(afsk_modulator_t *mod, int16_t markLevel, int16_t spaceLevel);
+
+/**
+ * @brief Restart tone phase and bit timing
+ * @param mod Modulator state
+ */
+void afskModulatorReset(afsk_modulator_t *mod);
+
+/**
+ * @brief Render one bit
+ * @param mod Modulator state
+ * @param mark true for mark, false for space
+ * @param out Output buffer, at least sampleRate / baudRate + 1 samples
+ * @return Number of samples written
+ */
+size_t afskModulatorBit(afsk_modulator_t *mod, bool mark, int16_t *out);
+
+/**
+ * @brief Peak level of each tone for a twist
+ *
+ * The louder tone gets the full peak and the other is attenuated by the twist.
+ *
+ * @param peak Level of the louder tone, 0 to 32767
+ * @param twistDb Mark level relative to space in dB (positive = mark louder)
+ * @param markLevel Mark peak amplitude
+ * @param spaceLevel Space peak amplitude
+ */
+void afskTwistLevels(int16_t peak, float twistDb, int16_t *markLevel, int16_t *spaceLevel);
+
+/**
+ * @brief Fill a table with one sine cycle
+ * @param table Output, samples entries
+ * @param samples Samples per cycle
+ * @param level Peak amplitude, 0 to 32767
+ */
+void afskToneTable(int16_t *table, uint16_t samples, int16_t level);
+
+#endif // AFSK_MODULATOR_H
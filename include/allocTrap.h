@@ -0,0 +1,53 @@
+/**
+ * @file allocTrap.h
+ * @date 2025-10-09
+ * @brief Debug allocator hook that traps heap use inside registered hot-path scopes.
+ *
+ * After boot, nothing between an ADC block and the KISS frame sent to the host,
+ * or between KISS bytes from the host and the DAC, may touch the heap. The
+ * receive decoder tasks, the host KISS input and the transmit path mark their
+ * work with allocTrapEnter()/allocTrapLeave(). In env:alloc-trap, the linker
+ * routes malloc(), calloc() and realloc() through this module (-Wl,--wrap), so
+ * the firmware and the framework's own allocations are seen, operator new and
+ * String included. An allocation made by a task inside a scope is counted with
+ * the scope, size and caller. With ALLOC_TRAP 2 the first one also prints and
+ * aborts, and the panic backtrace (esp32_exception_decoder) shows where it came
+ * from. Direct heap_caps_malloc() calls bypass the hook.
+ *
+ * With ALLOC_TRAP 0, the default, the scope calls compile to nothing.
+ *
+ * Functions:
+ * - allocTrapEnter() / allocTrapLeave(): Mark a hot-path scope on the calling task.
+ * - getAllocTrapStats(): Copy the counters and the last trapped allocation.
+ * - printAllocTrapStats(): Print them to Serial, nothing when ALLOC_TRAP is 0.
+ */
+#ifndef ALLOC_TRAP_H
+#define ALLOC_TRAP_H
+
+#include <Arduino.h>
+
+#ifndef ALLOC_TRAP
+#define ALLOC_TRAP 0 // 1 counts allocations in hot-path scopes, 2 also aborts at the first one
+#endif
+static_assert(ALLOC_TRAP >= 0 && ALLOC_TRAP <= 2, "ALLOC_TRAP must be 0, 1 or 2");
+
+typedef struct
+{
+	uint32_t trapped;	  // Allocations made inside a scope
+	const char *scope;	  // Scope, size and caller of the last one
+	uint32_t size;
+	const void *caller;
+} alloc_trap_stats_t;
+
+#if ALLOC_TRAP
+void allocTrapEnter(const char *scope); // Scopes nest per task; the innermost name is reported
+void allocTrapLeave();
+#else
+static inline void allocTrapEnter(const char *scope) {}
+static inline void allocTrapLeave() {}
+#endif
+
+void getAllocTrapStats(alloc_trap_stats_t *stats);
+void printAllocTrapStats();
+
+#endif // ALLOC_TRAP_H
@@ -0,0 +1,51 @@
+/**
+ * @file audioCodec.h
+ * @date 2025-09-04
+ * @brief Register setup for external I2S audio codecs (WM8960, ES8388).
+ *
+ * The codecs run as I2S slaves at 48 kHz, 16 bits, with MCLK = 256 * fs supplied
+ * by the ESP32. Register sequences are plain tables walked by codecInit(), which
+ * writes through a caller supplied bus so the same code drives Wire on the ESP32
+ * and a recording mock on the host.
+ *
+ * Functions:
+ * - codecInit(): Send the init sequence for a codec over the given bus.
+ * - codecI2CAddress(): 7-bit I2C address of a codec.
+ */
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Supported codecs
+typedef enum
+{
+	CODEC_WM8960 = 0, // 9-bit registers, 7-bit register address packed into two bytes
+	CODEC_ES8388	  // 8-bit registers
+} codec_type_t;
+
+// Register access used by codecInit()
+typedef struct
+{
+	bool (*write)(void *ctx, uint8_t address, const uint8_t *data, size_t len); // One I2C write transaction
+	void (*delay)(void *ctx, uint32_t ms);										 // Settling time between writes
+	void *ctx;																	 // Passed back to write() and delay()
+} codec_bus_t;
+
+/**
+ * @brief Send the power-up and format sequence for a codec
+ * @param type Codec type
+ * @param bus Register access functions
+ * @return true if every register write was acknowledged
+ */
+bool codecInit(codec_type_t type, const codec_bus_t *bus);
+
+/**
+ * @brief Get the 7-bit I2C address of a codec
+ * @param type Codec type
+ * @return I2C address
+ */
+uint8_t codecI2CAddress(codec_type_t type);
+
+#endif // AUDIO_CODEC_H
@@ -0,0 +1,170 @@
+/**
+ * @file audioHal.h
+ * @date 2025-09-11
+ * @brief Sample-block audio interface between the modem and the audio hardware.
+ *
+ * A capture task owns the audio input and hands out blocks of signed 16-bit
+ * samples at AUDIO_RX_SAMPLE_RATE, one stream per radio port. Block-capable
+ * transmit paths write signed 16-bit samples at audioOutputSampleRate(),
+ * whatever hardware sits underneath:
+ *
+ * - AUDIO_BACKEND_INTERNAL: ESP32 ADC1 in continuous (DMA) mode, scanning one
+ *   GPIO per radio port in a single pattern. Each channel is oversampled by
+ *   AUDIO_ADC_OVERSAMPLE and FIR-decimated. Transmit stays on the encoder's timer
+ *   ISR (DAC, PWM or sigma-delta).
+ * - AUDIO_BACKEND_I2S_CODEC: WM8960 or ES8388 over I2S at 48 kHz, both directions
+ *   at 16 bits. Left input is port 0, right input is port 1.
+ *
+ * Several decoders can read one channel, for example one per modem profile.
+ * Each opens a reader; every block of the channel is queued to all of its
+ * readers without a copy and goes back to the pool when the last one releases
+ * it.
+ *
+ * A self-test can feed its own audio through the same blocks in place of the
+ * hardware, as fast as the slowest reader takes it; live audio is read and
+ * dropped meanwhile.
+ *
+ * Functions:
+ * - audioBegin(): Start the selected backend. Call in setup() before the encoder and decoder.
+ * - audioOpenReader(): Subscribe a decoder to a channel's blocks.
+ * - audioReceiveBlock() / audioReleaseBlock(): Borrow the next block of a reader and give it back.
+ * - audioInjectBegin() / audioInjectSamples() / audioInjectEnd(): Receive stored audio instead of live audio.
+ * - audioWriteBlock(): Write transmit samples, blocking while the output is full.
+ * - audioHasBlockOutput(): true if transmit goes through audioWriteBlock().
+ * - audioOutputSampleRate(): Transmit sample rate of the block output.
+ * - audioChannelCount(): Number of receive channels being captured.
+ * - audioDroppedBlocks(): Blocks lost because no decoder kept up.
+ * - audioEnd(): Stop the backend and release its pins.
+ */
+#ifndef AUDIO_HAL_H
+#define AUDIO_HAL_H
+
+#include <Arduino.h>
+
+#define AUDIO_RX_SAMPLE_RATE 9600	   // Sample rate delivered to the demodulators (Hz)
+#define AUDIO_CODEC_SAMPLE_RATE 48000 // I2S codec sample rate (Hz), MCLK = 256 * fs
+#define AUDIO_ADC_MIDPOINT 2048	   // ESP32 12-bit ADC resolution is 4096
+#define AUDIO_ADC_OVERSAMPLE 3		   // ADC rate per channel / AUDIO_RX_SAMPLE_RATE, DMA needs >= 20 kHz total
+#define AUDIO_BLOCK_SAMPLES 96		   // Samples per block, 10 ms at 9600 Hz
+#define AUDIO_MAX_CHANNELS 2		   // Radio ports
+#define AUDIO_BLOCK_POOL 12		   // Blocks shared by all channels
+#define AUDIO_MAX_READERS 4		   // Decoders over all channels
+
+// Audio hardware backends
+typedef enum
+{
+	AUDIO_BACKEND_INTERNAL = 0, // ESP32 ADC in, encoder timer ISR out
+	AUDIO_BACKEND_I2S_CODEC	   // External codec on I2S, configured over I2C
+} audio_backend_t;
+
+// One block of receive audio for one channel
+typedef struct
+{
+	int16_t samples[AUDIO_BLOCK_SAMPLES];
+	uint32_t sequence;	 // Block number within its channel, gaps mean dropped blocks
+	uint32_t capturedUs; // micros() when the last sample arrived
+	uint8_t channel;
+	uint8_t readers; // Readers yet to release the block, kept by the HAL
+} audio_block_t;
+
+/**
+ * @brief Start an audio backend and its capture task
+ * @param backend Backend to start
+ * @param channels Receive channels to capture, 1 to AUDIO_MAX_CHANNELS
+ * @return true on success, false if the hardware could not be configured
+ */
+bool audioBegin(audio_backend_t backend, uint8_t channels);
+
+/**
+ * @brief Subscribe to the receive blocks of a channel
+ *
+ * Readers stay open for good; the blocks of a channel that has none are
+ * dropped. A reader that falls behind holds blocks from the shared pool, so
+ * the other readers and channels run short too.
+ *
+ * @param channel Channel number, 0 to AUDIO_MAX_CHANNELS - 1
+ * @return Reader number for audioReceiveBlock(), -1 if AUDIO_MAX_READERS are open
+ */
+int8_t audioOpenReader(uint8_t channel);
+
+/**
+ * @brief Wait for the next receive block of a reader
+ * @param reader Reader number from audioOpenReader()
+ * @param timeoutMs Longest wait in milliseconds
+ * @return Block to read, or NULL on timeout. Return it with audioReleaseBlock().
+ */
+audio_block_t *audioReceiveBlock(uint8_t reader, uint32_t timeoutMs);
+
+/**
+ * @brief Release a block; the last of its readers returns it to the capture pool
+ * @param block Block from audioReceiveBlock(), not to be read afterwards
+ */
+void audioReleaseBlock(audio_block_t *block);
+
+/**
+ * @brief Replace live receive audio with samples from the calling task
+ *
+ * Waits for the capture task to finish its current read. Until
+ * audioInjectEnd() the capture task drops what it reads, so the channels
+ * not injected get no blocks.
+ *
+ * @return true once the capture task has stopped appending, false if audio is
+ *         stopped or another injection is running
+ */
+bool audioInjectBegin();
+
+/**
+ * @brief Append samples to a channel as if captured, between audioInjectBegin() and audioInjectEnd()
+ *
+ * Blocks while the pool is empty instead of dropping audio, so injection
+ * runs as fast as the slowest reader of the channel.
+ *
+ * @param channel Receive channel
+ * @param samples Samples at AUDIO_RX_SAMPLE_RATE
+ * @param count Number of samples
+ */
+void audioInjectSamples(uint8_t channel, const int16_t *samples, size_t count);
+
+/**
+ * @brief Return the receive blocks to live audio; a partly filled block is dropped
+ */
+void audioInjectEnd();
+
+/**
+ * @brief Write transmit samples at audioOutputSampleRate()
+ * @param samples Signed 16-bit samples
+ * @param count Number of samples to write
+ * @return Number of samples written
+ */
+size_t audioWriteBlock(const int16_t *samples, size_t count);
+
+/**
+ * @brief Check whether transmit audio goes through audioWriteBlock()
+ * @return true for block outputs such as an I2S codec
+ */
+bool audioHasBlockOutput();
+
+/**
+ * @brief Get the transmit sample rate of the block output
+ * @return Sample rate in Hz, 0 if there is no block output
+ */
+uint32_t audioOutputSampleRate();
+
+/**
+ * @brief Get the number of receive channels being captured
+ * @return Channel count, 0 when stopped
+ */
+uint8_t audioChannelCount();
+
+/**
+ * @brief Get the number of blocks dropped because the pool or a reader queue was full
+ * @return Dropped blocks since audioBegin()
+ */
+uint32_t audioDroppedBlocks();
+
+/**
+ * @brief Stop the active backend
+ */
+void audioEnd();
+
+#endif // AUDIO_HAL_H
@@ -0,0 +1,75 @@
+/**
+ * @file audioReplay.h
+ * @date 2025-10-16
+ * @brief On-device replay of a stored recording through the receive chain, for field checks.
+ *
+ * A short reference recording, for example an excerpt of a standard test
+ * track, sits in the LittleFS partition as REPLAY_FILE. A replay feeds it to
+ * receive channel 0 through audioInjectSamples() in place of the live input,
+ * as fast as the decoder tasks take it. Every port on that channel decodes
+ * it exactly as it would decode the radio, through squelch, demodulator,
+ * cascade and eye monitor. The frames are only counted, so nothing reaches
+ * the host or the digipeater. The report gives:
+ * - frames decoded per port against the expected count, PASS or FAIL on the
+ *   first port
+ * - how much faster than real time the replay ran
+ * - the decoder CPU time per port, as a share of real time and as cycles
+ *   per second of audio at RX_ACTIVE_CPU_MHZ
+ * So each unit in the field can check its firmware build and measure its
+ * decode throughput without test equipment.
+ *
+ * The file is a 16-bit PCM WAV at AUDIO_RX_SAMPLE_RATE or a whole multiple
+ * of it, which is FIR-decimated as it is read; of several channels the first
+ * is used. Put it in data/ and upload it with "pio run -t uploadfs". The
+ * expected count is what "program batch" decodes from the same file.
+ *
+ * Start a replay with a KISS SETHARDWARE frame "replay" or "replay <expected>"
+ * on port 0, answered with a SETHARDWARE frame holding the one-line report,
+ * or at boot with REPLAY_ON_BOOT. Live receive audio is dropped while the
+ * replay runs, for a few seconds at most.
+ *
+ * Compiled only when FEATURE_REPLAY is set.
+ *
+ * Functions:
+ * - audioReplayStart(): Replay REPLAY_FILE in a background task.
+ * - audioReplayCommand(): Start a replay from a SETHARDWARE command.
+ * - audioReplayBusy(): true while a replay runs.
+ * - getAudioReplayResult(): Copy the report of the last replay.
+ * - printAudioReplayResult(): Print it to Serial.
+ */
+#ifndef AUDIO_REPLAY_H
+#define AUDIO_REPLAY_H
+
+#include <Arduino.h>
+#include "audioHal.h"
+
+#define REPLAY_FILE "/replay.wav"	  // In the LittleFS partition
+#define REPLAY_CHANNEL 0			  // Receive channel the recording replaces
+#define REPLAY_READ_FRAMES 480		  // WAV frames per file read, 10 ms at 48 kHz
+#define REPLAY_TAIL_BLOCKS 50		  // Silence after the recording, for DCD to drop and cascade retries to run
+#define REPLAY_DRAIN_MS 2000		  // Longest wait for the decoders to finish the last blocks
+#define REPLAY_TASK_STACK 4096		  // LittleFS calls
+#define REPLAY_TASK_PRIORITY 2		  // Below the decoders, which set the pace
+#define REPLAY_COMMAND "replay"		  // SETHARDWARE payload, optionally followed by the expected frame count
+#define REPLAY_REPLY_MAX 96			  // Longest SETHARDWARE reply
+
+// Report of the last replay
+typedef struct
+{
+	const char *error;					// NULL if the replay ran
+	uint32_t audioMs;					// Recording plus REPLAY_TAIL_BLOCKS of silence
+	uint32_t elapsedMs;					// Wall time of the replay
+	uint32_t expected;					// Frames expected per port, 0 if not given
+	uint8_t ports;						// Ports that decoded the recording
+	uint8_t port[AUDIO_MAX_READERS];	// Their KISS port numbers
+	uint32_t frames[AUDIO_MAX_READERS]; // Frames each port decoded
+	uint64_t busyUs[AUDIO_MAX_READERS]; // Squelch and demodulator CPU time of each port
+} audio_replay_result_t;
+
+bool audioReplayStart(uint32_t expected, int8_t replyPort); // replyPort -1: report on Serial only
+bool audioReplayCommand(uint8_t port, const uint8_t *data, size_t len); // false if data is not a replay command
+bool audioReplayBusy();
+bool getAudioReplayResult(audio_replay_result_t *result); // false before the first replay has finished
+void printAudioReplayResult();
+
+#endif // AUDIO_REPLAY_H
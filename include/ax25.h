@@ -0,0 +1,87 @@
+/**
+ * @file ax25.h
+ * @date 2025-09-22
+ * @brief AX.25 UI frame parser and TNC2 monitor formatter.
+ *
+ * Checks that a frame from the air or from the host is a well-formed AX.25
+ * frame: shifted callsign characters, SSID, the address extension bit, at most
+ * AX25_MAX_DIGIS digipeaters and a control/PID pair. The parsed frame points
+ * into the caller's buffer; nothing is copied or allocated. The code has no
+ * Arduino dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - ax25Parse(): Validate and split a frame (without FCS) into its fields.
+ * - ax25Format(): Print a parsed frame as a TNC2 monitor line, SRC>DST,DIGI*:info.
+ * - ax25StatusString(): Describe a parse result.
+ */
+#ifndef AX25_H
+#define AX25_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AX25_ADDRESS_LEN 7	 // 6 shifted callsign characters + SSID byte
+#define AX25_MAX_DIGIS 8	 // Digipeater addresses after source
+#define AX25_MAX_INFO 256	 // Default N1 information field length
+#define AX25_CONTROL_UI 0x03 // Unnumbered information, used by APRS
+#define AX25_PID_NONE 0xF0	 // No layer 3
+
+typedef struct
+{
+	char call[7];  // Callsign, NUL terminated, trailing spaces removed
+	uint8_t ssid;  // 0-15
+	bool hBit;	   // Command/response bit, or has-been-repeated for digipeaters
+} ax25_address_t;
+
+typedef struct
+{
+	ax25_address_t dest;
+	ax25_address_t source;
+	ax25_address_t digis[AX25_MAX_DIGIS];
+	uint8_t digiCount;
+	uint8_t control;
+	int16_t pid;		 // -1 for frames without a PID (S and most U frames)
+	const uint8_t *info; // Points into the parsed buffer
+	size_t infoLength;
+} ax25_frame_t;
+
+// Parse results
+typedef enum
+{
+	AX25_OK = 0,
+	AX25_ERROR_SHORT,		  // Ends inside the address field or before control
+	AX25_ERROR_ADDRESS,		  // Callsign character outside A-Z, 0-9 or trailing space
+	AX25_ERROR_TOO_MANY_DIGIS, // Extension bit not set within AX25_MAX_DIGIS digipeaters
+	AX25_ERROR_INFO_LENGTH	  // Information field longer than AX25_MAX_INFO
+} ax25_status_t;
+
+/**
+ * @brief Validate a frame and split it into its fields
+ * @param frame Frame bytes without FCS
+ * @param len Number of bytes
+ * @param out Parsed fields, valid while frame is
+ * @return AX25_OK, or the first problem found
+ */
+ax25_status_t ax25Parse(const uint8_t *frame, size_t len, ax25_frame_t *out);
+
+/**
+ * @brief Print a parsed frame as a TNC2 monitor line
+ *
+ * Non-printable information bytes are written as <0xNN>. The output is always
+ * NUL terminated and truncated to fit.
+ *
+ * @param f Parsed frame
+ * @param out Output buffer
+ * @param size Size of out
+ * @return Length the full line would have, like snprintf()
+ */
+size_t ax25Format(const ax25_frame_t *f, char *out, size_t size);
+
+/**
+ * @brief Describe a parse result
+ * @param status Parse result
+ * @return Static description
+ */
+const char *ax25StatusString(ax25_status_t status);
+
+#endif // AX25_H
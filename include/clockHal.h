@@ -0,0 +1,99 @@
+/**
+ * @file clockHal.h
+ * @date 2025-09-30
+ * @brief Time base and one-shot timers for the timing-sensitive TNC logic.
+ *
+ * Channel access, TXDELAY and protocol timers read the time and schedule work
+ * through this interface instead of millis()/micros(), so the same code runs on
+ * the ESP32 and in host simulations:
+ *
+ * - ESP32 (ARDUINO defined): time is esp_timer_get_time(); due timers run from
+ *   clockRunTimers(), called in loop(). Timers belong to the loop task.
+ * - Host: time is virtual and only moves in clockAdvance(), which runs every
+ *   timer in due-time order and jumps straight to the next one. Hours of channel
+ *   activity take seconds, and a run is reproduced exactly from its inputs.
+ *
+ * Timers that fall due at the same time run in the order they were started. A
+ * timer may restart itself or others from its callback.
+ *
+ * Functions:
+ * - clockMicros() / clockMillis(): Current time since boot (or since clockReset() on the host).
+ * - clockTimerInit(): Bind a timer to its callback.
+ * - clockTimerStart() / clockTimerStop() / clockTimerActive(): Arm, cancel and query a one-shot timer.
+ * - clockRunTimers(): Run every timer that is due now.
+ * - clockAdvance() / clockReset(): Host only, move virtual time forward / back to zero.
+ */
+#ifndef CLOCK_HAL_H
+#define CLOCK_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*clock_timer_cb)(void *ctx);
+
+typedef struct clock_timer
+{
+	uint64_t dueUs;
+	clock_timer_cb fn;
+	void *ctx;
+	struct clock_timer *next; // Pending list, sorted by due time
+	bool active;
+} clock_timer_t;
+
+/**
+ * @brief Current time
+ * @return Microseconds since boot, or since clockReset() on the host
+ */
+uint64_t clockMicros();
+
+/**
+ * @brief Current time in milliseconds, wraps after 49 days like millis()
+ */
+uint32_t clockMillis();
+
+/**
+ * @brief Bind a timer to its callback, leaving it stopped
+ * @param t Timer
+ * @param fn Called when the timer falls due
+ * @param ctx Passed back to fn
+ */
+void clockTimerInit(clock_timer_t *t, clock_timer_cb fn, void *ctx);
+
+/**
+ * @brief Arm a one-shot timer, replacing any pending expiry
+ * @param t Timer set up with clockTimerInit()
+ * @param delayUs Time from now until the callback runs
+ */
+void clockTimerStart(clock_timer_t *t, uint64_t delayUs);
+
+/**
+ * @brief Cancel a timer; does nothing if it is not pending
+ */
+void clockTimerStop(clock_timer_t *t);
+
+/**
+ * @brief true while a timer is pending
+ */
+bool clockTimerActive(const clock_timer_t *t);
+
+/**
+ * @brief Run every timer that is due, including ones started by the callbacks with no delay
+ * @return Number of callbacks run
+ */
+size_t clockRunTimers();
+
+#ifndef ARDUINO
+/**
+ * @brief Move virtual time to untilUs, running each timer at its due time on the way
+ * @param untilUs Absolute virtual time; earlier times are ignored
+ * @return Number of callbacks run
+ */
+size_t clockAdvance(uint64_t untilUs);
+
+/**
+ * @brief Drop all pending timers and set virtual time back to zero
+ */
+void clockReset();
+#endif
+
+#endif // CLOCK_HAL_H
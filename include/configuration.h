@@ -2,14 +2,31 @@
  * @file configuration.h
  * @brief Configuration constants for ESP32 KISS TNC project.
  * @date 2025-08-26
- * This header defines Bluetooth device name, and pin assignments
+ * This header defines the build profile, Bluetooth device name, and pin assignments
  * for the ESP32-based KISS TNC (Terminal Node Controller).
  *
+ * Build profile:
+ * - FEATURE_*: 1 compiles a subsystem in, 0 leaves it out of the image entirely.
+ *   The defaults are the full build; platformio.ini profiles override them with -D.
+ * - BOOT_SERIAL_DELAY_MS: Wait for a serial monitor at boot, 0 for headless builds.
+ * - TX_TWIST_DB: Mark level relative to space of the transmitted tones at boot.
+ * - REPLAY_*: Expected frames of the stored self-test recording, and whether to replay it at boot.
+ * - DIGI_*: Digipeater callsign and WIDEn-N hop limit when FEATURE_DIGIPEATER is 1.
+ * - RX_FRONT_END: Demodulator front end, trading sensitivity for CPU time.
+ * - RX_DECODE_CASCADE: Retry missed bursts with heavier decoder variants.
+ * - RX_SHED_ON_OVERLOAD: Drop the cascade's replay variants while the decoders miss deadlines.
+ * - RX_MODES: Modem profiles decoded at once on every receive channel.
+ * - RX_SQUELCH_MODE: Whether the energy squelch gates the demodulators and lowers the CPU clock.
+ * - RX_EYE_MONITOR: Eye diagram and bit timing per port, served at GET /eye.
+ * - FRAME_TRACE_LOG: Print every frame's stage timestamps to Serial.
+ *
  * Pin Definitions:
  * - PTT_PIN: GPIO pin used for Push-to-Talk (PTT) control.
  * - PTT_LED: GPIO pin connected to an LED indicating PTT status.
  * - TX_PIN:  Uses GPIO25 set as DAC_CHANNEL_1 in afskEncode.cpp for AFSK audio output.
  * - RX_PIN:  GPIO pin for receiving audio from the radio.
+ * - RX_PIN_2, RX_CHANNEL_COUNT: Second radio port (KISS port 1) on another ADC1 input.
+ * - I2S_*_PIN, CODEC_*_PIN: External codec wiring when AUDIO_BACKEND is AUDIO_BACKEND_I2S_CODEC.
  *
  * @note There is no matching .cpp file for this header
  *	Add the following to platformio.ini
@@ -21,6 +38,51 @@
  */
 #include <Arduino.h> // for IPAddress
 
+// Build profile: subsystems compiled into the image
+#ifndef FEATURE_BT_CLASSIC
+#define FEATURE_BT_CLASSIC 1 // KISS over Bluetooth serial (SPP)
+#endif
+#ifndef FEATURE_BLE
+#define FEATURE_BLE 0 // KISS over BLE, not implemented yet; 0 also frees the BLE controller memory
+#endif
+#ifndef FEATURE_WIFI
+#define FEATURE_WIFI 1 // Station mode with the static IP below
+#endif
+#ifndef FEATURE_OTA
+#define FEATURE_OTA 1 // ArduinoOTA updates, needs WiFi
+#endif
+#ifndef FEATURE_WEB_UI
+#define FEATURE_WEB_UI 0 // Status and configuration pages, not implemented yet
+#endif
+#ifndef FEATURE_DIGIPEATER
+#define FEATURE_DIGIPEATER 0 // Repeat frames for DIGI_CALL and WIDEn-N
+#endif
+#ifndef FEATURE_REPLAY
+#define FEATURE_REPLAY 1 // Decoder self-test from a recording in LittleFS (audioReplay.h)
+#endif
+#ifndef BOOT_SERIAL_DELAY_MS
+#define BOOT_SERIAL_DELAY_MS 1000 // Time for a serial monitor to attach before the boot messages
+#endif
+
+static_assert(FEATURE_BT_CLASSIC == 0 || FEATURE_BT_CLASSIC == 1, "FEATURE_BT_CLASSIC must be 0 or 1");
+static_assert(FEATURE_BLE == 0 || FEATURE_BLE == 1, "FEATURE_BLE must be 0 or 1");
+static_assert(FEATURE_WIFI == 0 || FEATURE_WIFI == 1, "FEATURE_WIFI must be 0 or 1");
+static_assert(FEATURE_OTA == 0 || FEATURE_OTA == 1, "FEATURE_OTA must be 0 or 1");
+static_assert(FEATURE_WEB_UI == 0 || FEATURE_WEB_UI == 1, "FEATURE_WEB_UI must be 0 or 1");
+static_assert(FEATURE_DIGIPEATER == 0 || FEATURE_DIGIPEATER == 1, "FEATURE_DIGIPEATER must be 0 or 1");
+static_assert(FEATURE_REPLAY == 0 || FEATURE_REPLAY == 1, "FEATURE_REPLAY must be 0 or 1");
+static_assert(!FEATURE_OTA || FEATURE_WIFI, "FEATURE_OTA needs FEATURE_WIFI");
+static_assert(!FEATURE_WEB_UI || FEATURE_WIFI, "FEATURE_WEB_UI needs FEATURE_WIFI");
+static_assert(!FEATURE_BLE, "FEATURE_BLE: KISS over BLE is not implemented yet");
+static_assert(!FEATURE_WEB_UI, "FEATURE_WEB_UI: the web UI is not implemented yet");
+static_assert(FEATURE_BT_CLASSIC || FEATURE_BLE || FEATURE_DIGIPEATER,
+			  "Without a host link or the digipeater nothing would use the radio");
+
+// Digipeater identity, used when FEATURE_DIGIPEATER is 1
+#define DIGI_CALL "N0CALL" // Your callsign, A-Z and 0-9
+#define DIGI_SSID 0
+#define DIGI_MAX_HOPS 2 // Service WIDE1-1 and WIDE2-N; 0 answers to DIGI_CALL only
+
 // Bluetooth device name for the KISS TNC
 #define BT_NAME "ESP32 KISS TNC"
 
@@ -35,10 +97,112 @@ inline const IPAddress SUBNET(255, 255, 255, 0);
 
 // Pin definitions for transceiver interface
 #define RX_PIN 34	// Audio from radio
+#define RX_PIN_2 39 // Audio from the second radio, must also be an ADC1 pin (32-39)
+#define RX_CHANNEL_COUNT 1 // Radio ports to decode: 1, or 2 with RX_PIN_2 wired
 #define TX_PIN 25	// AFSK audio output pin
 #define PTT_PIN 4	// Push-to-Talk control pin
 #ifndef LED_BUILTIN // LED to indicate PTT status
 #define PTT_LED 2	// Use GPIO2 if LED_BUILTIN is not defined
 #else
 #define PTT_LED LED_BUILTIN
-#endif
\ No newline at end of file
+#endif
+
+// Audio hardware: AUDIO_BACKEND_INTERNAL (ADC/DAC) or AUDIO_BACKEND_I2S_CODEC
+#define AUDIO_BACKEND AUDIO_BACKEND_INTERNAL
+#define AUDIO_CODEC CODEC_WM8960 // CODEC_WM8960 or CODEC_ES8388
+
+// Demodulator front end. "program demod" with its defaults measures the SNR
+// for 10% PER and the host time per sample of each:
+// - AFSK_FRONT_END_GOERTZEL: 10 dB, the best sensitivity.
+// - AFSK_FRONT_END_DELAY_LINE: 12 dB (2 dB worse) at 0.5 to 0.6 times the CPU.
+// - AFSK_FRONT_END_ZERO_CROSSING: 14 dB (4 dB worse) at 0.9 to 1.0 times the CPU,
+//   more than the delay line. It has no per-sample multiply but divides at every
+//   zero crossing, so it only pays off on a core without a fast multiplier.
+#ifndef RX_FRONT_END
+#define RX_FRONT_END AFSK_FRONT_END_GOERTZEL
+#endif
+
+// Decode cascade: 1 keeps RX_FRONT_END as the primary and retries the bursts
+// it missed with bit-repair, Goertzel and shifted-slicer variants replayed
+// from RX_CASCADE_HISTORY_MS of audio (2 bytes per sample per port).
+// On the host, delay-line plus the cascade gains 2 dB over Goertzel alone for about
+// 15% more CPU; see "program demod".
+#ifndef RX_DECODE_CASCADE
+#define RX_DECODE_CASCADE 0
+#endif
+#define RX_CASCADE_HISTORY_MS 2000 // An APRS frame of up to 150 bytes, the lead and the replays
+
+// With the cascade, 1 sheds its replay variants while the decoders fall
+// behind: a block demodulated past RX_DEADLINE_US, or audio dropped before a
+// decoder saw it (deadlineMonitor.h). Bit-repair, which replays no audio,
+// stays on; the variants come back after RX_SHED_HOLD_MS on time.
+#ifndef RX_SHED_ON_OVERLOAD
+#define RX_SHED_ON_OVERLOAD 1
+#endif
+
+// Modem profiles decoded on every receive channel, RX_MODE_* bits from
+// afskDecode.h. (RX_MODE_1200 | RX_MODE_300) gives a cross-band gateway both
+// on one audio input, each on its own KISS ports; transmit stays on port 0.
+// Channels times profiles is at most AUDIO_MAX_READERS.
+#ifndef RX_MODES
+#define RX_MODES RX_MODE_1200
+#endif
+
+// Receive squelch at boot (setReceiveSquelchMode()). RX_SQUELCH_SHADOW
+// demodulates every block at full clock and only counts the frames gating
+// would have missed, shown by the receive statistics. RX_SQUELCH_GATED skips
+// the demodulators and idles at RX_IDLE_CPU_MHZ while every port is quiet, for
+// solar sites once SHADOW shows no missed preambles there. Gate only behind a
+// closed radio squelch: open-squelch hiss is as loud as a carrier, so the
+// noise floor tracks it and the energy detector never opens.
+// RX_SQUELCH_OFF skips the energy detector as well.
+#ifndef RX_SQUELCH_MODE
+#define RX_SQUELCH_MODE RX_SQUELCH_SHADOW
+#endif
+
+// Eye diagram and bit timing of every receive port, about 2.2 KB of RAM per
+// port. Every sample while the PLL is locked costs float work: "program demod"
+// measures 4 to 6 ns/sample on the host, about a quarter more CPU on Goertzel
+// and two fifths more on the delay line, so it is off by default. Turn it on
+// to tune a site. The receive statistics print its summary; with FEATURE_OTA,
+// GET /eye?port=N[&format=bmp][&reset=1] on OTA_HTTP_PORT returns it as JSON
+// or an image.
+#ifndef RX_EYE_MONITOR
+#define RX_EYE_MONITOR 0
+#endif
+
+// Transmit twist at boot, the mark level relative to space in dB. 0 suits a
+// radio's mic input, which pre-emphasizes; -5.3 (space louder) emulates the
+// pre-emphasis on a flat data port. The SETHARDWARE command "twist <dB>",
+// "twist flat" or "twist preemph" changes it at run time, "twist" reports it.
+#ifndef TX_TWIST_DB
+#define TX_TWIST_DB 0.0f
+#endif
+
+// Self-test replay of data/replay.wav from LittleFS (FEATURE_REPLAY): frames
+// the first port on channel 0 must decode for a PASS, 0 to report without a
+// verdict ("program batch" on the same file gives the count). 1 replays it at
+// boot; otherwise send the SETHARDWARE command "replay" over KISS.
+#ifndef REPLAY_EXPECTED_FRAMES
+#define REPLAY_EXPECTED_FRAMES 0
+#endif
+#ifndef REPLAY_ON_BOOT
+#define REPLAY_ON_BOOT 0
+#endif
+
+// Every frame is traced from where it enters the TNC to where it leaves, and
+// the latency of each stage goes into the receive and transmit statistics.
+// 1 also prints one line per frame with the time spent in each stage; the
+// Serial write adds to the decoder's own latency, so leave it off in service.
+#ifndef FRAME_TRACE_LOG
+#define FRAME_TRACE_LOG 0
+#endif
+
+// Pin definitions for an external I2S codec
+#define I2S_MCLK_PIN 0	 // Master clock, GPIO0 is the only MCLK output on the ESP32
+#define I2S_BCK_PIN 14	 // Bit clock
+#define I2S_WS_PIN 13	 // Word select (LRCK)
+#define I2S_DOUT_PIN 27	 // ESP32 to codec DAC
+#define I2S_DIN_PIN 35	 // Codec ADC to ESP32
+#define CODEC_SDA_PIN 21 // Codec control
+#define CODEC_SCL_PIN 22 // Codec control
\ No newline at end of file
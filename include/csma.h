@@ -0,0 +1,99 @@
+/**
+ * @file csma.h
+ * @date 2025-09-30
+ * @brief p-persistent CSMA channel access with the KISS timing parameters.
+ *
+ * Implements the access procedure of the KISS specification: when a frame is
+ * ready, wait while the channel is busy (DCD); once it is clear, transmit with
+ * probability (persist + 1) / 256, otherwise wait one slot time and repeat.
+ * Full duplex skips the procedure. TXDELAY is the keyup time before the first
+ * flag. All waiting runs on clockHal timers, so the same code is used on the
+ * ESP32 and in virtual-time simulations. No Arduino dependency.
+ *
+ * Functions:
+ * - csmaInit(): Set callbacks, seed and the default parameters.
+ * - csmaSetParam(): Apply a KISS TXDELAY, PERSIST, SLOTTIME, TXTAIL or FULLDUPLEX command.
+ * - csmaRequest(): Ask for the channel; transmit() is called once access is granted.
+ * - csmaCancel(): Withdraw a pending request.
+ * - csmaTxDelayUs(): Current TXDELAY in microseconds.
+ */
+#ifndef CSMA_H
+#define CSMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "clockHal.h"
+
+// Defaults in KISS units: 10 ms steps, persist 0-255
+#define CSMA_DEFAULT_TXDELAY 30	 // 300 ms keyup
+#define CSMA_DEFAULT_PERSIST 63	 // p = 0.25
+#define CSMA_DEFAULT_SLOTTIME 10 // 100 ms
+#define CSMA_DEFAULT_TXTAIL 0
+#define CSMA_UNIT_US 10000		 // One KISS time unit
+
+// true while another station is heard on the channel
+typedef bool (*csma_busy_cb)(void *ctx);
+
+// Access granted: start the transmission now
+typedef void (*csma_transmit_cb)(void *ctx);
+
+typedef struct
+{
+	uint8_t txDelay;  // KISS units
+	uint8_t persist;
+	uint8_t slotTime; // KISS units
+	uint8_t txTail;	  // KISS units, kept for the host; the framer sends fixed tail flags
+	bool fullDuplex;
+	bool pending;	  // A request is waiting for the channel
+	uint32_t rng;	  // xorshift32 state for the persistence draw
+	clock_timer_t slot;
+	csma_busy_cb busy;
+	csma_transmit_cb transmit;
+	void *ctx;
+	uint64_t requestedUs;	// clockMicros() of the pending request
+	uint32_t grants;		// Requests that reached transmit()
+	uint32_t busySlots;		// Slots spent waiting for DCD to drop
+	uint32_t deferredSlots; // Slots lost to the persistence draw
+	uint64_t accessDelayUs; // Total request-to-grant time
+} csma_t;
+
+/**
+ * @brief Set callbacks, seed and the default parameters
+ * @param c Channel access state
+ * @param busy Channel busy test, NULL for a channel that is never busy
+ * @param transmit Called when access is granted
+ * @param ctx Passed back to both callbacks
+ * @param seed Persistence draw seed; 0 is replaced by a fixed non-zero value
+ */
+void csmaInit(csma_t *c, csma_busy_cb busy, csma_transmit_cb transmit, void *ctx, uint32_t seed);
+
+/**
+ * @brief Apply a KISS parameter command
+ * @param c Channel access state
+ * @param command KISS_CMD_TXDELAY, _PERSIST, _SLOTTIME, _TXTAIL or _FULLDUPLEX
+ * @param value Command argument
+ * @return false if the command is not a channel access parameter
+ */
+bool csmaSetParam(csma_t *c, uint8_t command, uint8_t value);
+
+/**
+ * @brief Ask for the channel; transmit() is called once access is granted
+ *
+ * The first check runs from the next clockRunTimers(). A request while one is
+ * pending is ignored; call again from transmit() for the next frame.
+ */
+void csmaRequest(csma_t *c);
+
+/**
+ * @brief Withdraw a pending request
+ */
+void csmaCancel(csma_t *c);
+
+/**
+ * @brief Current TXDELAY
+ * @return Keyup time before the first flag, in microseconds
+ */
+uint32_t csmaTxDelayUs(const csma_t *c);
+
+#endif // CSMA_H
@@ -0,0 +1,84 @@
+/**
+ * @file deadlineMonitor.h
+ * @date 2025-10-18
+ * @brief Deadline and overrun accounting for the real-time stages of the audio pipeline.
+ *
+ * A missed deadline in the modem does not fail loudly. The demodulator falls
+ * behind the sample clock and blocks are dropped, or the modulator starves
+ * the output and the tone breaks up; either way only garbage shows. Each
+ * real-time stage declares its deadline with deadlineDeclare() and reports to
+ * this module:
+ * - capture: audio lost before a decoder saw it. The ADC DMA ring overflowed
+ *   or the block pool or a decoder's queue was full. Events, no deadline.
+ * - demod: a block demodulated more than RX_DEADLINE_US after its capture.
+ * - tx isr: the encoder timer ISR ran more than half a sample period of the
+ *   higher tone late, checked once per transmission.
+ * - tx output: rendering the next block took longer than the codec's DMA
+ *   buffers last, so the output ran dry (underrun).
+ * - queue: the transmit queue or the digipeater queue was full. Events.
+ * Each stage counts its checks and misses and keeps the DEADLINE_WORST worst
+ * misses with their time and context, such as the port or block.
+ *
+ * deadlineMissedSince() lets a stage react to overload; the decoders use it to
+ * shed cascade variants (RX_SHED_ON_OVERLOAD).
+ *
+ * Safe to call from any task on either core, not from an ISR.
+ *
+ * Functions:
+ * - deadlineDeclare(): Set the deadline of a stage.
+ * - deadlineCheck(): Count a timed run of a stage, a miss if it took too long.
+ * - deadlineMiss(): Count an overrun, underrun or full queue.
+ * - deadlineMissedSince(): Misses of a stage since a count taken earlier.
+ * - getDeadlineStats(): Copy the counters and worst misses.
+ * - printDeadlineStats(): Print them to Serial.
+ */
+#ifndef DEADLINE_MONITOR_H
+#define DEADLINE_MONITOR_H
+
+#include <Arduino.h>
+
+#define DEADLINE_WORST 4 // Worst misses kept per stage
+
+typedef enum
+{
+	DEADLINE_CAPTURE = 0, // Audio dropped between the ADC or codec and the decoders
+	DEADLINE_DEMOD,		  // Capture to demodulated, per block and port
+	DEADLINE_TX_ISR,	  // Encoder timer ISR service, per transmission
+	DEADLINE_TX_OUTPUT,	  // Gap between block output writes
+	DEADLINE_QUEUE,		  // Frame queues full
+	DEADLINE_STAGES
+} deadline_stage_t;
+
+// One missed deadline
+typedef struct
+{
+	uint32_t lateUs;	// Past the deadline, 0 for an event
+	uint32_t atMs;		// millis() of the miss
+	const char *source; // What missed, for example "pool" or "port"
+	uint32_t value;		// Its number: port, channel, block, queue length...
+} deadline_miss_t;
+
+typedef struct
+{
+	const char *name;
+	uint32_t deadlineUs; // 0: event stage, only misses are reported
+	uint32_t checks;
+	uint32_t misses;
+	uint32_t worstUs; // Longest run checked, on time or not
+	uint8_t worstCount;
+	deadline_miss_t worst[DEADLINE_WORST]; // Most late first, the latest first among equals
+} deadline_stage_stats_t;
+
+typedef struct
+{
+	deadline_stage_stats_t stages[DEADLINE_STAGES];
+} deadline_stats_t;
+
+void deadlineDeclare(deadline_stage_t stage, uint32_t deadlineUs); // Call once by the stage's owner
+bool deadlineCheck(deadline_stage_t stage, uint32_t elapsedUs, const char *source, uint32_t value); // false: missed
+void deadlineMiss(deadline_stage_t stage, uint32_t lateUs, const char *source, uint32_t value);
+uint32_t deadlineMissedSince(deadline_stage_t stage, uint32_t *seen); // Misses since *seen, which is updated
+void getDeadlineStats(deadline_stats_t *stats);
+void printDeadlineStats(); // Counters, then the worst misses of each stage that had any
+
+#endif // DEADLINE_MONITOR_H
@@ -0,0 +1,195 @@
+/**
+ * @file decodeCascade.h
+ * @date 2025-10-14
+ * @brief Tiered receive: a cheap primary demodulator, heavier decoder variants only for bursts it missed.
+ *
+ * The primary afskDemod (any front end, usually a cheap one) runs on every
+ * sample, and the audio goes into a history ring. A burst is the time the
+ * primary's DCD is up, from CASCADE_LEAD_MS before it rises to CASCADE_HANG_MS
+ * after it falls. A burst in which the primary decoded nothing, or saw an FCS
+ * error, has failed. The variants then retry it, one at a time, until one
+ * finds a frame the primary did not deliver:
+ * - bit-repair: hdlcRepair() on the primary's bad frames, kept only if the
+ *   result parses as AX.25. Costs no audio processing.
+ * - goertzel: replay (retro-decode) the burst from the history through the
+ *   Goertzel front end; skipped when that is the primary
+ * - slicer-mark, slicer-space: the same with the mark/space decision moved
+ *   toward one tone (afskDemodSetSlicer()), for audio with twist
+ * Replays run at up to CASCADE_REPLAY_SPEED times real time, spread over the
+ * following cascadeProcess() calls, so one call never costs more than that
+ * many samples of Goertzel. A replay the ring overwrites is abandoned.
+ *
+ * Order: every variant has a score of recent success, raised by a success and
+ * decayed by every try. Scores are kept for the channel and for the last
+ * CASCADE_STATIONS stations (source address). A bad frame from the burst
+ * usually still has a readable source address, which selects the station's
+ * scores; otherwise the channel's are used.
+ *
+ * Under CPU overload the caller can shed variants with cascadeSetVariants(),
+ * for example keeping only bit-repair, which replays no audio; a retry whose
+ * variant is shed stops at once.
+ *
+ * The code has no Arduino dependency so it can also be built for the host,
+ * where "program demod" reports its PER and CPU time next to the single front
+ * ends and all variants running at once.
+ *
+ * Functions:
+ * - cascadeInit(): Set up the primary demodulator, the history and the variants.
+ * - cascadeProcess(): Demodulate a block, track bursts and advance a retry.
+ * - cascadeBusy(): A burst or retry is in progress and needs more blocks.
+ * - cascadeSetVariants(): Enable and disable variants, to shed load.
+ * - cascadeVariantName(): Short name of a variant.
+ */
+#ifndef DECODE_CASCADE_H
+#define DECODE_CASCADE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "afskDemod.h"
+#include "ax25.h"
+#include "hdlc.h"
+
+#define CASCADE_LEAD_MS 100		  // History replayed before DCD rose, for the variant to lock in
+#define CASCADE_HANG_MS 30		  // DCD down this long ends a burst
+#define CASCADE_REPLAY_SPEED 16	  // Replay samples per input sample while retrying
+#define CASCADE_BAD_FRAMES 2	  // Bad frames kept per burst for bit-repair
+#define CASCADE_BURST_FRAMES 8	  // Delivered frames remembered per burst, so variants drop them
+#define CASCADE_STATIONS 16		  // Stations with their own variant order
+#define CASCADE_SLICER_LEVEL 0.3f // Slicer variants' decision level, toward mark or space
+#define CASCADE_SCORE_START 128	  // Score of a variant nothing is known about
+#define CASCADE_SCORE_GAIN 32	  // Added by a success, after the decay by 1/8
+
+typedef enum
+{
+	CASCADE_BIT_REPAIR = 0,
+	CASCADE_GOERTZEL,
+	CASCADE_SLICER_MARK,  // Favours mark, for a weak space tone
+	CASCADE_SLICER_SPACE, // Favours space, for a weak mark tone
+	CASCADE_VARIANTS
+} cascade_variant_t;
+
+#define CASCADE_ALL_VARIANTS ((1u << CASCADE_VARIANTS) - 1) // cascadeSetVariants() mask
+
+typedef struct
+{
+	uint32_t bursts;
+	uint32_t failedBursts;
+	uint32_t retries;
+	uint32_t skipped;	// Failed bursts not retried, another retry was running
+	uint32_t overruns;	// Replays abandoned, the history ring overtook them
+	uint32_t shed;		// Retries stopped, cascadeSetVariants() disabled their variant
+	uint32_t recovered; // Frames delivered by variants
+	uint64_t primarySamples;
+	uint64_t replaySamples; // Samples through the variants, the extra CPU
+	uint32_t tries[CASCADE_VARIANTS];
+	uint32_t successes[CASCADE_VARIANTS];
+} cascade_stats_t;
+
+typedef struct
+{
+	uint8_t address[AX25_ADDRESS_LEN]; // Source address as on the air
+	uint8_t score[CASCADE_VARIANTS];
+	uint32_t lastUsed;
+	bool used;
+} cascade_station_t;
+
+typedef struct
+{
+	uint64_t start; // History sample numbers
+	uint64_t end;
+	uint32_t frames; // Delivered by the primary
+	uint32_t errors; // FCS errors in the primary
+	uint16_t delivered[CASCADE_BURST_FRAMES]; // FCS of the frames delivered
+	uint8_t deliveredCount;
+	uint8_t badCount;
+	uint16_t badLength[CASCADE_BAD_FRAMES];
+	uint8_t bad[CASCADE_BAD_FRAMES][HDLC_MAX_FRAME];
+} cascade_burst_t;
+
+typedef struct
+{
+	afsk_demod_t *primary; // Caller's, configured by cascadeInit()
+	afsk_demod_t replay;   // Variant being replayed
+	afsk_profile_t profile;
+	uint8_t port;
+	int16_t *history;
+	size_t historyLength;
+	uint64_t written; // Samples written to the history since init
+	uint32_t leadSamples;
+	uint32_t hangSamples;
+
+	bool inBurst;
+	uint32_t quietSamples; // Since DCD fell in the current burst
+	cascade_burst_t burst;
+
+	bool retrying;
+	cascade_burst_t retry;
+	uint64_t retryPos;
+	int8_t retryStation; // Index into stations, -1 for the channel scores
+	uint8_t order[CASCADE_VARIANTS];
+	uint8_t orderCount;
+	uint8_t orderPos;
+	uint32_t retryFound; // New frames from the current variant
+
+	uint8_t variants;				 // Enabled variants, bit per cascade_variant_t
+	uint8_t score[CASCADE_VARIANTS]; // Channel scores
+	cascade_station_t stations[CASCADE_STATIONS];
+	uint32_t stationClock;
+
+	cascade_stats_t stats;
+	afsk_frame_cb onFrame;
+	void *ctx;
+} decode_cascade_t;
+
+/**
+ * @brief Set up a cascade
+ * @param c Cascade state
+ * @param primary Demodulator to run on every sample, initialized here
+ * @param profile Primary's profile; the replay variants use its tones with the Goertzel front end
+ * @param port KISS port number passed to onFrame
+ * @param onFrame Callback for decoded frames from the primary and the variants
+ * @param ctx Passed back to onFrame
+ * @param history Audio ring, at least a burst plus CASCADE_LEAD_MS and the replay time
+ * @param historyLength Samples in history
+ * @return false if a demodulator rejects the profile or the history is shorter than one bit
+ */
+bool cascadeInit(decode_cascade_t *c, afsk_demod_t *primary, const afsk_profile_t *profile, uint8_t port,
+				 afsk_frame_cb onFrame, void *ctx, int16_t *history, size_t historyLength);
+
+/**
+ * @brief Demodulate a block with the primary and advance any retry
+ * @param c Cascade state
+ * @param samples Signed 16-bit samples at profile.sampleRate
+ * @param count Number of samples, at most historyLength
+ */
+void cascadeProcess(decode_cascade_t *c, const int16_t *samples, size_t count);
+
+/**
+ * @brief Check whether the cascade still needs blocks to finish a burst or a retry
+ *
+ * A squelch that skips the demodulator should keep feeding it while this is true.
+ *
+ * @param c Cascade state
+ * @return true during a burst or a retry
+ */
+bool cascadeBusy(const decode_cascade_t *c);
+
+/**
+ * @brief Enable and disable variants, for example to shed load
+ *
+ * Disabled variants are left out of new retries and of the rest of the
+ * current one; the current retry stops if its variant is disabled.
+ *
+ * @param c Cascade state
+ * @param mask Bit (1 << variant) per enabled variant, CASCADE_ALL_VARIANTS after cascadeInit()
+ */
+void cascadeSetVariants(decode_cascade_t *c, uint8_t mask);
+
+/**
+ * @brief Get the short name of a variant
+ * @param variant Variant
+ * @return "bit-repair", "goertzel", "slicer-mark", "slicer-space" or "unknown"
+ */
+const char *cascadeVariantName(cascade_variant_t variant);
+
+#endif // DECODE_CASCADE_H
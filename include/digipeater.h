@@ -0,0 +1,72 @@
+/**
+ * @file digipeater.h
+ * @date 2025-10-06
+ * @brief APRS digipeater path handling: own callsign and WIDEn-N with duplicate suppression.
+ *
+ * Decides whether a frame heard on the air should be repeated and rewrites its
+ * path. The first unused digipeater address is checked. If it is our own
+ * callsign, it is marked as used. If it is WIDEn-N with n up to maxHops, N is
+ * decremented and our callsign is inserted in front of it, already marked as
+ * used, so the path keeps a trace; a hop whose N reaches 0 is marked as used.
+ * The same frame (destination, source and content, ignoring the path) is
+ * repeated at most once per DIGI_DUPE_MS, and our own frames are never
+ * repeated. Time comes from clockHal, and there is no Arduino dependency, so
+ * the host simulators use the same rules.
+ *
+ * Functions:
+ * - digiInit(): Set the digipeater callsign and the WIDEn-N hop limit.
+ * - digiProcess(): Check a received frame and build the frame to repeat, if any.
+ */
+#ifndef DIGIPEATER_H
+#define DIGIPEATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ax25.h"
+
+#define DIGI_DUPE_MS 30000 // A frame is repeated at most once in this time
+#define DIGI_DUPE_SLOTS 16 // Frames remembered for duplicate suppression
+#define DIGI_MAX_GROWTH AX25_ADDRESS_LEN // A repeated frame is at most this much longer
+
+typedef struct
+{
+	uint32_t hash; // Destination, source and everything after the path
+	uint32_t atMs; // clockMillis() when repeated
+} digi_seen_t;
+
+typedef struct
+{
+	uint8_t call[AX25_ADDRESS_LEN]; // Our address field, shifted, with the H bit set
+	ax25_address_t address;
+	uint8_t maxHops; // Largest n of WIDEn-N to service, 0 for own callsign only
+	digi_seen_t seen[DIGI_DUPE_SLOTS];
+	uint8_t nextSeen;
+	uint8_t seenCount; // Slots filled so far
+	uint32_t repeated;
+	uint32_t duplicates;
+	uint32_t ignored; // Valid frames that are not for us
+} digi_t;
+
+/**
+ * @brief Set the digipeater callsign and the WIDEn-N hop limit
+ * @param d Digipeater state
+ * @param call Callsign, 1-6 characters A-Z and 0-9
+ * @param ssid 0-15
+ * @param maxHops Largest n of WIDEn-N to service, up to 7; 0 for own callsign only
+ * @return false if the callsign or SSID is invalid
+ */
+bool digiInit(digi_t *d, const char *call, uint8_t ssid, uint8_t maxHops);
+
+/**
+ * @brief Check a received frame and build the frame to repeat, if any
+ * @param d Digipeater state
+ * @param frame Frame without FCS
+ * @param len Frame length
+ * @param out Rewritten frame
+ * @param outSize Size of out, len + DIGI_MAX_GROWTH always fits
+ * @return Length of the frame to transmit, 0 if it is not repeated
+ */
+size_t digiProcess(digi_t *d, const uint8_t *frame, size_t len, uint8_t *out, size_t outSize);
+
+#endif // DIGIPEATER_H
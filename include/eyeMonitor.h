@@ -0,0 +1,130 @@
+/**
+ * @file eyeMonitor.h
+ * @date 2025-10-15
+ * @brief Eye diagram and bit timing statistics of a demodulator, for tuning a site.
+ *
+ * While its PLL is locked, afskDemod hands every sample's discriminator value
+ * and PLL phase to the attached monitor. Locked is DCD up with no more than one
+ * recent transition off the clock; DCD alone stays up for several bits of
+ * silence after a frame, which would fill the middle of the eye.
+ * - The eye is a 2D histogram of EYE_ROWS value rows by EYE_COLUMNS phase
+ *   columns spanning two bit periods, edge to edge to edge, so the two bit
+ *   centers fall at one and three quarters of the width. Values are scaled
+ *   to twice their running mean magnitude, so the rails sit at a quarter and
+ *   three quarters of the height whatever the front end and the audio level.
+ *   A bin reaching 65535 halves all of them, so recent audio dominates.
+ * - Every level transition under DCD adds the PLL phase at that moment, which should be
+ *   zero, to a timing error histogram over +-half a bit, and to its mean and RMS.
+ * Accumulation is a few integer operations per sample, cheap enough to leave
+ * on. A closing eye shows low audio (noise fills the middle), twist (one
+ * rail wider than the other) or a filter that is too narrow (slow edges and
+ * timing spread).
+ *
+ * eyeMonitorSummary() reduces the histograms to the eye opening and timing
+ * numbers. eyeMonitorJson() and eyeMonitorBmp() stream the whole thing
+ * through a write callback, to a file on the host ("program eye") or over
+ * HTTP on the TNC (GET /eye on OTA_HTTP_PORT).
+ *
+ * The code has no Arduino dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - eyeMonitorReset(): Clear the histograms and statistics.
+ * - eyeMonitorSample(): Add one discriminator value at a PLL phase.
+ * - eyeMonitorTiming(): Add the PLL phase at a level transition.
+ * - eyeMonitorSummary(): Eye opening, rail levels and timing error.
+ * - eyeMonitorJson(): Write the summary and the histograms as JSON.
+ * - eyeMonitorBmp(): Write the eye as an 8-bit BMP image.
+ */
+#ifndef EYE_MONITOR_H
+#define EYE_MONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EYE_COLUMNS 32		  // Over two bit periods
+#define EYE_ROWS 32			  // Over +-2 times the mean value magnitude
+#define EYE_TIMING_BINS 32	  // Over +-half a bit
+#define EYE_LEVEL_SHIFT 10	  // Mean magnitude averages over 1024 samples
+#define EYE_GAIN_INTERVAL 256 // Samples between updates of the row scale
+#define EYE_BMP_SCALE 8		  // Pixels per bin in eyeMonitorBmp()
+#define EYE_RAIL_PERCENTILE 0.01f // Share of a rail's samples allowed inside the reported opening
+
+typedef struct
+{
+	uint16_t bins[EYE_ROWS][EYE_COLUMNS]; // Row 0 is the top, the largest mark value
+	uint32_t timingBins[EYE_TIMING_BINS];
+	float level;	  // Running mean of |value|
+	float rowGain;	  // Rows per unit of value, from level
+	uint32_t samples; // Since the last reset
+	uint32_t sinceGain;
+	uint32_t halvings; // Times the bins were halved
+	uint32_t transitions;
+	int64_t timingSum; // Timing error in 1/65536 bit
+	uint64_t timingSumSquares;
+	int32_t lastPhase;
+	uint8_t bit; // 0 or 1: which half of the eye the phase is in
+} eye_monitor_t;
+
+typedef struct
+{
+	uint32_t samples;
+	uint32_t transitions;
+	float level;		 // Mean |value| in front end units
+	float opening;		 // Inner rail distance over mean rail distance at the bit centers, 0 when closed
+	float markRail;		 // Mean mark and space values at the bit centers, in units of level
+	float spaceRail;
+	float timingMean;	 // Mean timing error, bits; positive means transitions late against the PLL
+	float timingRms;	 // RMS timing error, bits
+} eye_summary_t;
+
+typedef void (*eye_write_cb)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Clear the histograms and statistics
+ * @param e Monitor state
+ */
+void eyeMonitorReset(eye_monitor_t *e);
+
+/**
+ * @brief Add one discriminator value
+ * @param e Monitor state
+ * @param phase PLL phase after the sample: 0 at a bit edge, INT32_MIN at the bit center
+ * @param value Discriminator, positive for mark, 0 at the decision level
+ */
+void eyeMonitorSample(eye_monitor_t *e, int32_t phase, float value);
+
+/**
+ * @brief Add the PLL phase at a level transition, before the PLL corrects it
+ * @param e Monitor state
+ * @param phase PLL phase, 0 for a transition exactly on time
+ */
+void eyeMonitorTiming(eye_monitor_t *e, int32_t phase);
+
+/**
+ * @brief Reduce the histograms to a few numbers
+ * @param e Monitor state
+ * @param out Summary
+ */
+void eyeMonitorSummary(const eye_monitor_t *e, eye_summary_t *out);
+
+/**
+ * @brief Write the summary and both histograms as one JSON object
+ * @param e Monitor state
+ * @param write Called with consecutive pieces of the output, each at most 256 bytes
+ * @param ctx Passed back to write
+ */
+void eyeMonitorJson(const eye_monitor_t *e, eye_write_cb write, void *ctx);
+
+/**
+ * @brief Write the eye as an 8-bit grayscale BMP, brightness log-scaled by count
+ *
+ * The image is EYE_BMP_SCALE pixels per bin with the zero line and the bit
+ * centers marked in dark gray.
+ *
+ * @param e Monitor state
+ * @param write Called with consecutive pieces of the output, each at most 1024 bytes
+ * @param ctx Passed back to write
+ */
+void eyeMonitorBmp(const eye_monitor_t *e, eye_write_cb write, void *ctx);
+
+#endif // EYE_MONITOR_H
@@ -0,0 +1,52 @@
+/**
+ * @file firDecimator.h
+ * @date 2025-09-04
+ * @brief Integer FIR low-pass decimator for bringing capture rates down to the demodulator rate.
+ *
+ * Taps are a Hamming-windowed sinc in Q15 and the multiply-accumulate is done in
+ * 32 bits, so the filter is exact and cheap on the ESP32. The code has no Arduino
+ * dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - firDecimatorInit(): Design the filter for a decimation factor and cutoff.
+ * - firDecimatorProcess(): Filter a block of input and emit every factor-th output.
+ */
+#ifndef FIR_DECIMATOR_H
+#define FIR_DECIMATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FIR_DECIMATOR_MAX_TAPS 64 // Longest filter supported
+
+typedef struct
+{
+	int16_t taps[FIR_DECIMATOR_MAX_TAPS];		  // Q15 coefficients
+	int16_t history[2 * FIR_DECIMATOR_MAX_TAPS]; // Input history, stored twice for a contiguous window
+	uint8_t numTaps;
+	uint8_t factor;
+	uint8_t phase; // Inputs since the last output
+	uint8_t pos;   // Next write position in history
+} fir_decimator_t;
+
+/**
+ * @brief Design a decimating low-pass filter
+ * @param fir Filter state
+ * @param factor Decimation factor (1 = filter only)
+ * @param numTaps Filter length, up to FIR_DECIMATOR_MAX_TAPS
+ * @param cutoff Cutoff frequency as a fraction of the input sample rate (0 to 0.5)
+ * @return true on success, false if the parameters are out of range
+ */
+bool firDecimatorInit(fir_decimator_t *fir, uint8_t factor, uint8_t numTaps, float cutoff);
+
+/**
+ * @brief Filter and decimate a block of samples
+ * @param fir Filter state
+ * @param in Input samples
+ * @param count Number of input samples
+ * @param out Output buffer, at least count / factor + 1 samples
+ * @return Number of output samples written
+ */
+size_t firDecimatorProcess(fir_decimator_t *fir, const int16_t *in, size_t count, int16_t *out);
+
+#endif // FIR_DECIMATOR_H
@@ -0,0 +1,152 @@
+/**
+ * @file frameTrace.h
+ * @date 2025-10-17
+ * @brief Per-frame IDs and stage timestamps, with latency histograms per pipeline stage.
+ *
+ * Each frame carries a frame_trace_t from where it enters the TNC to where it
+ * leaves. Every stage it passes stamps the time in microseconds:
+ * - TX: KISS bytes read from the host (or the digipeater's receive), queued,
+ *   channel access granted, PTT on, first bit, last bit, PTT off.
+ * - RX: closing flag (the audio block holding it was captured), CRC passed,
+ *   routed (digipeater done), written to the host link.
+ * traceEnd() adds the time between consecutive stamped stages, and from the
+ * first stage to the last, to log2 histograms of the direction's tracer. When
+ * clients find the TNC sluggish, the stage that grew shows whether the host
+ * link, the queue, channel access or the modem is to blame. A skipped stage,
+ * such as a transmission that failed, leaves a gap that is not counted.
+ *
+ * The caller owns the tracers and the locking; the code has no Arduino
+ * dependency so the host "tnc" subcommand traces the same stages.
+ *
+ * Functions:
+ * - traceInit(): Name a tracer and its stages, clear the histograms.
+ * - traceBegin(): Give a frame the next ID and clear its stamps.
+ * - traceStamp(): Record the time a frame reached a stage.
+ * - traceEnd(): Add a finished frame to the histograms.
+ * - traceQuantileUs(): Upper bound of a quantile of one histogram.
+ * - traceFormatStage(): One line of statistics for a histogram.
+ * - traceFormatFrame(): One trace log line for a frame.
+ */
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAX_STAGES 8
+#define TRACE_BUCKETS 24 // Bucket b counts below 2^(b+1) us, the last one everything from 8.4 s
+#define FRAME_TRACE_LINE 200 // Longest traceFormatStage() or traceFormatFrame() line
+
+// Transmit stages, in order
+typedef enum
+{
+	TRACE_TX_RECEIVED = 0, // KISS frame read from the host, or decoded for the digipeater
+	TRACE_TX_QUEUED,
+	TRACE_TX_ACCESS, // CSMA granted the channel
+	TRACE_TX_PTT_ON,
+	TRACE_TX_FIRST_BIT, // Audio handed to the output
+	TRACE_TX_LAST_BIT,
+	TRACE_TX_PTT_OFF,
+	TRACE_TX_STAGES
+} trace_tx_stage_t;
+
+// Receive stages, in order
+typedef enum
+{
+	TRACE_RX_FLAG = 0, // Capture of the audio block holding the closing flag
+	TRACE_RX_CRC,
+	TRACE_RX_ROUTED,  // Digipeater done, about to go to the host
+	TRACE_RX_WRITTEN, // Host link write returned
+	TRACE_RX_STAGES
+} trace_rx_stage_t;
+
+extern const char *const traceTxStageNames[TRACE_TX_STAGES];
+extern const char *const traceRxStageNames[TRACE_RX_STAGES];
+
+// One frame on its way through the TNC
+typedef struct
+{
+	uint32_t id;
+	uint32_t us[TRACE_MAX_STAGES]; // Microsecond clock at each stage, wrapping
+	uint8_t stamped;			   // Bit per stage reached
+	uint8_t port;
+	uint16_t length;
+} frame_trace_t;
+
+// Histograms of one direction. Slot 0 is first to last stage, slot k is stage k-1 to k.
+typedef struct
+{
+	const char *name;
+	const char *const *stageNames;
+	uint8_t stages;
+	uint32_t nextId;
+	uint32_t frames;
+	uint32_t counts[TRACE_MAX_STAGES][TRACE_BUCKETS];
+	uint32_t samples[TRACE_MAX_STAGES];
+	uint64_t sumUs[TRACE_MAX_STAGES];
+	uint32_t maxUs[TRACE_MAX_STAGES];
+} frame_tracer_t;
+
+/**
+ * @brief Name a tracer and its stages, clear the histograms
+ * @param t Tracer
+ * @param name Direction, for example "TX"
+ * @param stageNames Name of each stage, kept by reference
+ * @param stages Number of stages, at most TRACE_MAX_STAGES
+ */
+void traceInit(frame_tracer_t *t, const char *name, const char *const *stageNames, uint8_t stages);
+
+/**
+ * @brief Give a frame the next ID and clear its stamps
+ * @param t Tracer of the frame's direction
+ * @param f Trace carried with the frame
+ * @param port KISS port
+ * @param length Frame length in bytes
+ */
+void traceBegin(frame_tracer_t *t, frame_trace_t *f, uint8_t port, size_t length);
+
+/**
+ * @brief Record the time a frame reached a stage
+ * @param f Trace carried with the frame
+ * @param stage Stage number, below the tracer's stage count
+ * @param us Microsecond clock
+ */
+void traceStamp(frame_trace_t *f, uint8_t stage, uint32_t us);
+
+/**
+ * @brief Add a finished frame to the histograms
+ * @param t Tracer that began the frame
+ * @param f Trace carried with the frame
+ */
+void traceEnd(frame_tracer_t *t, const frame_trace_t *f);
+
+/**
+ * @brief Upper bound of a quantile of one histogram
+ * @param t Tracer
+ * @param slot 0 for first to last stage, k for stage k-1 to k
+ * @param q Quantile, 0 to 1
+ * @return Upper edge of the bucket holding the quantile, 0 if the histogram is empty
+ */
+uint32_t traceQuantileUs(const frame_tracer_t *t, uint8_t slot, float q);
+
+/**
+ * @brief One line of statistics for a histogram, such as "TX queued>access: 12, mean 80.1 ms, ..."
+ * @param t Tracer
+ * @param slot 0 for first to last stage, k for stage k-1 to k
+ * @param out Destination, NUL-terminated
+ * @param size Size of out
+ * @return Length of the line, 0 if the histogram is empty
+ */
+size_t traceFormatStage(const frame_tracer_t *t, uint8_t slot, char *out, size_t size);
+
+/**
+ * @brief One trace log line: the frame ID and the time spent up to each stage
+ * @param t Tracer that began the frame
+ * @param f Trace carried with the frame
+ * @param out Destination, NUL-terminated
+ * @param size Size of out
+ * @return Length of the line
+ */
+size_t traceFormatFrame(const frame_tracer_t *t, const frame_trace_t *f, char *out, size_t size);
+
+#endif // FRAME_TRACE_H
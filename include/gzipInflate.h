@@ -0,0 +1,104 @@
+/**
+ * @file gzipInflate.h
+ * @date 2025-10-12
+ * @brief Streaming gzip decompressor with a fixed window, for compressed OTA images.
+ *
+ * Input is pushed in chunks of any size, as it arrives from the network. Output
+ * goes through the caller's window buffer and is handed to a callback in
+ * contiguous runs, at most one window at a time, so an image can be inflated
+ * straight into the OTA partition. The only state besides the window is the
+ * gzip_inflate_t struct: Huffman tables and a carry buffer for an incomplete
+ * symbol or block header at the end of a chunk. Nothing is allocated.
+ *
+ * The window must cover the longest back-reference of the stream. gzip and
+ * zlib use 32 KB (15 bits); tools/otaPack.py can compress with a smaller window
+ * so the target needs less RAM. A reference beyond the window stops with
+ * GZIP_ERROR_DISTANCE. The CRC-32 and length in the gzip trailer are checked at
+ * the end. The code has no Arduino dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - gzipInflateInit(): Reset a decompressor and set its window and output callback.
+ * - gzipInflateInput(): Feed the next chunk of the compressed stream.
+ * - gzipInflateStatusString(): Text for a status code.
+ */
+#ifndef GZIP_INFLATE_H
+#define GZIP_INFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GZIP_MAX_WINDOW_BITS 15 // Deflate limit, 32 KB
+#define GZIP_MIN_WINDOW_BITS 8
+#define GZIP_CARRY_BYTES 640	// Largest dynamic block header is under 580 bytes
+
+typedef enum
+{
+	GZIP_MORE = 0,		  // Waiting for more input
+	GZIP_DONE,			  // Trailer checked; later input is ignored
+	GZIP_ERROR_HEADER,	  // Not a gzip deflate stream
+	GZIP_ERROR_DATA,	  // Invalid block, code or back-reference
+	GZIP_ERROR_DISTANCE,  // Back-reference beyond the window
+	GZIP_ERROR_CHECK,	  // CRC-32 or length in the trailer does not match
+	GZIP_ERROR_OUTPUT	  // Output callback refused the data
+} gzip_status_t;
+
+// Receives inflated bytes in order, false to stop with GZIP_ERROR_OUTPUT
+typedef bool (*gzip_output_cb)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct
+{
+	uint16_t count[GZIP_MAX_WINDOW_BITS + 1]; // Codes of each length
+	uint16_t symbol[288];					   // Symbols ordered by code
+} gzip_huffman_t;
+
+typedef struct
+{
+	gzip_status_t status;
+	uint8_t stage;		 // Header field, block or trailer being read
+	uint8_t flags;		 // gzip FLG
+	bool lastBlock;
+	bool fixedTables;	 // lit and dist hold the fixed codes
+	uint16_t skip;		 // Bytes left in FEXTRA
+	uint16_t stored;	 // Bytes left in a stored block
+	gzip_huffman_t lit;	 // Literal/length code of the current block
+	gzip_huffman_t dist; // Distance code
+	uint8_t *window;
+	uint32_t windowSize;
+	uint32_t total;	  // Bytes inflated
+	uint32_t flushed; // Bytes handed to the callback
+	uint32_t crc;
+	uint32_t bitBuf; // Bits not yet used, LSB first
+	uint8_t bitCount;
+	const uint8_t *in; // Chunk being read, after the carried bytes
+	size_t inLen;
+	size_t pos; // Read position over carry then in
+	uint8_t carry[GZIP_CARRY_BYTES];
+	size_t carryLen;
+	gzip_output_cb onOutput;
+	void *ctx;
+} gzip_inflate_t;
+
+/**
+ * @brief Reset a decompressor
+ * @param z Decompressor state
+ * @param window Buffer of 1 << windowBits bytes, used for the whole stream
+ * @param windowBits GZIP_MIN_WINDOW_BITS to GZIP_MAX_WINDOW_BITS
+ * @param onOutput Receives the inflated bytes
+ * @param ctx Passed back to onOutput
+ * @return false if windowBits is out of range
+ */
+bool gzipInflateInit(gzip_inflate_t *z, uint8_t *window, uint8_t windowBits, gzip_output_cb onOutput, void *ctx);
+
+/**
+ * @brief Feed the next chunk of the compressed stream
+ *
+ * Inflates everything the chunk completes and flushes it to the callback
+ * before returning. An error is final; call gzipInflateInit() to start over.
+ *
+ * @return GZIP_MORE until the trailer has been checked, then GZIP_DONE
+ */
+gzip_status_t gzipInflateInput(gzip_inflate_t *z, const uint8_t *data, size_t len);
+
+const char *gzipInflateStatusString(gzip_status_t status);
+
+#endif // GZIP_INFLATE_H
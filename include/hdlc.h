@@ -0,0 +1,113 @@
+/**
+ * @file hdlc.h
+ * @date 2025-09-11
+ * @brief HDLC deframer and framer, AX.25 frame check sequence.
+ *
+ * Turns the recovered NRZI line bits into AX.25 frames: NRZI decoding, flag and
+ * abort detection, bit-unstuffing, byte assembly and the CCITT FCS check. Frames
+ * that pass are handed to a callback without their FCS. Writes are bounded by
+ * HDLC_MAX_FRAME, so arbitrary input cannot overrun the buffer. The code has no
+ * Arduino dependency so it can also be built for the host.
+ *
+ * Functions:
+ * - hdlcInit(): Reset a deframer and set its frame callback.
+ * - hdlcSetErrorCallback(): Also receive frames that failed the FCS check.
+ * - hdlcBit(): Feed one recovered line bit.
+ * - hdlcRepair(): Fix one wrong bit or line level in a frame that failed the FCS check.
+ * - hdlcEncode(): Frame an AX.25 frame into NRZI line levels for transmission.
+ * - ax25Fcs(): CRC-16-CCITT as used by AX.25 (reflected, init and final XOR 0xFFFF).
+ */
+#ifndef HDLC_H
+#define HDLC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HDLC_MAX_FRAME 330 // 2 x 7 address + 8 x 7 digipeaters + control + PID + 256 info + FCS
+#define HDLC_MIN_FRAME 17  // 2 x 7 address + control + FCS
+#define HDLC_TAIL_FLAGS 2  // Flags after the frame, so the last byte clears the receiver
+
+// Line levels hdlcEncode() can need: flags, then frame and FCS with worst-case stuffing (one per five bits)
+#define HDLC_ENCODED_LEVELS(len, flags) ((size_t)((flags) + HDLC_TAIL_FLAGS) * 8 + ((size_t)(len) + 2) * 8 * 6 / 5 + 1)
+
+// Called with a frame that passed the FCS check, FCS removed
+typedef void (*hdlc_frame_cb)(void *ctx, const uint8_t *frame, size_t len);
+
+typedef struct
+{
+	uint8_t frame[HDLC_MAX_FRAME];
+	size_t length;	  // Bytes received in the current frame
+	uint8_t pattern;  // Last 8 decoded bits, newest in bit 7
+	uint8_t shift;	  // Byte being assembled, LSB first
+	int8_t bitCount;  // Bits in shift, -1 when outside a frame
+	bool lastLevel;	  // Previous line level for NRZI decoding
+	bool overflow;	  // Current frame exceeded HDLC_MAX_FRAME
+	uint32_t frames;  // Frames delivered
+	uint32_t fcsErrors; // Byte-aligned frames with a bad FCS
+	hdlc_frame_cb onFrame;
+	hdlc_frame_cb onError; // Byte-aligned frames with a bad FCS, FCS included; NULL for none
+	void *ctx;
+} hdlc_deframer_t;
+
+/**
+ * @brief Reset a deframer
+ * @param h Deframer state
+ * @param onFrame Callback for frames with a valid FCS
+ * @param ctx Passed back to onFrame
+ */
+void hdlcInit(hdlc_deframer_t *h, hdlc_frame_cb onFrame, void *ctx);
+
+/**
+ * @brief Deliver frames that fail the FCS check as well, for hdlcRepair()
+ * @param h Deframer state
+ * @param onError Called with the frame and its FCS, with the ctx given to hdlcInit(); NULL to stop
+ */
+void hdlcSetErrorCallback(hdlc_deframer_t *h, hdlc_frame_cb onError);
+
+/**
+ * @brief Feed one recovered line bit
+ * @param h Deframer state
+ * @param level Line level at the bit center, true for mark
+ * @return true if this bit completed a frame that passed the FCS check
+ */
+bool hdlcBit(hdlc_deframer_t *h, bool level);
+
+/**
+ * @brief Frame an AX.25 frame for transmission
+ *
+ * Appends the FCS, stuffs a zero after every five ones, wraps the frame in
+ * flags and NRZI-encodes the result starting from mark.
+ *
+ * @param frame Frame bytes without FCS
+ * @param len Number of bytes, HDLC_MIN_FRAME - 2 to HDLC_MAX_FRAME - 2
+ * @param preambleFlags Flags sent before the frame (TXDELAY), at least 1
+ * @param levels Output line levels, one per byte, 1 = mark
+ * @param maxLevels Size of levels, HDLC_ENCODED_LEVELS(len, preambleFlags) always fits
+ * @return Number of levels written, 0 if the frame length is out of range or levels is too small
+ */
+size_t hdlcEncode(const uint8_t *frame, size_t len, uint16_t preambleFlags, uint8_t *levels, size_t maxLevels);
+
+/**
+ * @brief Repair a frame that failed the FCS check
+ *
+ * Tries every single flipped bit, and every pair of adjacent flipped bits,
+ * which is what one wrong line level becomes after NRZI decoding. The CRC is
+ * linear, so each candidate costs one CRC step instead of a new FCS. With a
+ * 16-bit FCS and thousands of candidates in a long frame, a false match has a
+ * chance of a few percent: check the result, for example with ax25Parse().
+ *
+ * @param frame Frame bytes and FCS, repaired in place
+ * @param len Number of bytes, FCS included
+ * @return true if exactly one candidate passes the FCS check and was applied
+ */
+bool hdlcRepair(uint8_t *frame, size_t len);
+
+/**
+ * @brief Compute the AX.25 frame check sequence
+ * @param data Frame bytes
+ * @param len Number of bytes
+ * @return FCS, transmitted low byte first
+ */
+uint16_t ax25Fcs(const uint8_t *data, size_t len);
+
+#endif // HDLC_H
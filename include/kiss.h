@@ -0,0 +1,94 @@
+/**
+ * @file kiss.h
+ * @date 2025-09-22
+ * @brief KISS framing between the TNC and the host application.
+ *
+ * Byte-stream decoder for frames arriving from the host over Bluetooth, and the
+ * matching encoder for frames sent to it. The decoder keeps at most
+ * KISS_MAX_FRAME bytes per frame, plus the tag of an ACKMODE frame, and drops
+ * anything longer or badly escaped, so a misbehaving client cannot overrun it. The code has no Arduino dependency so
+ * it can also be built for the host.
+ *
+ * Functions:
+ * - kissInit(): Reset a decoder and set its frame callback.
+ * - kissInput(): Feed bytes received from the host.
+ * - kissEncode(): Frame, escape and address a packet for the host.
+ */
+#ifndef KISS_H
+#define KISS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hdlc.h"
+
+// KISS special characters
+#define KISS_FEND 0xC0	// Frame end
+#define KISS_FESC 0xDB	// Frame escape
+#define KISS_TFEND 0xDC // Transposed FEND
+#define KISS_TFESC 0xDD // Transposed FESC
+
+#define KISS_MAX_FRAME (HDLC_MAX_FRAME - 2) // Largest AX.25 frame without FCS
+#define KISS_MAX_ENCODED(len) (2 * (size_t)(len) + 3) // FEND, command, escaped data, FEND
+#define KISS_ACK_TAG_LEN 2 // ACKMODE tag ahead of the frame, high byte first
+
+// Commands, in the low nibble of the command byte; the port is in the high nibble
+typedef enum
+{
+	KISS_CMD_DATA = 0x00,
+	KISS_CMD_TXDELAY = 0x01,
+	KISS_CMD_PERSIST = 0x02,
+	KISS_CMD_SLOTTIME = 0x03,
+	KISS_CMD_TXTAIL = 0x04,
+	KISS_CMD_FULLDUPLEX = 0x05,
+	KISS_CMD_SETHARDWARE = 0x06,
+	KISS_CMD_ACKMODE = 0x0C, // Data frame with a 2-byte tag, echoed back once transmitted
+	KISS_CMD_RETURN = 0x0F // Whole byte 0xFF: leave KISS mode
+} kiss_command_t;
+
+// Called with the payload of a complete frame, unescaped and without the command byte
+typedef void (*kiss_frame_cb)(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len);
+
+typedef struct
+{
+	uint8_t frame[KISS_MAX_FRAME + 1 + KISS_ACK_TAG_LEN]; // Command byte, ACKMODE tag and payload
+	size_t length;
+	bool escape;	  // Previous byte was FESC
+	bool discard;	  // Current frame is dropped, skip to the next FEND
+	uint32_t frames;  // Frames delivered
+	uint32_t overflows; // Frames longer than KISS_MAX_FRAME plus an ACKMODE tag
+	uint32_t badEscapes; // FESC followed by anything but TFEND or TFESC
+	kiss_frame_cb onFrame;
+	void *ctx;
+} kiss_decoder_t;
+
+/**
+ * @brief Reset a decoder
+ * @param k Decoder state
+ * @param onFrame Callback for complete frames
+ * @param ctx Passed back to onFrame
+ */
+void kissInit(kiss_decoder_t *k, kiss_frame_cb onFrame, void *ctx);
+
+/**
+ * @brief Feed bytes received from the host
+ * @param k Decoder state
+ * @param data Received bytes, any split across calls
+ * @param len Number of bytes
+ * @return Number of frames delivered by this call
+ */
+size_t kissInput(kiss_decoder_t *k, const uint8_t *data, size_t len);
+
+/**
+ * @brief Frame a packet for the host
+ * @param port KISS port, 0-15
+ * @param command Command, KISS_CMD_DATA for received frames
+ * @param data Payload
+ * @param len Payload length
+ * @param out Output buffer
+ * @param outSize Size of out, KISS_MAX_ENCODED(len) always fits
+ * @return Bytes written, 0 if out is too small
+ */
+size_t kissEncode(uint8_t port, uint8_t command, const uint8_t *data, size_t len, uint8_t *out, size_t outSize);
+
+#endif // KISS_H
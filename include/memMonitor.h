@@ -0,0 +1,94 @@
+/**
+ * @file memMonitor.h
+ * @date 2025-10-08
+ * @brief Heap, stack and pool watermark monitor with leak and fragmentation alarms.
+ *
+ * A low-priority task samples the free heap, the largest free block, the stack
+ * high-water mark of the TNC's tasks and the fill level of registered pools
+ * every MEM_SAMPLE_MS. The highest free heap in each MEM_TREND_INTERVAL_MS is
+ * the baseline once transient allocations are freed. A least-squares slope over
+ * the last MEM_TREND_POINTS baselines exposes slow leaks long before the heap
+ * runs out. Alarms are raised for:
+ * - a leak trend
+ * - fragmentation (the largest block is small next to the free heap)
+ * - a low heap
+ * - a stack near its end
+ * - an exhausted pool
+ * Each alarm is printed once when it is raised, and stays in the stats until
+ * it clears.
+ *
+ * Functions:
+ * - memMonitorBegin(): Start the monitor task. Call at the end of setup().
+ * - memMonitorWatchPool(): Register a pool or queue whose fill level is sampled.
+ * - getMemStats(): Copy the latest sample, trend and alarms.
+ * - printMemStats(): Print them to Serial.
+ */
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include <Arduino.h>
+
+#define MEM_SAMPLE_MS 10000			  // Heap, stack and pool sampling period
+#define MEM_TREND_INTERVAL_MS 300000  // One baseline point per 5 minutes...
+#define MEM_TREND_POINTS 24			  // ...over a 2 hour window
+#define MEM_LEAK_ALARM_BPH 2048		  // Baseline falling faster than this, bytes per hour
+#define MEM_LOW_HEAP 20000			  // Free heap alarm level, bytes
+#define MEM_MIN_LARGEST_BLOCK 16384	  // Largest block alarm level, bytes
+#define MEM_FRAG_ALARM_RATIO 0.5f	  // Largest block below this fraction of the free heap
+#define MEM_STACK_MARGIN 512		  // Stack high-water alarm level, bytes
+#define MEM_MAX_TASKS 11
+#define MEM_MAX_POOLS 6
+#define MEM_TASK_STACK 3072
+#define MEM_TASK_PRIORITY 1 // Above idle, below loop() and the radio tasks
+
+// Alarm bits in mem_stats_t.alarms
+typedef enum
+{
+	MEM_ALARM_LEAK = 0x01,
+	MEM_ALARM_FRAGMENTED = 0x02,
+	MEM_ALARM_LOW_HEAP = 0x04,
+	MEM_ALARM_STACK = 0x08,
+	MEM_ALARM_POOL = 0x10
+} mem_alarm_t;
+
+// Current and capacity of a pool, sampled by the monitor task
+typedef void (*mem_pool_cb)(void *ctx, uint32_t *used, uint32_t *capacity);
+
+typedef struct
+{
+	const char *name;
+	uint32_t stackFree; // Smallest free stack seen by FreeRTOS, bytes
+} mem_task_stats_t;
+
+typedef struct
+{
+	const char *name;
+	uint32_t used;
+	uint32_t peak;
+	uint32_t capacity;
+	uint32_t exhaustedSamples; // Samples taken with the pool full
+} mem_pool_stats_t;
+
+typedef struct
+{
+	uint32_t samples;
+	uint32_t freeHeap;
+	uint32_t minFreeHeap; // Lowest free heap since boot, from the allocator
+	uint32_t largestBlock;
+	uint32_t minLargestBlock;
+	int32_t trendBph;	  // Baseline slope, bytes per hour; 0 until the window is full
+	uint8_t trendPoints;
+	uint8_t alarms;		  // mem_alarm_t bits active now
+	uint32_t alarmsRaised; // Alarm bits that went from clear to set, counted
+	uint8_t taskCount;
+	mem_task_stats_t tasks[MEM_MAX_TASKS];
+	uint8_t poolCount;
+	mem_pool_stats_t pools[MEM_MAX_POOLS];
+} mem_stats_t;
+
+void memMonitorBegin(); // Call at the end of setup(), after the tasks to watch have started
+bool memMonitorWatchPool(const char *name, mem_pool_cb usage, void *ctx); // false once MEM_MAX_POOLS are registered
+void getMemStats(mem_stats_t *stats); // Copy the latest sample, trend and alarms
+void printMemStats();				   // Print heap, trend, stacks, pools and alarms to Serial
+
+#endif // MEM_MONITOR_H
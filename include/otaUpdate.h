@@ -0,0 +1,88 @@
+/**
+ * @file otaUpdate.h
+ * @date 2025-10-11
+ * @brief Background ArduinoOTA updates that keep the TNC on the air until the reboot.
+ *
+ * ArduinoOTA.handle() receives and flashes a whole image before it returns.
+ * Called from loop(), that kept the transmit queue, the host link and the
+ * digipeater stalled for the whole update. Here a low-priority task runs
+ * handle() instead. Between the network chunks, the progress callback:
+ * - holds off while DCD is up or a frame is on the air, so the 4 KB sector
+ *   erases and writes fall between packets
+ * - throttles the transfer to OTA_RATE_BYTES_PER_S, to leave CPU and flash
+ *   time for the radio tasks
+ * Progress is printed in OTA_PROGRESS_STEP_PERCENT steps. After the image is
+ * verified, the reboot waits until the channel is quiet.
+ *
+ * Images can also be uploaded over HTTP to OTA_HTTP_PORT, plain or gzip
+ * compressed (tools/otaPack.py). A gzip image is inflated as it arrives,
+ * through a window of 1 << OTA_INFLATE_WINDOW_BITS bytes allocated for the
+ * upload, straight into the OTA partition. That is about half the transfer
+ * time over a weak link. The gzip CRC-32 and the MD5 of the inflated image
+ * are both checked before the image is accepted.
+ *
+ * The server also answers GET /eye?port=N with the eye diagram and bit timing
+ * of a receive port (RX_EYE_MONITOR), as JSON or with format=bmp as an image;
+ * reset=1 starts a new diagram afterwards. Like uploads, it is served from
+ * OTA_CONFIRM_MS after boot.
+ *
+ * Rollback: Update.end() checks the received image before it is made the boot
+ * partition. The image that did the update stays in the other OTA slot. A new
+ * image boots as pending verify. It is marked valid only once it has run for
+ * OTA_CONFIRM_MS with WiFi up and the receive tasks running, so it can take
+ * the next update. Otherwise it is marked invalid and the previous image
+ * boots. No update is accepted before that decision, so the rollback image is
+ * never overwritten.
+ *
+ * Compiled only when FEATURE_OTA is set. Needs a partition table with two OTA
+ * app slots (min_spiffs.csv in platformio.ini).
+ *
+ * Functions:
+ * - otaBegin(): Start the update task. Call in setup() after WiFi.
+ * - otaSetRate(): Change the transfer throttle.
+ * - getOtaStats(): Copy the state and counters of the last update.
+ * - printOtaStats(): Print them to Serial.
+ */
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+
+#define OTA_TASK_STACK 8192			  // handle() buffers and the inflater's dynamic block header on the stack
+#define OTA_TASK_PRIORITY 1			  // Above idle, below loop() and the radio tasks
+#define OTA_POLL_MS 100				  // Check for an update invitation
+#define OTA_RATE_BYTES_PER_S 32768	  // Default throttle, about 45 s for a 1.5 MB image
+#define OTA_DCD_POLL_MS 10			  // Recheck DCD while holding off
+#define OTA_DCD_PAUSE_MAX_MS 3000	  // Longest hold per chunk; espota gives up after 10 s without an ack
+#define OTA_PROGRESS_STEP_PERCENT 10  // Progress lines per update
+#define OTA_CONFIRM_MS 60000		  // A new image must run this long before it is marked valid
+#define OTA_REBOOT_WAIT_MS 10000	  // Longest wait for a quiet channel before the reboot
+#define OTA_HTTP_PORT 8080			  // POST /update?md5=<hex>&size=<bytes>, plain or gzip image; GET /eye
+#define OTA_INFLATE_WINDOW_BITS 15	  // 32 KB, any gzip; smaller needs otaPack.py --window-bits
+
+typedef enum
+{
+	OTA_STATE_CONFIRMING = 0, // New image on probation, updates refused
+	OTA_STATE_IDLE,			  // Waiting for an invitation
+	OTA_STATE_RECEIVING,
+	OTA_STATE_REBOOTING
+} ota_state_t;
+
+typedef struct
+{
+	ota_state_t state;
+	uint32_t received;	  // Image bytes of the current or last update
+	uint32_t size;		  // Image size, 0 if the upload did not give it
+	uint32_t transferred; // Bytes over the network, less than received for a gzip image
+	uint32_t dcdPauseMs;  // Time held off for DCD or transmit
+	uint32_t throttleMs;  // Time held back by the rate limit
+	uint32_t updates;	  // Completed updates since boot, 0 or 1
+	uint32_t errors;
+} ota_stats_t;
+
+void otaBegin(); // Call in setup() after wifiBegin()
+void otaSetRate(uint32_t bytesPerSecond); // 0 turns the throttle off
+void getOtaStats(ota_stats_t *stats);
+void printOtaStats();
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,61 @@
+/**
+ * @file squelch.h
+ * @date 2025-09-08
+ * @brief Cheap audio energy detector used to gate the AFSK demodulator.
+ *
+ * Measures the mean absolute level of every decimation-th sample after removing
+ * DC, tracks the noise floor while closed and opens when a block rises above the
+ * floor by the open threshold. A hang time keeps it open across short fades and
+ * the gaps between frames. Integer only, with no Arduino dependency, so it can
+ * also be built for the host.
+ *
+ * The radio's own squelch should be set so that an idle channel is quiet; an
+ * open-squelch hiss is as loud as a signal and keeps the detector awake.
+ *
+ * Functions:
+ * - squelchInit(): Configure decimation, thresholds and hang time.
+ * - squelchProcess(): Measure one block and update the open/closed state.
+ */
+#ifndef SQUELCH_H
+#define SQUELCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+	int32_t dc;			   // DC estimate in 1/16 LSB
+	uint32_t floorLevel;   // Noise floor, mean absolute level
+	uint32_t level;		   // Level of the last block
+	uint32_t minLevel;	   // Floor never tracks below this level
+	uint16_t openRatioQ8;  // Open when level > floor * ratio / 256
+	uint16_t closeRatioQ8; // Close when level < floor * ratio / 256 for hangBlocks
+	uint16_t hangBlocks;
+	uint16_t hangLeft;
+	uint8_t decimation;
+	bool open;
+} squelch_t;
+
+/**
+ * @brief Configure a squelch detector
+ * @param sq Detector state
+ * @param decimation Use every n-th sample (1 = all). Avoid factors that alias a tone
+ *                   onto DC, e.g. 4 at 9600 Hz puts 1200 Hz at Nyquist.
+ * @param openDb Level above the noise floor that opens the squelch
+ * @param closeDb Level above the noise floor below which the squelch closes
+ * @param hangBlocks Blocks below the close level before closing
+ * @param minLevel Lowest noise floor, in 16-bit sample units
+ */
+void squelchInit(squelch_t *sq, uint8_t decimation, float openDb, float closeDb,
+				 uint16_t hangBlocks, uint16_t minLevel);
+
+/**
+ * @brief Measure a block and update the squelch state
+ * @param sq Detector state
+ * @param samples Signed 16-bit samples
+ * @param count Number of samples
+ * @return true if the squelch is open after this block
+ */
+bool squelchProcess(squelch_t *sq, const int16_t *samples, size_t count);
+
+#endif // SQUELCH_H
@@ -0,0 +1,38 @@
+/**
+ * @file txQueue.h
+ * @date 2025-09-30
+ * @brief Transmit queue with p-persistent channel access for frames from the host.
+ *
+ * Frames from the KISS link are queued and sent by transmitAX25() once csma.h
+ * grants the channel, with DCD from the receive ports as the busy signal. KISS
+ * TXDELAY, PERSIST, SLOTTIME, TXTAIL and FULLDUPLEX commands adjust the access
+ * parameters. ACKMODE frames are acknowledged with sendKISSack() after
+ * transmitAX25() returns, so the host can measure time to transmit and count
+ * frames that never went out. The queue runs from clockHal timers, so clockRunTimers() must be
+ * called in loop().
+ *
+ * Every frame carries a frameTrace.h trace from the moment its KISS bytes
+ * were read to PTT off. printTxQueueStats() prints the latency of each stage,
+ * and with FRAME_TRACE_LOG every frame's trace is printed as it finishes.
+ *
+ * Functions:
+ * - txQueueBegin(): Seed the access procedure. Call in setup() after the encoder and decoder.
+ * - txQueueFrame(): Queue an AX.25 frame for transmission.
+ * - txQueueAckFrame(): Queue a KISS ACKMODE frame, acknowledged to the host once sent.
+ * - txQueueSetParam(): Apply a KISS channel access command.
+ * - printTxQueueStats(): Print access and queue counters and the stage latencies to Serial.
+ */
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <Arduino.h>
+
+#define TX_QUEUE_FRAMES 4 // Frames waiting for the channel
+
+void txQueueBegin();								  // Call in setup() after setupAFSKEncoder() and setupAFSKdecoder()
+bool txQueueFrame(const uint8_t *frame, size_t len, uint32_t receivedUs); // Queue a frame, false if full or too long
+bool txQueueAckFrame(uint16_t tag, const uint8_t *frame, size_t len, uint32_t receivedUs); // Acknowledge tag once sent
+bool txQueueSetParam(uint8_t command, uint8_t value); // KISS TXDELAY..FULLDUPLEX, false for other commands
+void printTxQueueStats();							  // Print access and queue counters to Serial
+
+#endif // TX_QUEUE_H
@@ -1,9 +1,9 @@
 /**
  * @file wifiConnection.h
- * @brief Declarations for WiFi and OTA connection management functions.
+ * @brief Declarations for WiFi connection management functions.
  *
- * This header provides function declarations for initializing WiFi,
- * connecting to a WiFi network, and starting OTA (Over-The-Air) updates.
+ * This header provides function declarations for initializing WiFi and
+ * connecting to a WiFi network. OTA updates are started by otaUpdate.h.
  * 
  * @author Karl Berger
  * @date 2025-05-20
@@ -23,10 +23,3 @@ void wifiBegin();
  * Called in loop() to restore a connection if lost.
  */
 void wifiConnect();
-
-/**
- * @brief Initializes OTA (Over-The-Air) update functionality.
- *
- * Sets up the device to receive firmware updates over the network.
- */
-void otaBegin();
\ No newline at end of file
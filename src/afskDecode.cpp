@@ -1,198 +1,728 @@
 #include "afskDecode.h"
 
 #include <Arduino.h>
-#include "btFunctions.h" // Include Bluetooth functions
+#include <esp_timer.h>
+#include "afskDemod.h"	 // Per-channel demodulator and HDLC deframer
+#include "allocTrap.h"	 // Heap use checks in env:alloc-trap
+#include "audioHal.h"	 // Sample-block audio input
 #include "configuration.h"
+#include "deadlineMonitor.h" // Decoders falling behind the sample clock
+#include "decodeCascade.h" // Variants retry the bursts the demodulator missed
+#include "frameTrace.h"	   // Receive stage latencies
+#include "kiss.h"		 // KISS framing for the host link
+#include "squelch.h" // Energy detector for low-power idle
+#if FEATURE_BT_CLASSIC
+#include "btFunctions.h" // Include Bluetooth functions
+#endif
+#if FEATURE_DIGIPEATER
+#include "digipeater.h" // Path rewriting and duplicate suppression
+#include "memMonitor.h"	// Queue fill level
+#include "txQueue.h"	// Repeated frames join the host's frames
+#endif
+
+#define RX_MAX_PORTS AUDIO_MAX_READERS // One audio reader per port
+
+// Modem profiles RX_MODES selects from, in KISS port order
+typedef struct
+{
+	uint8_t mode; // RX_MODE_* bit
+	const char *name;
+	uint16_t markFreq;
+	uint16_t spaceFreq;
+	uint16_t baudRate;
+} rx_mode_info_t;
+
+static const rx_mode_info_t rxModes[] = {
+	{RX_MODE_1200, "1200", 1200, 2200, 1200}, // Bell 202, VHF/UHF packet
+	{RX_MODE_300, "300", 1600, 1800, 300},	  // HF packet, 200 Hz shift on an SSB receiver
+};
+
+// One KISS port: a modem profile on an audio channel with its demodulator, squelch and accounting
+typedef struct
+{
+	afsk_demod_t demod;
+#if RX_DECODE_CASCADE
+	decode_cascade_t cascade; // Runs demod as its primary
+	bool cascadeOn;			  // History allocated
+	bool shed;				  // Replay variants off, the decoders are behind
+	uint32_t sheds;			  // Times the variants were shed
+	uint32_t onTimeSinceMs;	  // millis() of the last missed deadline
+	uint32_t captureMisses;	  // deadlineMissedSince() count of DEADLINE_CAPTURE
+#endif
+	squelch_t squelch;
+#if RX_EYE_MONITOR
+	eye_monitor_t eye;		 // Fed by demod, read by the HTTP server
+	volatile bool eyeReset; // Cleared by the decoder task, which owns eye
+#endif
+	rx_power_stats_t stats;
+	bool active;			  // Squelch open (or no squelch)
+	uint32_t stateSinceUs;	  // Start of the current idle/active period
+	uint32_t framesAtWake;	  // stats.frames when the squelch last opened
+	uint64_t sampleCount;	  // Samples received, the timeline for missed-preamble checks
+	uint64_t openedAtSample;  // sampleCount when the squelch last opened
+	uint32_t nextSequence;	  // Expected audio block sequence number, after the first block
+	uint32_t blockUs;		  // Capture time of the block being demodulated
+	TaskHandle_t task;
+	uint8_t channel; // Audio channel
+	uint8_t reader;	 // audioOpenReader() number
+	const rx_mode_info_t *mode;
+} rx_port_t;
+
+static rx_port_t rxPorts[RX_MAX_PORTS];
+static uint8_t rxPortCount = 0;
+static rx_squelch_mode_t squelchMode = RX_SQUELCH_MODE;
+static int64_t rxStartUs = 0; // esp_timer time of setupAFSKdecoder(), micros() wraps after 71 minutes
+static volatile bool selfTest = false; // Frames are counted but go nowhere
+
+// CPU clock is shared: it drops only while every port is idle
+static portMUX_TYPE clockLock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t activePorts = 0;
+
+// Frames from different ports must not interleave on the KISS link
+static SemaphoreHandle_t kissMutex = NULL;
+
+// Receive latency histograms, shared by the decoder tasks
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+static frame_tracer_t rxTrace;
 
-#define SAMPLE_RATE 9600  // Sample rate for AFSK demodulation
-#define ADC_MIDPOINT 2048 // ESP32 12-bit resolution is 4096
-#define GOERTZEL_N 64	  // Number of samples for Goertzel filter
-#define MARK_FREQ 1200	  // Mark frequency for AFSK
-#define SPACE_FREQ 2200	  // Space frequency for AFSK
+#if FEATURE_DIGIPEATER
+#define DIGI_QUEUE_FRAMES 2 // Repeated frames waiting for loop(), which owns the transmit queue
 
-// Coefficients for Goertzel filter
-float coeffMark;
-float coeffSpace;
+typedef struct
+{
+	uint8_t data[KISS_MAX_FRAME];
+	uint16_t length;
+	uint32_t receivedUs; // Capture of the closing flag, the first stage of the transmit trace
+} digi_item_t;
+
+static digi_t digi;					   // Guarded by digiMutex, decoder tasks share it
+static SemaphoreHandle_t digiMutex = NULL;
+static QueueHandle_t digiQueue = NULL;
+static uint32_t digiQueueFull = 0;
 
 /**
- * @brief Initializes the Goertzel filter coefficients for mark and space frequencies.
- *
- * This function calculates the angular frequencies for the MARK_FREQ and SPACE_FREQ
- * based on the defined SAMPLE_RATE. It then computes and assigns the corresponding
- * Goertzel filter coefficients (coeffMark and coeffSpace) using the cosine of the
- * calculated angular frequencies.
+ * @brief Hands a decoded frame to the digipeater; a frame to repeat is queued for loop()
+ */
+static void repeatFrame(const uint8_t *frame, size_t len, uint32_t receivedUs)
+{
+	static digi_item_t item; // Guarded by digiMutex
+	xSemaphoreTake(digiMutex, portMAX_DELAY);
+	item.length = (uint16_t)digiProcess(&digi, frame, len, item.data, sizeof(item.data));
+	item.receivedUs = receivedUs;
+	if (item.length > 0 && xQueueSend(digiQueue, &item, 0) != pdTRUE)
+	{
+		digiQueueFull++;
+		deadlineMiss(DEADLINE_QUEUE, 0, "digiQueue, frame bytes", item.length);
+	}
+	xSemaphoreGive(digiMutex);
+}
+
+static void digiQueueUsage(void *ctx, uint32_t *used, uint32_t *capacity)
+{
+	*used = uxQueueMessagesWaiting(digiQueue);
+	*capacity = DIGI_QUEUE_FRAMES;
+}
+#endif
+
+/**
+ * @brief Frames a KISS packet and writes it to BTSerial in one call, under kissMutex
  *
- * Assumes that MARK_FREQ, SPACE_FREQ, SAMPLE_RATE, coeffMark, and coeffSpace are
- * defined and accessible in the current scope.
+ * Without FEATURE_BT_CLASSIC there is no host link and the packet is dropped.
  */
-void setupAFSKdecoder()
+static void sendKISS(uint8_t port, uint8_t command, const uint8_t *data, size_t len)
 {
-	float omegaMark = 2.0 * PI * MARK_FREQ / SAMPLE_RATE;
-	float omegaSpace = 2.0 * PI * SPACE_FREQ / SAMPLE_RATE;
-	coeffMark = 2.0 * cos(omegaMark);
-	coeffSpace = 2.0 * cos(omegaSpace);
-	analogReadResolution(12); // Set ADC resolution to 12 bits for ESP32
-	pinMode(RX_PIN, INPUT);	  // Set RX pin as input for analog read
+#if FEATURE_BT_CLASSIC
+	static uint8_t encoded[KISS_MAX_ENCODED(KISS_MAX_FRAME)]; // Guarded by kissMutex
+
+	if (kissMutex != NULL)
+	{
+		xSemaphoreTake(kissMutex, portMAX_DELAY);
+	}
+
+	size_t n = kissEncode(port, command, data, len, encoded, sizeof(encoded));
+	if (n > 0)
+	{
+		BTSerial.write(encoded, n);
+	}
+
+	if (kissMutex != NULL)
+	{
+		xSemaphoreGive(kissMutex);
+	}
+#endif
 }
 
 /**
  * @brief Sends a data packet using the KISS protocol over Bluetooth serial.
  *
- * This function frames the provided data according to the KISS protocol,
- * escaping special characters as required, and writes the framed packet
- * to the BTSerial interface.
+ * This function frames the provided data according to the KISS protocol
+ * (kissEncode()) and writes the framed packet to the BTSerial interface in one
+ * call. The port number goes in the high nibble of the command byte, so port 0
+ * keeps the classic 0x00 data frame.
  *
+ * @param port KISS port (0-15) the frame was received on.
  * @param data Pointer to the data buffer to be sent.
- * @param len  Length of the data buffer in bytes.
+ * @param len  Length of the data buffer in bytes, at most KISS_MAX_FRAME.
+ *
+ * Safe to call from several decoder tasks.
+ */
+void sendKISSpacket(uint8_t port, const uint8_t *data, size_t len)
+{
+	sendKISS(port, KISS_CMD_DATA, data, len);
+}
+
+/**
+ * @brief Tells the host that an ACKMODE frame has been transmitted.
+ *
+ * @param port KISS port the frame was queued on.
+ * @param tag Tag from the ACKMODE frame, sent back high byte first.
+ */
+void sendKISSack(uint8_t port, uint16_t tag)
+{
+	uint8_t data[KISS_ACK_TAG_LEN] = {(uint8_t)(tag >> 8), (uint8_t)tag};
+	sendKISS(port, KISS_CMD_ACKMODE, data, sizeof(data));
+}
+
+/**
+ * @brief Sends a SETHARDWARE reply, such as a self-test report, to the host.
+ *
+ * @param port KISS port of the command being answered.
+ * @param data Reply payload.
+ * @param len  Length of the payload, at most KISS_MAX_FRAME.
+ */
+void sendKISShardware(uint8_t port, const uint8_t *data, size_t len)
+{
+	sendKISS(port, KISS_CMD_SETHARDWARE, data, len);
+}
+
+/**
+ * @brief Counts a decoded frame and forwards it to the host.
+ *
+ * A frame whose opening flag arrived before the squelch opened is a missed
+ * preamble: in RX_SQUELCH_GATED mode the demodulator would not have seen it.
+ * The frame length gives its start on the channel's sample timeline, to within
+ * one audio block. Frames a cascade variant finds in replayed history are
+ * late and not checked. During a self-test frames are only counted.
+ *
+ * The frame's trace starts at the capture of the block holding its closing
+ * flag; the digipeater runs before the host write so its delay is one stage.
+ */
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	rx_port_t *rx = (rx_port_t *)ctx;
+	rx->stats.frames++;
+	bool replayed = false; // From a cascade variant, late by design
+#if RX_DECODE_CASCADE
+	replayed = rx->cascadeOn && rx->cascade.retrying;
+#endif
+
+	// Opening flag + frame + FCS, ignoring bit stuffing
+	uint64_t frameSamples = (uint64_t)(len + 3) * 8 * AUDIO_RX_SAMPLE_RATE / rx->mode->baudRate;
+	uint64_t startSample = rx->sampleCount > frameSamples ? rx->sampleCount - frameSamples : 0;
+	if (squelchMode != RX_SQUELCH_OFF && !replayed && (!rx->active || rx->openedAtSample > startSample))
+	{
+		rx->stats.missedPreambles++;
+	}
+
+	if (selfTest)
+	{
+		return; // Recorded traffic must not reach the host or the air
+	}
+	frame_trace_t trace;
+	portENTER_CRITICAL(&traceLock);
+	traceBegin(&rxTrace, &trace, port, len);
+	portEXIT_CRITICAL(&traceLock);
+	traceStamp(&trace, TRACE_RX_FLAG, rx->blockUs);
+	traceStamp(&trace, TRACE_RX_CRC, micros());
+#if FEATURE_DIGIPEATER
+	repeatFrame(frame, len, rx->blockUs);
+#endif
+	traceStamp(&trace, TRACE_RX_ROUTED, micros());
+	sendKISSpacket(port, frame, len);
+#if FEATURE_BT_CLASSIC
+	traceStamp(&trace, TRACE_RX_WRITTEN, micros());
+#endif
+	portENTER_CRITICAL(&traceLock);
+	traceEnd(&rxTrace, &trace);
+	portEXIT_CRITICAL(&traceLock);
+#if FRAME_TRACE_LOG
+	char line[FRAME_TRACE_LINE];
+	traceFormatFrame(&rxTrace, &trace, line, sizeof(line));
+	Serial.println(line);
+#endif
+}
+
+#if RX_DECODE_CASCADE && RX_SHED_ON_OVERLOAD
+/**
+ * @brief Sheds the cascade's replay variants while the decoders miss deadlines.
+ *
+ * Overload is this port's block past RX_DEADLINE_US or audio dropped on any
+ * channel, since the ports share the CPU. Only bit-repair stays on; the
+ * variants come back after RX_SHED_HOLD_MS without either.
+ *
+ * @param rx Port whose block was just demodulated.
+ * @param onTime The block met its deadline.
+ */
+static void shedOnOverload(rx_port_t *rx, bool onTime)
+{
+	uint32_t now = millis();
+	if (!onTime || deadlineMissedSince(DEADLINE_CAPTURE, &rx->captureMisses) > 0)
+	{
+		rx->onTimeSinceMs = now;
+		if (!rx->shed)
+		{
+			cascadeSetVariants(&rx->cascade, 1u << CASCADE_BIT_REPAIR);
+			rx->shed = true;
+			rx->sheds++;
+		}
+	}
+	else if (rx->shed && now - rx->onTimeSinceMs >= RX_SHED_HOLD_MS)
+	{
+		cascadeSetVariants(&rx->cascade, CASCADE_ALL_VARIANTS);
+		rx->shed = false;
+	}
+}
+#endif
+
+/**
+ * @brief Tracks squelch transitions, time spent in each state and the CPU clock.
  *
- * The function automatically handles the insertion of KISS frame delimiters
- * and escapes any occurrence of the special characters FEND (0xC0) and FESC (0xDB)
- * within the data payload.
+ * @param rx Port whose squelch was just updated.
+ * @param open Squelch state after the latest block.
  */
-void sendKISSpacket(uint8_t *data, size_t len)
+static void updatePowerState(rx_port_t *rx, bool open)
 {
-	// KISS protocol special characters
-	const uint8_t FEND = 0xC0;	// Frame End
-	const uint8_t FESC = 0xDB;	// Frame Escape
-	const uint8_t TFEND = 0xDC; // Transposed FEND
-	const uint8_t TFESC = 0xDD; // Transposed FESC
+	uint32_t now = micros();
+	if (rx->active)
+	{
+		rx->stats.activeUs += now - rx->stateSinceUs;
+	}
+	else
+	{
+		rx->stats.idleUs += now - rx->stateSinceUs;
+	}
+	rx->stateSinceUs = now;
+
+	if (open == rx->active)
+	{
+		return;
+	}
+
+	rx->active = open;
+	if (open)
+	{
+		rx->stats.wakes++;
+		rx->framesAtWake = rx->stats.frames;
+		rx->openedAtSample = rx->sampleCount;
+	}
+	else if (rx->stats.frames == rx->framesAtWake)
+	{
+		rx->stats.falseWakes++;
+	}
 
-	BTSerial.write(FEND);
-	BTSerial.write(0x00); // Indicates start of KISS data frame
+	// First port to wake raises the clock, last port to sleep lowers it
+	portENTER_CRITICAL(&clockLock);
+	activePorts += open ? 1 : -1;
+	bool change = (open && activePorts == 1) || (!open && activePorts == 0);
+	portEXIT_CRITICAL(&clockLock);
+	if (change && squelchMode == RX_SQUELCH_GATED)
+	{
+		setCpuFrequencyMhz(open ? RX_ACTIVE_CPU_MHZ : RX_IDLE_CPU_MHZ);
+	}
+}
 
-	for (size_t i = 0; i < len; i++)
+/**
+ * @brief Decoder task: squelch and demodulate every block of one port.
+ *
+ * The squelch detector sees every block first. In RX_SQUELCH_GATED mode a closed
+ * squelch skips the demodulator; the block that opens it is demodulated. The
+ * detector needs a block or two of carrier: "program squelch" measures a worst
+ * wake of 12.1 ms (1.8 flags) from the first flag at 8 dB SNR, inside the
+ * preamble.
+ */
+static void decoderTask(void *arg)
+{
+	rx_port_t *rx = (rx_port_t *)arg;
+	for (;;)
 	{
-		if (data[i] == FEND)
+		audio_block_t *block = audioReceiveBlock(rx->reader, RX_BLOCK_TIMEOUT_MS);
+		if (block == NULL)
+		{
+			continue;
+		}
+
+		uint32_t startUs = micros();
+		allocTrapEnter("adcToKiss");
+		if (rx->stats.blocks > 0)
 		{
-			BTSerial.write(FESC);
-			BTSerial.write(TFEND);
+			// Blocks published before audioOpenReader() numbered from audioBegin() are not lost
+			rx->stats.lostBlocks += block->sequence - rx->nextSequence;
 		}
-		else if (data[i] == FESC)
+		rx->nextSequence = block->sequence + 1;
+		rx->stats.blocks++;
+		rx->blockUs = block->capturedUs;
+		rx->sampleCount += AUDIO_BLOCK_SAMPLES;
+#if RX_EYE_MONITOR
+		if (rx->eyeReset)
 		{
-			BTSerial.write(FESC);
-			BTSerial.write(TFESC);
+			eyeMonitorReset(&rx->eye);
+			rx->eyeReset = false;
+		}
+#endif
+
+		bool demodulate = true;
+		if (squelchMode != RX_SQUELCH_OFF)
+		{
+			updatePowerState(rx, squelchProcess(&rx->squelch, block->samples, AUDIO_BLOCK_SAMPLES));
+			demodulate = rx->active || squelchMode != RX_SQUELCH_GATED;
+		}
+#if RX_DECODE_CASCADE
+		if (rx->cascadeOn)
+		{
+			// A burst or replay started before the squelch closed is finished
+			if (demodulate || cascadeBusy(&rx->cascade))
+			{
+				cascadeProcess(&rx->cascade, block->samples, AUDIO_BLOCK_SAMPLES);
+			}
 		}
 		else
+#endif
+		if (demodulate)
+		{
+			afskDemodProcess(&rx->demod, block->samples, AUDIO_BLOCK_SAMPLES);
+		}
+		audioReleaseBlock(block);
+		allocTrapLeave();
+		uint32_t doneUs = micros();
+		rx->stats.busyUs += doneUs - startUs;
+		if (selfTest)
+		{
+			continue; // A replay runs the decoders flat out, behind its injection by design
+		}
+		bool onTime = deadlineCheck(DEADLINE_DEMOD, doneUs - rx->blockUs, "port", (uint32_t)(rx - rxPorts));
+#if RX_DECODE_CASCADE && RX_SHED_ON_OVERLOAD
+		if (rx->cascadeOn)
+		{
+			shedOnOverload(rx, onTime);
+		}
+#else
+		(void)onTime;
+#endif
+	}
+}
+
+/**
+ * @brief Starts one decoder task per receive channel and modem profile.
+ *
+ * Every profile in RX_MODES gets a demodulator with the RX_FRONT_END front end
+ * and its own squelch on every channel. KISS ports number the channels of the
+ * first profile, then those of the next: with two channels and both modes,
+ * ports 0 and 1 are 1200 baud and ports 2 and 3 are 300 baud. Each port reads
+ * the channel's blocks through its own audio reader, so the profiles share the
+ * samples without a copy.
+ * With RX_DECODE_CASCADE each demodulator is the primary of a decodeCascade
+ * with RX_CASCADE_HISTORY_MS of history; if the history cannot be allocated
+ * the port runs the demodulator alone.
+ * Even ports run on core 1 next to loop() and odd ports on core 0, so the
+ * channels of one profile, or the profiles of one channel, use both cores.
+ */
+void setupAFSKdecoder()
+{
+	if (kissMutex == NULL)
+	{
+		kissMutex = xSemaphoreCreateMutex();
+	}
+#if FEATURE_DIGIPEATER
+	if (digiMutex == NULL)
+	{
+		digiMutex = xSemaphoreCreateMutex();
+		digiQueue = xQueueCreate(DIGI_QUEUE_FRAMES, sizeof(digi_item_t));
+		memMonitorWatchPool("digiQueue", digiQueueUsage, NULL);
+		if (!digiInit(&digi, DIGI_CALL, DIGI_SSID, DIGI_MAX_HOPS))
+		{
+			Serial.printf("Digipeater: invalid callsign %s-%u\n", DIGI_CALL, DIGI_SSID);
+		}
+	}
+#endif
+	rxStartUs = esp_timer_get_time();
+	deadlineDeclare(DEADLINE_DEMOD, RX_DEADLINE_US);
+	traceInit(&rxTrace, "RX", traceRxStageNames, TRACE_RX_STAGES);
+	uint8_t channels = audioChannelCount();
+	uint8_t port = 0;
+	for (size_t m = 0; m < sizeof(rxModes) / sizeof(rxModes[0]); m++)
+	{
+		if ((RX_MODES & rxModes[m].mode) == 0)
+		{
+			continue;
+		}
+		for (uint8_t ch = 0; ch < channels && port < RX_MAX_PORTS; ch++, port++)
 		{
-			BTSerial.write(data[i]);
+			rx_port_t *rx = &rxPorts[port];
+			if (rx->task != NULL)
+			{
+				continue; // Already running
+			}
+			const afsk_profile_t profile = {rxModes[m].markFreq, rxModes[m].spaceFreq, rxModes[m].baudRate,
+											AUDIO_RX_SAMPLE_RATE, RX_FRONT_END};
+			memset(rx, 0, sizeof(*rx));
+			rx->channel = ch;
+			rx->mode = &rxModes[m];
+			rx->stateSinceUs = micros();
+			rx->active = true;
+			if (!afskDemodInit(&rx->demod, &profile, port, onFrame, rx))
+			{
+				Serial.printf("Port %u: %s baud profile not supported by the %s front end\n", port, rx->mode->name,
+							  afskFrontEndName(profile.frontEnd));
+				rx->mode = NULL;
+				continue;
+			}
+#if RX_DECODE_CASCADE
+			size_t historyLength = (size_t)AUDIO_RX_SAMPLE_RATE * RX_CASCADE_HISTORY_MS / 1000;
+			int16_t *history = (int16_t *)malloc(historyLength * sizeof(int16_t));
+			rx->cascadeOn = history != NULL && cascadeInit(&rx->cascade, &rx->demod, &profile, port, onFrame, rx,
+														   history, historyLength);
+			if (!rx->cascadeOn)
+			{
+				free(history);
+				Serial.printf("Port %u: decode cascade off, no room for %u ms of history\n", port,
+							  RX_CASCADE_HISTORY_MS);
+				afskDemodInit(&rx->demod, &profile, port, onFrame, rx);
+			}
+#endif
+#if RX_EYE_MONITOR
+			eyeMonitorReset(&rx->eye);
+			afskDemodSetEyeMonitor(&rx->demod, &rx->eye); // After cascadeInit(), which initializes demod
+#endif
+			int8_t reader = audioOpenReader(ch);
+			if (reader < 0)
+			{
+				Serial.printf("Port %u: no audio reader left for channel %u\n", port, ch);
+#if RX_DECODE_CASCADE
+				if (rx->cascadeOn)
+				{
+					free(rx->cascade.history);
+				}
+#endif
+				rx->mode = NULL;
+				continue;
+			}
+			rx->reader = (uint8_t)reader;
+			squelchInit(&rx->squelch, RX_SQUELCH_DECIMATION, RX_SQUELCH_OPEN_DB, RX_SQUELCH_CLOSE_DB,
+						RX_SQUELCH_HANG_BLOCKS, RX_SQUELCH_MIN_LEVEL);
+
+			portENTER_CRITICAL(&clockLock);
+			activePorts++; // Ports start active until their squelch settles
+			portEXIT_CRITICAL(&clockLock);
+
+			char name[12];
+			snprintf(name, sizeof(name), "afskRx%u", port);
+			xTaskCreatePinnedToCore(decoderTask, name, RX_TASK_STACK, rx, RX_TASK_PRIORITY, &rx->task, (port + 1) % 2);
 		}
 	}
-	BTSerial.write(FEND);
+	rxPortCount = port;
+}
+
+/**
+ * @brief Selects how the energy detector gates the demodulators.
+ *
+ * GATED skips the demodulator and drops the CPU to RX_IDLE_CPU_MHZ while every
+ * port's squelch is closed. SHADOW keeps demodulating at full clock but counts
+ * frames that started while the squelch was closed, which is the missed-preamble
+ * rate GATED would have had with the same settings.
+ *
+ * @param mode RX_SQUELCH_OFF, RX_SQUELCH_GATED or RX_SQUELCH_SHADOW
+ */
+void setReceiveSquelchMode(rx_squelch_mode_t mode)
+{
+	squelchMode = mode;
+	if (mode != RX_SQUELCH_GATED && getCpuFrequencyMhz() != RX_ACTIVE_CPU_MHZ)
+	{
+		setCpuFrequencyMhz(RX_ACTIVE_CPU_MHZ);
+	}
+}
+
+/**
+ * @brief Counts decoded frames without sending them to the host or the digipeater.
+ *
+ * For stored audio injected through the audio HAL (audioReplay.h).
+ *
+ * @param on true while the self-test audio is being decoded.
+ */
+void setReceiveSelfTest(bool on)
+{
+	selfTest = on;
 }
 
-// CRC-16-CCITT implementation
 /**
- * @brief Calculates the CRC-16-CCITT checksum for the given data.
+ * @brief Copies the receive accounting counters of one port.
  *
- * @param data Pointer to the data buffer.
- * @param len Length of the data buffer in bytes.
- * @return The computed 16-bit CRC value.
+ * @param port KISS port number.
+ * @param stats Destination for the counters.
+ * @return false if the port is not running.
  */
-uint16_t crc16_ccitt(uint8_t *data, size_t len)
+bool getReceivePowerStats(uint8_t port, rx_power_stats_t *stats)
 {
-	uint16_t crc = 0xFFFF;
-	for (size_t i = 0; i < len; i++)
+	if (port >= rxPortCount || rxPorts[port].mode == NULL)
 	{
-		crc ^= (uint16_t)data[i] << 8;
-		for (int j = 0; j < 8; j++)
-			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		return false;
 	}
-	return crc;
+	*stats = rxPorts[port].stats;
+	return true;
 }
 
 /**
- * @brief Processes a single decoded NRZ bit for AX.25/KISS frame detection and extraction.
+ * @brief Gives access to the eye diagram of one port.
  *
- * This function handles bit-stuffing removal, frame flag detection, and frame buffering.
- * When a complete frame is detected and its CRC is valid, the frame is passed to sendKISSpacket().
+ * The decoder task keeps adding to it, so a reader may see a bin or two from
+ * different moments; fine for a diagnostic.
  *
- * @param bit The next NRZ bit to process (true for '1', false for '0').
+ * @param port KISS port number.
+ * @return The port's monitor, NULL if the port is not running or RX_EYE_MONITOR is 0.
+ */
+const eye_monitor_t *getReceiveEye(uint8_t port)
+{
+#if RX_EYE_MONITOR
+	if (port < rxPortCount && rxPorts[port].mode != NULL)
+	{
+		return &rxPorts[port].eye;
+	}
+#endif
+	return NULL;
+}
+
+/**
+ * @brief Starts a new eye diagram on one port with its next audio block.
  *
- * Internal logic:
- * - Removes bit-stuffing by counting consecutive '1's and skipping the 6th.
- * - Detects KISS frame flags using a shift register.
- * - Buffers frame bits into frameBuffer.
- * - On frame end, checks CRC (using crc16_ccitt) and sends valid frames.
+ * @param port KISS port number.
  */
-void handleBit(bool bit)
+void resetReceiveEye(uint8_t port)
 {
-	const uint8_t KISS_FRAME_FLAG = 0x7E; // KISS frame flag
-	bool lastNRZ = true;
-	int oneCount = 0;
-	uint32_t shiftReg = 0;
-	bool inFrame = false;
-	uint8_t frameBuffer[330];
-	int frameIndex = 0;
+#if RX_EYE_MONITOR
+	if (port < rxPortCount)
+	{
+		rxPorts[port].eyeReset = true;
+	}
+#endif
+}
 
-	bool decoded = lastNRZ ^ bit;
-	lastNRZ = bit;
-	oneCount = decoded ? oneCount + 1 : 0;
-	if (oneCount == 6)
+/**
+ * @brief Reports whether any port currently hears a packet signal.
+ *
+ * A port whose squelch is closed in RX_SQUELCH_GATED mode is not demodulating,
+ * so its last DCD state is stale and it counts as clear.
+ *
+ * @return true while any port's demodulator has DCD.
+ */
+bool getReceiveDcd()
+{
+	for (uint8_t p = 0; p < rxPortCount; p++)
 	{
-		return;
+		const rx_port_t *rx = &rxPorts[p];
+		bool demodulating = rx->active || squelchMode != RX_SQUELCH_GATED;
+		if (rx->mode != NULL && demodulating && afskDemodDcd(&rx->demod))
+		{
+			return true;
+		}
 	}
+	return false;
+}
 
-	shiftReg = (shiftReg >> 1) | (decoded << 7);
-	if (shiftReg == KISS_FRAME_FLAG)
+/**
+ * @brief Prints wake statistics, estimated average current and CPU load per port.
+ *
+ * The current is a time-weighted average of RX_IDLE_CURRENT_MA and
+ * RX_ACTIVE_CURRENT_MA, so calibrate those two values for the board. CPU load
+ * is the time spent in each port's squelch and demodulator over the time since
+ * setupAFSKdecoder(), at whatever clock was running; compare runs with one and
+ * two ports and RX_SQUELCH_OFF to get the cost of each added channel. The CPU
+ * load is also summed per modem profile, the cost of each added mode.
+ */
+void printReceivePowerStats()
+{
+	uint64_t elapsedUs = esp_timer_get_time() - rxStartUs;
+	float totalCpu = 0.0f;
+	float modeCpu[sizeof(rxModes) / sizeof(rxModes[0])] = {};
+	for (uint8_t p = 0; p < rxPortCount; p++)
 	{
-		if (inFrame && frameIndex >= 3)
+		const rx_port_t *rx = &rxPorts[p];
+		if (rx->mode == NULL)
+		{
+			continue;
+		}
+		const rx_power_stats_t *s = &rx->stats;
+		uint64_t total = s->idleUs + s->activeUs;
+		float idleFraction = total ? (float)s->idleUs / total : 0.0f;
+		float averageMa = idleFraction * RX_IDLE_CURRENT_MA + (1.0f - idleFraction) * RX_ACTIVE_CURRENT_MA;
+		float cpu = elapsedUs ? 100.0f * s->busyUs / elapsedUs : 0.0f;
+		totalCpu += cpu;
+		modeCpu[rx->mode - rxModes] += cpu;
+		Serial.printf("RX port %u (%s baud, channel %u): idle %.1f%%, est. %.1f mA, wakes %lu (false %lu), frames %lu, missed preambles %lu, "
+					  "CPU %.1f%% (%.1f us/block), lost blocks %lu\n",
+					  p, rx->mode->name, rx->channel, idleFraction * 100.0f, averageMa, s->wakes, s->falseWakes, s->frames, s->missedPreambles,
+					  cpu, s->blocks ? (float)s->busyUs / s->blocks : 0.0f, s->lostBlocks);
+#if RX_EYE_MONITOR
+		eye_summary_t eye;
+		eyeMonitorSummary(&rx->eye, &eye);
+		Serial.printf("  eye: opening %.0f%%, rails %+.2f/%+.2f, timing mean %+.3f rms %.3f bit over %lu transitions\n",
+					  100.0f * eye.opening, eye.markRail, eye.spaceRail, eye.timingMean, eye.timingRms,
+					  eye.transitions);
+#endif
+#if RX_DECODE_CASCADE
+		if (rx->cascadeOn)
 		{
-			uint16_t crc = crc16_ccitt(frameBuffer, frameIndex - 2);
-			if (crc == 0xF0B8)
+			const cascade_stats_t *cs = &rx->cascade.stats;
+			Serial.printf("  cascade: bursts %lu, failed %lu, retried %lu (skipped %lu, overrun %lu, shed %lu), "
+						  "recovered %lu, replayed %.1f%%, variants shed %lu times%s\n ",
+						  cs->bursts, cs->failedBursts, cs->retries, cs->skipped, cs->overruns, cs->shed,
+						  cs->recovered, cs->primarySamples ? 100.0f * cs->replaySamples / cs->primarySamples : 0.0f,
+						  rx->sheds, rx->shed ? " (now)" : "");
+			for (int i = 0; i < CASCADE_VARIANTS; i++)
 			{
-				sendKISSpacket(frameBuffer, frameIndex - 2);
+				Serial.printf(" %s %lu/%lu", cascadeVariantName((cascade_variant_t)i), cs->successes[i], cs->tries[i]);
 			}
+			Serial.println();
 		}
-		frameIndex = 0;
-		inFrame = true;
-		return;
+#endif
 	}
-
-	if (inFrame && frameIndex < sizeof(frameBuffer))
+	for (size_t m = 0; m < sizeof(rxModes) / sizeof(rxModes[0]); m++)
+	{
+		if (RX_MODES & rxModes[m].mode)
+		{
+			Serial.printf("RX %s baud: CPU %.1f%% of one core\n", rxModes[m].name, modeCpu[m]);
+		}
+	}
+	Serial.printf("RX total: %u ports, CPU %.1f%% of one core, dropped blocks %lu\n",
+				  rxPortCount, totalCpu, audioDroppedBlocks());
+	static frame_tracer_t trace; // Copy, the decoder tasks keep adding to rxTrace
+	portENTER_CRITICAL(&traceLock);
+	trace = rxTrace;
+	portEXIT_CRITICAL(&traceLock);
+	char line[FRAME_TRACE_LINE];
+	for (uint8_t slot = 0; slot < TRACE_RX_STAGES; slot++)
 	{
-		frameBuffer[frameIndex / 8] |= (decoded << (frameIndex % 8));
-		frameIndex++;
+		if (traceFormatStage(&trace, slot, line, sizeof(line)) > 0)
+		{
+			Serial.println(line);
+		}
 	}
+#if FEATURE_DIGIPEATER
+	Serial.printf("Digi %s-%u: repeated %lu, duplicates %lu, not for us %lu, queue full %lu\n", DIGI_CALL, DIGI_SSID,
+				  digi.repeated, digi.duplicates, digi.ignored, digiQueueFull);
+#endif
 }
 
 /**
- * @brief Processes a block of audio samples using the Goertzel algorithm to detect mark and space frequencies.
- *
- * This function reads a series of samples from the ADC, centers them around zero, and applies the Goertzel filter
- * to detect the presence of two specific frequencies (mark and space). It calculates the squared magnitude for each
- * frequency and determines which frequency is dominant in the current block of samples. The detected bit is then
- * passed to the handleBit function for further processing.
+ * @brief Moves frames to repeat from the decoder tasks to the transmit queue.
  *
- * Assumes the following external variables and constants are defined:
- * - GOERTZEL_N: Number of samples per block.
- * - RX_PIN: ADC pin to read samples from.
- * - ADC_MIDPOINT: Value to center the ADC reading around zero.
- * - coeffMark: Goertzel coefficient for the mark frequency.
- * - coeffSpace: Goertzel coefficient for the space frequency.
- * - handleBit(bool): Function to handle the detected bit.
+ * Call in loop(); does nothing unless FEATURE_DIGIPEATER is set.
  */
-void receiveAFSK()
+void pollDigipeater()
 {
-	float qm1 = 0; // Previous sample for mark frequency
-	float qm2 = 0; // Second previous sample for mark frequency
-	float qs1 = 0; // Previous sample for space frequency
-	float qs2 = 0; // Second previous sample for space frequency
-	// Read a sample from the ADC, centered around the ADC midpoint
-	// and process it through mark and space Goertzel filters
-	for (int i = 0; i < GOERTZEL_N; i++)
+#if FEATURE_DIGIPEATER
+	digi_item_t item;
+	while (digiQueue != NULL && xQueueReceive(digiQueue, &item, 0) == pdTRUE)
 	{
-		int sample = analogRead(RX_PIN) - ADC_MIDPOINT;
-		float in = (float)sample;
-		float new_qm = coeffMark * qm1 - qm2 + in;
-		float new_qs = coeffSpace * qs1 - qs2 + in;
-		qm2 = qm1;
-		qm1 = new_qm;
-		qs2 = qs1;
-		qs1 = new_qs;
+		txQueueFrame(item.data, item.length, item.receivedUs);
 	}
-	// Calculate the squared magnitude for each frequency using the Goertzel algorithm
-	float magMark = qm1 * qm1 + qm2 * qm2 - qm1 * qm2 * coeffMark;
-	float magSpace = qs1 * qs1 + qs2 * qs2 - qs1 * qs2 * coeffSpace;
-	bool bit = magMark > magSpace;
-	handleBit(bit);
+#endif
 }
@@ -0,0 +1,407 @@
+/**
+ * @file afskDemod.cpp
+ * @date 2025-09-11
+ * @brief Per-channel AFSK demodulator: tone discriminator, bit clock recovery and HDLC deframing.
+ */
+
+#include "afskDemod.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TRIG_TABLE_BITS 8
+#define TRIG_TABLE_SIZE (1 << TRIG_TABLE_BITS)
+
+#define PLL_LOCKED_INERTIA 0.75f	   // Keep 75% of the timing error when locked
+#define PLL_SEARCH_INERTIA 0.5f		   // Pull in faster while searching
+#define DCD_GOOD_WINDOW (1 << 30)	   // Transition within a quarter bit of the expected edge
+#define DCD_SCORE_MAX 32
+#define DCD_ON 16
+#define DCD_OFF 8
+#define EYE_DCD_SCORE (DCD_SCORE_MAX - 2) // Eye samples stop at the second bad transition, before the DCD hangover
+#define DELAY_MIN_CONTRAST 0.3f // Weaker of the two tones' |cos(2 pi f delay)| a delay must reach
+#define DC_SHIFT 8				// Zero-crossing DC tracker time constant, 2^8 samples
+
+// Q15 cosine and sine, shared by all instances
+static int16_t cosTable[TRIG_TABLE_SIZE];
+static int16_t sinTable[TRIG_TABLE_SIZE];
+static bool trigReady = false;
+
+/**
+ * @brief Frame callback from the deframer, adds the port number
+ */
+static void deliverFrame(void *ctx, const uint8_t *frame, size_t len)
+{
+	afsk_demod_t *d = (afsk_demod_t *)ctx;
+	if (d->onFrame)
+	{
+		d->onFrame(d->ctx, d->port, frame, len);
+	}
+}
+
+/**
+ * @brief FCS error callback from the deframer, adds the port number
+ */
+static void deliverBadFrame(void *ctx, const uint8_t *frame, size_t len)
+{
+	afsk_demod_t *d = (afsk_demod_t *)ctx;
+	if (d->onBadFrame)
+	{
+		d->onBadFrame(d->ctx, d->port, frame, len);
+	}
+}
+
+/**
+ * @brief Pick the delay-line delay that best separates the tones
+ *
+ * The mean product of a tone with itself delay samples later is proportional
+ * to cos(2 pi f delay / sampleRate). The tones need opposite signs, and the
+ * smaller magnitude of the two is the margin against noise.
+ *
+ * @return false if no delay up to AFSK_DEMOD_MAX_DELAY reaches DELAY_MIN_CONTRAST
+ */
+static bool chooseDelay(afsk_demod_t *d)
+{
+	float best = DELAY_MIN_CONTRAST;
+	for (uint8_t delay = 1; delay <= AFSK_DEMOD_MAX_DELAY && delay < d->window; delay++)
+	{
+		float mark = cosf(2.0f * (float)M_PI * d->profile.markFreq * delay / d->profile.sampleRate);
+		float space = cosf(2.0f * (float)M_PI * d->profile.spaceFreq * delay / d->profile.sampleRate);
+		float contrast = fabsf(mark) < fabsf(space) ? fabsf(mark) : fabsf(space);
+		if (mark * space < 0.0f && contrast > best)
+		{
+			best = contrast;
+			d->delay = delay;
+			d->markPositive = mark > 0.0f;
+		}
+	}
+	return d->delay != 0;
+}
+
+/**
+ * @brief Configure a demodulator instance
+ * @param d Demodulator state
+ * @param profile Tone frequencies, baud rate and sample rate
+ * @param port KISS port number passed to onFrame
+ * @param onFrame Callback for decoded frames
+ * @param ctx Passed back to onFrame
+ * @return true on success, false if the profile does not fit AFSK_DEMOD_MAX_WINDOW or
+ *         the front end cannot tell its tones apart
+ */
+bool afskDemodInit(afsk_demod_t *d, const afsk_profile_t *profile, uint8_t port,
+				   afsk_frame_cb onFrame, void *ctx)
+{
+	if (!d || !profile || profile->baudRate == 0 || profile->sampleRate == 0 || profile->markFreq == 0 ||
+		profile->spaceFreq == 0)
+	{
+		return false;
+	}
+	uint32_t window = (profile->sampleRate + profile->baudRate / 2) / profile->baudRate;
+	if (window < 2 || window > AFSK_DEMOD_MAX_WINDOW)
+	{
+		return false;
+	}
+
+	if (!trigReady)
+	{
+		for (int i = 0; i < TRIG_TABLE_SIZE; i++)
+		{
+			float angle = 2.0f * (float)M_PI * i / TRIG_TABLE_SIZE;
+			cosTable[i] = (int16_t)lroundf(32767.0f * cosf(angle));
+			sinTable[i] = (int16_t)lroundf(32767.0f * sinf(angle));
+		}
+		trigReady = true;
+	}
+
+	memset(d, 0, sizeof(*d));
+	d->profile = *profile;
+	d->port = port;
+	d->window = (uint8_t)window;
+	d->markStep = (uint32_t)(((uint64_t)profile->markFreq << 32) / profile->sampleRate);
+	d->spaceStep = (uint32_t)(((uint64_t)profile->spaceFreq << 32) / profile->sampleRate);
+	d->pllStep = (uint32_t)(((uint64_t)profile->baudRate << 32) / profile->sampleRate);
+	d->onFrame = onFrame;
+	d->ctx = ctx;
+	hdlcInit(&d->hdlc, deliverFrame, d);
+
+	switch (profile->frontEnd)
+	{
+	case AFSK_FRONT_END_GOERTZEL:
+		return true;
+	case AFSK_FRONT_END_DELAY_LINE:
+		d->filterLen = (uint8_t)(window * 3 / 4);
+		return chooseDelay(d);
+	case AFSK_FRONT_END_ZERO_CROSSING:
+	{
+		// Half period in 1/256 samples is sampleRate * 128 / f
+		int32_t mark = (int32_t)(((uint64_t)profile->sampleRate << 7) / profile->markFreq);
+		int32_t space = (int32_t)(((uint64_t)profile->sampleRate << 7) / profile->spaceFreq);
+		d->filterLen = (uint8_t)(window / 2);
+		d->thresholdQ8 = (mark + space) / 2;
+		d->intervalQ8 = d->thresholdQ8;
+		d->markPositive = mark > space;
+		return profile->markFreq != profile->spaceFreq;
+	}
+	}
+	return false;
+}
+
+/**
+ * @brief Slide one product into a running sum
+ */
+static inline void slide(int32_t *sum, int16_t *history, uint8_t pos, int32_t product)
+{
+	*sum += product - history[pos];
+	history[pos] = (int16_t)product;
+}
+
+/**
+ * @brief Advance the PLL by one sample, slice a bit at the bit center and update DCD
+ *
+ * Transitions pull the PLL phase toward zero and score DCD by how close to
+ * zero they land.
+ */
+static inline void clockLevel(afsk_demod_t *d, bool level)
+{
+	// Sample the bit when the PLL passes the bit center
+	int32_t previous = d->pllPhase;
+	d->pllPhase = (int32_t)((uint32_t)d->pllPhase + d->pllStep);
+	if (previous >= 0 && d->pllPhase < 0)
+	{
+		hdlcBit(&d->hdlc, level);
+	}
+
+	// Align the PLL to transitions, which should land at phase zero
+	if (level != d->lastLevel)
+	{
+		d->lastLevel = level;
+		if (d->eye != NULL && d->dcd)
+		{
+			eyeMonitorTiming(d->eye, d->pllPhase);
+		}
+		bool good = d->pllPhase > -DCD_GOOD_WINDOW && d->pllPhase < DCD_GOOD_WINDOW;
+		if (good)
+		{
+			d->dcdScore = d->dcdScore < DCD_SCORE_MAX ? d->dcdScore + 1 : DCD_SCORE_MAX;
+		}
+		else
+		{
+			d->dcdScore = d->dcdScore > 2 ? d->dcdScore - 2 : 0;
+		}
+		if (d->dcdScore >= DCD_ON)
+			d->dcd = true;
+		else if (d->dcdScore < DCD_OFF)
+			d->dcd = false;
+
+		d->pllPhase = (int32_t)(d->pllPhase * (d->dcd ? PLL_LOCKED_INERTIA : PLL_SEARCH_INERTIA));
+	}
+}
+
+/**
+ * @brief Hand the discriminator value of the sample just clocked to the eye monitor
+ */
+static inline void observe(afsk_demod_t *d, float value)
+{
+	if (d->eye != NULL && d->dcdScore >= EYE_DCD_SCORE)
+	{
+		eyeMonitorSample(d->eye, d->pllPhase, value);
+	}
+}
+
+/**
+ * @brief Goertzel front end
+ *
+ * Per sample: correlate against both tones over the last bit, form the
+ * discriminator (m - s) / (m + s) from the squared magnitudes and clock its
+ * sign into the PLL.
+ */
+static void processGoertzel(afsk_demod_t *d, const int16_t *samples, size_t count)
+{
+	for (size_t n = 0; n < count; n++)
+	{
+		int32_t x = samples[n];
+		uint8_t mi = d->markPhase >> (32 - TRIG_TABLE_BITS);
+		uint8_t si = d->spacePhase >> (32 - TRIG_TABLE_BITS);
+		d->markPhase += d->markStep;
+		d->spacePhase += d->spaceStep;
+
+		slide(&d->markI, d->history[0], d->pos, (x * cosTable[mi]) >> 15);
+		slide(&d->markQ, d->history[1], d->pos, (x * sinTable[mi]) >> 15);
+		slide(&d->spaceI, d->history[2], d->pos, (x * cosTable[si]) >> 15);
+		slide(&d->spaceQ, d->history[3], d->pos, (x * sinTable[si]) >> 15);
+		if (++d->pos >= d->window)
+		{
+			d->pos = 0;
+		}
+
+		float mI = (float)d->markI, mQ = (float)d->markQ;
+		float sI = (float)d->spaceI, sQ = (float)d->spaceQ;
+		float mark = mI * mI + mQ * mQ;
+		float space = sI * sI + sQ * sQ;
+		float disc = (mark - space) / (mark + space + 1.0f);
+		clockLevel(d, disc > d->slicerLevel);
+		observe(d, disc - d->slicerLevel);
+	}
+}
+
+/**
+ * @brief Delay-line front end
+ *
+ * Per sample: multiply with the sample delay samples back, smooth over three
+ * quarters of a bit and clock the sign into the PLL.
+ */
+static void processDelayLine(afsk_demod_t *d, const int16_t *samples, size_t count)
+{
+	for (size_t n = 0; n < count; n++)
+	{
+		int32_t x = samples[n];
+		int32_t past = d->delayLine[d->delayPos];
+		d->delayLine[d->delayPos] = (int16_t)x;
+		if (++d->delayPos >= d->delay)
+		{
+			d->delayPos = 0;
+		}
+
+		slide(&d->filterSum, d->filterHistory, d->filterPos, (x * past) >> 16);
+		if (++d->filterPos >= d->filterLen)
+		{
+			d->filterPos = 0;
+		}
+		clockLevel(d, (d->filterSum > 0) == d->markPositive);
+		observe(d, (float)(d->markPositive ? d->filterSum : -d->filterSum));
+	}
+}
+
+/**
+ * @brief Zero-crossing front end
+ *
+ * Per sample: track and remove DC, and on a sign change measure the time since
+ * the previous crossing, interpolated between the two samples. The last half
+ * period is held until the next crossing; its distance from the threshold,
+ * smoothed over half a bit, is the discriminator.
+ */
+static void processZeroCrossing(afsk_demod_t *d, const int16_t *samples, size_t count)
+{
+	int32_t holdLimit = (int32_t)d->window << 8;
+	for (size_t n = 0; n < count; n++)
+	{
+		d->dcQ8 += samples[n] - (d->dcQ8 >> DC_SHIFT);
+		int32_t x = samples[n] - (d->dcQ8 >> DC_SHIFT);
+
+		d->sinceCrossQ8 += 256;
+		if ((x >= 0) != (d->lastSample >= 0))
+		{
+			// Time from the crossing to this sample, x / (x - previous) of a sample
+			int32_t afterQ8 = x * 256 / (x - d->lastSample);
+			d->intervalQ8 = d->sinceCrossQ8 - afterQ8;
+			d->sinceCrossQ8 = afterQ8;
+		}
+		else if (d->sinceCrossQ8 > holdLimit)
+		{
+			// No signal: stop counting so the interval stays in range
+			d->sinceCrossQ8 = holdLimit;
+			d->intervalQ8 = holdLimit;
+		}
+		d->lastSample = x;
+
+		slide(&d->filterSum, d->filterHistory, d->filterPos, d->intervalQ8 - d->thresholdQ8);
+		if (++d->filterPos >= d->filterLen)
+		{
+			d->filterPos = 0;
+		}
+		clockLevel(d, (d->filterSum > 0) == d->markPositive);
+		observe(d, (float)(d->markPositive ? d->filterSum : -d->filterSum));
+	}
+}
+
+/**
+ * @brief Demodulate a block of samples with the profile's front end
+ * @param d Demodulator state
+ * @param samples Signed 16-bit samples at profile.sampleRate
+ * @param count Number of samples
+ */
+void afskDemodProcess(afsk_demod_t *d, const int16_t *samples, size_t count)
+{
+	switch (d->profile.frontEnd)
+	{
+	case AFSK_FRONT_END_GOERTZEL:
+		processGoertzel(d, samples, count);
+		break;
+	case AFSK_FRONT_END_DELAY_LINE:
+		processDelayLine(d, samples, count);
+		break;
+	case AFSK_FRONT_END_ZERO_CROSSING:
+		processZeroCrossing(d, samples, count);
+		break;
+	}
+}
+
+/**
+ * @brief Advance the bit clock by one sample of an externally computed level
+ * @param d Demodulator state, its correlator fields are not used
+ * @param level true for mark
+ */
+void afskDemodClock(afsk_demod_t *d, bool level)
+{
+	clockLevel(d, level);
+}
+
+/**
+ * @brief Move the Goertzel front end's mark/space decision
+ * @param d Demodulator state
+ * @param level Mark when (m - s) / (m + s) is above level, -1 to 1, 0 after afskDemodInit()
+ */
+void afskDemodSetSlicer(afsk_demod_t *d, float level)
+{
+	d->slicerLevel = level;
+}
+
+/**
+ * @brief Deliver frames that fail the FCS check as well
+ * @param d Demodulator state
+ * @param onBadFrame Called with the frame and its FCS and the onFrame ctx, NULL to stop
+ */
+void afskDemodSetErrorCallback(afsk_demod_t *d, afsk_frame_cb onBadFrame)
+{
+	d->onBadFrame = onBadFrame;
+	hdlcSetErrorCallback(&d->hdlc, onBadFrame ? deliverBadFrame : NULL);
+}
+
+/**
+ * @brief Feed an eye monitor from this demodulator while its PLL is locked
+ * @param d Demodulator state
+ * @param eye Monitor, reset by the caller; NULL to stop
+ */
+void afskDemodSetEyeMonitor(afsk_demod_t *d, eye_monitor_t *eye)
+{
+	d->eye = eye;
+}
+
+/**
+ * @brief Get the data carrier detect state
+ * @param d Demodulator state
+ * @return true while transitions line up with the recovered bit clock
+ */
+bool afskDemodDcd(const afsk_demod_t *d)
+{
+	return d->dcd;
+}
+
+/**
+ * @brief Get the short name of a front end
+ * @param frontEnd Front end
+ * @return "goertzel", "delay-line", "zero-crossing" or "unknown"
+ */
+const char *afskFrontEndName(afsk_front_end_t frontEnd)
+{
+	switch (frontEnd)
+	{
+	case AFSK_FRONT_END_GOERTZEL:
+		return "goertzel";
+	case AFSK_FRONT_END_DELAY_LINE:
+		return "delay-line";
+	case AFSK_FRONT_END_ZERO_CROSSING:
+		return "zero-crossing";
+	}
+	return "unknown";
+}
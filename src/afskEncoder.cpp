@@ -7,11 +7,13 @@
  * the modern Arduino ESP32 framework without legacy ESP-IDF driver dependencies.
  *
  * Key Features:
- * - Uses dacWrite() instead of driver/dac.h functions
+ * - DAC, LEDC PWM or sigma-delta output written from an IRAM timer ISR through
+ *   the register-level HAL, so flash writes do not stall the tones
+ * - Noise-shaped quantization of 16-bit wave tables to the output resolution
+ * - Fixed-rate rendering for sample-block outputs such as an I2S codec
  * - Accurate timer-based frequency generation
- * - Sine wave table generation for clean AFSK tones
- * - AX.25 frame encoding with bit-stuffing
- * - NRZI encoding for AFSK transmission
+ * - Separate mark and space sine tables so twist is applied at render time
+ * - AX.25 frame validation, HDLC framing with bit-stuffing and NRZI (hdlc.h)
  * - PTT and LED control for radio interface
  * - Proper resource management and cleanup
  *
@@ -20,101 +22,245 @@
 
 #include "afskEncoder.h"
 #include "configuration.h"
+#include "afskModulator.h"
+#include "audioHal.h"
+#include "ax25.h"
+#include "deadlineMonitor.h"
+#include "hdlc.h"
+#include "noiseShaper.h"
 #include <math.h>
+#include <driver/timer.h>
+#include <hal/ledc_ll.h>
+#include <hal/sigmadelta_ll.h>
+#include <soc/gpio_sd_struct.h>
+#include <soc/ledc_struct.h>
+#if SOC_DAC_SUPPORTED
+#include <hal/dac_ll.h>
+#endif
 
 // Timer frequency after divider (80MHz / 8 = 10MHz)
 #define TIMER_FREQ (APB_CLK_FREQ / AFSK_TIMER_DIVIDER)
+#define AFSK_TIMER_GROUP TIMER_GROUP_0
+#define AFSK_TIMER_INDEX TIMER_0
+
+// LEDC group and channel behind Arduino's AFSK_PWM_CHANNEL, written directly by the ISR
+#if SOC_LEDC_SUPPORT_HS_MODE
+#define AFSK_PWM_SPEED_MODE ((ledc_mode_t)(AFSK_PWM_CHANNEL / 8)) // Arduino channels 0-7 are high speed
+#else
+#define AFSK_PWM_SPEED_MODE LEDC_LOW_SPEED_MODE
+#endif
+#define AFSK_PWM_LL_CHANNEL ((ledc_channel_t)(AFSK_PWM_CHANNEL % 8))
+
+// Wait for the ISR beyond the nominal length of a transmission
+#define AFSK_TX_TIMEOUT_MARGIN_MS 100
+
+// Block output buffer, enough for several bits at 48 kHz
+#define AFSK_BLOCK_SAMPLES 256
+
+// Line levels of one flag; NRZI from mark, every flag after the first is the same 8 levels
+#define AFSK_FLAG_LEVELS 8
 
 // Module state variables
 static struct
 {
-	uint8_t dacPin;
+	uint8_t dacPin; // Audio output pin, a DAC channel only for AFSK_OUTPUT_DAC
+	afsk_output_t output;
+	uint8_t shapingOrder;
 	int8_t pttPin;
 	int8_t pttLedPin;
 	uint16_t markFreq;
 	uint16_t spaceFreq;
 	uint16_t baudRate;
 	float amplitude;
+	float twistDb;
 	uint8_t samplesPerCycle;
+	uint16_t txDelayFlags; // Flags sent before each frame
 	bool initialized;
 	bool transmitting;
 } afsk_config = {
 	.dacPin = AFSK_DAC_PIN,
-	.pttPin = -1,
-	.pttLedPin = -1,
+	.output = AFSK_DEFAULT_OUTPUT,
+	.shapingOrder = AFSK_NOISE_SHAPING_ORDER,
+	.pttPin = PTT_PIN,
+	.pttLedPin = PTT_LED,
 	.markFreq = AFSK_MARK_FREQ,
 	.spaceFreq = AFSK_SPACE_FREQ,
 	.baudRate = AFSK_BAUD_RATE,
 	.amplitude = AFSK_AMPLITUDE,
+	.twistDb = AFSK_TWIST_DB,
 	.samplesPerCycle = AFSK_SAMPLES_PER_CYCLE,
+	.txDelayFlags = AFSK_TXDELAY_FLAGS,
 	.initialized = false,
 	.transmitting = false};
 
-// Hardware resources
-static hw_timer_t *afsk_timer = NULL;
-static uint8_t *waveTable = NULL;
+// Hardware resources. Everything the timer ISR touches is in DRAM and its code
+// in IRAM, so it keeps running while flash writes disable the cache.
+static bool timerReady = false;
+static DRAM_ATTR int16_t waveTable[2 * UINT8_MAX]; // Mark table followed by space table, samplesPerCycle each
+static DRAM_ATTR uint8_t txLevels[HDLC_ENCODED_LEVELS(HDLC_MAX_FRAME - 2, 1)]; // transmitAX25() frame, one preamble flag
+static const int16_t *volatile activeTable = NULL; // Table of the tone being sent
+static noise_shaper_t shaper;					   // Quantizer for the output resolution
+static afsk_modulator_t modulator;				   // Tone generator for AFSK_OUTPUT_BLOCK
 static volatile uint16_t currentSampleIndex = 0;
-static volatile bool timerEnabled = false;
 
-// Timer calculation variables
-static volatile uint64_t ticksPerSample = 0;
+// Transmission run by the timer ISR: it clocks out the line levels itself, so
+// bit timing does not depend on a task that runs from flash
+static DRAM_ATTR struct
+{
+	const uint8_t *bits;
+	size_t preambleLevels; // The first flag, sent again this many levels before the rest
+	size_t total;		   // Levels to send, preamble included
+	volatile size_t next;  // Level being sent
+	uint32_t markTicks;	   // Timer ticks per sample of each tone
+	uint32_t spaceTicks;
+	uint32_t sampleTicks;  // Of the tone being sent
+	uint32_t bitPhase;	   // Ticks x baud into the current bit, a bit is TIMER_FREQ
+	uint32_t baudRate;
+	uint8_t dacChannel;
+	uint32_t worstLatency; // Ticks, of this transmission; guarded by timingLock
+	TaskHandle_t waiter;   // Notified when the last level is done
+} tx;
+
+static DRAM_ATTR afsk_timing_stats_t timing; // Guarded by timingLock
+static afsk_tx_times_t txTimes;				 // Written by the transmitting task only
+static DRAM_ATTR portMUX_TYPE timingLock = portMUX_INITIALIZER_UNLOCKED;
 
 // Forward declarations
 static afsk_status_t generateWaveTable();
 static uint64_t calculateTimerTicks(uint16_t frequency);
-static void setTimerFrequency(uint16_t frequency);
 static void setPTT(bool enable);
+static void writeOutputIdle();
+static afsk_status_t sendLevels(const uint8_t *bits, size_t len, uint16_t extraFlags);
+static afsk_status_t sendBlocks(const uint8_t *bits, size_t len, uint16_t extraFlags);
+
+/**
+ * @brief Write one output code straight to the peripheral registers
+ *
+ * ledcWrite(), sigmaDeltaWrite() and dacWrite() live in flash; the *_ll_
+ * register helpers are inline. An if chain, because a switch may compile to a
+ * jump table in flash.
+ */
+static inline void IRAM_ATTR writeCode(uint16_t code)
+{
+	if (afsk_config.output == AFSK_OUTPUT_PWM)
+	{
+		ledc_ll_set_duty_int_part(&LEDC, AFSK_PWM_SPEED_MODE, AFSK_PWM_LL_CHANNEL, code);
+		ledc_ll_set_duty_start(&LEDC, AFSK_PWM_SPEED_MODE, AFSK_PWM_LL_CHANNEL, true);
+#if !SOC_LEDC_SUPPORT_HS_MODE
+		ledc_ll_ls_channel_update(&LEDC, AFSK_PWM_SPEED_MODE, AFSK_PWM_LL_CHANNEL);
+#endif
+	}
+	else if (afsk_config.output == AFSK_OUTPUT_SIGMA_DELTA)
+	{
+		sigmadelta_ll_set_duty(&SIGMADELTA, (sigmadelta_channel_t)AFSK_SIGMA_DELTA_CHANNEL, (int8_t)(code - 128));
+	}
+#if SOC_DAC_SUPPORTED
+	else
+	{
+		dac_ll_update_output_value((dac_channel_t)tx.dacChannel, (uint8_t)code);
+	}
+#endif
+}
+
+/**
+ * @brief Select the tone of a line level and retune the timer, from the ISR
+ */
+static inline void IRAM_ATTR startLevel(bool mark)
+{
+	activeTable = mark ? waveTable : waveTable + afsk_config.samplesPerCycle;
+	tx.sampleTicks = mark ? tx.markTicks : tx.spaceTicks;
+	timer_group_set_alarm_value_in_isr(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX, tx.sampleTicks);
+}
 
 /**
  * @brief Timer interrupt service routine for AFSK sample generation
+ *
+ * Writes one sample, then moves to the next line level once a bit time has
+ * passed. Allocated with ESP_INTR_FLAG_IRAM, so it also runs during flash
+ * writes. The timer reloads at each alarm, so its count on entry is the
+ * interrupt latency.
+ *
+ * @return true if the waiting task must run next
  */
-void IRAM_ATTR afskTimerISR()
+static bool IRAM_ATTR afskTimerISR(void *arg)
 {
-	if (!timerEnabled || !waveTable)
-		return;
+	const int16_t *table = activeTable;
+	if (!table)
+	{
+		return false;
+	}
 
-	// Output current sample to DAC using modern Arduino API
-	dacWrite(afsk_config.dacPin, waveTable[currentSampleIndex]);
+	uint32_t latency = (uint32_t)timer_group_get_counter_value_in_isr(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+	portENTER_CRITICAL_ISR(&timingLock);
+	timing.samples++;
+	timing.totalLatencyTicks += latency;
+	if (latency > timing.maxLatencyTicks)
+	{
+		timing.maxLatencyTicks = latency;
+	}
+	if (latency > tx.worstLatency)
+	{
+		tx.worstLatency = latency;
+	}
+	if (latency > tx.sampleTicks / 2)
+	{
+		timing.lateSamples++;
+	}
+	portEXIT_CRITICAL_ISR(&timingLock);
 
-	// Advance to next sample
+	// Quantize the current sample and write it to the selected output
+	writeCode(noiseShaperStep(&shaper, table[currentSampleIndex]));
 	currentSampleIndex++;
 	if (currentSampleIndex >= afsk_config.samplesPerCycle)
 	{
 		currentSampleIndex = 0;
 	}
+
+	// Bit clock: every sample of the current tone is sampleTicks long
+	tx.bitPhase += tx.sampleTicks * tx.baudRate;
+	if (tx.bitPhase < TIMER_FREQ)
+	{
+		return false;
+	}
+	tx.bitPhase -= TIMER_FREQ;
+	size_t next = tx.next + 1;
+	tx.next = next;
+	if (next < tx.total)
+	{
+		startLevel(next < tx.preambleLevels ? tx.bits[next % AFSK_FLAG_LEVELS] : tx.bits[next - tx.preambleLevels]);
+		return false;
+	}
+
+	activeTable = NULL; // Done; the task stops the timer and parks the output
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(tx.waiter, &woken);
+	return woken == pdTRUE;
 }
 
 /**
- * @brief Generate sine wave table for AFSK tones
+ * @brief Generate mark and space sine wave tables for AFSK tones
+ *
+ * The louder of the two tones gets the configured amplitude and the other is
+ * attenuated by the twist, so the ISR only has to switch table pointers.
+ *
  * @return AFSK_SUCCESS on success, error code otherwise
  */
 static afsk_status_t generateWaveTable()
 {
-	// Free existing table
-	if (waveTable)
-	{
-		free(waveTable);
-		waveTable = NULL;
-	}
-
-	// Allocate new table
-	waveTable = (uint8_t *)malloc(afsk_config.samplesPerCycle);
-	if (!waveTable)
+	if (afsk_config.samplesPerCycle == 0)
 	{
-		return AFSK_ERROR_DAC_INIT;
+		return AFSK_ERROR_INVALID_PARAMS;
 	}
+	activeTable = NULL; // The ISR stays silent while the tables are rewritten
 
-	// Generate sine wave samples
-	const uint8_t midpoint = AFSK_DAC_MAX_VALUE / 2;
-	for (uint8_t i = 0; i < afsk_config.samplesPerCycle; i++)
-	{
-		float angle = 2.0f * PI * i / afsk_config.samplesPerCycle;
-		float sineValue = sin(angle);
+	// Signed 16-bit sine tables, quantized later by the noise shaper
+	int16_t markLevel, spaceLevel;
+	afskTwistLevels((int16_t)lroundf(afsk_config.amplitude * INT16_MAX), afsk_config.twistDb, &markLevel, &spaceLevel);
+	afskToneTable(waveTable, afsk_config.samplesPerCycle, markLevel);
+	afskToneTable(waveTable + afsk_config.samplesPerCycle, afsk_config.samplesPerCycle, spaceLevel);
 
-		// Scale to DAC range with amplitude control
-		uint8_t dacValue = (uint8_t)(midpoint + (afsk_config.amplitude * midpoint * sineValue));
-		waveTable[i] = dacValue;
-	}
+	// Same tone levels for the block renderer
+	afskModulatorSetLevels(&modulator, markLevel, spaceLevel);
 
 	return AFSK_SUCCESS;
 }
@@ -127,12 +273,7 @@ static afsk_status_t generateWaveTable()
 static uint64_t calculateTimerTicks(uint16_t frequency)
 {
 	uint32_t denominator = frequency * afsk_config.samplesPerCycle;
-	uint64_t result = TIMER_FREQ / denominator;
-	
-	// Debug output for diagnosis
-	Serial.printf("Calc: freq=%d, denom=%lu, ticks=%llu\n", frequency, denominator, result);
-	
-	return result;
+	return TIMER_FREQ / denominator;
 }
 
 /**
@@ -152,14 +293,26 @@ static void setPTT(bool enable)
 }
 
 /**
- * @brief Set timer frequency for AFSK tone
- * @param frequency Frequency in Hz (mark or space)
+ * @brief Park the audio output at midscale
  */
-static void setTimerFrequency(uint16_t frequency)
+static void writeOutputIdle()
 {
-	ticksPerSample = calculateTimerTicks(frequency);
-	Serial.printf("Timer: Setting %d Hz -> %llu ticks\n", frequency, ticksPerSample);
-	timerAlarmWrite(afsk_timer, ticksPerSample, true);
+	switch (afsk_config.output)
+	{
+	case AFSK_OUTPUT_PWM:
+		ledcWrite(AFSK_PWM_CHANNEL, 1 << (AFSK_PWM_RESOLUTION - 1));
+		break;
+	case AFSK_OUTPUT_SIGMA_DELTA:
+		sigmaDeltaWrite(AFSK_SIGMA_DELTA_CHANNEL, AFSK_DAC_MAX_VALUE / 2);
+		break;
+	case AFSK_OUTPUT_BLOCK:
+		break; // The I2S driver sends silence when it runs dry
+#if SOC_DAC_SUPPORTED
+	default:
+		dacWrite(afsk_config.dacPin, AFSK_DAC_MAX_VALUE / 2);
+		break;
+#endif
+	}
 }
 
 /**
@@ -178,15 +331,37 @@ afsk_status_t setupAFSKEncoder()
 	Serial.printf("AFSK Init: Mark=%d Hz, Space=%d Hz, Samples=%d\n", 
 	              afsk_config.markFreq, afsk_config.spaceFreq, afsk_config.samplesPerCycle);
 
-	// Initialize timer (timer 0, divider 8 for 10MHz, count up)
-	afsk_timer = timerBegin(0, AFSK_TIMER_DIVIDER, true);
-	if (!afsk_timer)
+	// Block outputs render at a fixed rate and need no timer or quantizer
+	if (afsk_config.output == AFSK_OUTPUT_BLOCK)
 	{
-		return AFSK_ERROR_TIMER_INIT;
+		if (!audioHasBlockOutput() ||
+			!afskModulatorInit(&modulator, audioOutputSampleRate(), afsk_config.markFreq,
+							   afsk_config.spaceFreq, afsk_config.baudRate))
+		{
+			return AFSK_ERROR_DAC_INIT;
+		}
 	}
-
-	// Attach ISR
-	timerAttachInterrupt(afsk_timer, afskTimerISR, true);
+	else
+	{
+		// Timer 0, divider 8 for 10MHz, reloading at each alarm; IRAM interrupt so
+		// flash writes do not stall the samples
+		timer_config_t config = {};
+		config.alarm_en = TIMER_ALARM_EN;
+		config.counter_en = TIMER_PAUSE;
+		config.intr_type = TIMER_INTR_LEVEL;
+		config.counter_dir = TIMER_COUNT_UP;
+		config.auto_reload = TIMER_AUTORELOAD_EN;
+		config.divider = AFSK_TIMER_DIVIDER;
+		if (timer_init(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX, &config) != ESP_OK ||
+			timer_isr_callback_add(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX, afskTimerISR, NULL, ESP_INTR_FLAG_IRAM) != ESP_OK)
+		{
+			return AFSK_ERROR_TIMER_INIT;
+		}
+		timerReady = true;
+	}
+#if SOC_DAC_SUPPORTED
+	tx.dacChannel = afsk_config.dacPin == 26 ? DAC_CHANNEL_2 : DAC_CHANNEL_1;
+#endif
 
 	// Generate sine wave table
 	afsk_status_t status = generateWaveTable();
@@ -207,8 +382,34 @@ afsk_status_t setupAFSKEncoder()
 		digitalWrite(afsk_config.pttLedPin, LOW);
 	}
 
-	// Set DAC to midpoint
-	dacWrite(afsk_config.dacPin, AFSK_DAC_MAX_VALUE / 2);
+	// Configure the output peripheral and its quantizer
+	uint8_t outputBits = 8;
+	switch (afsk_config.output)
+	{
+	case AFSK_OUTPUT_PWM:
+		if (!ledcSetup(AFSK_PWM_CHANNEL, AFSK_PWM_FREQ, AFSK_PWM_RESOLUTION))
+		{
+			return AFSK_ERROR_DAC_INIT;
+		}
+		ledcAttachPin(afsk_config.dacPin, AFSK_PWM_CHANNEL);
+		outputBits = AFSK_PWM_RESOLUTION;
+		break;
+	case AFSK_OUTPUT_SIGMA_DELTA:
+		if (!sigmaDeltaSetup(afsk_config.dacPin, AFSK_SIGMA_DELTA_CHANNEL, AFSK_SIGMA_DELTA_FREQ))
+		{
+			return AFSK_ERROR_DAC_INIT;
+		}
+		break;
+	default:
+		break;
+	}
+	if (!noiseShaperInit(&shaper, outputBits, afsk_config.shapingOrder))
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+
+	// Set output to midpoint
+	writeOutputIdle();
 
 	afsk_config.initialized = true;
 	return AFSK_SUCCESS;
@@ -232,16 +433,155 @@ afsk_status_t setAFSKParameters(uint16_t markFreq, uint16_t spaceFreq,
 	afsk_config.baudRate = baudRate;
 	afsk_config.amplitude = amplitude;
 	afsk_config.samplesPerCycle = samplesPerCycle;
-	
+
 	// Regenerate wave table with new parameters
 	if (afsk_config.initialized)
 	{
+		if (afsk_config.output == AFSK_OUTPUT_BLOCK &&
+			!afskModulatorInit(&modulator, audioOutputSampleRate(), markFreq, spaceFreq, baudRate))
+		{
+			return AFSK_ERROR_INVALID_PARAMS;
+		}
 		return generateWaveTable();
 	}
 	
 	return AFSK_SUCCESS;
 }
 
+/**
+ * @brief Select the audio output backend
+ * @param output Output backend
+ * @param pin Audio output pin
+ * @param shapingOrder Noise shaping order
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKOutput(afsk_output_t output, uint8_t pin, uint8_t shapingOrder)
+{
+	if (afsk_config.initialized || shapingOrder > NOISE_SHAPER_MAX_ORDER)
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+
+	if (output == AFSK_OUTPUT_DAC)
+	{
+#if SOC_DAC_SUPPORTED
+		if (pin != 25 && pin != 26)
+		{
+			return AFSK_ERROR_INVALID_PIN;
+		}
+#else
+		return AFSK_ERROR_INVALID_PIN;
+#endif
+	}
+
+	afsk_config.output = output;
+	afsk_config.dacPin = pin;
+	afsk_config.shapingOrder = shapingOrder;
+	return AFSK_SUCCESS;
+}
+
+/**
+ * @brief Set the mark-to-space twist
+ * @param twistDb Mark level relative to space in dB (positive = mark louder)
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTwist(float twistDb)
+{
+	if (afsk_config.transmitting || !(fabsf(twistDb) <= AFSK_TWIST_MAX_DB)) // NaN fails too
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+
+	afsk_config.twistDb = twistDb;
+
+	// Regenerate wave tables with the new tone levels
+	if (afsk_config.initialized)
+	{
+		return generateWaveTable();
+	}
+
+	return AFSK_SUCCESS;
+}
+
+/**
+ * @brief Select a twist preset for the radio's audio input
+ * @param profile Twist profile
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTwistProfile(afsk_twist_profile_t profile)
+{
+	switch (profile)
+	{
+	case AFSK_TWIST_PREEMPHASIZED_INPUT:
+		return setAFSKTwist(0.0f);
+	case AFSK_TWIST_FLAT_INPUT:
+		return setAFSKTwist(-AFSK_PREEMPHASIS_DB); // Space louder
+	default:
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+}
+
+/**
+ * @brief Get the current twist
+ * @return Mark level relative to space in dB
+ */
+float getAFSKTwist()
+{
+	return afsk_config.twistDb;
+}
+
+/**
+ * @brief Check if a transmission is in progress, e.g. to hold off flash writes
+ */
+bool isAFSKTransmitting()
+{
+	return afsk_config.transmitting;
+}
+
+/**
+ * @brief Copy the ISR sample timing
+ */
+void getAFSKTimingStats(afsk_timing_stats_t *stats)
+{
+	portENTER_CRITICAL(&timingLock);
+	*stats = timing;
+	portEXIT_CRITICAL(&timingLock);
+}
+
+/**
+ * @brief Copy the PTT and bit times of the last transmission
+ */
+void getAFSKTxTimes(afsk_tx_times_t *times)
+{
+	*times = txTimes;
+}
+
+void resetAFSKTimingStats()
+{
+	portENTER_CRITICAL(&timingLock);
+	memset(&timing, 0, sizeof(timing));
+	portEXIT_CRITICAL(&timingLock);
+}
+
+/**
+ * @brief Report the transmission's worst ISR latency to the deadline monitor
+ *
+ * The deadline is half a sample period of the higher tone, as lateSamples
+ * counts for the tone being sent.
+ *
+ * @param levels Levels sent, kept with a miss
+ */
+static void checkSampleDeadline(size_t levels)
+{
+	uint32_t shortestTicks = (uint32_t)calculateTimerTicks(
+		afsk_config.markFreq > afsk_config.spaceFreq ? afsk_config.markFreq : afsk_config.spaceFreq);
+	portENTER_CRITICAL(&timingLock);
+	uint32_t worst = tx.worstLatency;
+	portEXIT_CRITICAL(&timingLock);
+	deadlineDeclare(DEADLINE_TX_ISR, shortestTicks / 2 / AFSK_TIMER_TICKS_PER_US);
+	deadlineCheck(DEADLINE_TX_ISR, worst / AFSK_TIMER_TICKS_PER_US, "levels", levels);
+}
+
 /**
  * @brief Send raw bits using AFSK modulation
  * @param bits Array of bits to send (1 = mark, 0 = space)
@@ -250,6 +590,34 @@ afsk_status_t setAFSKParameters(uint16_t markFreq, uint16_t spaceFreq,
  */
 afsk_status_t afskSend(uint8_t *bits, size_t len)
 {
+	return sendLevels(bits, len, 0);
+}
+
+/**
+ * @brief Line level i of a transmission whose first flag is sent extraFlags more times
+ */
+static inline uint8_t levelAt(const uint8_t *bits, size_t i, size_t preambleLevels)
+{
+	return i < preambleLevels ? bits[i % AFSK_FLAG_LEVELS] : bits[i - preambleLevels];
+}
+
+/**
+ * @brief Send line levels, repeating the first flag to stretch the preamble
+ *
+ * Lets transmitAX25() keep one flag of TXDELAY in its buffer however long the
+ * keyup is. The timer ISR clocks out the levels and the calling task sleeps
+ * until it is done, so bits must stay in internal RAM until then.
+ *
+ * @param bits Line levels (1 = mark, 0 = space), starting with a flag if extraFlags > 0
+ * @param len Number of levels
+ * @param extraFlags Times the first AFSK_FLAG_LEVELS levels are sent again before the rest
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+static afsk_status_t sendLevels(const uint8_t *bits, size_t len, uint16_t extraFlags)
+{
+	size_t preambleLevels = (size_t)extraFlags * AFSK_FLAG_LEVELS;
+	size_t total = len + preambleLevels;
+
 	if (!afsk_config.initialized)
 	{
 		return AFSK_ERROR_NOT_INITIALIZED;
@@ -260,79 +628,178 @@ afsk_status_t afskSend(uint8_t *bits, size_t len)
 		return AFSK_ERROR_INVALID_PARAMS; // Already transmitting
 	}
 
-	Serial.printf("Starting transmission of %d bits\n", len);
-	
-	afsk_config.transmitting = true;
-	timerEnabled = true;
+	if (extraFlags > 0 && len < AFSK_FLAG_LEVELS)
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
 
-	// Start transmission
-	timerAlarmEnable(afsk_timer);
+	Serial.printf("Starting transmission of %u bits\n", (unsigned)total);
 
-	for (size_t bit = 0; bit < len; bit++)
+	memset(&txTimes, 0, sizeof(txTimes));
+	setPTT(true);
+	txTimes.pttOnUs = micros();
+	if (afsk_config.output == AFSK_OUTPUT_BLOCK)
 	{
-		// Set frequency based on bit value: 1 = mark, 0 = space
-		uint16_t freq = bits[bit] ? afsk_config.markFreq : afsk_config.spaceFreq;
-		setTimerFrequency(freq);
+		afsk_status_t result = sendBlocks(bits, len, extraFlags);
+		setPTT(false);
+		txTimes.pttOffUs = micros();
+		return result;
+	}
 
-		// Wait for one bit duration
-		uint64_t startTime = micros();
-		uint64_t bitDuration = 1000000UL / afsk_config.baudRate;
-		while ((micros() - startTime) < bitDuration)
-		{
-			yield(); // Allow other tasks to run
-		}
+	afsk_config.transmitting = true;
+	noiseShaperReset(&shaper);
+
+	// Hand the levels to the ISR, starting with the tone of the first one
+	tx.bits = bits;
+	tx.preambleLevels = preambleLevels;
+	tx.total = total;
+	tx.next = 0;
+	tx.bitPhase = 0;
+	tx.baudRate = afsk_config.baudRate;
+	tx.markTicks = (uint32_t)calculateTimerTicks(afsk_config.markFreq);
+	tx.spaceTicks = (uint32_t)calculateTimerTicks(afsk_config.spaceFreq);
+	tx.waiter = xTaskGetCurrentTaskHandle();
+	tx.worstLatency = 0;
+	bool mark = levelAt(bits, 0, preambleLevels);
+	tx.sampleTicks = mark ? tx.markTicks : tx.spaceTicks;
+	ulTaskNotifyTake(pdTRUE, 0); // Drop a notification left by a timed-out transmission
+	timer_set_counter_value(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX, 0);
+	timer_set_alarm_value(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX, tx.sampleTicks);
+	activeTable = mark ? waveTable : waveTable + afsk_config.samplesPerCycle;
+	timer_start(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+	txTimes.firstBitUs = micros();
+
+	// Sleep until the ISR has sent the last level
+	uint32_t timeoutMs = (uint32_t)(total * 1000 / tx.baudRate) + AFSK_TX_TIMEOUT_MARGIN_MS;
+	afsk_status_t result = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) ? AFSK_SUCCESS : AFSK_ERROR_TX_TIMEOUT;
+	if (result == AFSK_SUCCESS)
+	{
+		txTimes.lastBitUs = micros();
 	}
 
 	// Stop transmission
-	timerAlarmDisable(afsk_timer);
-	timerEnabled = false;
-	dacWrite(afsk_config.dacPin, AFSK_DAC_MAX_VALUE / 2); // Set to midpoint
+	timer_pause(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+	activeTable = NULL;
+	checkSampleDeadline(total);
+	writeOutputIdle(); // Set to midpoint
+	setPTT(false);
+	txTimes.pttOffUs = micros();
 	afsk_config.transmitting = false;
 
 	Serial.printf("Transmission complete\n");
 
-	return AFSK_SUCCESS;
+	return result;
 }
 
 /**
- * @brief Transmit AX.25 frame with AFSK modulation
- * @param kissFrame KISS frame data
- * @param len Frame length in bytes
+ * @brief Send raw bits through the sample-block output
+ *
+ * Bits are rendered into a block buffer and flushed whenever another bit might
+ * not fit. audioWriteBlock() blocks while the DMA buffers are full, which paces
+ * the loop to the output sample rate.
+ *
+ * @param bits Array of bits to send (1 = mark, 0 = space)
+ * @param len Number of bits to send
+ * @param extraFlags Times the first flag is repeated, see sendLevels()
  * @return AFSK_SUCCESS on success, error code otherwise
  */
-afsk_status_t transmitAX25(uint8_t *kissFrame, size_t len)
+static afsk_status_t sendBlocks(const uint8_t *bits, size_t len, uint16_t extraFlags)
 {
-	// This is a placeholder - full AX.25 implementation would go here
-	// For now, just convert bytes to bits and transmit
-	
-	if (!kissFrame || len == 0)
+	size_t preambleLevels = (size_t)extraFlags * AFSK_FLAG_LEVELS;
+	size_t total = len + preambleLevels;
+	static int16_t block[AFSK_BLOCK_SAMPLES];
+	size_t maxBitSamples = audioOutputSampleRate() / afsk_config.baudRate + 1;
+	size_t fill = 0;
+	uint32_t lastWriteUs = 0; // Return of the previous write, 0 before the first
+	afsk_status_t result = AFSK_SUCCESS;
+
+	if (maxBitSamples > AFSK_BLOCK_SAMPLES)
 	{
 		return AFSK_ERROR_INVALID_PARAMS;
 	}
 
-	// Simple implementation: convert each byte to 8 bits
-	uint8_t *bits = (uint8_t *)malloc(len * 8);
-	if (!bits)
-	{
-		return AFSK_ERROR_INVALID_PARAMS;
-	}
+	afsk_config.transmitting = true;
+	afskModulatorReset(&modulator);
 
-	// Convert bytes to bits
-	for (size_t i = 0; i < len; i++)
+	for (size_t bit = 0; bit < total; bit++)
 	{
-		for (int bit = 0; bit < 8; bit++)
+		fill += afskModulatorBit(&modulator, levelAt(bits, bit, preambleLevels), block + fill);
+		if (fill + maxBitSamples > AFSK_BLOCK_SAMPLES || bit + 1 == total)
 		{
-			bits[i * 8 + bit] = (kissFrame[i] >> bit) & 0x01;
+			if (txTimes.firstBitUs == 0)
+			{
+				txTimes.firstBitUs = micros();
+			}
+			if (lastWriteUs != 0)
+			{
+				deadlineCheck(DEADLINE_TX_OUTPUT, micros() - lastWriteUs, "level", bit); // Rendering time
+			}
+			if (audioWriteBlock(block, fill) != fill)
+			{
+				result = AFSK_ERROR_BUFFER_OVERFLOW;
+				break;
+			}
+			lastWriteUs = micros();
+			fill = 0;
 		}
 	}
+	if (result == AFSK_SUCCESS)
+	{
+		txTimes.lastBitUs = micros();
+	}
+
+	afsk_config.transmitting = false;
 
-	// Transmit the bits
-	afsk_status_t result = afskSend(bits, len * 8);
+	Serial.printf("Transmission complete\n");
 
-	free(bits);
 	return result;
 }
 
+/**
+ * @brief Set the keyup time sent as flags before each frame
+ * @param ms Time from PTT on to the frame (KISS TXDELAY x 10)
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t setAFSKTxDelay(uint16_t ms)
+{
+	if (afsk_config.transmitting)
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+	uint32_t flagMs = 8000 / afsk_config.baudRate; // Truncated, so the keyup is never shorter than asked
+	uint32_t flags = flagMs ? (ms + flagMs - 1) / flagMs : 1;
+	afsk_config.txDelayFlags = flags ? (uint16_t)flags : 1;
+	return AFSK_SUCCESS;
+}
+
+/**
+ * @brief Transmit AX.25 frame with AFSK modulation
+ *
+ * Frames into a static buffer with a single preamble flag; the rest of TXDELAY
+ * repeats that flag as it is sent, so the heap is not used at any keyup time.
+ * Call from one task only (loop(), through the transmit queue).
+ *
+ * @param frame AX.25 frame without FCS
+ * @param len Frame length in bytes
+ * @return AFSK_SUCCESS on success, error code otherwise
+ */
+afsk_status_t transmitAX25(const uint8_t *frame, size_t len)
+{
+	ax25_frame_t parsed;
+	if (!frame || afsk_config.transmitting || ax25Parse(frame, len, &parsed) != AX25_OK)
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+
+	// One line level per bit: a flag, stuffed frame and FCS, tail flags, NRZI encoded
+	size_t count = hdlcEncode(frame, len, 1, txLevels, sizeof(txLevels));
+	if (count == 0)
+	{
+		return AFSK_ERROR_INVALID_PARAMS;
+	}
+	return sendLevels(txLevels, count, afsk_config.txDelayFlags - 1);
+}
+
 /**
  * @brief Get status string for AFSK status code
  * @param status Status code
@@ -346,12 +813,18 @@ const char *getAFSKStatusString(afsk_status_t status)
 		return "Success";
 	case AFSK_ERROR_NOT_INITIALIZED:
 		return "Not initialized";
+	case AFSK_ERROR_INVALID_PIN:
+		return "Invalid output pin";
 	case AFSK_ERROR_TIMER_INIT:
 		return "Timer initialization failed";
 	case AFSK_ERROR_DAC_INIT:
 		return "DAC initialization failed";
 	case AFSK_ERROR_INVALID_PARAMS:
 		return "Invalid parameters";
+	case AFSK_ERROR_BUFFER_OVERFLOW:
+		return "Output write failed";
+	case AFSK_ERROR_TX_TIMEOUT:
+		return "Transmission timed out";
 	default:
 		return "Unknown error";
 	}
@@ -362,23 +835,25 @@ const char *getAFSKStatusString(afsk_status_t status)
  */
 void cleanupAFSKEncoder()
 {
-	if (afsk_timer)
+	if (timerReady)
 	{
-		timerEnd(afsk_timer);
-		afsk_timer = NULL;
+		timer_pause(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+		timer_isr_callback_remove(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+		timer_deinit(AFSK_TIMER_GROUP, AFSK_TIMER_INDEX);
+		timerReady = false;
 	}
 
-	if (waveTable)
-	{
-		free(waveTable);
-		waveTable = NULL;
-	}
+	activeTable = NULL;
 
 	// Turn off PTT
 	setPTT(false);
 
-	// Reset DAC to midpoint
-	dacWrite(afsk_config.dacPin, AFSK_DAC_MAX_VALUE / 2);
+	// Reset output to midpoint and release the PWM pin
+	writeOutputIdle();
+	if (afsk_config.output == AFSK_OUTPUT_PWM)
+	{
+		ledcDetachPin(afsk_config.dacPin);
+	}
 
 	afsk_config.initialized = false;
 	afsk_config.transmitting = false;
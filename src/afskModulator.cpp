@@ -0,0 +1,138 @@
+/**
+ * @file afskModulator.cpp
+ * @date 2025-09-04
+ * @brief Phase-continuous AFSK tone generator for fixed-rate sample-block outputs.
+ */
+
+#include "afskModulator.h"
+
+#include <math.h>
+
+#define SINE_TABLE_BITS 8
+#define SINE_TABLE_SIZE (1 << SINE_TABLE_BITS)
+
+// One sine cycle plus a guard entry for interpolation, built on first use
+static int16_t sineTable[SINE_TABLE_SIZE + 1];
+static bool sineTableReady = false;
+
+/**
+ * @brief Configure a modulator
+ * @param mod Modulator state
+ * @param sampleRate Output sample rate in Hz
+ * @param markFreq Mark frequency in Hz
+ * @param spaceFreq Space frequency in Hz
+ * @param baudRate Baud rate in bits per second
+ * @return true on success, false if the parameters are out of range
+ */
+bool afskModulatorInit(afsk_modulator_t *mod, uint32_t sampleRate, uint16_t markFreq,
+					   uint16_t spaceFreq, uint16_t baudRate)
+{
+	if (!mod || sampleRate == 0 || baudRate == 0 ||
+		markFreq * 2u >= sampleRate || spaceFreq * 2u >= sampleRate)
+	{
+		return false;
+	}
+
+	if (!sineTableReady)
+	{
+		for (int i = 0; i <= SINE_TABLE_SIZE; i++)
+		{
+			sineTable[i] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * i / SINE_TABLE_SIZE));
+		}
+		sineTableReady = true;
+	}
+
+	mod->sampleRate = sampleRate;
+	mod->baudRate = baudRate;
+	mod->markStep = (uint32_t)(((uint64_t)markFreq << 32) / sampleRate);
+	mod->spaceStep = (uint32_t)(((uint64_t)spaceFreq << 32) / sampleRate);
+	mod->markLevel = 32767;
+	mod->spaceLevel = 32767;
+	afskModulatorReset(mod);
+	return true;
+}
+
+/**
+ * @brief Set the peak level of each tone
+ * @param mod Modulator state
+ * @param markLevel Mark peak amplitude, 0 to 32767
+ * @param spaceLevel Space peak amplitude, 0 to 32767
+ */
+void afskModulatorSetLevels(afsk_modulator_t *mod, int16_t markLevel, int16_t spaceLevel)
+{
+	mod->markLevel = markLevel;
+	mod->spaceLevel = spaceLevel;
+}
+
+/**
+ * @brief Restart tone phase and bit timing
+ * @param mod Modulator state
+ */
+void afskModulatorReset(afsk_modulator_t *mod)
+{
+	mod->phase = 0;
+	mod->bitPhase = 0;
+}
+
+/**
+ * @brief Render one bit
+ *
+ * The number of samples per bit alternates around sampleRate / baudRate so that
+ * bit timing stays exact over long frames, e.g. 44100 Hz at 1200 baud.
+ *
+ * @param mod Modulator state
+ * @param mark true for mark, false for space
+ * @param out Output buffer, at least sampleRate / baudRate + 1 samples
+ * @return Number of samples written
+ */
+size_t afskModulatorBit(afsk_modulator_t *mod, bool mark, int16_t *out)
+{
+	uint32_t total = mod->bitPhase + mod->sampleRate;
+	size_t count = total / mod->baudRate;
+	mod->bitPhase = total % mod->baudRate;
+
+	uint32_t step = mark ? mod->markStep : mod->spaceStep;
+	int32_t level = mark ? mod->markLevel : mod->spaceLevel;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t index = mod->phase >> (32 - SINE_TABLE_BITS);
+		int32_t frac = (mod->phase >> (16 - SINE_TABLE_BITS)) & 0xFFFF;
+		int32_t a = sineTable[index];
+		int32_t b = sineTable[index + 1];
+		int32_t sine = a + (((b - a) * frac) >> 16);
+		out[i] = (int16_t)((sine * level) >> 15);
+		mod->phase += step;
+	}
+	return count;
+}
+
+/**
+ * @brief Peak level of each tone for a twist
+ *
+ * The louder tone gets the full peak and the other is attenuated by the twist.
+ *
+ * @param peak Level of the louder tone, 0 to 32767
+ * @param twistDb Mark level relative to space in dB (positive = mark louder)
+ * @param markLevel Mark peak amplitude
+ * @param spaceLevel Space peak amplitude
+ */
+void afskTwistLevels(int16_t peak, float twistDb, int16_t *markLevel, int16_t *spaceLevel)
+{
+	int16_t quiet = (int16_t)lroundf(peak * powf(10.0f, -fabsf(twistDb) / 20.0f));
+	*markLevel = twistDb < 0.0f ? quiet : peak;
+	*spaceLevel = twistDb > 0.0f ? quiet : peak;
+}
+
+/**
+ * @brief Fill a table with one sine cycle
+ * @param table Output, samples entries
+ * @param samples Samples per cycle
+ * @param level Peak amplitude, 0 to 32767
+ */
+void afskToneTable(int16_t *table, uint16_t samples, int16_t level)
+{
+	for (uint16_t i = 0; i < samples; i++)
+	{
+		table[i] = (int16_t)lroundf(level * sinf(2.0f * (float)M_PI * i / samples));
+	}
+}
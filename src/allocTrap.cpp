@@ -0,0 +1,113 @@
+/**
+ * @file allocTrap.cpp
+ * @date 2025-10-09
+ * @brief Debug allocator hook that traps heap use inside registered hot-path scopes.
+ *
+ * The wrappers run inside every allocation, so they touch only task-local
+ * state, a spinlock and ROM printf.
+ */
+
+#include "allocTrap.h"
+
+#if ALLOC_TRAP
+#include <esp_rom_sys.h>
+
+static __thread uint8_t depth = 0;
+static __thread const char *scope = NULL;
+static alloc_trap_stats_t stats; // Guarded by statsLock
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Mark the start of a hot-path scope on the calling task
+ * @param name Reported with trapped allocations, must stay valid
+ */
+void allocTrapEnter(const char *name)
+{
+	depth++;
+	scope = name;
+}
+
+void allocTrapLeave()
+{
+	if (depth > 0 && --depth == 0)
+	{
+		scope = NULL;
+	}
+}
+
+static void trap(size_t size, const void *caller)
+{
+	if (depth == 0 || xPortInIsrContext())
+	{
+		return;
+	}
+	portENTER_CRITICAL_SAFE(&statsLock);
+	stats.trapped++;
+	stats.scope = scope;
+	stats.size = size;
+	stats.caller = caller;
+	portEXIT_CRITICAL_SAFE(&statsLock);
+#if ALLOC_TRAP == 2
+	depth = 0; // Nothing below may trap again
+	esp_rom_printf("allocTrap: %u bytes in hot path '%s' from %p\n", (unsigned)size, scope, caller);
+	abort();
+#endif
+}
+
+extern "C"
+{
+	void *__real_malloc(size_t size);
+	void *__real_calloc(size_t count, size_t size);
+	void *__real_realloc(void *ptr, size_t size);
+
+	void *__wrap_malloc(size_t size)
+	{
+		trap(size, __builtin_return_address(0));
+		return __real_malloc(size);
+	}
+
+	void *__wrap_calloc(size_t count, size_t size)
+	{
+		trap(count * size, __builtin_return_address(0));
+		return __real_calloc(count, size);
+	}
+
+	void *__wrap_realloc(void *ptr, size_t size)
+	{
+		trap(size, __builtin_return_address(0));
+		return __real_realloc(ptr, size);
+	}
+}
+#endif // ALLOC_TRAP
+
+/**
+ * @brief Copy the counters and the last trapped allocation; all zero when ALLOC_TRAP is 0.
+ */
+void getAllocTrapStats(alloc_trap_stats_t *out)
+{
+#if ALLOC_TRAP
+	portENTER_CRITICAL(&statsLock);
+	*out = stats;
+	portEXIT_CRITICAL(&statsLock);
+#else
+	memset(out, 0, sizeof(*out));
+#endif
+}
+
+/**
+ * @brief Print the trapped allocation count and the last one to Serial.
+ */
+void printAllocTrapStats()
+{
+#if ALLOC_TRAP
+	alloc_trap_stats_t s;
+	getAllocTrapStats(&s);
+	if (s.trapped == 0)
+	{
+		Serial.println("ALLOC: no heap use in hot paths");
+		return;
+	}
+	Serial.printf("ALLOC: %lu allocations in hot paths, last %lu bytes in %s from %p\n", s.trapped, s.size, s.scope,
+				  s.caller);
+#endif
+}
@@ -0,0 +1,130 @@
+/**
+ * @file audioCodec.cpp
+ * @date 2025-09-04
+ * @brief Register init sequences for the WM8960 and ES8388 I2S codecs.
+ *
+ * Both codecs are set up as I2S slaves, 16-bit Philips format, 48 kHz from a
+ * 12.288 MHz MCLK, with the line/mic input on the ADC and the DAC routed to the
+ * headphone/line output at 0 dB. Levels to and from the radio are then set with
+ * the encoder amplitude and the radio's own controls.
+ */
+
+#include "audioCodec.h"
+
+#define WM8960_ADDRESS 0x1A
+#define ES8388_ADDRESS 0x10
+
+// One register write followed by an optional settling delay
+typedef struct
+{
+	uint8_t reg;
+	uint16_t value;
+	uint16_t delayMs;
+} codec_reg_t;
+
+static const codec_reg_t wm8960Init[] = {
+	{0x0F, 0x000, 10},	// Reset
+	{0x19, 0x0FC, 100}, // Power 1: VMID 2x50k, VREF, AINL/R, ADCL/R; wait for VMID
+	{0x1A, 0x1E0, 0},	// Power 2: DACL/R, LOUT1, ROUT1
+	{0x2F, 0x03C, 0},	// Power 3: LMIC, RMIC, LOMIX, ROMIX
+	{0x04, 0x000, 0},	// Clocking: SYSCLK = MCLK, fs = SYSCLK / 256
+	{0x07, 0x002, 0},	// Audio interface: slave, I2S format, 16 bits
+	{0x20, 0x108, 0},	// ADCL path: LINPUT1 to boost mixer
+	{0x21, 0x108, 0},	// ADCR path: RINPUT1 to boost mixer
+	{0x00, 0x117, 0},	// Left input volume 0 dB
+	{0x01, 0x117, 0},	// Right input volume 0 dB, update both
+	{0x15, 0x0C3, 0},	// Left ADC volume 0 dB
+	{0x16, 0x1C3, 0},	// Right ADC volume 0 dB, update both
+	{0x22, 0x100, 0},	// Left output mixer: left DAC
+	{0x25, 0x100, 0},	// Right output mixer: right DAC
+	{0x0A, 0x0FF, 0},	// Left DAC volume 0 dB
+	{0x0B, 0x1FF, 0},	// Right DAC volume 0 dB, update both
+	{0x02, 0x079, 0},	// LOUT1 volume 0 dB
+	{0x03, 0x179, 0},	// ROUT1 volume 0 dB, update both
+	{0x05, 0x000, 0},	// ADC/DAC control: DAC soft mute off
+};
+
+static const codec_reg_t es8388Init[] = {
+	{0x08, 0x00, 0},  // Master mode off: slave
+	{0x02, 0xF3, 0},  // Chip power: hold state machines in reset
+	{0x2B, 0x80, 0},  // DAC and ADC share LRCK
+	{0x00, 0x05, 0},  // Control 1: play and record, 500k VMID divider
+	{0x01, 0x40, 0},  // Control 2: low power reference off
+	{0x03, 0x00, 0},  // ADC power: all on
+	{0x04, 0x3C, 0},  // DAC power: LOUT1/ROUT1 and LOUT2/ROUT2 on
+	{0x09, 0x00, 0},  // ADC control 1: mic PGA 0 dB
+	{0x0A, 0x00, 0},  // ADC control 2: LINPUT1/RINPUT1
+	{0x0C, 0x0C, 0},  // ADC control 4: I2S, 16 bits
+	{0x0D, 0x02, 0},  // ADC control 5: MCLK / LRCK = 256
+	{0x10, 0x00, 0},  // Left ADC volume 0 dB
+	{0x11, 0x00, 0},  // Right ADC volume 0 dB
+	{0x17, 0x18, 0},  // DAC control 1: I2S, 16 bits
+	{0x18, 0x02, 0},  // DAC control 2: MCLK / LRCK = 256
+	{0x19, 0x02, 0},  // DAC control 3: unmute
+	{0x1A, 0x00, 0},  // Left DAC volume 0 dB
+	{0x1B, 0x00, 0},  // Right DAC volume 0 dB
+	{0x27, 0x90, 0},  // Left mixer: left DAC to left mixer
+	{0x2A, 0x90, 0},  // Right mixer: right DAC to right mixer
+	{0x2E, 0x1E, 0},  // LOUT1 volume 0 dB
+	{0x2F, 0x1E, 0},  // ROUT1 volume 0 dB
+	{0x02, 0x00, 50}, // Chip power: start state machines, wait for them to settle
+};
+
+/**
+ * @brief Get the 7-bit I2C address of a codec
+ * @param type Codec type
+ * @return I2C address
+ */
+uint8_t codecI2CAddress(codec_type_t type)
+{
+	return type == CODEC_WM8960 ? WM8960_ADDRESS : ES8388_ADDRESS;
+}
+
+/**
+ * @brief Send the power-up and format sequence for a codec
+ *
+ * WM8960 registers are 9 bits wide, so each write packs the 7-bit register
+ * address and bit 8 of the value into the first byte. ES8388 writes are a plain
+ * register/value pair.
+ *
+ * @param type Codec type
+ * @param bus Register access functions
+ * @return true if every register write was acknowledged
+ */
+bool codecInit(codec_type_t type, const codec_bus_t *bus)
+{
+	if (!bus || !bus->write)
+	{
+		return false;
+	}
+
+	const codec_reg_t *table = type == CODEC_WM8960 ? wm8960Init : es8388Init;
+	size_t count = type == CODEC_WM8960 ? sizeof(wm8960Init) / sizeof(wm8960Init[0])
+										: sizeof(es8388Init) / sizeof(es8388Init[0]);
+	uint8_t address = codecI2CAddress(type);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint8_t data[2];
+		if (type == CODEC_WM8960)
+		{
+			data[0] = (uint8_t)((table[i].reg << 1) | ((table[i].value >> 8) & 0x01));
+			data[1] = (uint8_t)(table[i].value & 0xFF);
+		}
+		else
+		{
+			data[0] = table[i].reg;
+			data[1] = (uint8_t)table[i].value;
+		}
+
+		if (!bus->write(bus->ctx, address, data, sizeof(data)))
+		{
+			return false;
+		}
+		if (table[i].delayMs && bus->delay)
+		{
+			bus->delay(bus->ctx, table[i].delayMs);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,694 @@
+/**
+ * @file audioHal.cpp
+ * @date 2025-09-04
+ * @brief Sample-block audio backends: internal ADC and external I2S codec.
+ *
+ * One capture task owns the input. The internal backend runs ADC1 in continuous
+ * mode with every radio port's GPIO in a single conversion pattern, so the DMA
+ * stream carries interleaved samples tagged with their ADC channel. The codec
+ * backend configures the codec over I2C with codecInit(), runs I2S0 as master at
+ * AUDIO_CODEC_SAMPLE_RATE and splits the stereo frames into left and right.
+ * Either way each channel is FIR-decimated to AUDIO_RX_SAMPLE_RATE and cut into
+ * blocks from a shared pool. A block is queued by pointer to every reader of
+ * its channel and counts the readers that still hold it.
+ * While another task injects audio, the capture task keeps draining the
+ * hardware but drops what it reads, and the injecting task owns the blocks
+ * being filled.
+ * Transmit blocks are written to both codec output channels.
+ */
+
+#include "audioHal.h"
+
+#include <Wire.h>
+#include <driver/adc.h>
+#include <driver/i2s.h>
+#include "audioCodec.h"
+#include "configuration.h"
+#include "deadlineMonitor.h"
+#include "firDecimator.h"
+
+#define CODEC_DECIMATION (AUDIO_CODEC_SAMPLE_RATE / AUDIO_RX_SAMPLE_RATE)
+#define CODEC_FRAMES_PER_READ 240 // Stereo frames per i2s_read(), 5 ms at 48 kHz
+#define CODEC_DMA_BUFFERS 4
+#define ADC_READ_SAMPLES 288		 // Conversions per adc_digi_read_bytes(), 5 ms per channel at 2 channels
+#define ADC_DMA_BUFFER_BYTES 4096	 // Driver ring buffer between the DMA interrupt and the capture task
+#define CAPTURE_TASK_STACK 3072
+#define CAPTURE_TASK_PRIORITY 5 // Above the decoders, the work per wake is small
+#define CAPTURE_TASK_CORE 0
+#define INJECT_HANDOVER_MS 100 // Longest wait for the capture task to stop appending
+
+// Who appends to the receive blocks
+#define INJECT_OFF 0		// Capture task, live audio
+#define INJECT_REQUESTED 1 // Capture task finishing its current read; it or a timeout leaves this state
+#define INJECT_ON 2		// Injecting task
+
+static audio_backend_t activeBackend = AUDIO_BACKEND_INTERNAL;
+static bool audioStarted = false;
+static uint8_t channelCount = 0;
+
+// Capture task and block pool
+static TaskHandle_t captureTask = NULL;
+static audio_block_t blockPool[AUDIO_BLOCK_POOL];
+static QueueHandle_t freeBlocks = NULL;
+static QueueHandle_t readyBlocks[AUDIO_MAX_READERS]; // Per reader
+static uint8_t readerChannel[AUDIO_MAX_READERS];
+static uint8_t readerCount = 0;
+static portMUX_TYPE blockLock = portMUX_INITIALIZER_UNLOCKED; // Reader list, block reader counts, injectState changes
+static audio_block_t *filling[AUDIO_MAX_CHANNELS]; // Block being filled per channel
+static size_t fillCount[AUDIO_MAX_CHANNELS];
+static uint32_t sequence[AUDIO_MAX_CHANNELS];
+static volatile uint32_t droppedBlocks = 0;
+static volatile uint8_t injectState = INJECT_OFF;
+
+// Per-channel decimation to AUDIO_RX_SAMPLE_RATE
+static fir_decimator_t decimators[AUDIO_MAX_CHANNELS];
+
+// Internal ADC channel of each radio port, -1 if unused
+static const uint8_t rxPins[AUDIO_MAX_CHANNELS] = {RX_PIN, RX_PIN_2};
+static int8_t adcChannel[AUDIO_MAX_CHANNELS];
+
+/**
+ * @brief Write one I2C transaction to the codec
+ */
+static bool wireWrite(void *ctx, uint8_t address, const uint8_t *data, size_t len)
+{
+	(void)ctx;
+	Wire.beginTransmission(address);
+	Wire.write(data, len);
+	return Wire.endTransmission() == 0;
+}
+
+/**
+ * @brief Wait between codec register writes
+ */
+static void wireDelay(void *ctx, uint32_t ms)
+{
+	(void)ctx;
+	delay(ms);
+}
+
+/**
+ * @brief Start ADC1 continuous conversion over every radio port
+ */
+static bool beginInternal()
+{
+	uint16_t mask = 0;
+	adc_digi_pattern_config_t pattern[AUDIO_MAX_CHANNELS] = {};
+	for (uint8_t ch = 0; ch < channelCount; ch++)
+	{
+		// Only ADC1 can be used while Wi-Fi or Bluetooth is running
+		adcChannel[ch] = digitalPinToAnalogChannel(rxPins[ch]);
+		if (adcChannel[ch] < 0 || adcChannel[ch] > 7)
+		{
+			Serial.printf("RX pin %u is not on ADC1\n", rxPins[ch]);
+			return false;
+		}
+		mask |= 1 << adcChannel[ch];
+		pattern[ch].atten = ADC_ATTEN_DB_11;
+		pattern[ch].channel = adcChannel[ch];
+		pattern[ch].unit = 0; // ADC1
+		pattern[ch].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+	}
+
+	adc_digi_init_config_t init = {};
+	init.max_store_buf_size = ADC_DMA_BUFFER_BYTES;
+	init.conv_num_each_intr = ADC_READ_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES;
+	init.adc1_chan_mask = mask;
+	if (adc_digi_initialize(&init) != ESP_OK)
+	{
+		return false;
+	}
+
+	// The conversion rate is shared by all channels in the pattern
+	adc_digi_configuration_t config = {};
+	config.conv_limit_en = true; // Required on ESP32
+	config.conv_limit_num = 250;
+	config.pattern_num = channelCount;
+	config.adc_pattern = pattern;
+	config.sample_freq_hz = (uint32_t)channelCount * AUDIO_RX_SAMPLE_RATE * AUDIO_ADC_OVERSAMPLE;
+	config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+	config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+	if (adc_digi_controller_configure(&config) != ESP_OK || adc_digi_start() != ESP_OK)
+	{
+		adc_digi_deinitialize();
+		return false;
+	}
+
+	// Pass band to 4 kHz; 24 taps are enough at the lower decimation factor
+	for (uint8_t ch = 0; ch < channelCount; ch++)
+	{
+		firDecimatorInit(&decimators[ch], AUDIO_ADC_OVERSAMPLE, 24,
+						 4000.0f / (AUDIO_RX_SAMPLE_RATE * AUDIO_ADC_OVERSAMPLE));
+	}
+	return true;
+}
+
+/**
+ * @brief Configure the codec and start I2S0 in full duplex
+ */
+static bool beginCodec()
+{
+	Wire.begin(CODEC_SDA_PIN, CODEC_SCL_PIN);
+
+	// The codec needs MCLK running before it accepts its power-up sequence
+	i2s_config_t config = {};
+	config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX);
+	config.sample_rate = AUDIO_CODEC_SAMPLE_RATE;
+	config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+	config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+	config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+	config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+	config.dma_buf_count = CODEC_DMA_BUFFERS;
+	config.dma_buf_len = CODEC_FRAMES_PER_READ;
+	config.use_apll = true;
+	config.tx_desc_auto_clear = true; // Send silence instead of repeating stale buffers
+	config.fixed_mclk = 256 * AUDIO_CODEC_SAMPLE_RATE;
+	if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK)
+	{
+		return false;
+	}
+	// When a write returns the DMA holds at least all buffers but one; longer between writes runs it dry
+	deadlineDeclare(DEADLINE_TX_OUTPUT,
+					(uint32_t)((CODEC_DMA_BUFFERS - 1) * CODEC_FRAMES_PER_READ * 1000000ULL / AUDIO_CODEC_SAMPLE_RATE));
+
+	i2s_pin_config_t pins = {};
+	pins.mck_io_num = I2S_MCLK_PIN;
+	pins.bck_io_num = I2S_BCK_PIN;
+	pins.ws_io_num = I2S_WS_PIN;
+	pins.data_out_num = I2S_DOUT_PIN;
+	pins.data_in_num = I2S_DIN_PIN;
+	if (i2s_set_pin(I2S_NUM_0, &pins) != ESP_OK)
+	{
+		i2s_driver_uninstall(I2S_NUM_0);
+		return false;
+	}
+
+	const codec_bus_t bus = {wireWrite, wireDelay, NULL};
+	if (!codecInit(AUDIO_CODEC, &bus))
+	{
+		Serial.println("Audio codec did not acknowledge");
+		i2s_driver_uninstall(I2S_NUM_0);
+		return false;
+	}
+
+	// Pass band to 4 kHz, well below the 4.8 kHz Nyquist limit of the demodulator rate
+	for (uint8_t ch = 0; ch < channelCount; ch++)
+	{
+		firDecimatorInit(&decimators[ch], CODEC_DECIMATION, 40, 4000.0f / AUDIO_CODEC_SAMPLE_RATE);
+	}
+	return true;
+}
+
+/**
+ * @brief Drop one reader's hold on a block, returning it to the pool after the last
+ */
+static void releaseBlock(audio_block_t *block)
+{
+	portENTER_CRITICAL(&blockLock);
+	bool last = block->readers == 0 || --block->readers == 0;
+	portEXIT_CRITICAL(&blockLock);
+	if (last)
+	{
+		xQueueSend(freeBlocks, &block, 0);
+	}
+}
+
+/**
+ * @brief Queue a full block to every reader of its channel
+ */
+static void publishBlock(audio_block_t *block)
+{
+	QueueHandle_t queues[AUDIO_MAX_READERS];
+	uint8_t readers[AUDIO_MAX_READERS];
+	uint8_t count = 0;
+	portENTER_CRITICAL(&blockLock);
+	for (uint8_t r = 0; r < readerCount; r++)
+	{
+		if (readerChannel[r] == block->channel)
+		{
+			readers[count] = r;
+			queues[count++] = readyBlocks[r];
+		}
+	}
+	block->readers = count;
+	portEXIT_CRITICAL(&blockLock);
+
+	if (count == 0)
+	{
+		xQueueSend(freeBlocks, &block, 0); // Channel nobody decodes
+		return;
+	}
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (xQueueSend(queues[i], &block, 0) != pdTRUE)
+		{
+			releaseBlock(block);
+			droppedBlocks++;
+			deadlineMiss(DEADLINE_CAPTURE, 0, "reader", readers[i]);
+		}
+	}
+}
+
+/**
+ * @brief Append decimated samples to a channel, queueing every full block
+ * @param wait Longest wait for a free block; 0 for live audio, which cannot wait
+ */
+static void appendSamples(uint8_t ch, const int16_t *samples, size_t count, TickType_t wait)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (filling[ch] == NULL)
+		{
+			// No free block: the decoders are behind, drop this block's worth of audio
+			if (xQueueReceive(freeBlocks, &filling[ch], wait) != pdTRUE)
+			{
+				filling[ch] = NULL;
+				if (++fillCount[ch] == AUDIO_BLOCK_SAMPLES)
+				{
+					fillCount[ch] = 0;
+					sequence[ch]++;
+					droppedBlocks++;
+					deadlineMiss(DEADLINE_CAPTURE, 0, "channel", ch); // No free block in the pool
+				}
+				continue;
+			}
+			fillCount[ch] = 0;
+		}
+
+		audio_block_t *block = filling[ch];
+		block->samples[fillCount[ch]++] = samples[i];
+		if (fillCount[ch] == AUDIO_BLOCK_SAMPLES)
+		{
+			block->channel = ch;
+			block->sequence = sequence[ch]++;
+			block->capturedUs = micros();
+			publishBlock(block);
+			filling[ch] = NULL;
+			fillCount[ch] = 0;
+		}
+	}
+}
+
+/**
+ * @brief Read one DMA chunk from ADC1 and de-interleave it by ADC channel
+ */
+static void captureInternal(int16_t raw[AUDIO_MAX_CHANNELS][ADC_READ_SAMPLES], size_t counts[AUDIO_MAX_CHANNELS])
+{
+	static uint8_t dma[ADC_READ_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES];
+	uint32_t bytesRead = 0;
+	esp_err_t result = adc_digi_read_bytes(dma, sizeof(dma), &bytesRead, portMAX_DELAY);
+	if (result == ESP_ERR_INVALID_STATE)
+	{
+		// The driver's ring overflowed before this read; what was read is still good
+		deadlineMiss(DEADLINE_CAPTURE, 0, "adc ring", 0);
+	}
+	else if (result != ESP_OK)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= bytesRead; i += SOC_ADC_DIGI_RESULT_BYTES)
+	{
+		const adc_digi_output_data_t *result = (const adc_digi_output_data_t *)&dma[i];
+		for (uint8_t ch = 0; ch < channelCount; ch++)
+		{
+			if (result->type1.channel == adcChannel[ch])
+			{
+				// 12 bits to 16, multiplied as in squelchProcess(): shifting a negative value is undefined
+				raw[ch][counts[ch]++] = (int16_t)(((int32_t)result->type1.data - AUDIO_ADC_MIDPOINT) * 16);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Read one DMA chunk from the codec and split left and right
+ */
+static void captureCodec(int16_t raw[AUDIO_MAX_CHANNELS][ADC_READ_SAMPLES], size_t counts[AUDIO_MAX_CHANNELS])
+{
+	static int16_t frames[2 * CODEC_FRAMES_PER_READ];
+	size_t bytesRead = 0;
+	if (i2s_read(I2S_NUM_0, frames, sizeof(frames), &bytesRead, portMAX_DELAY) != ESP_OK)
+	{
+		return;
+	}
+
+	size_t frameCount = bytesRead / (2 * sizeof(int16_t));
+	for (uint8_t ch = 0; ch < channelCount; ch++)
+	{
+		for (size_t i = 0; i < frameCount; i++)
+		{
+			raw[ch][i] = frames[2 * i + ch];
+		}
+		counts[ch] = frameCount;
+	}
+}
+
+/**
+ * @brief Capture task: read, de-interleave, decimate and queue blocks forever
+ */
+static void captureLoop(void *arg)
+{
+	(void)arg;
+	static_assert(CODEC_FRAMES_PER_READ <= ADC_READ_SAMPLES, "Capture buffer too small for codec reads");
+	static int16_t raw[AUDIO_MAX_CHANNELS][ADC_READ_SAMPLES];
+	static int16_t decimated[ADC_READ_SAMPLES / AUDIO_ADC_OVERSAMPLE + 1];
+
+	for (;;)
+	{
+		size_t counts[AUDIO_MAX_CHANNELS] = {};
+		if (activeBackend == AUDIO_BACKEND_I2S_CODEC)
+		{
+			captureCodec(raw, counts);
+		}
+		else
+		{
+			captureInternal(raw, counts);
+		}
+
+		if (injectState != INJECT_OFF)
+		{
+			// Hands the blocks being filled to audioInjectBegin(), unless it gave up waiting
+			portENTER_CRITICAL(&blockLock);
+			if (injectState == INJECT_REQUESTED)
+			{
+				injectState = INJECT_ON;
+			}
+			bool injecting = injectState == INJECT_ON;
+			portEXIT_CRITICAL(&blockLock);
+			if (injecting)
+			{
+				continue;
+			}
+		}
+		for (uint8_t ch = 0; ch < channelCount; ch++)
+		{
+			size_t produced = firDecimatorProcess(&decimators[ch], raw[ch], counts[ch], decimated);
+			appendSamples(ch, decimated, produced, 0);
+		}
+	}
+}
+
+/**
+ * @brief Start an audio backend and its capture task
+ * @param backend Backend to start
+ * @param channels Receive channels to capture, 1 to AUDIO_MAX_CHANNELS
+ * @return true on success, false if the hardware could not be configured
+ */
+bool audioBegin(audio_backend_t backend, uint8_t channels)
+{
+	if (audioStarted)
+	{
+		audioEnd();
+	}
+	if (channels < 1 || channels > AUDIO_MAX_CHANNELS)
+	{
+		return false;
+	}
+	channelCount = channels;
+
+	// Queues are created once and reused by later audioBegin() calls, readers stay open
+	if (freeBlocks == NULL)
+	{
+		freeBlocks = xQueueCreate(AUDIO_BLOCK_POOL, sizeof(audio_block_t *));
+	}
+	xQueueReset(freeBlocks);
+	for (size_t i = 0; i < AUDIO_BLOCK_POOL; i++)
+	{
+		audio_block_t *block = &blockPool[i];
+		block->readers = 0;
+		xQueueSend(freeBlocks, &block, 0);
+	}
+	for (uint8_t r = 0; r < readerCount; r++)
+	{
+		xQueueReset(readyBlocks[r]);
+	}
+	for (uint8_t ch = 0; ch < AUDIO_MAX_CHANNELS; ch++)
+	{
+		filling[ch] = NULL;
+		fillCount[ch] = 0;
+		sequence[ch] = 0;
+	}
+	droppedBlocks = 0;
+
+	bool ok = backend == AUDIO_BACKEND_I2S_CODEC ? beginCodec() : beginInternal();
+	if (!ok)
+	{
+		channelCount = 0;
+		return false;
+	}
+
+	activeBackend = backend;
+	audioStarted = true;
+	xTaskCreatePinnedToCore(captureLoop, "audioCapture", CAPTURE_TASK_STACK, NULL,
+							CAPTURE_TASK_PRIORITY, &captureTask, CAPTURE_TASK_CORE);
+	return true;
+}
+
+/**
+ * @brief Subscribe to the receive blocks of a channel
+ * @param channel Channel number, 0 to AUDIO_MAX_CHANNELS - 1
+ * @return Reader number for audioReceiveBlock(), -1 if AUDIO_MAX_READERS are open
+ */
+int8_t audioOpenReader(uint8_t channel)
+{
+	if (channel >= AUDIO_MAX_CHANNELS || readerCount >= AUDIO_MAX_READERS)
+	{
+		return -1;
+	}
+	uint8_t r = readerCount;
+	// Deep enough for the whole pool, so queueing to a reader never fails
+	readyBlocks[r] = xQueueCreate(AUDIO_BLOCK_POOL, sizeof(audio_block_t *));
+	if (readyBlocks[r] == NULL)
+	{
+		return -1;
+	}
+	readerChannel[r] = channel;
+	portENTER_CRITICAL(&blockLock);
+	readerCount++; // The capture task sees the reader from its next block on
+	portEXIT_CRITICAL(&blockLock);
+	return (int8_t)r;
+}
+
+/**
+ * @brief Wait for the next receive block of a reader
+ * @param reader Reader number from audioOpenReader()
+ * @param timeoutMs Longest wait in milliseconds
+ * @return Block to read, or NULL on timeout. Return it with audioReleaseBlock().
+ */
+audio_block_t *audioReceiveBlock(uint8_t reader, uint32_t timeoutMs)
+{
+	audio_block_t *block = NULL;
+	if (!audioStarted || reader >= readerCount || readerChannel[reader] >= channelCount)
+	{
+		return NULL;
+	}
+	if (xQueueReceive(readyBlocks[reader], &block, pdMS_TO_TICKS(timeoutMs)) != pdTRUE)
+	{
+		return NULL;
+	}
+	return block;
+}
+
+/**
+ * @brief Release a block; the last of its readers returns it to the capture pool
+ * @param block Block from audioReceiveBlock(), not to be read afterwards
+ */
+void audioReleaseBlock(audio_block_t *block)
+{
+	if (block != NULL)
+	{
+		releaseBlock(block);
+	}
+}
+
+/**
+ * @brief Return the partly filled blocks to the pool
+ */
+static void dropFilling()
+{
+	for (uint8_t ch = 0; ch < AUDIO_MAX_CHANNELS; ch++)
+	{
+		if (filling[ch] != NULL)
+		{
+			xQueueSend(freeBlocks, &filling[ch], 0);
+			filling[ch] = NULL;
+		}
+		fillCount[ch] = 0;
+	}
+}
+
+/**
+ * @brief Replace live receive audio with samples from the calling task
+ * @return true once the capture task has stopped appending, false if audio is
+ *         stopped or another injection is running
+ */
+bool audioInjectBegin()
+{
+	portENTER_CRITICAL(&blockLock);
+	bool idle = audioStarted && injectState == INJECT_OFF;
+	if (idle)
+	{
+		injectState = INJECT_REQUESTED;
+	}
+	portEXIT_CRITICAL(&blockLock);
+	if (!idle)
+	{
+		return false;
+	}
+	for (uint32_t waited = 0; injectState != INJECT_ON; waited++)
+	{
+		if (waited >= INJECT_HANDOVER_MS)
+		{
+			// Withdraw the request, unless the capture task took it since the last look
+			portENTER_CRITICAL(&blockLock);
+			bool handedOver = injectState == INJECT_ON;
+			if (!handedOver)
+			{
+				injectState = INJECT_OFF;
+			}
+			portEXIT_CRITICAL(&blockLock);
+			if (!handedOver)
+			{
+				return false;
+			}
+			break;
+		}
+		vTaskDelay(pdMS_TO_TICKS(1));
+	}
+	dropFilling(); // The injected audio starts on a block boundary
+	return true;
+}
+
+/**
+ * @brief Append samples to a channel as if captured, between audioInjectBegin() and audioInjectEnd()
+ * @param channel Receive channel
+ * @param samples Samples at AUDIO_RX_SAMPLE_RATE
+ * @param count Number of samples
+ */
+void audioInjectSamples(uint8_t channel, const int16_t *samples, size_t count)
+{
+	if (injectState == INJECT_ON && channel < channelCount)
+	{
+		appendSamples(channel, samples, count, portMAX_DELAY);
+	}
+}
+
+/**
+ * @brief Return the receive blocks to live audio; a partly filled block is dropped
+ */
+void audioInjectEnd()
+{
+	if (injectState != INJECT_ON)
+	{
+		return;
+	}
+	dropFilling();
+	portENTER_CRITICAL(&blockLock);
+	injectState = INJECT_OFF;
+	portEXIT_CRITICAL(&blockLock);
+}
+
+/**
+ * @brief Write transmit samples at audioOutputSampleRate()
+ * @param samples Signed 16-bit samples
+ * @param count Number of samples to write
+ * @return Number of samples written
+ */
+size_t audioWriteBlock(const int16_t *samples, size_t count)
+{
+	if (!audioStarted || activeBackend != AUDIO_BACKEND_I2S_CODEC)
+	{
+		return 0;
+	}
+
+	// Duplicate mono samples into both channels
+	static int16_t frames[2 * CODEC_FRAMES_PER_READ];
+	size_t written = 0;
+	while (written < count)
+	{
+		size_t chunk = count - written;
+		if (chunk > CODEC_FRAMES_PER_READ)
+		{
+			chunk = CODEC_FRAMES_PER_READ;
+		}
+		for (size_t i = 0; i < chunk; i++)
+		{
+			frames[2 * i] = samples[written + i];
+			frames[2 * i + 1] = samples[written + i];
+		}
+
+		size_t bytesWritten = 0;
+		if (i2s_write(I2S_NUM_0, frames, chunk * 2 * sizeof(int16_t), &bytesWritten, portMAX_DELAY) != ESP_OK)
+		{
+			break;
+		}
+		written += bytesWritten / (2 * sizeof(int16_t));
+	}
+	return written;
+}
+
+/**
+ * @brief Check whether transmit audio goes through audioWriteBlock()
+ * @return true for block outputs such as an I2S codec
+ */
+bool audioHasBlockOutput()
+{
+	return audioStarted && activeBackend == AUDIO_BACKEND_I2S_CODEC;
+}
+
+/**
+ * @brief Get the transmit sample rate of the block output
+ * @return Sample rate in Hz, 0 if there is no block output
+ */
+uint32_t audioOutputSampleRate()
+{
+	return audioHasBlockOutput() ? AUDIO_CODEC_SAMPLE_RATE : 0;
+}
+
+/**
+ * @brief Get the number of receive channels being captured
+ * @return Channel count, 0 when stopped
+ */
+uint8_t audioChannelCount()
+{
+	return audioStarted ? channelCount : 0;
+}
+
+/**
+ * @brief Get the number of blocks dropped because the pool or a reader queue was full
+ * @return Dropped blocks since audioBegin()
+ */
+uint32_t audioDroppedBlocks()
+{
+	return droppedBlocks;
+}
+
+/**
+ * @brief Stop the active backend
+ */
+void audioEnd()
+{
+	if (!audioStarted)
+	{
+		return;
+	}
+	if (captureTask != NULL)
+	{
+		vTaskDelete(captureTask);
+		captureTask = NULL;
+	}
+	if (activeBackend == AUDIO_BACKEND_I2S_CODEC)
+	{
+		i2s_driver_uninstall(I2S_NUM_0);
+		Wire.end();
+	}
+	else
+	{
+		adc_digi_stop();
+		adc_digi_deinitialize();
+	}
+	audioStarted = false;
+	channelCount = 0;
+}
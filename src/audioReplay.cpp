@@ -0,0 +1,399 @@
+/**
+ * @file audioReplay.cpp
+ * @date 2025-10-16
+ * @brief On-device replay of a stored recording through the receive chain, for field checks.
+ *
+ * The replay task reads the WAV file in REPLAY_READ_FRAMES pieces, decimates
+ * them and injects them into REPLAY_CHANNEL. audioInjectSamples() waits for
+ * free blocks, so the decoder tasks set the pace. The ports that decode the
+ * recording are the ones whose block count moves; their counters before and
+ * after give the frames and CPU time.
+ */
+
+#include "audioReplay.h"
+#include "configuration.h"
+
+#if FEATURE_REPLAY
+#include <LittleFS.h>
+#include "afskDecode.h"
+#include "firDecimator.h"
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define REPLAY_MAX_CHANNELS 2 // Interleaved channels the read buffer holds
+
+typedef struct
+{
+	uint32_t sampleRate;
+	uint16_t channels;
+	uint32_t dataOffset;
+	uint32_t dataBytes;
+} wav_info_t;
+
+static volatile bool busy = false;
+static bool haveResult = false;
+static audio_replay_result_t lastResult;
+static uint32_t pendingExpected = 0;
+static int8_t pendingReplyPort = -1;
+
+static uint32_t le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Walk the RIFF chunks to the format and the sample data
+ * @return NULL on success, otherwise the reason the file cannot be replayed
+ */
+static const char *readWavHeader(File &f, wav_info_t *wav)
+{
+	uint8_t header[12];
+	if (f.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "RIFF", 4) != 0 ||
+		memcmp(header + 8, "WAVE", 4) != 0)
+	{
+		return "not a WAV file";
+	}
+	bool haveFormat = false;
+	uint8_t chunk[8];
+	while (f.read(chunk, sizeof(chunk)) == sizeof(chunk))
+	{
+		uint32_t size = le32(chunk + 4);
+		uint32_t next = f.position() + size + (size & 1); // Chunks are padded to even sizes
+		if (memcmp(chunk, "fmt ", 4) == 0)
+		{
+			uint8_t format[16];
+			if (size < sizeof(format) || f.read(format, sizeof(format)) != sizeof(format))
+			{
+				return "bad format chunk";
+			}
+			uint16_t tag = le16(format);
+			if ((tag != WAV_FORMAT_PCM && tag != WAV_FORMAT_EXTENSIBLE) || le16(format + 14) != 16)
+			{
+				return "not 16-bit PCM";
+			}
+			wav->channels = le16(format + 2);
+			wav->sampleRate = le32(format + 4);
+			haveFormat = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			if (!haveFormat)
+			{
+				return "data before format";
+			}
+			wav->dataOffset = f.position();
+			wav->dataBytes = size;
+			return NULL;
+		}
+		if (!f.seek(next))
+		{
+			break;
+		}
+	}
+	return "no sample data";
+}
+
+/**
+ * @brief Inject the recording and a tail of silence, leaving the injection on
+ * @return Blocks injected, 0 on error with result->error set
+ */
+static uint32_t injectFile(File &f, const wav_info_t *wav, audio_replay_result_t *result)
+{
+	static int16_t raw[REPLAY_READ_FRAMES * REPLAY_MAX_CHANNELS];
+	static int16_t mono[REPLAY_READ_FRAMES];
+	static int16_t decimated[REPLAY_READ_FRAMES];
+	static fir_decimator_t fir;
+
+	uint32_t decimation = wav->sampleRate / AUDIO_RX_SAMPLE_RATE;
+	if (wav->channels < 1 || wav->channels > REPLAY_MAX_CHANNELS)
+	{
+		result->error = "more than 2 channels";
+		return 0;
+	}
+	if (decimation < 1 || wav->sampleRate % AUDIO_RX_SAMPLE_RATE != 0 || decimation * 8 > FIR_DECIMATOR_MAX_TAPS)
+	{
+		result->error = "sample rate is not 9600 Hz times 1 to 8";
+		return 0;
+	}
+	if (decimation > 1)
+	{
+		firDecimatorInit(&fir, (uint8_t)decimation, (uint8_t)(8 * decimation), 4000.0f / wav->sampleRate);
+	}
+	f.seek(wav->dataOffset);
+
+	if (!audioInjectBegin())
+	{
+		result->error = "audio input busy";
+		return 0;
+	}
+	uint64_t samples = 0;
+	uint32_t frameBytes = 2 * wav->channels;
+	uint32_t remaining = wav->dataBytes / frameBytes;
+	while (remaining > 0)
+	{
+		size_t want = remaining < REPLAY_READ_FRAMES ? remaining : REPLAY_READ_FRAMES;
+		size_t frames = f.read((uint8_t *)raw, want * frameBytes) / frameBytes;
+		if (frames == 0)
+		{
+			break; // File shorter than its header says
+		}
+		remaining -= frames;
+		for (size_t i = 0; i < frames; i++)
+		{
+			mono[i] = raw[i * wav->channels]; // WAV and the ESP32 are both little-endian
+		}
+		const int16_t *out = mono;
+		size_t count = frames;
+		if (decimation > 1)
+		{
+			count = firDecimatorProcess(&fir, mono, frames, decimated);
+			out = decimated;
+		}
+		audioInjectSamples(REPLAY_CHANNEL, out, count);
+		samples += count;
+	}
+
+	memset(decimated, 0, sizeof(decimated));
+	for (uint32_t tail = 0; tail < REPLAY_TAIL_BLOCKS * AUDIO_BLOCK_SAMPLES; tail += AUDIO_BLOCK_SAMPLES)
+	{
+		audioInjectSamples(REPLAY_CHANNEL, decimated, AUDIO_BLOCK_SAMPLES);
+	}
+	samples += REPLAY_TAIL_BLOCKS * AUDIO_BLOCK_SAMPLES;
+	result->audioMs = (uint32_t)(samples * 1000 / AUDIO_RX_SAMPLE_RATE);
+	return (uint32_t)(samples / AUDIO_BLOCK_SAMPLES); // The last partial block is dropped
+}
+
+/**
+ * @brief Replay REPLAY_FILE once and fill in the report
+ */
+static void runReplay(audio_replay_result_t *result)
+{
+	rx_power_stats_t before[AUDIO_MAX_READERS];
+	bool exists[AUDIO_MAX_READERS];
+
+	if (!LittleFS.begin(false))
+	{
+		result->error = "no LittleFS partition";
+		return;
+	}
+	File f = LittleFS.open(REPLAY_FILE, "r");
+	if (!f)
+	{
+		result->error = "no " REPLAY_FILE;
+		LittleFS.end();
+		return;
+	}
+	wav_info_t wav;
+	result->error = readWavHeader(f, &wav);
+	if (result->error == NULL)
+	{
+		for (uint8_t p = 0; p < AUDIO_MAX_READERS; p++)
+		{
+			exists[p] = getReceivePowerStats(p, &before[p]);
+		}
+		setReceiveSelfTest(true);
+		uint32_t startMs = millis();
+		uint32_t blocks = injectFile(f, &wav, result);
+
+		// Ports on the channel have taken every block once their count has moved by all of them
+		uint32_t injectedMs = millis();
+		bool done = blocks == 0;
+		while (!done && millis() - injectedMs < REPLAY_DRAIN_MS)
+		{
+			vTaskDelay(pdMS_TO_TICKS(10)); // Also lets the port that took the last block finish it
+			done = true;
+			for (uint8_t p = 0; p < AUDIO_MAX_READERS; p++)
+			{
+				rx_power_stats_t now;
+				if (exists[p] && getReceivePowerStats(p, &now) && now.blocks != before[p].blocks &&
+					now.blocks - before[p].blocks < blocks)
+				{
+					done = false;
+				}
+			}
+		}
+		result->elapsedMs = millis() - startMs;
+		audioInjectEnd();
+		setReceiveSelfTest(false);
+
+		for (uint8_t p = 0; blocks > 0 && p < AUDIO_MAX_READERS; p++)
+		{
+			rx_power_stats_t now;
+			if (exists[p] && getReceivePowerStats(p, &now) && now.blocks != before[p].blocks)
+			{
+				result->port[result->ports] = p;
+				result->frames[result->ports] = now.frames - before[p].frames;
+				result->busyUs[result->ports] = now.busyUs - before[p].busyUs;
+				result->ports++;
+			}
+		}
+	}
+	f.close();
+	LittleFS.end();
+}
+
+/**
+ * @brief One-line report, also the SETHARDWARE reply
+ */
+static size_t formatSummary(const audio_replay_result_t *r, char *out, size_t size)
+{
+	if (r->error != NULL)
+	{
+		return (size_t)snprintf(out, size, "replay: %s", r->error);
+	}
+	if (r->ports == 0)
+	{
+		return (size_t)snprintf(out, size, "replay: no port decodes channel %d", REPLAY_CHANNEL);
+	}
+	float mcycles = r->audioMs ? (float)r->busyUs[0] * RX_ACTIVE_CPU_MHZ / r->audioMs / 1000.0f : 0.0f;
+	const char *verdict = r->expected == 0 ? "" : r->frames[0] >= r->expected ? ", PASS" : ", FAIL";
+	return (size_t)snprintf(out, size, "replay: port %u %lu/%lu frames, %.1fx real time, %.1f Mcycles/s%s",
+							r->port[0], r->frames[0], r->expected, r->elapsedMs ? (float)r->audioMs / r->elapsedMs : 0.0f,
+							mcycles, verdict);
+}
+
+/**
+ * @brief Print the summary line, then every port that decoded the recording
+ */
+static void printResult(const audio_replay_result_t *r)
+{
+	char line[REPLAY_REPLY_MAX];
+	formatSummary(r, line, sizeof(line));
+	Serial.println(line);
+	if (r->error != NULL)
+	{
+		return;
+	}
+	Serial.printf("Replay: %lu ms of audio in %lu ms\n", r->audioMs, r->elapsedMs);
+	for (uint8_t i = 0; i < r->ports; i++)
+	{
+		Serial.printf("Replay port %u: %lu frames, CPU %lu ms (%.1f%% of real time), %.1f Mcycles per audio second\n",
+					  r->port[i], r->frames[i], (uint32_t)(r->busyUs[i] / 1000),
+					  r->audioMs ? r->busyUs[i] / 10.0f / r->audioMs : 0.0f,
+					  r->audioMs ? (float)r->busyUs[i] * RX_ACTIVE_CPU_MHZ / r->audioMs / 1000.0f : 0.0f);
+	}
+}
+
+static void replayTask(void *param)
+{
+	(void)param;
+	audio_replay_result_t result = {};
+	result.expected = pendingExpected;
+	runReplay(&result);
+	lastResult = result;
+	haveResult = true;
+	printResult(&result);
+	if (pendingReplyPort >= 0)
+	{
+		char reply[REPLAY_REPLY_MAX];
+		size_t n = formatSummary(&result, reply, sizeof(reply));
+		sendKISShardware((uint8_t)pendingReplyPort, (const uint8_t *)reply, n < sizeof(reply) ? n : sizeof(reply) - 1);
+	}
+	busy = false;
+	vTaskDelete(NULL);
+}
+
+/**
+ * @brief Replay REPLAY_FILE in a background task
+ * @param expected Frames the first port should decode, 0 to report without a verdict
+ * @param replyPort KISS port to send the report to as a SETHARDWARE frame, -1 for Serial only
+ * @return false if a replay is already running or the task cannot start
+ */
+bool audioReplayStart(uint32_t expected, int8_t replyPort)
+{
+	if (busy)
+	{
+		return false;
+	}
+	busy = true;
+	pendingExpected = expected;
+	pendingReplyPort = replyPort;
+	if (xTaskCreatePinnedToCore(replayTask, "audioReplay", REPLAY_TASK_STACK, NULL, REPLAY_TASK_PRIORITY, NULL,
+								tskNO_AFFINITY) != pdPASS)
+	{
+		busy = false;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Start a replay from a SETHARDWARE payload "replay" or "replay <expected>"
+ * @param port KISS port the command came on, which gets the report
+ * @param data Payload
+ * @param len Payload length
+ * @return true if the payload is a replay command, whether or not a replay could start
+ */
+bool audioReplayCommand(uint8_t port, const uint8_t *data, size_t len)
+{
+	const size_t nameLen = sizeof(REPLAY_COMMAND) - 1;
+	if (len < nameLen || memcmp(data, REPLAY_COMMAND, nameLen) != 0)
+	{
+		return false;
+	}
+	uint32_t expected = REPLAY_EXPECTED_FRAMES;
+	size_t i = nameLen;
+	while (i < len && data[i] == ' ')
+	{
+		i++;
+	}
+	if (i < len)
+	{
+		expected = 0;
+		for (; i < len && data[i] >= '0' && data[i] <= '9'; i++)
+		{
+			expected = expected * 10 + (data[i] - '0');
+		}
+	}
+	if (!audioReplayStart(expected, (int8_t)port))
+	{
+		static const char reply[] = "replay: already running";
+		sendKISShardware(port, (const uint8_t *)reply, sizeof(reply) - 1);
+	}
+	return true;
+}
+
+bool audioReplayBusy()
+{
+	return busy;
+}
+
+/**
+ * @brief Copy the report of the last replay
+ * @return false before the first replay has finished
+ */
+bool getAudioReplayResult(audio_replay_result_t *result)
+{
+	if (busy || !haveResult)
+	{
+		return false;
+	}
+	*result = lastResult;
+	return true;
+}
+
+/**
+ * @brief Print the last replay to Serial
+ */
+void printAudioReplayResult()
+{
+	if (busy)
+	{
+		Serial.println("Replay: running");
+	}
+	else if (!haveResult)
+	{
+		Serial.println("Replay: none yet");
+	}
+	else
+	{
+		printResult(&lastResult);
+	}
+}
+
+#endif // FEATURE_REPLAY
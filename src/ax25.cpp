@@ -0,0 +1,211 @@
+/**
+ * @file ax25.cpp
+ * @date 2025-09-22
+ * @brief AX.25 UI frame parser and TNC2 monitor formatter.
+ */
+
+#include "ax25.h"
+
+#include <stdio.h>
+
+/**
+ * @brief Decode one address field
+ *
+ * Callsign characters are shifted left by one. Spaces may only pad the end of
+ * the callsign, and the callsign must not be empty.
+ *
+ * @return true if the field is valid
+ */
+static bool parseAddress(const uint8_t *field, ax25_address_t *a)
+{
+	bool padding = false;
+	size_t length = 0;
+	for (size_t i = 0; i < 6; i++)
+	{
+		if (field[i] & 0x01)
+		{
+			return false; // Extension bit is only allowed in the SSID byte
+		}
+		char c = (char)(field[i] >> 1);
+		if (c == ' ')
+		{
+			padding = true;
+			continue;
+		}
+		if (padding || !((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+		{
+			return false;
+		}
+		a->call[length++] = c;
+	}
+	a->call[length] = '\0';
+	a->ssid = (field[6] >> 1) & 0x0F;
+	a->hBit = (field[6] & 0x80) != 0;
+	return length > 0;
+}
+
+/**
+ * @brief Validate a frame and split it into its fields
+ * @param frame Frame bytes without FCS
+ * @param len Number of bytes
+ * @param out Parsed fields, valid while frame is
+ * @return AX25_OK, or the first problem found
+ */
+ax25_status_t ax25Parse(const uint8_t *frame, size_t len, ax25_frame_t *out)
+{
+	if (len < 2 * AX25_ADDRESS_LEN + 1)
+	{
+		return AX25_ERROR_SHORT;
+	}
+	if (!parseAddress(frame, &out->dest) || !parseAddress(frame + AX25_ADDRESS_LEN, &out->source))
+	{
+		return AX25_ERROR_ADDRESS;
+	}
+
+	// The last address has bit 0 of its SSID byte set
+	size_t pos = 2 * AX25_ADDRESS_LEN;
+	out->digiCount = 0;
+	bool last = frame[pos - 1] & 0x01;
+	while (!last)
+	{
+		if (out->digiCount == AX25_MAX_DIGIS)
+		{
+			return AX25_ERROR_TOO_MANY_DIGIS;
+		}
+		if (pos + AX25_ADDRESS_LEN > len)
+		{
+			return AX25_ERROR_SHORT;
+		}
+		if (!parseAddress(frame + pos, &out->digis[out->digiCount]))
+		{
+			return AX25_ERROR_ADDRESS;
+		}
+		out->digiCount++;
+		pos += AX25_ADDRESS_LEN;
+		last = frame[pos - 1] & 0x01;
+	}
+
+	if (pos >= len)
+	{
+		return AX25_ERROR_SHORT;
+	}
+	out->control = frame[pos++];
+
+	// I frames and UI frames carry a PID
+	out->pid = -1;
+	if ((out->control & 0x01) == 0 || (out->control & 0xEF) == AX25_CONTROL_UI)
+	{
+		if (pos >= len)
+		{
+			return AX25_ERROR_SHORT;
+		}
+		out->pid = frame[pos++];
+	}
+
+	out->info = frame + pos;
+	out->infoLength = len - pos;
+	return out->infoLength > AX25_MAX_INFO ? AX25_ERROR_INFO_LENGTH : AX25_OK;
+}
+
+// Bounded appender for ax25Format(), counts what would have been written
+typedef struct
+{
+	char *out;
+	size_t size;
+	size_t length;
+} text_writer_t;
+
+static void putText(text_writer_t *w, const char *text)
+{
+	for (; *text; text++)
+	{
+		if (w->length + 1 < w->size)
+		{
+			w->out[w->length] = *text;
+		}
+		w->length++;
+	}
+}
+
+static void putAddress(text_writer_t *w, const ax25_address_t *a)
+{
+	putText(w, a->call);
+	if (a->ssid)
+	{
+		char ssid[8];
+		snprintf(ssid, sizeof(ssid), "-%u", a->ssid);
+		putText(w, ssid);
+	}
+}
+
+/**
+ * @brief Print a parsed frame as a TNC2 monitor line
+ * @param f Parsed frame
+ * @param out Output buffer
+ * @param size Size of out
+ * @return Length the full line would have, like snprintf()
+ */
+size_t ax25Format(const ax25_frame_t *f, char *out, size_t size)
+{
+	text_writer_t w = {out, size, 0};
+
+	putAddress(&w, &f->source);
+	putText(&w, ">");
+	putAddress(&w, &f->dest);
+	for (uint8_t i = 0; i < f->digiCount; i++)
+	{
+		putText(&w, ",");
+		putAddress(&w, &f->digis[i]);
+		if (f->digis[i].hBit)
+		{
+			putText(&w, "*");
+		}
+	}
+	putText(&w, ":");
+
+	for (size_t i = 0; i < f->infoLength; i++)
+	{
+		uint8_t c = f->info[i];
+		char text[8];
+		if (c >= 0x20 && c < 0x7F)
+		{
+			text[0] = (char)c;
+			text[1] = '\0';
+		}
+		else
+		{
+			snprintf(text, sizeof(text), "<0x%02X>", c);
+		}
+		putText(&w, text);
+	}
+
+	if (size > 0)
+	{
+		out[w.length < size ? w.length : size - 1] = '\0';
+	}
+	return w.length;
+}
+
+/**
+ * @brief Describe a parse result
+ * @param status Parse result
+ * @return Static description
+ */
+const char *ax25StatusString(ax25_status_t status)
+{
+	switch (status)
+	{
+	case AX25_OK:
+		return "OK";
+	case AX25_ERROR_SHORT:
+		return "Frame too short";
+	case AX25_ERROR_ADDRESS:
+		return "Invalid address";
+	case AX25_ERROR_TOO_MANY_DIGIS:
+		return "Too many digipeaters";
+	case AX25_ERROR_INFO_LENGTH:
+		return "Information field too long";
+	default:
+		return "Unknown error";
+	}
+}
@@ -1,36 +1,169 @@
 #include <Arduino.h>
-#include "btFunctions.h"
-#include "afskEncoder.h"
 #include "configuration.h"
 
+#if FEATURE_BT_CLASSIC
+#include "afskDecode.h"  // sendKISShardware()
+#include "afskEncoder.h" // Transmit twist
+#include "allocTrap.h"
+#include "audioReplay.h"
+#include "btFunctions.h"
+#include "kiss.h"
+#include "txQueue.h"
+
+#define BT_READ_CHUNK 64 // Bytes moved from the Bluetooth buffer per read
+#define TWIST_COMMAND "twist" // SETHARDWARE payload, optionally followed by dB, "flat" or "preemph"
+
 BluetoothSerial BTSerial; // Bluetooth KISS Interface
+static kiss_decoder_t hostKiss; // Frames from the host, collected across reads
+static uint32_t readUs;		 // micros() of the read that completed the frame being decoded
+
+static void onHostFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len);
 
 /**
  * @brief Initializes the Bluetooth serial interface with the specified device name.
  *
- * This function starts the Bluetooth serial communication using the device name defined by BT_NAME.
- * It also prints a message to the serial monitor indicating that the Bluetooth device is ready.
+ * This function starts the Bluetooth serial communication using the device name defined by BT_NAME,
+ * in classic-only mode unless FEATURE_BLE is set. It also prints a message to the serial monitor
+ * indicating that the Bluetooth device is ready.
  */
 void setupBluetooth()
 {
-  BTSerial.begin(BT_NAME); // Broadcast Bluetooth device name
+  kissInit(&hostKiss, onHostFrame, NULL);
+  // Classic only without FEATURE_BLE: setup() has released the BLE controller memory
+  BTSerial.begin(BT_NAME, false, !FEATURE_BLE); // Broadcast Bluetooth device name
   Serial.printf("%s %s\n", BT_NAME, "ready");
 }
 
+/**
+ * @brief Sets or reports the transmit twist from a SETHARDWARE command.
+ *
+ * "twist <dB>" sets the mark level relative to space, "twist flat" and
+ * "twist preemph" select the presets for the radio's input (setAFSKTwistProfile()).
+ * Every form answers with the twist now in use, or why it was refused.
+ *
+ * @return false if the payload is not a twist command
+ */
+static bool twistCommand(uint8_t port, const uint8_t *data, size_t len)
+{
+  const size_t nameLen = sizeof(TWIST_COMMAND) - 1;
+  if (len < nameLen || memcmp(data, TWIST_COMMAND, nameLen) != 0 || (len > nameLen && data[nameLen] != ' '))
+  {
+    return false;
+  }
+  char arg[16];
+  size_t i = nameLen;
+  while (i < len && data[i] == ' ')
+  {
+    i++;
+  }
+  size_t argLen = len - i < sizeof(arg) - 1 ? len - i : sizeof(arg) - 1;
+  memcpy(arg, data + i, argLen);
+  arg[argLen] = '\0';
+
+  afsk_status_t status = AFSK_SUCCESS;
+  if (strcmp(arg, "flat") == 0)
+  {
+    status = setAFSKTwistProfile(AFSK_TWIST_FLAT_INPUT);
+  }
+  else if (strcmp(arg, "preemph") == 0)
+  {
+    status = setAFSKTwistProfile(AFSK_TWIST_PREEMPHASIZED_INPUT);
+  }
+  else if (argLen > 0)
+  {
+    char *end;
+    float twistDb = strtof(arg, &end);
+    status = *end == '\0' && len - i < sizeof(arg) ? setAFSKTwist(twistDb) : AFSK_ERROR_INVALID_PARAMS;
+  }
+
+  char refused[48] = "";
+  if (status != AFSK_SUCCESS && isAFSKTransmitting())
+  {
+    snprintf(refused, sizeof(refused), "busy transmitting, ");
+  }
+  else if (status != AFSK_SUCCESS)
+  {
+    snprintf(refused, sizeof(refused), "expects dB within %.0f, flat or preemph, ", AFSK_TWIST_MAX_DB);
+  }
+  char reply[96];
+  int n = snprintf(reply, sizeof(reply), "twist: %smark %+.1f dB relative to space", refused, getAFSKTwist());
+  sendKISShardware(port, (const uint8_t *)reply, (size_t)n);
+  return true;
+}
+
+/**
+ * @brief Handles a complete KISS frame from the host.
+ *
+ * Data frames are queued for transmission once the channel is clear;
+ * transmitAX25() rejects anything that is not a well-formed AX.25 frame.
+ * ACKMODE frames carry a 2-byte tag ahead of the AX.25 frame, acknowledged
+ * once the frame has been sent.
+ * TXDELAY, PERSIST, SLOTTIME, TXTAIL and FULLDUPLEX set the channel access
+ * parameters. SETHARDWARE "twist" sets the transmit twist (twistCommand()),
+ * and "replay" runs the decoder self-test (audioReplay.h) when FEATURE_REPLAY
+ * is set. Other commands are ignored.
+ */
+static void onHostFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+  if (port != 0)
+  {
+    return; // Single transmitter
+  }
+  if (command == KISS_CMD_DATA)
+  {
+    txQueueFrame(data, len, readUs);
+  }
+  else if (command == KISS_CMD_ACKMODE)
+  {
+    if (len > KISS_ACK_TAG_LEN)
+    {
+      txQueueAckFrame((uint16_t)((data[0] << 8) | data[1]), data + KISS_ACK_TAG_LEN, len - KISS_ACK_TAG_LEN,
+                      readUs);
+    }
+  }
+  else if (command == KISS_CMD_SETHARDWARE)
+  {
+    if (twistCommand(port, data, len))
+    {
+      return;
+    }
+#if FEATURE_REPLAY
+    audioReplayCommand(port, data, len);
+#endif
+  }
+  else if (len >= 1)
+  {
+    txQueueSetParam(command, data[0]);
+  }
+}
+
 /**
  * @brief Checks if there is incoming data available on the Bluetooth serial interface.
  *
- * If data is available, reads up to 300 bytes from the Bluetooth serial buffer
- * and passes the received data to the transmitAX25 function for further processing.
+ * Reads whatever has arrived in chunks of BT_READ_CHUNK bytes and feeds it to
+ * the KISS decoder, which collects complete frames across calls and drops
+ * oversized or badly escaped ones. Each complete data frame is queued for
+ * transmission (txQueue.h).
  *
  * Call this function in loop() to handle incoming Bluetooth data.
  */
 void checkBTforData()
 {
-  if (BTSerial.available())
+  uint8_t buf[BT_READ_CHUNK];
+  int available;
+  while ((available = BTSerial.available()) > 0)
   {
-    uint8_t buf[300];
-    size_t bytesRead = BTSerial.readBytes(buf, sizeof(buf));
-    transmitAX25(buf, bytesRead);
+    size_t want = (size_t)available < sizeof(buf) ? (size_t)available : sizeof(buf);
+    size_t bytesRead = BTSerial.readBytes(buf, want);
+    if (bytesRead == 0)
+    {
+      break;
+    }
+    readUs = micros(); // First stage of the frame traces (frameTrace.h)
+    allocTrapEnter("kissInput");
+    kissInput(&hostKiss, buf, bytesRead);
+    allocTrapLeave();
   }
 }
+
+#endif // FEATURE_BT_CLASSIC
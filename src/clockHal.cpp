@@ -0,0 +1,169 @@
+/**
+ * @file clockHal.cpp
+ * @date 2025-09-30
+ * @brief Time base and one-shot timers for the timing-sensitive TNC logic.
+ */
+
+#include "clockHal.h"
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#endif
+
+static clock_timer_t *pending = NULL; // Sorted by due time, FIFO among equal times
+
+#ifdef ARDUINO
+/**
+ * @brief Current time
+ * @return Microseconds since boot
+ */
+uint64_t clockMicros()
+{
+	return (uint64_t)esp_timer_get_time();
+}
+#else
+static uint64_t virtualUs = 0;
+
+/**
+ * @brief Current time
+ * @return Virtual microseconds since clockReset()
+ */
+uint64_t clockMicros()
+{
+	return virtualUs;
+}
+#endif
+
+/**
+ * @brief Current time in milliseconds, wraps after 49 days like millis()
+ */
+uint32_t clockMillis()
+{
+	return (uint32_t)(clockMicros() / 1000);
+}
+
+/**
+ * @brief Bind a timer to its callback, leaving it stopped
+ * @param t Timer
+ * @param fn Called when the timer falls due
+ * @param ctx Passed back to fn
+ */
+void clockTimerInit(clock_timer_t *t, clock_timer_cb fn, void *ctx)
+{
+	t->dueUs = 0;
+	t->fn = fn;
+	t->ctx = ctx;
+	t->next = NULL;
+	t->active = false;
+}
+
+/**
+ * @brief Cancel a timer; does nothing if it is not pending
+ */
+void clockTimerStop(clock_timer_t *t)
+{
+	if (!t->active)
+	{
+		return;
+	}
+	for (clock_timer_t **link = &pending; *link; link = &(*link)->next)
+	{
+		if (*link == t)
+		{
+			*link = t->next;
+			break;
+		}
+	}
+	t->next = NULL;
+	t->active = false;
+}
+
+/**
+ * @brief Arm a one-shot timer, replacing any pending expiry
+ * @param t Timer set up with clockTimerInit()
+ * @param delayUs Time from now until the callback runs
+ */
+void clockTimerStart(clock_timer_t *t, uint64_t delayUs)
+{
+	clockTimerStop(t);
+	t->dueUs = clockMicros() + delayUs;
+
+	// After every timer due at or before this one, so equal times keep start order
+	clock_timer_t **link = &pending;
+	while (*link && (*link)->dueUs <= t->dueUs)
+	{
+		link = &(*link)->next;
+	}
+	t->next = *link;
+	*link = t;
+	t->active = true;
+}
+
+/**
+ * @brief true while a timer is pending
+ */
+bool clockTimerActive(const clock_timer_t *t)
+{
+	return t->active;
+}
+
+/**
+ * @brief Run every timer that is due at time now
+ */
+static size_t runDue(uint64_t now)
+{
+	size_t count = 0;
+	while (pending && pending->dueUs <= now)
+	{
+		clock_timer_t *t = pending;
+		pending = t->next;
+		t->next = NULL;
+		t->active = false;
+		t->fn(t->ctx);
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @brief Run every timer that is due, including ones started by the callbacks with no delay
+ * @return Number of callbacks run
+ */
+size_t clockRunTimers()
+{
+	return runDue(clockMicros());
+}
+
+#ifndef ARDUINO
+/**
+ * @brief Move virtual time to untilUs, running each timer at its due time on the way
+ * @param untilUs Absolute virtual time; earlier times are ignored
+ * @return Number of callbacks run
+ */
+size_t clockAdvance(uint64_t untilUs)
+{
+	size_t count = runDue(virtualUs);
+	while (pending && pending->dueUs <= untilUs)
+	{
+		virtualUs = pending->dueUs;
+		count += runDue(virtualUs);
+	}
+	if (untilUs > virtualUs)
+	{
+		virtualUs = untilUs;
+	}
+	return count;
+}
+
+/**
+ * @brief Drop all pending timers and set virtual time back to zero
+ */
+void clockReset()
+{
+	while (pending)
+	{
+		clockTimerStop(pending);
+	}
+	virtualUs = 0;
+}
+#endif
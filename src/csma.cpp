@@ -0,0 +1,156 @@
+/**
+ * @file csma.cpp
+ * @date 2025-09-30
+ * @brief p-persistent CSMA channel access with the KISS timing parameters.
+ */
+
+#include "csma.h"
+
+#include "kiss.h"
+
+/**
+ * @brief Next persistence draw, 0-255
+ */
+static uint8_t drawByte(csma_t *c)
+{
+	uint32_t x = c->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	c->rng = x;
+	return (uint8_t)(x >> 24);
+}
+
+/**
+ * @brief Grant the channel: count the access delay and start the transmission
+ */
+static void grant(csma_t *c)
+{
+	c->pending = false;
+	c->grants++;
+	c->accessDelayUs += clockMicros() - c->requestedUs;
+	c->transmit(c->ctx);
+}
+
+/**
+ * @brief One access check, at request time and then once per slot
+ */
+static void onSlot(void *ctx)
+{
+	csma_t *c = (csma_t *)ctx;
+	if (!c->pending)
+	{
+		return;
+	}
+	if (c->fullDuplex)
+	{
+		grant(c);
+		return;
+	}
+
+	if (c->busy && c->busy(c->ctx))
+	{
+		c->busySlots++;
+	}
+	else if (drawByte(c) <= c->persist)
+	{
+		grant(c);
+		return;
+	}
+	else
+	{
+		c->deferredSlots++;
+	}
+	clockTimerStart(&c->slot, (uint64_t)c->slotTime * CSMA_UNIT_US);
+}
+
+/**
+ * @brief Set callbacks, seed and the default parameters
+ * @param c Channel access state
+ * @param busy Channel busy test, NULL for a channel that is never busy
+ * @param transmit Called when access is granted
+ * @param ctx Passed back to both callbacks
+ * @param seed Persistence draw seed; 0 is replaced by a fixed non-zero value
+ */
+void csmaInit(csma_t *c, csma_busy_cb busy, csma_transmit_cb transmit, void *ctx, uint32_t seed)
+{
+	c->txDelay = CSMA_DEFAULT_TXDELAY;
+	c->persist = CSMA_DEFAULT_PERSIST;
+	c->slotTime = CSMA_DEFAULT_SLOTTIME;
+	c->txTail = CSMA_DEFAULT_TXTAIL;
+	c->fullDuplex = false;
+	c->pending = false;
+	c->rng = seed ? seed : 0x2545F491;
+	clockTimerInit(&c->slot, onSlot, c);
+	c->busy = busy;
+	c->transmit = transmit;
+	c->ctx = ctx;
+	c->requestedUs = 0;
+	c->grants = 0;
+	c->busySlots = 0;
+	c->deferredSlots = 0;
+	c->accessDelayUs = 0;
+}
+
+/**
+ * @brief Apply a KISS parameter command
+ * @param c Channel access state
+ * @param command KISS_CMD_TXDELAY, _PERSIST, _SLOTTIME, _TXTAIL or _FULLDUPLEX
+ * @param value Command argument
+ * @return false if the command is not a channel access parameter
+ */
+bool csmaSetParam(csma_t *c, uint8_t command, uint8_t value)
+{
+	switch (command)
+	{
+	case KISS_CMD_TXDELAY:
+		c->txDelay = value;
+		return true;
+	case KISS_CMD_PERSIST:
+		c->persist = value;
+		return true;
+	case KISS_CMD_SLOTTIME:
+		c->slotTime = value ? value : 1; // A zero slot would spin in place while busy
+		return true;
+	case KISS_CMD_TXTAIL:
+		c->txTail = value;
+		return true;
+	case KISS_CMD_FULLDUPLEX:
+		c->fullDuplex = value != 0;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Ask for the channel; transmit() is called once access is granted
+ */
+void csmaRequest(csma_t *c)
+{
+	if (c->pending)
+	{
+		return;
+	}
+	c->pending = true;
+	c->requestedUs = clockMicros();
+	clockTimerStart(&c->slot, 0);
+}
+
+/**
+ * @brief Withdraw a pending request
+ */
+void csmaCancel(csma_t *c)
+{
+	c->pending = false;
+	clockTimerStop(&c->slot);
+}
+
+/**
+ * @brief Current TXDELAY
+ * @return Keyup time before the first flag, in microseconds
+ */
+uint32_t csmaTxDelayUs(const csma_t *c)
+{
+	return (uint32_t)c->txDelay * CSMA_UNIT_US;
+}
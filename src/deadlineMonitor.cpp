@@ -0,0 +1,169 @@
+/**
+ * @file deadlineMonitor.cpp
+ * @date 2025-10-18
+ * @brief Deadline and overrun accounting for the real-time stages of the audio pipeline.
+ */
+
+#include "deadlineMonitor.h"
+
+static deadline_stats_t stats = {{
+	{"capture"},
+	{"demod"},
+	{"tx isr"},
+	{"tx output"},
+	{"queue"},
+}}; // Guarded by statsLock
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Set the deadline of a stage
+ * @param stage Stage
+ * @param deadlineUs Longest run that is on time, 0 for a stage that only reports events
+ */
+void deadlineDeclare(deadline_stage_t stage, uint32_t deadlineUs)
+{
+	if (stage < DEADLINE_STAGES)
+	{
+		portENTER_CRITICAL(&statsLock);
+		stats.stages[stage].deadlineUs = deadlineUs;
+		portEXIT_CRITICAL(&statsLock);
+	}
+}
+
+/**
+ * @brief Count a miss and keep it if it is among the worst. Call under statsLock.
+ */
+static void recordMiss(deadline_stage_stats_t *s, uint32_t lateUs, const char *source, uint32_t value)
+{
+	s->misses++;
+	uint8_t at = s->worstCount;
+	if (at == DEADLINE_WORST)
+	{
+		if (lateUs < s->worst[DEADLINE_WORST - 1].lateUs)
+		{
+			return;
+		}
+		at--; // Replaces the least late, the oldest of equals
+	}
+	else
+	{
+		s->worstCount++;
+	}
+	while (at > 0 && s->worst[at - 1].lateUs <= lateUs)
+	{
+		s->worst[at] = s->worst[at - 1];
+		at--;
+	}
+	s->worst[at] = {lateUs, (uint32_t)millis(), source, value};
+}
+
+/**
+ * @brief Count a timed run of a stage
+ * @param stage Stage
+ * @param elapsedUs Time the run took, or its latency, against the declared deadline
+ * @param source What ran, kept with a miss
+ * @param value Its number, kept with a miss
+ * @return false if the run missed the deadline
+ */
+bool deadlineCheck(deadline_stage_t stage, uint32_t elapsedUs, const char *source, uint32_t value)
+{
+	if (stage >= DEADLINE_STAGES)
+	{
+		return true;
+	}
+	deadline_stage_stats_t *s = &stats.stages[stage];
+	portENTER_CRITICAL(&statsLock);
+	s->checks++;
+	if (elapsedUs > s->worstUs)
+	{
+		s->worstUs = elapsedUs;
+	}
+	bool late = s->deadlineUs != 0 && elapsedUs > s->deadlineUs;
+	if (late)
+	{
+		recordMiss(s, elapsedUs - s->deadlineUs, source, value);
+	}
+	portEXIT_CRITICAL(&statsLock);
+	return !late;
+}
+
+/**
+ * @brief Count an overrun, underrun or full queue
+ * @param stage Stage
+ * @param lateUs How late, if known, 0 otherwise
+ * @param source What missed
+ * @param value Its number
+ */
+void deadlineMiss(deadline_stage_t stage, uint32_t lateUs, const char *source, uint32_t value)
+{
+	if (stage < DEADLINE_STAGES)
+	{
+		portENTER_CRITICAL(&statsLock);
+		recordMiss(&stats.stages[stage], lateUs, source, value);
+		portEXIT_CRITICAL(&statsLock);
+	}
+}
+
+/**
+ * @brief Misses of a stage since a count taken earlier
+ * @param stage Stage
+ * @param seen Miss count of the previous call, updated to the current count; start at 0
+ * @return Misses since the previous call
+ */
+uint32_t deadlineMissedSince(deadline_stage_t stage, uint32_t *seen)
+{
+	if (stage >= DEADLINE_STAGES)
+	{
+		return 0;
+	}
+	portENTER_CRITICAL(&statsLock);
+	uint32_t misses = stats.stages[stage].misses;
+	portEXIT_CRITICAL(&statsLock);
+	uint32_t since = misses - *seen;
+	*seen = misses;
+	return since;
+}
+
+/**
+ * @brief Copy the counters and worst misses of every stage
+ */
+void getDeadlineStats(deadline_stats_t *out)
+{
+	portENTER_CRITICAL(&statsLock);
+	*out = stats;
+	portEXIT_CRITICAL(&statsLock);
+}
+
+/**
+ * @brief Print each stage's counters, then its worst misses, to Serial
+ */
+void printDeadlineStats()
+{
+	static deadline_stats_t s; // Off the loop() stack
+	getDeadlineStats(&s);
+	for (uint8_t i = 0; i < DEADLINE_STAGES; i++)
+	{
+		const deadline_stage_stats_t *st = &s.stages[i];
+		if (st->deadlineUs != 0)
+		{
+			Serial.printf("RT %s: deadline %lu us, checked %lu, missed %lu, worst %lu us\n", st->name, st->deadlineUs,
+						  st->checks, st->misses, st->worstUs);
+		}
+		else
+		{
+			Serial.printf("RT %s: missed %lu\n", st->name, st->misses);
+		}
+		for (uint8_t w = 0; w < st->worstCount; w++)
+		{
+			const deadline_miss_t *m = &st->worst[w];
+			if (m->lateUs != 0)
+			{
+				Serial.printf("  %s %lu at %lu ms, %lu us late\n", m->source, m->value, m->atMs, m->lateUs);
+			}
+			else
+			{
+				Serial.printf("  %s %lu at %lu ms\n", m->source, m->value, m->atMs);
+			}
+		}
+	}
+}
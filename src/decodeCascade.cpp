@@ -0,0 +1,495 @@
+/**
+ * @file decodeCascade.cpp
+ * @date 2025-10-14
+ * @brief Tiered receive: a cheap primary demodulator, heavier decoder variants only for bursts it missed.
+ */
+
+#include "decodeCascade.h"
+
+#include <string.h>
+
+#define SSID_MASK 0x1E // SSID bits of an address's last byte
+
+/**
+ * @brief Copy the source address of a frame, if it looks like one
+ *
+ * Used on bad frames too, so only the source field is checked: six shifted
+ * A-Z, 0-9 or space characters. The SSID byte keeps only the SSID.
+ */
+static bool sourceAddress(const uint8_t *frame, size_t len, uint8_t *address)
+{
+	if (len < 2 * AX25_ADDRESS_LEN)
+	{
+		return false;
+	}
+	const uint8_t *field = frame + AX25_ADDRESS_LEN;
+	for (size_t i = 0; i < AX25_ADDRESS_LEN - 1; i++)
+	{
+		char ch = (char)(field[i] >> 1);
+		if ((field[i] & 0x01) || !((ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == ' '))
+		{
+			return false;
+		}
+		address[i] = field[i];
+	}
+	address[AX25_ADDRESS_LEN - 1] = field[AX25_ADDRESS_LEN - 1] & SSID_MASK;
+	return field[0] != (' ' << 1);
+}
+
+/**
+ * @brief Find a station, or take over the least recently used entry
+ * @return Index into c->stations
+ */
+static int8_t findStation(decode_cascade_t *c, const uint8_t *address)
+{
+	int8_t oldest = 0;
+	for (int8_t i = 0; i < CASCADE_STATIONS; i++)
+	{
+		cascade_station_t *s = &c->stations[i];
+		if (s->used && memcmp(s->address, address, AX25_ADDRESS_LEN) == 0)
+		{
+			s->lastUsed = ++c->stationClock;
+			return i;
+		}
+		if (!s->used || (c->stations[oldest].used && s->lastUsed < c->stations[oldest].lastUsed))
+		{
+			oldest = i;
+		}
+	}
+	cascade_station_t *s = &c->stations[oldest];
+	memcpy(s->address, address, AX25_ADDRESS_LEN);
+	memcpy(s->score, c->score, sizeof(s->score)); // A new station starts from the channel's experience
+	s->lastUsed = ++c->stationClock;
+	s->used = true;
+	return oldest;
+}
+
+/**
+ * @brief Decay a score and add a success
+ */
+static void updateScore(uint8_t *score, bool success)
+{
+	uint32_t s = *score - *score / 8 + (success ? CASCADE_SCORE_GAIN : 0);
+	*score = (uint8_t)(s > 255 ? 255 : s);
+}
+
+/**
+ * @brief Remember a delivered frame, so a variant retrying its burst drops it
+ */
+static void remember(cascade_burst_t *b, const uint8_t *frame, size_t len)
+{
+	if (b->deliveredCount < CASCADE_BURST_FRAMES)
+	{
+		b->delivered[b->deliveredCount++] = ax25Fcs(frame, len);
+	}
+}
+
+static void onPrimaryFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	decode_cascade_t *c = (decode_cascade_t *)ctx;
+	c->burst.frames++;
+	remember(&c->burst, frame, len);
+	if (c->onFrame)
+	{
+		c->onFrame(c->ctx, port, frame, len);
+	}
+}
+
+static void onPrimaryBadFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	decode_cascade_t *c = (decode_cascade_t *)ctx;
+	cascade_burst_t *b = &c->burst;
+	b->errors++;
+	if (b->badCount < CASCADE_BAD_FRAMES)
+	{
+		memcpy(b->bad[b->badCount], frame, len);
+		b->badLength[b->badCount++] = (uint16_t)len;
+	}
+}
+
+/**
+ * @brief A variant found a frame: deliver it and learn the station from it
+ */
+static void foundFrame(decode_cascade_t *c, const uint8_t *frame, size_t len)
+{
+	uint16_t fcs = ax25Fcs(frame, len);
+	for (uint8_t i = 0; i < c->retry.deliveredCount; i++)
+	{
+		if (c->retry.delivered[i] == fcs)
+		{
+			return;
+		}
+	}
+	remember(&c->retry, frame, len);
+	if (c->onFrame)
+	{
+		c->onFrame(c->ctx, c->port, frame, len);
+	}
+	c->stats.recovered++;
+	c->retryFound++;
+	uint8_t address[AX25_ADDRESS_LEN];
+	if (c->retryStation < 0 && sourceAddress(frame, len, address))
+	{
+		c->retryStation = findStation(c, address);
+	}
+}
+
+static void onReplayFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	foundFrame((decode_cascade_t *)ctx, frame, len);
+}
+
+/**
+ * @brief Bit-repair variant: fix the retried burst's bad frames
+ */
+static void repairFrames(decode_cascade_t *c)
+{
+	for (uint8_t i = 0; i < c->retry.badCount; i++)
+	{
+		uint8_t *frame = c->retry.bad[i];
+		size_t len = c->retry.badLength[i];
+		ax25_frame_t parsed;
+		if (hdlcRepair(frame, len) && ax25Parse(frame, len - 2, &parsed) == AX25_OK)
+		{
+			foundFrame(c, frame, len - 2);
+		}
+	}
+}
+
+/**
+ * @brief Set up the replay demodulator for the variant at orderPos
+ */
+static void startVariant(decode_cascade_t *c)
+{
+	cascade_variant_t v = (cascade_variant_t)c->order[c->orderPos];
+	c->retryFound = 0;
+	if (v == CASCADE_BIT_REPAIR)
+	{
+		return;
+	}
+	afsk_profile_t profile = c->profile;
+	profile.frontEnd = AFSK_FRONT_END_GOERTZEL;
+	afskDemodInit(&c->replay, &profile, c->port, onReplayFrame, c);
+	if (v == CASCADE_SLICER_MARK)
+	{
+		afskDemodSetSlicer(&c->replay, -CASCADE_SLICER_LEVEL);
+	}
+	else if (v == CASCADE_SLICER_SPACE)
+	{
+		afskDemodSetSlicer(&c->replay, CASCADE_SLICER_LEVEL);
+	}
+	c->retryPos = c->retry.start;
+}
+
+/**
+ * @brief Score the variant at orderPos; stop at the first one that found a frame
+ */
+static void finishVariant(decode_cascade_t *c)
+{
+	uint8_t v = c->order[c->orderPos];
+	bool success = c->retryFound > 0;
+	c->stats.tries[v]++;
+	if (success)
+	{
+		c->stats.successes[v]++;
+	}
+	updateScore(&c->score[v], success);
+	if (c->retryStation >= 0)
+	{
+		updateScore(&c->stations[c->retryStation].score[v], success);
+	}
+
+	if (success || ++c->orderPos >= c->orderCount)
+	{
+		c->retrying = false;
+		return;
+	}
+	startVariant(c);
+}
+
+/**
+ * @brief Start retrying the burst that just failed, best scored variant first
+ */
+static void startRetry(decode_cascade_t *c)
+{
+	c->retry = c->burst;
+	c->retrying = true;
+	c->stats.retries++;
+
+	c->retryStation = -1;
+	uint8_t address[AX25_ADDRESS_LEN];
+	for (uint8_t i = 0; i < c->retry.badCount && c->retryStation < 0; i++)
+	{
+		if (sourceAddress(c->retry.bad[i], c->retry.badLength[i], address))
+		{
+			c->retryStation = findStation(c, address);
+		}
+	}
+	const uint8_t *score = c->retryStation >= 0 ? c->stations[c->retryStation].score : c->score;
+
+	// Insertion sort by score, ties in table order
+	c->orderCount = 0;
+	bool primaryIsGoertzel = c->profile.frontEnd == AFSK_FRONT_END_GOERTZEL && c->primary->slicerLevel == 0.0f;
+	for (uint8_t v = 0; v < CASCADE_VARIANTS; v++)
+	{
+		if (!(c->variants & (1u << v)) || (v == CASCADE_GOERTZEL && primaryIsGoertzel) ||
+			(v == CASCADE_BIT_REPAIR && c->retry.badCount == 0))
+		{
+			continue;
+		}
+		uint8_t at = c->orderCount++;
+		while (at > 0 && score[c->order[at - 1]] < score[v])
+		{
+			c->order[at] = c->order[at - 1];
+			at--;
+		}
+		c->order[at] = v;
+	}
+	c->orderPos = 0;
+	if (c->orderCount == 0)
+	{
+		c->retrying = false;
+		return;
+	}
+	startVariant(c);
+}
+
+/**
+ * @brief Advance the retry by up to budget replayed samples
+ */
+static void advanceRetry(decode_cascade_t *c, size_t budget)
+{
+	while (c->retrying)
+	{
+		if (c->order[c->orderPos] == CASCADE_BIT_REPAIR)
+		{
+			repairFrames(c);
+			finishVariant(c);
+			continue;
+		}
+		if (c->retryPos + c->historyLength < c->written)
+		{
+			c->stats.overruns++;
+			c->retrying = false;
+			return;
+		}
+		if (c->retryPos >= c->retry.end)
+		{
+			finishVariant(c);
+			continue;
+		}
+		if (budget == 0)
+		{
+			return;
+		}
+
+		// Up to the end of the burst, the budget or the end of the ring
+		size_t at = (size_t)(c->retryPos % c->historyLength);
+		uint64_t left = c->retry.end - c->retryPos;
+		size_t n = left < budget ? (size_t)left : budget;
+		if (n > c->historyLength - at)
+		{
+			n = c->historyLength - at;
+		}
+		afskDemodProcess(&c->replay, c->history + at, n);
+		c->retryPos += n;
+		c->stats.replaySamples += n;
+		budget -= n;
+	}
+}
+
+/**
+ * @brief Forget the primary's frames outside a burst, or of the burst just judged
+ */
+static void clearBurst(cascade_burst_t *b)
+{
+	b->frames = 0;
+	b->errors = 0;
+	b->deliveredCount = 0;
+	b->badCount = 0;
+}
+
+/**
+ * @brief The primary's DCD stayed down for the hang time: judge the burst
+ */
+static void endBurst(decode_cascade_t *c)
+{
+	c->inBurst = false;
+	c->burst.end = c->written;
+	c->stats.bursts++;
+	if (c->burst.frames == 0 || c->burst.errors > 0)
+	{
+		c->stats.failedBursts++;
+		if (c->retrying)
+		{
+			c->stats.skipped++;
+		}
+		else
+		{
+			startRetry(c);
+		}
+	}
+	clearBurst(&c->burst);
+}
+
+/**
+ * @brief Set up a cascade
+ * @param c Cascade state
+ * @param primary Demodulator to run on every sample, initialized here
+ * @param profile Primary's profile; the replay variants use its tones with the Goertzel front end
+ * @param port KISS port number passed to onFrame
+ * @param onFrame Callback for decoded frames from the primary and the variants
+ * @param ctx Passed back to onFrame
+ * @param history Audio ring, at least a burst plus CASCADE_LEAD_MS and the replay time
+ * @param historyLength Samples in history
+ * @return false if a demodulator rejects the profile or the history is shorter than one bit
+ */
+bool cascadeInit(decode_cascade_t *c, afsk_demod_t *primary, const afsk_profile_t *profile, uint8_t port,
+				 afsk_frame_cb onFrame, void *ctx, int16_t *history, size_t historyLength)
+{
+	memset(c, 0, sizeof(*c));
+	if (!afskDemodInit(primary, profile, port, onPrimaryFrame, c) || !history ||
+		historyLength < profile->sampleRate / profile->baudRate)
+	{
+		return false;
+	}
+	afsk_profile_t goertzel = *profile;
+	goertzel.frontEnd = AFSK_FRONT_END_GOERTZEL;
+	if (!afskDemodInit(&c->replay, &goertzel, port, NULL, NULL))
+	{
+		return false;
+	}
+	afskDemodSetErrorCallback(primary, onPrimaryBadFrame);
+	c->primary = primary;
+	c->profile = *profile;
+	c->port = port;
+	c->history = history;
+	c->historyLength = historyLength;
+	c->leadSamples = profile->sampleRate * CASCADE_LEAD_MS / 1000;
+	c->hangSamples = profile->sampleRate * CASCADE_HANG_MS / 1000;
+	memset(c->score, CASCADE_SCORE_START, sizeof(c->score));
+	c->variants = CASCADE_ALL_VARIANTS;
+	c->onFrame = onFrame;
+	c->ctx = ctx;
+	return true;
+}
+
+/**
+ * @brief Demodulate a block with the primary and advance any retry
+ *
+ * Bursts are tracked per block, from the primary's DCD after the block.
+ *
+ * @param c Cascade state
+ * @param samples Signed 16-bit samples at profile.sampleRate
+ * @param count Number of samples, at most historyLength
+ */
+void cascadeProcess(decode_cascade_t *c, const int16_t *samples, size_t count)
+{
+	afskDemodProcess(c->primary, samples, count);
+	c->stats.primarySamples += count;
+
+	for (size_t done = 0; done < count;)
+	{
+		size_t at = (size_t)(c->written % c->historyLength);
+		size_t n = count - done < c->historyLength - at ? count - done : c->historyLength - at;
+		memcpy(c->history + at, samples + done, n * sizeof(int16_t));
+		c->written += n;
+		done += n;
+	}
+
+	if (afskDemodDcd(c->primary))
+	{
+		if (!c->inBurst)
+		{
+			// Start a little before the block DCD rose in, within the ring
+			uint64_t start = c->written - count;
+			start = start > c->leadSamples ? start - c->leadSamples : 0;
+			if (start + c->historyLength < c->written)
+			{
+				start = c->written - c->historyLength;
+			}
+			c->burst.start = start; // Counters hold this block's frames, they belong to the burst
+			c->inBurst = true;
+		}
+		c->quietSamples = 0;
+	}
+	else if (c->inBurst)
+	{
+		c->quietSamples += count;
+		if (c->quietSamples >= c->hangSamples)
+		{
+			endBurst(c);
+		}
+	}
+	else
+	{
+		clearBurst(&c->burst);
+	}
+
+	if (c->retrying)
+	{
+		advanceRetry(c, count * CASCADE_REPLAY_SPEED);
+	}
+}
+
+/**
+ * @brief Check whether the cascade still needs blocks to finish a burst or a retry
+ * @param c Cascade state
+ * @return true during a burst or a retry
+ */
+bool cascadeBusy(const decode_cascade_t *c)
+{
+	return c->inBurst || c->retrying;
+}
+
+/**
+ * @brief Enable and disable variants, for example to shed load
+ * @param c Cascade state
+ * @param mask Bit (1 << variant) per enabled variant
+ */
+void cascadeSetVariants(decode_cascade_t *c, uint8_t mask)
+{
+	c->variants = mask & CASCADE_ALL_VARIANTS;
+	if (!c->retrying)
+	{
+		return;
+	}
+	if (!(c->variants & (1u << c->order[c->orderPos])))
+	{
+		c->retrying = false;
+		c->stats.shed++;
+		return;
+	}
+	uint8_t kept = c->orderPos + 1;
+	for (uint8_t i = kept; i < c->orderCount; i++)
+	{
+		if (c->variants & (1u << c->order[i]))
+		{
+			c->order[kept++] = c->order[i];
+		}
+	}
+	c->orderCount = kept;
+}
+
+/**
+ * @brief Get the short name of a variant
+ * @param variant Variant
+ * @return "bit-repair", "goertzel", "slicer-mark", "slicer-space" or "unknown"
+ */
+const char *cascadeVariantName(cascade_variant_t variant)
+{
+	switch (variant)
+	{
+	case CASCADE_BIT_REPAIR:
+		return "bit-repair";
+	case CASCADE_GOERTZEL:
+		return "goertzel";
+	case CASCADE_SLICER_MARK:
+		return "slicer-mark";
+	case CASCADE_SLICER_SPACE:
+		return "slicer-space";
+	case CASCADE_VARIANTS:
+		break;
+	}
+	return "unknown";
+}
@@ -0,0 +1,189 @@
+/**
+ * @file digipeater.cpp
+ * @date 2025-10-06
+ * @brief APRS digipeater path handling: own callsign and WIDEn-N with duplicate suppression.
+ */
+
+#include "digipeater.h"
+
+#include <string.h>
+
+#include "clockHal.h"
+
+#define SSID_MASK 0x1E // SSID bits of an address field's last byte
+#define H_BIT 0x80	   // Has-been-repeated, in a digipeater address
+
+/**
+ * @brief Set the digipeater callsign and the WIDEn-N hop limit
+ * @param d Digipeater state
+ * @param call Callsign, 1-6 characters A-Z and 0-9
+ * @param ssid 0-15
+ * @param maxHops Largest n of WIDEn-N to service, up to 7; 0 for own callsign only
+ * @return false if the callsign or SSID is invalid
+ */
+bool digiInit(digi_t *d, const char *call, uint8_t ssid, uint8_t maxHops)
+{
+	memset(d, 0, sizeof(*d));
+	size_t n = strlen(call);
+	if (n < 1 || n > 6 || ssid > 15 || maxHops > 7)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < 6; i++)
+	{
+		char c = i < n ? call[i] : ' ';
+		if (i < n && !((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+		{
+			return false;
+		}
+		d->call[i] = (uint8_t)(c << 1);
+	}
+	d->call[6] = (uint8_t)(H_BIT | 0x60 | (ssid << 1));
+	memcpy(d->address.call, call, n + 1);
+	d->address.ssid = ssid;
+	d->maxHops = maxHops;
+	return true;
+}
+
+static bool sameAddress(const ax25_address_t *a, const ax25_address_t *b)
+{
+	return a->ssid == b->ssid && strcmp(a->call, b->call) == 0;
+}
+
+/**
+ * @brief WIDEn-N hop count n, 0 if the address is not a WIDEn-N alias
+ */
+static uint8_t wideHops(const ax25_address_t *a)
+{
+	if (strncmp(a->call, "WIDE", 4) != 0 || a->call[4] < '1' || a->call[4] > '7' || a->call[5] != '\0')
+	{
+		return 0;
+	}
+	return (uint8_t)(a->call[4] - '0');
+}
+
+/**
+ * @brief FNV-1a of destination, source and everything after the path
+ */
+static uint32_t frameHash(const uint8_t *frame, size_t len, size_t pathEnd)
+{
+	uint32_t h = 0x811C9DC5;
+	for (size_t i = 0; i < len; i++)
+	{
+		if (i == 2 * AX25_ADDRESS_LEN)
+		{
+			i = pathEnd;
+			if (i >= len)
+				break;
+		}
+		uint8_t byte = frame[i];
+		if (i < 2 * AX25_ADDRESS_LEN && i % AX25_ADDRESS_LEN == 6)
+		{
+			byte &= SSID_MASK; // Ignore the C and extension bits
+		}
+		h = (h ^ byte) * 0x01000193;
+	}
+	return h;
+}
+
+/**
+ * @brief true if the frame was repeated within DIGI_DUPE_MS; otherwise remember it
+ */
+static bool isDuplicate(digi_t *d, uint32_t hash)
+{
+	uint32_t now = clockMillis();
+	for (size_t i = 0; i < d->seenCount; i++)
+	{
+		const digi_seen_t *s = &d->seen[i];
+		if (s->hash == hash && now - s->atMs < DIGI_DUPE_MS)
+		{
+			return true;
+		}
+	}
+	d->seen[d->nextSeen].hash = hash;
+	d->seen[d->nextSeen].atMs = now;
+	d->nextSeen = (d->nextSeen + 1) % DIGI_DUPE_SLOTS;
+	if (d->seenCount < DIGI_DUPE_SLOTS)
+	{
+		d->seenCount++;
+	}
+	return false;
+}
+
+/**
+ * @brief Check a received frame and build the frame to repeat, if any
+ *
+ * A WIDEn-N hop gets our callsign inserted in front of it as a trace when the
+ * path has room for it; a full path is only decremented.
+ *
+ * @param d Digipeater state
+ * @param frame Frame without FCS
+ * @param len Frame length
+ * @param out Rewritten frame
+ * @param outSize Size of out, len + DIGI_MAX_GROWTH always fits
+ * @return Length of the frame to transmit, 0 if it is not repeated
+ */
+size_t digiProcess(digi_t *d, const uint8_t *frame, size_t len, uint8_t *out, size_t outSize)
+{
+	ax25_frame_t f;
+	if (ax25Parse(frame, len, &f) != AX25_OK || sameAddress(&f.source, &d->address))
+	{
+		return 0;
+	}
+
+	uint8_t next = 0;
+	while (next < f.digiCount && f.digis[next].hBit)
+	{
+		next++;
+	}
+	if (next == f.digiCount)
+	{
+		d->ignored++;
+		return 0; // No path left, or already complete
+	}
+
+	const ax25_address_t *hop = &f.digis[next];
+	uint8_t hops = wideHops(hop);
+	bool own = sameAddress(hop, &d->address);
+	if (!own && !(hops > 0 && hops <= d->maxHops && hop->ssid >= 1 && hop->ssid <= hops))
+	{
+		d->ignored++;
+		return 0;
+	}
+
+	size_t pathEnd = 2 * AX25_ADDRESS_LEN + (size_t)f.digiCount * AX25_ADDRESS_LEN;
+	bool trace = !own && f.digiCount < AX25_MAX_DIGIS;
+	size_t outLen = len + (trace ? AX25_ADDRESS_LEN : 0);
+	if (outLen > outSize)
+	{
+		return 0;
+	}
+	if (isDuplicate(d, frameHash(frame, len, pathEnd)))
+	{
+		d->duplicates++;
+		return 0;
+	}
+
+	// Everything up to the hop, our trace, the hop, then the rest of the path and the frame
+	size_t hopAt = 2 * AX25_ADDRESS_LEN + (size_t)next * AX25_ADDRESS_LEN;
+	size_t n = hopAt;
+	memcpy(out, frame, hopAt);
+	if (trace)
+	{
+		memcpy(out + n, d->call, AX25_ADDRESS_LEN);
+		n += AX25_ADDRESS_LEN;
+	}
+	memcpy(out + n, frame + hopAt, len - hopAt);
+	uint8_t *ssidByte = out + n + AX25_ADDRESS_LEN - 1;
+	if (own)
+	{
+		*ssidByte |= H_BIT;
+	}
+	else
+	{
+		uint8_t remaining = hop->ssid - 1;
+		*ssidByte = (uint8_t)((*ssidByte & ~SSID_MASK) | (remaining << 1) | (remaining == 0 ? H_BIT : 0));
+	}
+	d->repeated++;
+	return outLen;
+}
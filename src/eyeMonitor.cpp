@@ -0,0 +1,293 @@
+/**
+ * @file eyeMonitor.cpp
+ * @date 2025-10-15
+ * @brief Eye diagram and bit timing statistics of a demodulator, for tuning a site.
+ *
+ * The phase of the demodulator's PLL is 2^32 per bit, 0 at the edge. The
+ * column is the phase's top bits plus the bit parity, flipped every time the
+ * phase passes an edge. The row scale follows the mean value magnitude but is
+ * only recomputed every EYE_GAIN_INTERVAL samples, so the per-sample cost has
+ * no division.
+ */
+
+#include "eyeMonitor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CENTER_COLUMNS 4 // Bins either side of the two bit centers read by eyeMonitorSummary()
+
+/**
+ * @brief Clear the histograms and statistics
+ * @param e Monitor state
+ */
+void eyeMonitorReset(eye_monitor_t *e)
+{
+	memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Halve every bin, keeping the shape after one reaches its limit
+ */
+static void halveBins(eye_monitor_t *e)
+{
+	for (int r = 0; r < EYE_ROWS; r++)
+		for (int c = 0; c < EYE_COLUMNS; c++)
+			e->bins[r][c] >>= 1;
+	e->halvings++;
+}
+
+/**
+ * @brief Add one discriminator value
+ * @param e Monitor state
+ * @param phase PLL phase after the sample: 0 at a bit edge, INT32_MIN at the bit center
+ * @param value Discriminator, positive for mark, 0 at the decision level
+ */
+void eyeMonitorSample(eye_monitor_t *e, int32_t phase, float value)
+{
+	float magnitude = fabsf(value);
+	if (e->sinceGain == 0)
+	{
+		if (e->level <= 0.0f)
+		{
+			e->level = magnitude; // First sample sets the scale
+		}
+		e->rowGain = e->level > 0.0f ? EYE_ROWS / (4.0f * e->level) : 0.0f;
+		e->sinceGain = EYE_GAIN_INTERVAL;
+	}
+	e->sinceGain--;
+	e->level += (magnitude - e->level) * (1.0f / (1 << EYE_LEVEL_SHIFT));
+
+	if (e->lastPhase < 0 && phase >= 0)
+	{
+		e->bit ^= 1;
+	}
+	e->lastPhase = phase;
+
+	float position = EYE_ROWS / 2 - value * e->rowGain;
+	int32_t row = position < 0.0f ? 0 : position >= EYE_ROWS ? EYE_ROWS - 1 : (int32_t)position;
+	uint32_t column = e->bit * (EYE_COLUMNS / 2) + (uint32_t)(((uint64_t)(uint32_t)phase * (EYE_COLUMNS / 2)) >> 32);
+	if (++e->bins[row][column] == UINT16_MAX)
+	{
+		halveBins(e);
+	}
+	e->samples++;
+}
+
+/**
+ * @brief Add the PLL phase at a level transition, before the PLL corrects it
+ * @param e Monitor state
+ * @param phase PLL phase, 0 for a transition exactly on time
+ */
+void eyeMonitorTiming(eye_monitor_t *e, int32_t phase)
+{
+	int32_t error = phase / 65536; // 1/65536 bit
+	e->timingSum += error;
+	e->timingSumSquares += (uint64_t)((int64_t)error * error);
+	e->timingBins[((uint64_t)((uint32_t)phase ^ 0x80000000u) * EYE_TIMING_BINS) >> 32]++;
+	e->transitions++;
+}
+
+/**
+ * @brief Value of a row's center in units of the mean magnitude
+ */
+static float rowValue(int row)
+{
+	return (EYE_ROWS / 2 - row - 0.5f) * 4.0f / EYE_ROWS;
+}
+
+/**
+ * @brief Reduce the histograms to a few numbers
+ *
+ * The opening reads the columns within CENTER_COLUMNS / 2 of both bit
+ * centers. On each rail it finds the row, counted from zero outward, within
+ * which EYE_RAIL_PERCENTILE of the rail's samples lie; the distance between
+ * those rows over the distance between the rail means is the opening.
+ *
+ * @param e Monitor state
+ * @param out Summary
+ */
+void eyeMonitorSummary(const eye_monitor_t *e, eye_summary_t *out)
+{
+	memset(out, 0, sizeof(*out));
+	out->samples = e->samples;
+	out->transitions = e->transitions;
+	out->level = e->level;
+	if (e->transitions > 0)
+	{
+		double mean = (double)e->timingSum / e->transitions;
+		out->timingMean = (float)(mean / 65536.0);
+		out->timingRms = (float)(sqrt((double)e->timingSumSquares / e->transitions) / 65536.0);
+	}
+
+	uint32_t rows[EYE_ROWS] = {};
+	for (int half = 0; half < 2; half++)
+	{
+		int center = EYE_COLUMNS / 4 + half * (EYE_COLUMNS / 2);
+		for (int c = center - CENTER_COLUMNS / 2; c < center + CENTER_COLUMNS / 2; c++)
+			for (int r = 0; r < EYE_ROWS; r++)
+				rows[r] += e->bins[r][c];
+	}
+
+	// Mark rail: rows above zero, space rail: rows below
+	uint64_t markCount = 0, spaceCount = 0;
+	double markSum = 0, spaceSum = 0;
+	for (int r = 0; r < EYE_ROWS; r++)
+	{
+		if (r < EYE_ROWS / 2)
+		{
+			markCount += rows[r];
+			markSum += rows[r] * (double)rowValue(r);
+		}
+		else
+		{
+			spaceCount += rows[r];
+			spaceSum += rows[r] * (double)rowValue(r);
+		}
+	}
+	if (markCount == 0 || spaceCount == 0)
+	{
+		return;
+	}
+	out->markRail = (float)(markSum / markCount);
+	out->spaceRail = (float)(spaceSum / spaceCount);
+
+	uint64_t seen = 0;
+	int markInner = EYE_ROWS / 2 - 1;
+	for (; markInner > 0; markInner--)
+	{
+		seen += rows[markInner];
+		if (seen > markCount * EYE_RAIL_PERCENTILE)
+			break;
+	}
+	seen = 0;
+	int spaceInner = EYE_ROWS / 2;
+	for (; spaceInner < EYE_ROWS - 1; spaceInner++)
+	{
+		seen += rows[spaceInner];
+		if (seen > spaceCount * EYE_RAIL_PERCENTILE)
+			break;
+	}
+	// A rail whose inner edge is the row next to zero counts as reaching zero
+	float markEdge = markInner == EYE_ROWS / 2 - 1 ? 0.0f : rowValue(markInner);
+	float spaceEdge = spaceInner == EYE_ROWS / 2 ? 0.0f : rowValue(spaceInner);
+	float opening = (markEdge - spaceEdge) / (out->markRail - out->spaceRail);
+	out->opening = opening < 0.0f ? 0.0f : opening > 1.0f ? 1.0f : opening;
+}
+
+/**
+ * @brief Write the summary and both histograms as one JSON object
+ * @param e Monitor state
+ * @param write Called with consecutive pieces of the output, each at most 256 bytes
+ * @param ctx Passed back to write
+ */
+void eyeMonitorJson(const eye_monitor_t *e, eye_write_cb write, void *ctx)
+{
+	eye_summary_t s;
+	eyeMonitorSummary(e, &s);
+	char line[256];
+	int n = snprintf(line, sizeof(line),
+					 "{\"samples\":%lu,\"transitions\":%lu,\"halvings\":%lu,\"level\":%g,\"opening\":%.3f,"
+					 "\"markRail\":%.3f,\"spaceRail\":%.3f,\"timingMean\":%.4f,\"timingRms\":%.4f,"
+					 "\"columns\":%d,\"rows\":%d,\"eye\":[\n",
+					 (unsigned long)s.samples, (unsigned long)s.transitions, (unsigned long)e->halvings, s.level,
+					 s.opening, s.markRail, s.spaceRail, s.timingMean, s.timingRms, EYE_COLUMNS, EYE_ROWS);
+	write(ctx, line, (size_t)n);
+
+	for (int r = 0; r < EYE_ROWS; r++)
+	{
+		n = 0;
+		for (int c = 0; c < EYE_COLUMNS; c++)
+			n += snprintf(line + n, sizeof(line) - n, "%c%u", c == 0 ? '[' : ',', e->bins[r][c]);
+		n += snprintf(line + n, sizeof(line) - n, "]%s\n", r < EYE_ROWS - 1 ? "," : "");
+		write(ctx, line, (size_t)n);
+	}
+
+	n = snprintf(line, sizeof(line), "],\"timing\":");
+	write(ctx, line, (size_t)n);
+	n = 0;
+	for (int b = 0; b < EYE_TIMING_BINS; b++)
+	{
+		n += snprintf(line + n, sizeof(line) - n, "%c%lu", b == 0 ? '[' : ',', (unsigned long)e->timingBins[b]);
+		if (n > (int)sizeof(line) - 16)
+		{
+			write(ctx, line, (size_t)n);
+			n = 0;
+		}
+	}
+	n += snprintf(line + n, sizeof(line) - n, "]}\n");
+	write(ctx, line, (size_t)n);
+}
+
+static void putLe16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void putLe32(uint8_t *p, uint32_t v)
+{
+	putLe16(p, (uint16_t)v);
+	putLe16(p + 2, (uint16_t)(v >> 16));
+}
+
+/**
+ * @brief Write the eye as an 8-bit grayscale BMP, brightness log-scaled by count
+ * @param e Monitor state
+ * @param write Called with consecutive pieces of the output, each at most 1024 bytes
+ * @param ctx Passed back to write
+ */
+void eyeMonitorBmp(const eye_monitor_t *e, eye_write_cb write, void *ctx)
+{
+	const uint32_t width = EYE_COLUMNS * EYE_BMP_SCALE; // A multiple of 4, rows need no padding
+	const uint32_t height = EYE_ROWS * EYE_BMP_SCALE;
+	const uint32_t paletteBytes = 256 * 4;
+	const uint32_t offset = 14 + 40 + paletteBytes;
+
+	uint8_t header[54] = {'B', 'M'};
+	putLe32(header + 2, offset + width * height);
+	putLe32(header + 10, offset);
+	putLe32(header + 14, 40); // BITMAPINFOHEADER
+	putLe32(header + 18, width);
+	putLe32(header + 22, height); // Positive: rows bottom-up
+	putLe16(header + 26, 1);
+	putLe16(header + 28, 8);
+	putLe32(header + 34, width * height);
+	putLe32(header + 38, 2835); // 72 dpi
+	putLe32(header + 42, 2835);
+	putLe32(header + 46, 256);
+	write(ctx, header, sizeof(header));
+
+	uint8_t palette[256 * 4];
+	for (int i = 0; i < 256; i++)
+	{
+		palette[4 * i] = palette[4 * i + 1] = palette[4 * i + 2] = (uint8_t)i;
+		palette[4 * i + 3] = 0;
+	}
+	write(ctx, palette, sizeof(palette));
+
+	uint16_t peak = 0;
+	for (int r = 0; r < EYE_ROWS; r++)
+		for (int c = 0; c < EYE_COLUMNS; c++)
+			peak = e->bins[r][c] > peak ? e->bins[r][c] : peak;
+	float logPeak = logf(1.0f + peak);
+
+	uint8_t pixels[EYE_COLUMNS * EYE_BMP_SCALE];
+	for (int y = (int)height - 1; y >= 0; y--)
+	{
+		const uint16_t *row = e->bins[y / EYE_BMP_SCALE];
+		bool zeroLine = y == (int)height / 2;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint16_t count = row[x / EYE_BMP_SCALE];
+			uint8_t v = count ? (uint8_t)(64 + 191 * logf(1.0f + count) / logPeak) : 0;
+			if (v == 0 && (zeroLine || x == width / 4 || x == 3 * width / 4))
+			{
+				v = 40;
+			}
+			pixels[x] = v;
+		}
+		write(ctx, pixels, width);
+	}
+}
@@ -0,0 +1,93 @@
+/**
+ * @file firDecimator.cpp
+ * @date 2025-09-04
+ * @brief Integer FIR low-pass decimator.
+ */
+
+#include "firDecimator.h"
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * @brief Design a Hamming-windowed sinc decimating low-pass filter
+ * @param fir Filter state
+ * @param factor Decimation factor (1 = filter only)
+ * @param numTaps Filter length, up to FIR_DECIMATOR_MAX_TAPS
+ * @param cutoff Cutoff frequency as a fraction of the input sample rate (0 to 0.5)
+ * @return true on success, false if the parameters are out of range
+ */
+bool firDecimatorInit(fir_decimator_t *fir, uint8_t factor, uint8_t numTaps, float cutoff)
+{
+	if (!fir || factor == 0 || numTaps == 0 || numTaps > FIR_DECIMATOR_MAX_TAPS ||
+		cutoff <= 0.0f || cutoff >= 0.5f)
+	{
+		return false;
+	}
+
+	memset(fir, 0, sizeof(*fir));
+	fir->numTaps = numTaps;
+	fir->factor = factor;
+
+	// Windowed sinc, normalized to unity DC gain before conversion to Q15
+	float taps[FIR_DECIMATOR_MAX_TAPS];
+	float sum = 0.0f;
+	float center = (numTaps - 1) / 2.0f;
+	for (uint8_t i = 0; i < numTaps; i++)
+	{
+		float t = i - center;
+		float sinc = t == 0.0f ? 2.0f * cutoff : sinf(2.0f * (float)M_PI * cutoff * t) / ((float)M_PI * t);
+		float window = numTaps > 1 ? 0.54f - 0.46f * cosf(2.0f * (float)M_PI * i / (numTaps - 1)) : 1.0f;
+		taps[i] = sinc * window;
+		sum += taps[i];
+	}
+	for (uint8_t i = 0; i < numTaps; i++)
+	{
+		fir->taps[i] = (int16_t)lroundf(taps[i] / sum * 32767.0f);
+	}
+	return true;
+}
+
+/**
+ * @brief Filter and decimate a block of samples
+ * @param fir Filter state
+ * @param in Input samples
+ * @param count Number of input samples
+ * @param out Output buffer, at least count / factor + 1 samples
+ * @return Number of output samples written
+ */
+size_t firDecimatorProcess(fir_decimator_t *fir, const int16_t *in, size_t count, int16_t *out)
+{
+	size_t produced = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		// Keep two copies so the newest numTaps samples are always contiguous
+		fir->history[fir->pos] = in[i];
+		fir->history[fir->pos + fir->numTaps] = in[i];
+		if (++fir->pos >= fir->numTaps)
+		{
+			fir->pos = 0;
+		}
+
+		if (++fir->phase < fir->factor)
+		{
+			continue;
+		}
+		fir->phase = 0;
+
+		// Oldest sample is at pos, newest at pos + numTaps - 1
+		const int16_t *window = &fir->history[fir->pos];
+		int32_t acc = 0;
+		for (uint8_t t = 0; t < fir->numTaps; t++)
+		{
+			acc += (int32_t)fir->taps[t] * window[t];
+		}
+		acc = (acc + (1 << 14)) >> 15;
+		if (acc > INT16_MAX)
+			acc = INT16_MAX;
+		else if (acc < INT16_MIN)
+			acc = INT16_MIN;
+		out[produced++] = (int16_t)acc;
+	}
+	return produced;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file frameTrace.cpp
+ * @date 2025-10-17
+ * @brief Per-frame IDs and stage timestamps, with latency histograms per pipeline stage.
+ *
+ * Bucket b of a histogram counts delays d with 2^b <= d + 1 < 2^(b+1)
+ * microseconds: a count-leading-zeros per sample, no division. Sums and
+ * maxima give exact means and worst cases alongside the bucket quantiles.
+ */
+
+#include "frameTrace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char *const traceTxStageNames[TRACE_TX_STAGES] = {"received", "queued",	 "access",	"ptt on",
+														"first bit", "last bit", "ptt off"};
+const char *const traceRxStageNames[TRACE_RX_STAGES] = {"flag", "crc", "routed", "written"};
+
+/**
+ * @brief Name a tracer and its stages, clear the histograms
+ * @param t Tracer
+ * @param name Direction, for example "TX"
+ * @param stageNames Name of each stage, kept by reference
+ * @param stages Number of stages, at most TRACE_MAX_STAGES
+ */
+void traceInit(frame_tracer_t *t, const char *name, const char *const *stageNames, uint8_t stages)
+{
+	memset(t, 0, sizeof(*t));
+	t->name = name;
+	t->stageNames = stageNames;
+	t->stages = stages < TRACE_MAX_STAGES ? stages : TRACE_MAX_STAGES;
+}
+
+/**
+ * @brief Give a frame the next ID and clear its stamps
+ * @param t Tracer of the frame's direction
+ * @param f Trace carried with the frame
+ * @param port KISS port
+ * @param length Frame length in bytes
+ */
+void traceBegin(frame_tracer_t *t, frame_trace_t *f, uint8_t port, size_t length)
+{
+	f->id = t->nextId++;
+	f->stamped = 0;
+	f->port = port;
+	f->length = (uint16_t)length;
+}
+
+/**
+ * @brief Record the time a frame reached a stage
+ * @param f Trace carried with the frame
+ * @param stage Stage number, below the tracer's stage count
+ * @param us Microsecond clock
+ */
+void traceStamp(frame_trace_t *f, uint8_t stage, uint32_t us)
+{
+	if (stage < TRACE_MAX_STAGES)
+	{
+		f->us[stage] = us;
+		f->stamped |= (uint8_t)(1u << stage);
+	}
+}
+
+static void addSample(frame_tracer_t *t, uint8_t slot, uint32_t us)
+{
+	uint32_t v = us + 1;
+	int bucket = v > 1 ? 31 - __builtin_clz(v) : 0;
+	t->counts[slot][bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1]++;
+	t->samples[slot]++;
+	t->sumUs[slot] += us;
+	if (us > t->maxUs[slot])
+	{
+		t->maxUs[slot] = us;
+	}
+}
+
+/**
+ * @brief Add a finished frame to the histograms
+ * @param t Tracer that began the frame
+ * @param f Trace carried with the frame
+ */
+void traceEnd(frame_tracer_t *t, const frame_trace_t *f)
+{
+	int first = -1, last = -1;
+	for (uint8_t s = 0; s < t->stages; s++)
+	{
+		if (!(f->stamped & (1u << s)))
+		{
+			continue;
+		}
+		if (s > 0 && (f->stamped & (1u << (s - 1))))
+		{
+			addSample(t, s, f->us[s] - f->us[s - 1]);
+		}
+		first = first < 0 ? s : first;
+		last = s;
+	}
+	if (first >= 0 && last > first)
+	{
+		addSample(t, 0, f->us[last] - f->us[first]);
+	}
+	t->frames++;
+}
+
+/**
+ * @brief Upper bound of a quantile of one histogram
+ * @param t Tracer
+ * @param slot 0 for first to last stage, k for stage k-1 to k
+ * @param q Quantile, 0 to 1
+ * @return Upper edge of the bucket holding the quantile, 0 if the histogram is empty
+ */
+uint32_t traceQuantileUs(const frame_tracer_t *t, uint8_t slot, float q)
+{
+	if (slot >= TRACE_MAX_STAGES || t->samples[slot] == 0)
+	{
+		return 0;
+	}
+	uint32_t target = (uint32_t)(q * t->samples[slot]);
+	uint32_t seen = 0;
+	for (int b = 0; b < TRACE_BUCKETS - 1; b++)
+	{
+		seen += t->counts[slot][b];
+		if (seen > target)
+		{
+			return (2u << b) - 1;
+		}
+	}
+	return t->maxUs[slot];
+}
+
+/**
+ * @brief Print a duration in the unit that keeps it short
+ */
+static int formatUs(char *out, size_t size, uint32_t us)
+{
+	return us < 10000 ? snprintf(out, size, "%lu us", (unsigned long)us)
+					  : snprintf(out, size, "%.1f ms", us / 1000.0f);
+}
+
+/**
+ * @brief One line of statistics for a histogram, such as "TX queued>access: 12, mean 80.1 ms, ..."
+ * @param t Tracer
+ * @param slot 0 for first to last stage, k for stage k-1 to k
+ * @param out Destination, NUL-terminated
+ * @param size Size of out
+ * @return Length of the line, 0 if the histogram is empty
+ */
+size_t traceFormatStage(const frame_tracer_t *t, uint8_t slot, char *out, size_t size)
+{
+	if (slot >= t->stages || t->samples[slot] == 0 || size == 0)
+	{
+		return 0;
+	}
+	const char *from = t->stageNames[slot == 0 ? 0 : slot - 1];
+	const char *to = t->stageNames[slot == 0 ? t->stages - 1 : slot];
+	char mean[16], p50[16], p99[16], max[16];
+	formatUs(mean, sizeof(mean), (uint32_t)(t->sumUs[slot] / t->samples[slot]));
+	formatUs(p50, sizeof(p50), traceQuantileUs(t, slot, 0.5f));
+	formatUs(p99, sizeof(p99), traceQuantileUs(t, slot, 0.99f));
+	formatUs(max, sizeof(max), t->maxUs[slot]);
+	int n = snprintf(out, size, "%s %s>%s: %lu, mean %s, p50 < %s, p99 < %s, max %s", t->name, from, to,
+					 (unsigned long)t->samples[slot], mean, p50, p99, max);
+	return n < 0 ? 0 : (size_t)n < size ? (size_t)n : size - 1;
+}
+
+/**
+ * @brief One trace log line: the frame ID and the time spent up to each stage
+ * @param t Tracer that began the frame
+ * @param f Trace carried with the frame
+ * @param out Destination, NUL-terminated
+ * @param size Size of out
+ * @return Length of the line
+ */
+size_t traceFormatFrame(const frame_tracer_t *t, const frame_trace_t *f, char *out, size_t size)
+{
+	if (size == 0)
+	{
+		return 0;
+	}
+	int n = snprintf(out, size, "%s #%lu port %u, %u bytes:", t->name, (unsigned long)f->id, f->port, f->length);
+	int previous = -1;
+	for (uint8_t s = 0; s < t->stages && n >= 0 && (size_t)n < size; s++)
+	{
+		if (!(f->stamped & (1u << s)))
+		{
+			n += snprintf(out + n, size - n, " %s -", t->stageNames[s]);
+			continue;
+		}
+		if (previous < 0)
+		{
+			n += snprintf(out + n, size - n, " %s", t->stageNames[s]);
+		}
+		else
+		{
+			char delay[16];
+			formatUs(delay, sizeof(delay), f->us[s] - f->us[previous]);
+			n += snprintf(out + n, size - n, " %s +%s", t->stageNames[s], delay);
+		}
+		previous = s;
+	}
+	return n < 0 ? 0 : (size_t)n < size ? (size_t)n : size - 1;
+}
@@ -0,0 +1,715 @@
+/**
+ * @file gzipInflate.cpp
+ * @date 2025-10-12
+ * @brief Streaming gzip decompressor with a fixed window, for compressed OTA images.
+ *
+ * Decoding runs in steps: one header field, block header, literal, match or
+ * run of stored bytes. The read position is saved before each step. A step that
+ * runs out of input is undone and its bytes are kept in the carry buffer for
+ * the next chunk, so decoding never has to pause inside a Huffman code.
+ * Huffman decoding is canonical and bit by bit, as in zlib's puff.c: slower
+ * than a table decoder, but a few hundred bytes of state and much faster than
+ * any WiFi link.
+ */
+
+#include "gzipInflate.h"
+
+#include <string.h>
+
+// gzip FLG bits
+#define GZIP_FHCRC 0x02
+#define GZIP_FEXTRA 0x04
+#define GZIP_FNAME 0x08
+#define GZIP_FCOMMENT 0x10
+#define GZIP_FRESERVED 0xE0
+
+// Stream position, in stream order
+enum
+{
+	STAGE_HEADER = 0,
+	STAGE_EXTRA_LEN,
+	STAGE_EXTRA,
+	STAGE_NAME,
+	STAGE_COMMENT,
+	STAGE_HCRC,
+	STAGE_BLOCK,
+	STAGE_STORED,
+	STAGE_CODES,
+	STAGE_TRAILER,
+	STAGE_DONE
+};
+
+// Step results; errors are recorded in the status
+enum
+{
+	STEP_OK = 0,
+	STEP_NEED, // Out of input, undo the step
+	STEP_STOP  // Done or failed
+};
+
+#define DECODE_NEED -1
+#define DECODE_ERROR -2
+
+static const uint16_t lengthBase[29] = {3,	4,	5,	6,	7,	8,	9,	10,	 11,  13,  15,	17,	 19,  23, 27,
+										31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distBase[30] = {1,   2,	3,	 4,	  5,   7,	 9,	   13,	 17,   25,	 33,   49,	 65,	97,	   129,
+									  193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// CRC-32 (reflected 0xEDB88320) four bits at a time, to keep the table small
+static const uint32_t crcNibble[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+									   0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+									   0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+static int stop(gzip_inflate_t *z, gzip_status_t status)
+{
+	z->status = status;
+	return STEP_STOP;
+}
+
+/**
+ * @brief Make at least bits bits available, reading the carry then the chunk
+ * @return false if the input ran out first
+ */
+static bool fill(gzip_inflate_t *z, uint8_t bits)
+{
+	while (z->bitCount < bits)
+	{
+		if (z->pos >= z->carryLen + z->inLen)
+		{
+			return false;
+		}
+		uint8_t b = z->pos < z->carryLen ? z->carry[z->pos] : z->in[z->pos - z->carryLen];
+		z->pos++;
+		z->bitBuf |= (uint32_t)b << z->bitCount;
+		z->bitCount += 8;
+	}
+	return true;
+}
+
+// Remove bits that fill() made available, at most 16
+static uint32_t take(gzip_inflate_t *z, uint8_t bits)
+{
+	uint32_t value = z->bitBuf & ((1UL << bits) - 1);
+	z->bitBuf >>= bits;
+	z->bitCount -= bits;
+	return value;
+}
+
+static int readByte(gzip_inflate_t *z)
+{
+	return fill(z, 8) ? (int)take(z, 8) : -1;
+}
+
+static bool flush(gzip_inflate_t *z)
+{
+	uint32_t n = z->total - z->flushed;
+	if (n == 0)
+	{
+		return true;
+	}
+	const uint8_t *start = z->window + (z->flushed & (z->windowSize - 1));
+	z->flushed = z->total;
+	return z->onOutput(z->ctx, start, n);
+}
+
+/**
+ * @brief Append one inflated byte, flushing the window each time it wraps
+ */
+static bool put(gzip_inflate_t *z, uint8_t b)
+{
+	z->window[z->total & (z->windowSize - 1)] = b;
+	uint32_t crc = z->crc ^ b;
+	crc = (crc >> 4) ^ crcNibble[crc & 0x0F];
+	z->crc = (crc >> 4) ^ crcNibble[crc & 0x0F];
+	z->total++;
+	return (z->total & (z->windowSize - 1)) != 0 || flush(z);
+}
+
+/**
+ * @brief Build a canonical Huffman code from code lengths
+ * @return 0 if complete, > 0 if incomplete, < 0 if over-subscribed
+ */
+static int buildHuffman(gzip_huffman_t *h, const uint8_t *lengths, int n)
+{
+	uint16_t offset[GZIP_MAX_WINDOW_BITS + 1];
+	memset(h->count, 0, sizeof(h->count));
+	for (int s = 0; s < n; s++)
+	{
+		h->count[lengths[s]]++;
+	}
+	if (h->count[0] == n)
+	{
+		return 0; // No codes; any use fails to decode
+	}
+	int left = 1;
+	for (int len = 1; len <= GZIP_MAX_WINDOW_BITS; len++)
+	{
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0)
+		{
+			return left;
+		}
+	}
+	offset[1] = 0;
+	for (int len = 1; len < GZIP_MAX_WINDOW_BITS; len++)
+	{
+		offset[len + 1] = offset[len] + h->count[len];
+	}
+	for (int s = 0; s < n; s++)
+	{
+		if (lengths[s] != 0)
+		{
+			h->symbol[offset[lengths[s]]++] = s;
+		}
+	}
+	return left;
+}
+
+/**
+ * @brief Decode one symbol
+ * @return Symbol, DECODE_NEED or DECODE_ERROR for a code not in the table
+ */
+static int decode(gzip_inflate_t *z, const gzip_huffman_t *h)
+{
+	fill(z, GZIP_MAX_WINDOW_BITS); // Fewer bits at the end of the input can still hold a short code
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	for (uint8_t len = 1; len <= GZIP_MAX_WINDOW_BITS; len++)
+	{
+		if (len > z->bitCount)
+		{
+			return DECODE_NEED;
+		}
+		code |= (z->bitBuf >> (len - 1)) & 1;
+		int count = h->count[len];
+		if (code - first < count)
+		{
+			take(z, len);
+			return h->symbol[index + code - first];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return DECODE_ERROR;
+}
+
+static void buildFixedTables(gzip_inflate_t *z)
+{
+	uint8_t lengths[288];
+	int s = 0;
+	for (; s < 144; s++)
+	{
+		lengths[s] = 8;
+	}
+	for (; s < 256; s++)
+	{
+		lengths[s] = 9;
+	}
+	for (; s < 280; s++)
+	{
+		lengths[s] = 7;
+	}
+	for (; s < 288; s++)
+	{
+		lengths[s] = 8;
+	}
+	buildHuffman(&z->lit, lengths, 288);
+	memset(lengths, 5, 30);
+	buildHuffman(&z->dist, lengths, 30);
+	z->fixedTables = true;
+}
+
+/**
+ * @brief Read the code lengths of a dynamic block and build its tables
+ */
+static int readDynamicTables(gzip_inflate_t *z)
+{
+	uint8_t lengths[286 + 30];
+	gzip_huffman_t lengthCode;
+
+	if (!fill(z, 14))
+	{
+		return STEP_NEED;
+	}
+	int nlen = take(z, 5) + 257;
+	int ndist = take(z, 5) + 1;
+	int ncode = take(z, 4) + 4;
+	if (nlen > 286 || ndist > 30)
+	{
+		return stop(z, GZIP_ERROR_DATA);
+	}
+
+	for (int i = 0; i < 19; i++)
+	{
+		lengths[codeLengthOrder[i]] = 0;
+		if (i < ncode)
+		{
+			if (!fill(z, 3))
+			{
+				return STEP_NEED;
+			}
+			lengths[codeLengthOrder[i]] = take(z, 3);
+		}
+	}
+	if (buildHuffman(&lengthCode, lengths, 19) != 0)
+	{
+		return stop(z, GZIP_ERROR_DATA); // Must be complete
+	}
+
+	int index = 0;
+	while (index < nlen + ndist)
+	{
+		int symbol = decode(z, &lengthCode);
+		if (symbol == DECODE_NEED)
+		{
+			return STEP_NEED;
+		}
+		if (symbol < 0)
+		{
+			return stop(z, GZIP_ERROR_DATA);
+		}
+		if (symbol < 16)
+		{
+			lengths[index++] = symbol;
+			continue;
+		}
+		uint8_t len = 0;
+		int repeat;
+		if (symbol == 16)
+		{
+			if (index == 0)
+			{
+				return stop(z, GZIP_ERROR_DATA); // Nothing to repeat
+			}
+			len = lengths[index - 1];
+			if (!fill(z, 2))
+			{
+				return STEP_NEED;
+			}
+			repeat = 3 + take(z, 2);
+		}
+		else if (symbol == 17)
+		{
+			if (!fill(z, 3))
+			{
+				return STEP_NEED;
+			}
+			repeat = 3 + take(z, 3);
+		}
+		else
+		{
+			if (!fill(z, 7))
+			{
+				return STEP_NEED;
+			}
+			repeat = 11 + take(z, 7);
+		}
+		if (index + repeat > nlen + ndist)
+		{
+			return stop(z, GZIP_ERROR_DATA);
+		}
+		while (repeat-- > 0)
+		{
+			lengths[index++] = len;
+		}
+	}
+	if (lengths[256] == 0)
+	{
+		return stop(z, GZIP_ERROR_DATA); // No end-of-block code
+	}
+
+	// Incomplete codes are only allowed with a single code of one bit
+	z->fixedTables = false;
+	int err = buildHuffman(&z->lit, lengths, nlen);
+	if (err < 0 || (err > 0 && nlen != z->lit.count[0] + z->lit.count[1]))
+	{
+		return stop(z, GZIP_ERROR_DATA);
+	}
+	err = buildHuffman(&z->dist, lengths + nlen, ndist);
+	if (err < 0 || (err > 0 && ndist != z->dist.count[0] + z->dist.count[1]))
+	{
+		return stop(z, GZIP_ERROR_DATA);
+	}
+	return STEP_OK;
+}
+
+// First optional header field present at or after from, else the first block
+static uint8_t headerStage(uint8_t flags, uint8_t from)
+{
+	if (from <= STAGE_EXTRA_LEN && (flags & GZIP_FEXTRA))
+	{
+		return STAGE_EXTRA_LEN;
+	}
+	if (from <= STAGE_NAME && (flags & GZIP_FNAME))
+	{
+		return STAGE_NAME;
+	}
+	if (from <= STAGE_COMMENT && (flags & GZIP_FCOMMENT))
+	{
+		return STAGE_COMMENT;
+	}
+	if (from <= STAGE_HCRC && (flags & GZIP_FHCRC))
+	{
+		return STAGE_HCRC;
+	}
+	return STAGE_BLOCK;
+}
+
+/**
+ * @brief Decode one header field, block header, symbol or run of stored bytes
+ */
+static int step(gzip_inflate_t *z)
+{
+	uint8_t blockEnd = z->lastBlock ? STAGE_TRAILER : STAGE_BLOCK;
+	switch (z->stage)
+	{
+	case STAGE_HEADER:
+	{
+		uint8_t header[10];
+		for (int i = 0; i < 10; i++)
+		{
+			int b = readByte(z);
+			if (b < 0)
+			{
+				return STEP_NEED;
+			}
+			header[i] = b;
+		}
+		// ID1, ID2, deflate, no reserved flags; MTIME, XFL and OS are not used
+		if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8 || (header[3] & GZIP_FRESERVED))
+		{
+			return stop(z, GZIP_ERROR_HEADER);
+		}
+		z->flags = header[3];
+		z->stage = headerStage(z->flags, STAGE_EXTRA_LEN);
+		return STEP_OK;
+	}
+
+	case STAGE_EXTRA_LEN:
+	{
+		int lo = readByte(z);
+		int hi = readByte(z);
+		if (hi < 0)
+		{
+			return STEP_NEED;
+		}
+		z->skip = lo | (hi << 8);
+		z->stage = STAGE_EXTRA;
+		return STEP_OK;
+	}
+
+	case STAGE_EXTRA:
+	case STAGE_NAME:
+	case STAGE_COMMENT:
+	{
+		// Skipped byte by byte; the name and comment end with a zero byte
+		bool progress = false;
+		for (;;)
+		{
+			if (z->stage == STAGE_EXTRA && z->skip == 0)
+			{
+				z->stage = headerStage(z->flags, STAGE_NAME);
+				return STEP_OK;
+			}
+			int b = readByte(z);
+			if (b < 0)
+			{
+				return progress ? STEP_OK : STEP_NEED;
+			}
+			progress = true;
+			if (z->stage == STAGE_EXTRA)
+			{
+				z->skip--;
+			}
+			else if (b == 0)
+			{
+				z->stage = headerStage(z->flags, z->stage + 1);
+				return STEP_OK;
+			}
+		}
+	}
+
+	case STAGE_HCRC:
+		if (readByte(z) < 0 || readByte(z) < 0)
+		{
+			return STEP_NEED;
+		}
+		z->stage = STAGE_BLOCK;
+		return STEP_OK;
+
+	case STAGE_BLOCK:
+	{
+		if (!fill(z, 3))
+		{
+			return STEP_NEED;
+		}
+		z->lastBlock = take(z, 1);
+		uint8_t type = take(z, 2);
+		if (type == 0)
+		{
+			take(z, z->bitCount & 7); // Stored blocks start on a byte boundary
+			if (!fill(z, 16))
+			{
+				return STEP_NEED;
+			}
+			uint16_t len = take(z, 16);
+			if (!fill(z, 16))
+			{
+				return STEP_NEED;
+			}
+			if (len != (uint16_t)~take(z, 16))
+			{
+				return stop(z, GZIP_ERROR_DATA);
+			}
+			z->stored = len;
+			z->stage = STAGE_STORED;
+			return STEP_OK;
+		}
+		if (type == 1)
+		{
+			if (!z->fixedTables)
+			{
+				buildFixedTables(z);
+			}
+			z->stage = STAGE_CODES;
+			return STEP_OK;
+		}
+		if (type == 2)
+		{
+			int r = readDynamicTables(z);
+			if (r == STEP_OK)
+			{
+				z->stage = STAGE_CODES;
+			}
+			return r;
+		}
+		return stop(z, GZIP_ERROR_DATA);
+	}
+
+	case STAGE_STORED:
+	{
+		if (z->stored == 0)
+		{
+			z->stage = blockEnd;
+			return STEP_OK;
+		}
+		bool progress = false;
+		while (z->stored > 0 && fill(z, 8))
+		{
+			if (!put(z, take(z, 8)))
+			{
+				return stop(z, GZIP_ERROR_OUTPUT);
+			}
+			z->stored--;
+			progress = true;
+		}
+		return progress ? STEP_OK : STEP_NEED;
+	}
+
+	case STAGE_CODES:
+	{
+		int symbol = decode(z, &z->lit);
+		if (symbol == DECODE_NEED)
+		{
+			return STEP_NEED;
+		}
+		if (symbol < 0)
+		{
+			return stop(z, GZIP_ERROR_DATA);
+		}
+		if (symbol < 256)
+		{
+			return put(z, symbol) ? STEP_OK : stop(z, GZIP_ERROR_OUTPUT);
+		}
+		if (symbol == 256)
+		{
+			z->stage = blockEnd;
+			return STEP_OK;
+		}
+
+		// Match: all of its bits are read before anything is written
+		symbol -= 257;
+		if (symbol >= 29)
+		{
+			return stop(z, GZIP_ERROR_DATA);
+		}
+		if (!fill(z, lengthExtra[symbol]))
+		{
+			return STEP_NEED;
+		}
+		uint32_t len = lengthBase[symbol] + take(z, lengthExtra[symbol]);
+		int code = decode(z, &z->dist);
+		if (code == DECODE_NEED)
+		{
+			return STEP_NEED;
+		}
+		if (code < 0 || code >= 30)
+		{
+			return stop(z, GZIP_ERROR_DATA);
+		}
+		if (!fill(z, distExtra[code]))
+		{
+			return STEP_NEED;
+		}
+		uint32_t dist = distBase[code] + take(z, distExtra[code]);
+		if (dist > z->windowSize)
+		{
+			return stop(z, GZIP_ERROR_DISTANCE);
+		}
+		if (dist > z->total)
+		{
+			return stop(z, GZIP_ERROR_DATA); // Before the start of the stream
+		}
+		uint32_t mask = z->windowSize - 1;
+		while (len-- > 0)
+		{
+			if (!put(z, z->window[(z->total - dist) & mask]))
+			{
+				return stop(z, GZIP_ERROR_OUTPUT);
+			}
+		}
+		return STEP_OK;
+	}
+
+	case STAGE_TRAILER:
+	{
+		take(z, z->bitCount & 7);
+		uint8_t trailer[8];
+		for (int i = 0; i < 8; i++)
+		{
+			int b = readByte(z);
+			if (b < 0)
+			{
+				return STEP_NEED;
+			}
+			trailer[i] = b;
+		}
+		uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+		uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+		if (crc != (z->crc ^ 0xFFFFFFFF) || size != z->total)
+		{
+			return stop(z, GZIP_ERROR_CHECK);
+		}
+		z->stage = STAGE_DONE;
+		return stop(z, GZIP_DONE);
+	}
+
+	default:
+		return STEP_STOP;
+	}
+}
+
+/**
+ * @brief Reset a decompressor
+ * @return false if windowBits is out of range
+ */
+bool gzipInflateInit(gzip_inflate_t *z, uint8_t *window, uint8_t windowBits, gzip_output_cb onOutput, void *ctx)
+{
+	if (windowBits < GZIP_MIN_WINDOW_BITS || windowBits > GZIP_MAX_WINDOW_BITS)
+	{
+		return false;
+	}
+	memset(z, 0, sizeof(*z));
+	z->status = GZIP_MORE;
+	z->stage = STAGE_HEADER;
+	z->window = window;
+	z->windowSize = 1UL << windowBits;
+	z->crc = 0xFFFFFFFF;
+	z->onOutput = onOutput;
+	z->ctx = ctx;
+	return true;
+}
+
+/**
+ * @brief Feed the next chunk of the compressed stream
+ * @return GZIP_MORE until the trailer has been checked, then GZIP_DONE
+ */
+gzip_status_t gzipInflateInput(gzip_inflate_t *z, const uint8_t *data, size_t len)
+{
+	if (z->status != GZIP_MORE)
+	{
+		return z->status;
+	}
+	z->in = data;
+	z->inLen = len;
+	z->pos = 0;
+
+	for (;;)
+	{
+		size_t pos = z->pos;
+		uint32_t bitBuf = z->bitBuf;
+		uint8_t bitCount = z->bitCount;
+		int r = step(z);
+		if (r == STEP_NEED)
+		{
+			z->pos = pos;
+			z->bitBuf = bitBuf;
+			z->bitCount = bitCount;
+			break;
+		}
+		if (r == STEP_STOP)
+		{
+			break;
+		}
+	}
+
+	if (z->status == GZIP_MORE)
+	{
+		// Keep the bytes of the unfinished step for the next chunk
+		size_t rest = z->carryLen + z->inLen - z->pos;
+		if (rest > GZIP_CARRY_BYTES)
+		{
+			z->status = GZIP_ERROR_DATA; // Longer than any valid header or symbol
+		}
+		else
+		{
+			if (z->pos < z->carryLen)
+			{
+				memmove(z->carry, z->carry + z->pos, z->carryLen - z->pos);
+				memcpy(z->carry + z->carryLen - z->pos, z->in, z->inLen);
+			}
+			else
+			{
+				memcpy(z->carry, z->in + (z->pos - z->carryLen), rest);
+			}
+			z->carryLen = rest;
+			z->pos = 0;
+		}
+	}
+	if ((z->status == GZIP_MORE || z->status == GZIP_DONE) && !flush(z))
+	{
+		z->status = GZIP_ERROR_OUTPUT;
+	}
+	z->in = NULL;
+	z->inLen = 0;
+	return z->status;
+}
+
+const char *gzipInflateStatusString(gzip_status_t status)
+{
+	switch (status)
+	{
+	case GZIP_MORE:
+		return "Waiting for more input";
+	case GZIP_DONE:
+		return "Complete";
+	case GZIP_ERROR_HEADER:
+		return "Not a gzip deflate stream";
+	case GZIP_ERROR_DATA:
+		return "Corrupt compressed data";
+	case GZIP_ERROR_DISTANCE:
+		return "Back-reference beyond the window";
+	case GZIP_ERROR_CHECK:
+		return "CRC or length mismatch";
+	case GZIP_ERROR_OUTPUT:
+		return "Output refused";
+	default:
+		return "Unknown status";
+	}
+}
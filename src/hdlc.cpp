@@ -0,0 +1,323 @@
+/**
+ * @file hdlc.cpp
+ * @date 2025-09-11
+ * @brief HDLC deframer and framer, AX.25 frame check sequence.
+ */
+
+#include "hdlc.h"
+
+#define HDLC_FLAG 0x7E
+#define FCS_POLY 0x8408		   // CRC-16-CCITT, reflected
+#define FCS_GOOD_RESIDUE 0xF0B8 // CRC register after a frame and its correct FCS
+
+/**
+ * @brief Compute the AX.25 frame check sequence
+ * @param data Frame bytes
+ * @param len Number of bytes
+ * @return FCS, transmitted low byte first
+ */
+uint16_t ax25Fcs(const uint8_t *data, size_t len)
+{
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < len; i++)
+	{
+		crc ^= data[i];
+		for (int j = 0; j < 8; j++)
+		{
+			crc = (crc & 0x0001) ? (crc >> 1) ^ FCS_POLY : (crc >> 1);
+		}
+	}
+	return crc ^ 0xFFFF;
+}
+
+/**
+ * @brief Repair a frame that failed the FCS check
+ *
+ * The CRC register after a frame with errors is the register of the correct
+ * frame XOR the register of the error pattern alone. For a single bit, that
+ * is FCS_POLY shifted through the rest of the frame, so walking the frame
+ * backwards gives each bit's effect with one CRC step. A candidate matches
+ * when its effect equals the difference from FCS_GOOD_RESIDUE.
+ *
+ * @param frame Frame bytes and FCS, repaired in place
+ * @param len Number of bytes, FCS included
+ * @return true if exactly one candidate passes the FCS check and was applied
+ */
+bool hdlcRepair(uint8_t *frame, size_t len)
+{
+	if (len < HDLC_MIN_FRAME || len > HDLC_MAX_FRAME)
+	{
+		return false;
+	}
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < len; i++)
+	{
+		crc ^= frame[i];
+		for (int j = 0; j < 8; j++)
+		{
+			crc = (crc & 0x0001) ? (crc >> 1) ^ FCS_POLY : (crc >> 1);
+		}
+	}
+	uint16_t syndrome = crc ^ FCS_GOOD_RESIDUE;
+	if (syndrome == 0)
+	{
+		return false; // Nothing to repair
+	}
+
+	size_t bits = len * 8;
+	size_t found = 0;
+	bool pair = false;
+	int matches = 0;
+	uint16_t effect = FCS_POLY; // Of the last bit
+	uint16_t later = 0;			// Of the bit after this one
+	for (size_t p = bits; p-- > 0;)
+	{
+		if (effect == syndrome)
+		{
+			matches++;
+			found = p;
+			pair = false;
+		}
+		if (p + 1 < bits && (effect ^ later) == syndrome)
+		{
+			matches++;
+			found = p;
+			pair = true;
+		}
+		later = effect;
+		effect = (effect & 0x0001) ? (effect >> 1) ^ FCS_POLY : (effect >> 1);
+	}
+	if (matches != 1)
+	{
+		return false;
+	}
+
+	frame[found / 8] ^= (uint8_t)(1 << (found % 8));
+	if (pair)
+	{
+		frame[(found + 1) / 8] ^= (uint8_t)(1 << ((found + 1) % 8));
+	}
+	return true;
+}
+
+/**
+ * @brief Reset a deframer
+ * @param h Deframer state
+ * @param onFrame Callback for frames with a valid FCS
+ * @param ctx Passed back to onFrame
+ */
+void hdlcInit(hdlc_deframer_t *h, hdlc_frame_cb onFrame, void *ctx)
+{
+	h->length = 0;
+	h->pattern = 0;
+	h->shift = 0;
+	h->bitCount = -1;
+	h->lastLevel = false;
+	h->overflow = false;
+	h->frames = 0;
+	h->fcsErrors = 0;
+	h->onFrame = onFrame;
+	h->onError = NULL;
+	h->ctx = ctx;
+}
+
+/**
+ * @brief Deliver frames that fail the FCS check as well, for hdlcRepair()
+ * @param h Deframer state
+ * @param onError Called with the frame and its FCS, with the ctx given to hdlcInit(); NULL to stop
+ */
+void hdlcSetErrorCallback(hdlc_deframer_t *h, hdlc_frame_cb onError)
+{
+	h->onError = onError;
+}
+
+/**
+ * @brief Check the FCS of a completed frame and deliver it
+ */
+static bool deliverFrame(hdlc_deframer_t *h)
+{
+	if (h->overflow || h->length < HDLC_MIN_FRAME)
+	{
+		return false;
+	}
+
+	size_t payload = h->length - 2;
+	uint16_t received = (uint16_t)h->frame[payload] | ((uint16_t)h->frame[payload + 1] << 8);
+	if (ax25Fcs(h->frame, payload) != received)
+	{
+		h->fcsErrors++;
+		if (h->onError)
+		{
+			h->onError(h->ctx, h->frame, h->length);
+		}
+		return false;
+	}
+
+	h->frames++;
+	if (h->onFrame)
+	{
+		h->onFrame(h->ctx, h->frame, payload);
+	}
+	return true;
+}
+
+/**
+ * @brief Feed one recovered line bit
+ *
+ * A flag ends the current frame if exactly seven of its bits were shifted in
+ * after the last whole byte, which is where the flag's leading 0111111 lands.
+ * Seven ones in a row abort the frame; a zero after five ones is a stuffed bit.
+ *
+ * @param h Deframer state
+ * @param level Line level at the bit center, true for mark
+ * @return true if this bit completed a frame that passed the FCS check
+ */
+bool hdlcBit(hdlc_deframer_t *h, bool level)
+{
+	// NRZI: no change is a one, a change is a zero
+	bool bit = level == h->lastLevel;
+	h->lastLevel = level;
+	h->pattern = (uint8_t)((h->pattern >> 1) | (bit ? 0x80 : 0x00));
+
+	bool delivered = false;
+	if (h->pattern == HDLC_FLAG)
+	{
+		if (h->bitCount == 7)
+		{
+			delivered = deliverFrame(h);
+		}
+		h->length = 0;
+		h->shift = 0;
+		h->bitCount = 0;
+		h->overflow = false;
+	}
+	else if (h->pattern == 0xFE)
+	{
+		h->bitCount = -1; // Abort or idle: seven ones
+		h->length = 0;
+	}
+	else if ((h->pattern & 0xFC) == 0x7C)
+	{
+		// Stuffed zero after five ones, discard
+	}
+	else if (h->bitCount >= 0)
+	{
+		h->shift = (uint8_t)((h->shift >> 1) | (bit ? 0x80 : 0x00));
+		if (++h->bitCount == 8)
+		{
+			h->bitCount = 0;
+			if (h->length < HDLC_MAX_FRAME)
+			{
+				h->frame[h->length++] = h->shift;
+			}
+			else
+			{
+				h->overflow = true;
+			}
+		}
+	}
+	return delivered;
+}
+
+// Line level writer for hdlcEncode(), stops at the end of the buffer
+typedef struct
+{
+	uint8_t *levels;
+	size_t count;
+	size_t max;
+	uint8_t level;
+	uint8_t ones;
+} hdlc_writer_t;
+
+/**
+ * @brief NRZI-encode one bit: a zero toggles the line, a one keeps it
+ */
+static inline bool putBit(hdlc_writer_t *w, bool bit)
+{
+	if (w->count >= w->max)
+	{
+		return false;
+	}
+	if (!bit)
+	{
+		w->level ^= 1;
+	}
+	w->levels[w->count++] = w->level;
+	return true;
+}
+
+/**
+ * @brief Write a flag, which is never stuffed
+ */
+static bool putFlag(hdlc_writer_t *w)
+{
+	w->ones = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		if (!putBit(w, (HDLC_FLAG >> i) & 1))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Write a data byte LSB first with bit stuffing
+ */
+static bool putByte(hdlc_writer_t *w, uint8_t byte)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		bool bit = (byte >> i) & 1;
+		if (!putBit(w, bit))
+		{
+			return false;
+		}
+		w->ones = bit ? w->ones + 1 : 0;
+		if (w->ones == 5)
+		{
+			if (!putBit(w, false))
+			{
+				return false;
+			}
+			w->ones = 0;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Frame an AX.25 frame for transmission
+ * @param frame Frame bytes without FCS
+ * @param len Number of bytes, HDLC_MIN_FRAME - 2 to HDLC_MAX_FRAME - 2
+ * @param preambleFlags Flags sent before the frame (TXDELAY), at least 1
+ * @param levels Output line levels, one per byte, 1 = mark
+ * @param maxLevels Size of levels, HDLC_ENCODED_LEVELS(len, preambleFlags) always fits
+ * @return Number of levels written, 0 if the frame length is out of range or levels is too small
+ */
+size_t hdlcEncode(const uint8_t *frame, size_t len, uint16_t preambleFlags, uint8_t *levels, size_t maxLevels)
+{
+	if (!frame || !levels || len < HDLC_MIN_FRAME - 2 || len > HDLC_MAX_FRAME - 2 || preambleFlags == 0)
+	{
+		return 0;
+	}
+
+	hdlc_writer_t w = {levels, 0, maxLevels, 1, 0};
+	uint16_t fcs = ax25Fcs(frame, len);
+	bool ok = true;
+	for (uint16_t i = 0; i < preambleFlags && ok; i++)
+	{
+		ok = putFlag(&w);
+	}
+	for (size_t i = 0; i < len && ok; i++)
+	{
+		ok = putByte(&w, frame[i]);
+	}
+	ok = ok && putByte(&w, (uint8_t)(fcs & 0xFF)) && putByte(&w, (uint8_t)(fcs >> 8));
+	for (int i = 0; i < HDLC_TAIL_FLAGS && ok; i++)
+	{
+		ok = putFlag(&w);
+	}
+	return ok ? w.count : 0;
+}
@@ -0,0 +1,379 @@
+/**
+ * @file allocCheck.cpp
+ * @date 2025-10-08
+ * @brief "alloc" subcommand: fail when a per-frame or per-sample path touches the heap.
+ *
+ * The firmware's receive and transmit paths run for days and must not allocate.
+ * A leak or a fragmenting malloc/free pair there is what the memory monitor
+ * (memMonitor.h) sees as a falling baseline, hours too late. This runs every
+ * portable hot path with the host allocator guarded (allocGuard.h):
+ * - modulate: hdlcEncode() and afskModulatorBit(), the transmit path
+ * - demodulate: afskDemodProcess() and hdlcBit() on the modulated audio,
+ *   decoded frames through ax25Parse(), ax25Format() and kissEncode()
+ * - kiss: kissInput() on the host byte stream, frames through ax25Parse()
+ * - digi: digiProcess() on WIDEn-N paths, duplicates included
+ * - csma: csmaRequest() and the virtual clock's timers up to the grant
+ * - pipeline: the whole loop, KISS bytes from the host to audio the way
+ *   transmitAX25() renders it, one flag in the buffer repeated for TXDELAY,
+ *   and that audio back to KISS bytes for the host; every frame must come out
+ * Buffers are set up before a region starts and the callbacks only count, so
+ * any allocation is the module's own. Exits 1 if there was one; --abort stops
+ * at the first one instead, for a stack trace in a debugger.
+ *
+ * Sanitizer builds (env:native-sanitize) keep their own allocator, so the check
+ * is skipped there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "allocGuard.h"
+#include "ax25.h"
+#include "clockHal.h"
+#include "csma.h"
+#include "digipeater.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define ALLOC_RATE 9600 // Sample rate of the demodulator, as on the firmware
+#define ALLOC_BLOCK 96	// Samples per demodulator call, 10 ms
+#define ALLOC_FLAGS 8	// Preamble flags
+#define ALLOC_DEFAULT_FRAMES 2000
+#define ALLOC_TONE_LEVEL 16384
+#define ALLOC_TXDELAY_FLAGS 30 // 200 ms at 1200 baud, as sent by the firmware
+#define ALLOC_FLAG_LEVELS 8
+
+typedef struct
+{
+	const char *name;
+	uint64_t calls;		  // Top-level calls made inside the region
+	uint64_t allocations; // Heap allocations counted there
+} alloc_path_t;
+
+// Only counters in the callbacks; anything else could allocate on its own
+static uint64_t decoded;
+static uint64_t parsed;
+static uint64_t hostFrames;
+static uint64_t grants;
+
+// KISS in, audio, KISS out: the pipeline path's buffers, filled before the region
+typedef struct
+{
+	afsk_modulator_t *mod;
+	afsk_demod_t *demod;
+	uint8_t *levels;
+	size_t maxLevels;
+	int16_t *audio;
+	uint64_t in;
+	uint64_t out;
+} alloc_pipeline_t;
+
+static void allocUsage()
+{
+	fprintf(stderr,
+			"usage: program alloc [options]\n"
+			"  --frames N   frames per path (default %d)\n"
+			"  --abort      abort at the first allocation instead of counting\n",
+			ALLOC_DEFAULT_FRAMES);
+}
+
+/**
+ * @brief Append an AX.25 address field
+ */
+static void putAddress(std::vector<uint8_t> &out, const char *call, uint8_t ssid, uint8_t flags)
+{
+	size_t n = strlen(call);
+	for (size_t i = 0; i < 6; i++)
+	{
+		out.push_back((uint8_t)((i < n ? call[i] : ' ') << 1));
+	}
+	out.push_back((uint8_t)(0x60 | (ssid << 1) | flags));
+}
+
+/**
+ * @brief APRS UI frames of growing length, every other one via WIDE1-1,WIDE2-2
+ */
+static std::vector<std::vector<uint8_t>> makeFrames(size_t count)
+{
+	std::vector<std::vector<uint8_t>> frames;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool viaDigi = i % 2 == 0;
+		std::vector<uint8_t> f;
+		putAddress(f, "APRS", 0, 0x80);
+		putAddress(f, "N0CALL", (uint8_t)(i % 16), viaDigi ? 0x00 : 0x01);
+		if (viaDigi)
+		{
+			putAddress(f, "WIDE1", 1, 0x00);
+			putAddress(f, "WIDE2", 2, 0x01);
+		}
+		f.push_back(AX25_CONTROL_UI);
+		f.push_back(AX25_PID_NONE);
+		char info[32];
+		int n = snprintf(info, sizeof(info), "!4903.50N/07201.75W-%06zu ", i);
+		f.insert(f.end(), info, info + n);
+		f.resize(f.size() + i % (AX25_MAX_INFO - (size_t)n), (uint8_t)('A' + i % 26));
+		frames.push_back(f);
+	}
+	return frames;
+}
+
+static void onDecoded(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	decoded++;
+	ax25_frame_t f;
+	if (ax25Parse(frame, len, &f) == AX25_OK)
+	{
+		parsed++;
+		char line[AX25_MAX_INFO * 6 + 128];
+		ax25Format(&f, line, sizeof(line));
+	}
+	uint8_t encoded[KISS_MAX_ENCODED(KISS_MAX_FRAME)];
+	kissEncode(port, KISS_CMD_DATA, frame, len, encoded, sizeof(encoded));
+}
+
+static void onHostFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	ax25_frame_t f;
+	if (command == KISS_CMD_DATA && ax25Parse(data, len, &f) == AX25_OK)
+	{
+		hostFrames++;
+	}
+}
+
+static void onGrant(void *ctx)
+{
+	grants++;
+}
+
+static void onPipelineOut(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	uint8_t encoded[KISS_MAX_ENCODED(KISS_MAX_FRAME)];
+	if (kissEncode(port, KISS_CMD_DATA, frame, len, encoded, sizeof(encoded)) > 0)
+	{
+		((alloc_pipeline_t *)ctx)->out++;
+	}
+}
+
+/**
+ * @brief A frame from the host: framed and rendered like transmitAX25(), then received
+ */
+static void onPipelineIn(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	alloc_pipeline_t *p = (alloc_pipeline_t *)ctx;
+	if (command != KISS_CMD_DATA)
+	{
+		return;
+	}
+	p->in++;
+	size_t count = hdlcEncode(data, len, 1, p->levels, p->maxLevels);
+	size_t preamble = (ALLOC_TXDELAY_FLAGS - 1) * ALLOC_FLAG_LEVELS;
+	size_t samples = 0;
+	afskModulatorReset(p->mod);
+	for (size_t i = 0; count > 0 && i < preamble + count; i++)
+	{
+		bool mark = i < preamble ? p->levels[i % ALLOC_FLAG_LEVELS] : p->levels[i - preamble];
+		samples += afskModulatorBit(p->mod, mark, p->audio + samples);
+	}
+	for (size_t at = 0; at < samples; at += ALLOC_BLOCK)
+	{
+		afskDemodProcess(p->demod, p->audio + at, samples - at < ALLOC_BLOCK ? samples - at : ALLOC_BLOCK);
+	}
+}
+
+/**
+ * @brief Render a frame: HDLC levels, then AFSK samples into audio
+ * @return Samples written
+ */
+static size_t modulate(afsk_modulator_t *mod, const std::vector<uint8_t> &frame, uint8_t *levels, size_t maxLevels,
+					   int16_t *audio)
+{
+	size_t count = hdlcEncode(frame.data(), frame.size(), ALLOC_FLAGS, levels, maxLevels);
+	size_t samples = 0;
+	afskModulatorReset(mod);
+	for (size_t i = 0; i < count; i++)
+	{
+		samples += afskModulatorBit(mod, levels[i], audio + samples);
+	}
+	return samples;
+}
+
+static void finish(alloc_path_t *path, uint64_t before)
+{
+	path->allocations = allocGuardCount() - before;
+}
+
+int allocMain(int argc, char **argv)
+{
+	size_t frameCount = ALLOC_DEFAULT_FRAMES;
+	bool abortOnAlloc = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--frames") == 0 && more)
+			frameCount = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--abort") == 0)
+			abortOnAlloc = true;
+		else
+		{
+			allocUsage();
+			return 2;
+		}
+	}
+	if (frameCount < 1)
+	{
+		allocUsage();
+		return 2;
+	}
+	if (!allocGuardActive())
+	{
+		fprintf(stderr, "alloc: sanitizer build, the allocator is not replaced; skipped\n");
+		return 0;
+	}
+
+	// Everything the regions touch, allocated up front
+	std::vector<std::vector<uint8_t>> frames = makeFrames(frameCount);
+	const size_t maxLevels = HDLC_ENCODED_LEVELS(HDLC_MAX_FRAME, ALLOC_FLAGS);
+	std::vector<uint8_t> levels(maxLevels);
+	std::vector<int16_t> scratch(maxLevels * (ALLOC_RATE / 1200 + 1));
+	std::vector<std::vector<int16_t>> audio(frames.size());
+	std::vector<uint8_t> stream;
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, ALLOC_RATE, 1200, 2200, 1200);
+	afskModulatorSetLevels(&mod, ALLOC_TONE_LEVEL, ALLOC_TONE_LEVEL);
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		audio[i].assign(scratch.begin(), scratch.begin() + modulate(&mod, frames[i], levels.data(), maxLevels,
+																	scratch.data()));
+		std::vector<uint8_t> encoded(KISS_MAX_ENCODED(frames[i].size()));
+		encoded.resize(kissEncode(0, KISS_CMD_DATA, frames[i].data(), frames[i].size(), encoded.data(),
+								  encoded.size()));
+		stream.insert(stream.end(), encoded.begin(), encoded.end());
+	}
+	std::vector<uint8_t> repeated(KISS_MAX_FRAME + DIGI_MAX_GROWTH);
+	afsk_profile_t profile = {1200, 2200, 1200, ALLOC_RATE};
+	afsk_demod_t demod;
+	afskDemodInit(&demod, &profile, 0, onDecoded, NULL);
+	kiss_decoder_t kiss;
+	kissInit(&kiss, onHostFrame, NULL);
+	digi_t digi;
+	digiInit(&digi, "DIGI", 0, 2);
+	csma_t csma;
+	clockReset();
+	csmaInit(&csma, NULL, onGrant, NULL, 1);
+	std::vector<int16_t> pipelineAudio((maxLevels + ALLOC_TXDELAY_FLAGS * ALLOC_FLAG_LEVELS) * (ALLOC_RATE / 1200 + 1));
+	afsk_demod_t pipelineDemod;
+	alloc_pipeline_t pipeline = {&mod, &pipelineDemod, levels.data(), maxLevels, pipelineAudio.data(), 0, 0};
+	afskDemodInit(&pipelineDemod, &profile, 0, onPipelineOut, &pipeline);
+	kiss_decoder_t pipelineKiss;
+	kissInit(&pipelineKiss, onPipelineIn, &pipeline);
+
+	allocGuardSetAbort(abortOnAlloc);
+	alloc_path_t paths[] = {{"modulate", 0, 0}, {"demodulate", 0, 0}, {"kiss", 0, 0},
+							{"digi", 0, 0},		{"csma", 0, 0},		  {"pipeline", 0, 0}};
+	uint64_t before;
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[0].name);
+		for (const std::vector<uint8_t> &f : frames)
+		{
+			modulate(&mod, f, levels.data(), maxLevels, scratch.data());
+			paths[0].calls++;
+		}
+	}
+	finish(&paths[0], before);
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[1].name);
+		for (const std::vector<int16_t> &a : audio)
+		{
+			for (size_t at = 0; at < a.size(); at += ALLOC_BLOCK)
+			{
+				afskDemodProcess(&demod, a.data() + at, a.size() - at < ALLOC_BLOCK ? a.size() - at : ALLOC_BLOCK);
+				paths[1].calls++;
+			}
+		}
+	}
+	finish(&paths[1], before);
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[2].name);
+		for (size_t at = 0; at < stream.size(); at += 64)
+		{
+			kissInput(&kiss, stream.data() + at, stream.size() - at < 64 ? stream.size() - at : 64);
+			paths[2].calls++;
+		}
+	}
+	finish(&paths[2], before);
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[3].name);
+		for (const std::vector<uint8_t> &f : frames)
+		{
+			for (int copy = 0; copy < 2; copy++) // The second copy is a duplicate
+			{
+				digiProcess(&digi, f.data(), f.size(), repeated.data(), repeated.size());
+				paths[3].calls++;
+			}
+		}
+	}
+	finish(&paths[3], before);
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[4].name);
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			csmaRequest(&csma);
+			clockAdvance(clockMicros() + 5000000); // Long enough for any persistence draw
+			paths[4].calls++;
+		}
+	}
+	finish(&paths[4], before);
+
+	before = allocGuardCount();
+	{
+		AllocGuardScope scope(paths[5].name);
+		for (size_t at = 0; at < stream.size(); at += 64)
+		{
+			kissInput(&pipelineKiss, stream.data() + at, stream.size() - at < 64 ? stream.size() - at : 64);
+			paths[5].calls++;
+		}
+	}
+	finish(&paths[5], before);
+	allocGuardSetAbort(false);
+
+	uint64_t total = 0;
+	printf("path\tcalls\tallocations\n");
+	for (const alloc_path_t &p : paths)
+	{
+		printf("%s\t%llu\t%llu\n", p.name, (unsigned long long)p.calls, (unsigned long long)p.allocations);
+		total += p.allocations;
+	}
+	printf("# %zu frames: %llu decoded (%llu parsed), %llu from the host, %u repeated, %u duplicates, %llu grants\n",
+		   frames.size(), (unsigned long long)decoded, (unsigned long long)parsed, (unsigned long long)hostFrames,
+		   digi.repeated, digi.duplicates, (unsigned long long)grants);
+	printf("# pipeline: %llu frames in, %llu out\n", (unsigned long long)pipeline.in, (unsigned long long)pipeline.out);
+	if (pipeline.out != frames.size())
+	{
+		printf("# FAIL: the pipeline lost frames\n");
+		return 1;
+	}
+	if (total > 0)
+	{
+		printf("# FAIL: %llu allocations in hot paths, last in %s\n", (unsigned long long)total,
+			   allocGuardLastRegion());
+		return 1;
+	}
+	printf("# OK: no allocations in hot paths\n");
+	return 0;
+}
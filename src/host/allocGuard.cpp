@@ -0,0 +1,159 @@
+/**
+ * @file allocGuard.cpp
+ * @date 2025-10-08
+ * @brief Counts heap allocations made inside marked hot-path regions of the host build.
+ *
+ * Nothing in the wrappers may allocate, so the region state is plain
+ * thread-local data and the abort message goes straight to write().
+ */
+
+#include "allocGuard.h"
+
+#include <atomic>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ALLOC_GUARD_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ALLOC_GUARD_SANITIZED 1
+#endif
+#endif
+#ifndef ALLOC_GUARD_SANITIZED
+#define ALLOC_GUARD_SANITIZED 0
+#endif
+
+static __thread unsigned depth = 0;
+static __thread const char *region = NULL;
+static std::atomic<uint64_t> counted{0};
+static std::atomic<const char *> lastRegion{NULL};
+static std::atomic<bool> abortOnFirst{false};
+
+bool allocGuardActive()
+{
+	return !ALLOC_GUARD_SANITIZED;
+}
+
+/**
+ * @brief Mark the start of a hot-path region on this thread
+ * @param name Reported with the allocations, must stay valid
+ */
+void allocGuardEnter(const char *name)
+{
+	depth++;
+	region = name;
+}
+
+void allocGuardLeave()
+{
+	if (depth > 0 && --depth == 0)
+	{
+		region = NULL;
+	}
+}
+
+uint64_t allocGuardCount()
+{
+	return counted.load();
+}
+
+const char *allocGuardLastRegion()
+{
+	return lastRegion.load();
+}
+
+void allocGuardSetAbort(bool abortOnAlloc)
+{
+	abortOnFirst.store(abortOnAlloc);
+}
+
+#if !ALLOC_GUARD_SANITIZED
+
+extern "C"
+{
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	void *__libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void *ptr);
+}
+
+static void note(const char *call)
+{
+	if (depth == 0)
+	{
+		return;
+	}
+	counted++;
+	lastRegion.store(region);
+	if (abortOnFirst.load())
+	{
+		depth = 0; // abort() may allocate on its way out
+		const char *parts[] = {"allocGuard: ", call, " in hot path '", region, "'\n"};
+		for (const char *p : parts)
+		{
+			ssize_t ignored = write(STDERR_FILENO, p, strlen(p));
+			(void)ignored;
+		}
+		abort();
+	}
+}
+
+extern "C"
+{
+	void *malloc(size_t size)
+	{
+		note("malloc");
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t count, size_t size)
+	{
+		note("calloc");
+		return __libc_calloc(count, size);
+	}
+
+	void *realloc(void *ptr, size_t size)
+	{
+		note("realloc");
+		return __libc_realloc(ptr, size);
+	}
+
+	void free(void *ptr)
+	{
+		__libc_free(ptr);
+	}
+
+	void *memalign(size_t alignment, size_t size)
+	{
+		note("memalign");
+		return __libc_memalign(alignment, size);
+	}
+
+	void *aligned_alloc(size_t alignment, size_t size)
+	{
+		note("aligned_alloc");
+		return __libc_memalign(alignment, size);
+	}
+
+	int posix_memalign(void **out, size_t alignment, size_t size)
+	{
+		note("posix_memalign");
+		if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+		{
+			return EINVAL;
+		}
+		void *p = __libc_memalign(alignment, size);
+		if (p == NULL)
+		{
+			return ENOMEM;
+		}
+		*out = p;
+		return 0;
+	}
+}
+
+#endif // !ALLOC_GUARD_SANITIZED
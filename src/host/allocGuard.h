@@ -0,0 +1,41 @@
+/**
+ * @file allocGuard.h
+ * @date 2025-10-08
+ * @brief Counts heap allocations made inside marked hot-path regions of the host build.
+ *
+ * The host build replaces malloc(), calloc(), realloc() and the aligned
+ * allocators, and so also operator new, with wrappers around glibc's own
+ * allocator. While a thread is inside a region, every allocation it makes is
+ * counted against the region. With allocGuardSetAbort(), the first one aborts,
+ * so a debugger or the sanitizers' stack trace shows where it came from.
+ * Sanitizer builds keep their own allocator and the guard is inactive there.
+ *
+ * Functions:
+ * - allocGuardActive(): false when the allocator could not be replaced.
+ * - allocGuardEnter() / allocGuardLeave(): Mark a hot-path region on this thread.
+ * - allocGuardCount(): Allocations made inside regions so far, all threads.
+ * - allocGuardLastRegion(): Region of the most recent counted allocation.
+ * - allocGuardSetAbort(): Abort on the first allocation inside a region.
+ */
+#ifndef ALLOC_GUARD_H
+#define ALLOC_GUARD_H
+
+#include <stdint.h>
+
+bool allocGuardActive();
+void allocGuardEnter(const char *region); // Regions nest; the innermost name is reported
+void allocGuardLeave();
+uint64_t allocGuardCount();
+const char *allocGuardLastRegion(); // NULL before the first counted allocation
+void allocGuardSetAbort(bool abortOnAlloc);
+
+// Marks the enclosing block as a region
+struct AllocGuardScope
+{
+	explicit AllocGuardScope(const char *region) { allocGuardEnter(region); }
+	~AllocGuardScope() { allocGuardLeave(); }
+	AllocGuardScope(const AllocGuardScope &) = delete;
+	AllocGuardScope &operator=(const AllocGuardScope &) = delete;
+};
+
+#endif // ALLOC_GUARD_H
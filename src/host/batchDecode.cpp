@@ -0,0 +1,328 @@
+/**
+ * @file batchDecode.cpp
+ * @date 2025-09-18
+ * @brief "batch" subcommand: run the receive chain over a corpus of WAV recordings.
+ *
+ * Every file and channel is cut into chunks of --chunk seconds. A task decodes
+ * one chunk with its own firDecimator and afskDemod, starting BATCH_OVERLAP_SECONDS
+ * early so the demodulator is locked and any frame crossing the boundary is
+ * complete. Chunks lie on a grid of whole demodulator blocks and a frame belongs
+ * to the chunk holding the block it ended in, so each frame is reported exactly
+ * once and the output does not depend on the thread count or scheduling. Only
+ * the FCS error count can move slightly with --chunk, as every chunk's
+ * demodulator locks in afresh on noise.
+ *
+ * Output (stdout): one line per frame "file<TAB>time<TAB>port<TAB>hex", sorted by
+ * file, end time and port, then "#" summary lines. Timing goes to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "afskDemod.h"
+#include "firDecimator.h"
+#include "hostTools.h"
+#include "wavFile.h"
+#include "workPool.h"
+
+#define BATCH_DEMOD_RATE 9600		// Target demodulator rate, as in the firmware
+#define BATCH_BLOCK_SAMPLES 96		// Demodulator block, as AUDIO_BLOCK_SAMPLES
+#define BATCH_OVERLAP_SECONDS 3.0	// Longer than the longest frame (330 bytes at 1200 bd) plus lock-in
+#define BATCH_DEFAULT_CHUNK 60.0	// Seconds per task
+#define BATCH_MARK_FREQ 1200
+#define BATCH_SPACE_FREQ 2200
+#define BATCH_BAUD_RATE 1200
+
+// One input file and its chunk grid
+typedef struct
+{
+	const char *path;
+	wav_file_t wav;
+	uint32_t decimation;   // Input samples per demodulator sample
+	uint32_t demodRate;	   // sampleRate / decimation
+	size_t blockFrames;	   // Input frames per demodulator block
+	size_t chunkFrames;	   // Multiple of blockFrames
+	size_t overlapFrames;  // Multiple of blockFrames
+	size_t chunks;
+} batch_file_t;
+
+// One decoded frame, positioned by the input frame its last block ended on
+struct BatchFrame
+{
+	size_t file;
+	uint16_t channel;
+	size_t endFrame;
+	std::vector<uint8_t> data;
+};
+
+// Result of one chunk
+struct BatchResult
+{
+	std::vector<BatchFrame> frames;
+	uint32_t fcsErrors = 0;
+};
+
+// Task number -> file, channel and chunk
+struct BatchTask
+{
+	size_t file;
+	uint16_t channel;
+	size_t chunk;
+};
+
+// Frame callback context
+struct ChunkContext
+{
+	BatchResult *result;
+	size_t file;
+	size_t blockEnd; // End frame of the block being demodulated
+	size_t ownFrom;	 // Frames ending after this belong to the chunk
+};
+
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	ChunkContext *c = (ChunkContext *)ctx;
+	if (c->blockEnd <= c->ownFrom)
+	{
+		return; // Ended in the overlap, the previous chunk reports it
+	}
+	BatchFrame f;
+	f.file = c->file;
+	f.channel = port;
+	f.endFrame = c->blockEnd;
+	f.data.assign(frame, frame + len);
+	c->result->frames.push_back(std::move(f));
+}
+
+/**
+ * @brief Choose the decimation and chunk grid of a file
+ */
+static void planFile(batch_file_t *f, double chunkSeconds)
+{
+	uint32_t rate = f->wav.sampleRate;
+	f->decimation = rate >= 2 * BATCH_DEMOD_RATE ? rate / BATCH_DEMOD_RATE : 1;
+	f->demodRate = (rate + f->decimation / 2) / f->decimation;
+	f->blockFrames = (size_t)BATCH_BLOCK_SAMPLES * f->decimation;
+
+	size_t chunkBlocks = (size_t)(chunkSeconds * rate / f->blockFrames);
+	size_t overlapBlocks = (size_t)(BATCH_OVERLAP_SECONDS * rate / f->blockFrames) + 1;
+	f->chunkFrames = (chunkBlocks ? chunkBlocks : 1) * f->blockFrames;
+	f->overlapFrames = overlapBlocks * f->blockFrames;
+	f->chunks = f->wav.frames ? (f->wav.frames + f->chunkFrames - 1) / f->chunkFrames : 0;
+}
+
+/**
+ * @brief Decode one chunk of one channel
+ */
+static void decodeChunk(const batch_file_t *f, size_t fileIndex, uint16_t channel, size_t chunk, BatchResult *result)
+{
+	size_t ownFrom = chunk * f->chunkFrames;
+	size_t from = ownFrom > f->overlapFrames ? ownFrom - f->overlapFrames : 0;
+	size_t end = std::min(ownFrom + f->chunkFrames, f->wav.frames);
+
+	ChunkContext ctx = {result, fileIndex, from, ownFrom};
+	afsk_profile_t profile = {BATCH_MARK_FREQ, BATCH_SPACE_FREQ, BATCH_BAUD_RATE, f->demodRate};
+	afsk_demod_t demod;
+	if (!afskDemodInit(&demod, &profile, (uint8_t)channel, onFrame, &ctx))
+	{
+		return;
+	}
+
+	// Same anti-alias filter design as the firmware's capture paths
+	fir_decimator_t fir;
+	bool decimate = f->decimation > 1;
+	if (decimate)
+	{
+		uint8_t taps = (uint8_t)std::min<uint32_t>(FIR_DECIMATOR_MAX_TAPS, 8 * f->decimation);
+		firDecimatorInit(&fir, (uint8_t)f->decimation, taps, 4000.0f / f->wav.sampleRate);
+	}
+
+	std::vector<int16_t> input(f->blockFrames);
+	std::vector<int16_t> output(f->blockFrames / f->decimation + 1);
+	uint32_t errorsAtOwn = 0;
+	for (size_t pos = from; pos < end; pos += f->blockFrames)
+	{
+		if (pos == ownFrom)
+		{
+			errorsAtOwn = demod.hdlc.fcsErrors;
+		}
+		size_t n = wavRead(&f->wav, channel, pos, std::min(f->blockFrames, end - pos), input.data());
+		ctx.blockEnd = pos + n;
+		if (decimate)
+		{
+			size_t produced = firDecimatorProcess(&fir, input.data(), n, output.data());
+			afskDemodProcess(&demod, output.data(), produced);
+		}
+		else
+		{
+			afskDemodProcess(&demod, input.data(), n);
+		}
+	}
+	result->fcsErrors = demod.hdlc.fcsErrors - errorsAtOwn;
+}
+
+/**
+ * @brief Format an input frame position as h:mm:ss.sss
+ */
+static void formatTime(char *out, size_t size, size_t frame, uint32_t rate)
+{
+	uint64_t ms = (uint64_t)frame * 1000 / rate;
+	snprintf(out, size, "%u:%02u:%02u.%03u", (unsigned)(ms / 3600000), (unsigned)(ms / 60000 % 60),
+			 (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+}
+
+static void batchUsage()
+{
+	fprintf(stderr,
+			"usage: batch [-j threads] [--chunk seconds] [--quiet] file.wav...\n"
+			"  -j N         worker threads (default: all hardware threads)\n"
+			"  --chunk S    seconds of audio per task (default %.0f)\n"
+			"  --quiet      print the summary only\n",
+			BATCH_DEFAULT_CHUNK);
+}
+
+/**
+ * @brief Decode WAV recordings in parallel and print a merged frame list
+ * @param argc Argument count, argv[0] is "batch"
+ * @param argv Options and file names
+ * @return 0 on success, 1 if a file could not be read, 2 on a usage error
+ */
+int batchMain(int argc, char **argv)
+{
+	unsigned threads = 0;
+	double chunkSeconds = BATCH_DEFAULT_CHUNK;
+	bool quiet = false;
+	std::vector<batch_file_t> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			threads = (unsigned)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc)
+		{
+			chunkSeconds = strtod(argv[++i], NULL);
+		}
+		else if (strcmp(argv[i], "--quiet") == 0)
+		{
+			quiet = true;
+		}
+		else if (argv[i][0] == '-')
+		{
+			batchUsage();
+			return 2;
+		}
+		else
+		{
+			batch_file_t f = {};
+			f.path = argv[i];
+			files.push_back(f);
+		}
+	}
+	if (files.empty() || chunkSeconds <= 0)
+	{
+		batchUsage();
+		return 2;
+	}
+
+	// Open everything up front; a bad file is reported and skipped
+	int status = 0;
+	std::vector<BatchTask> tasks;
+	double audioSeconds = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		batch_file_t *f = &files[i];
+		if (!wavOpen(&f->wav, f->path))
+		{
+			fprintf(stderr, "%s: %s\n", f->path, f->wav.error);
+			status = 1;
+			continue;
+		}
+		planFile(f, chunkSeconds);
+		audioSeconds += (double)f->wav.frames * f->wav.channels / f->wav.sampleRate;
+		for (uint16_t ch = 0; ch < f->wav.channels; ch++)
+		{
+			for (size_t c = 0; c < f->chunks; c++)
+			{
+				tasks.push_back({i, ch, c});
+			}
+		}
+	}
+
+	// The demodulator's shared tables are built by the first init; do it before the workers start
+	afsk_profile_t warmup = {BATCH_MARK_FREQ, BATCH_SPACE_FREQ, BATCH_BAUD_RATE, BATCH_DEMOD_RATE};
+	afsk_demod_t scratch;
+	afskDemodInit(&scratch, &warmup, 0, NULL, NULL);
+
+	std::vector<BatchResult> results(tasks.size());
+	work_pool_stats_t poolStats = {};
+	auto started = std::chrono::steady_clock::now();
+	workPoolRun(
+		tasks.size(), threads,
+		[&](size_t t, unsigned worker)
+		{
+			(void)worker;
+			const BatchTask &task = tasks[t];
+			decodeChunk(&files[task.file], task.file, task.channel, task.chunk, &results[t]);
+		},
+		&poolStats);
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	// Merge in a fixed order
+	std::vector<BatchFrame> frames;
+	uint64_t fcsErrors = 0;
+	for (BatchResult &r : results)
+	{
+		fcsErrors += r.fcsErrors;
+		for (BatchFrame &f : r.frames)
+		{
+			frames.push_back(std::move(f));
+		}
+	}
+	std::stable_sort(frames.begin(), frames.end(), [](const BatchFrame &a, const BatchFrame &b)
+					 {
+						 if (a.file != b.file)
+							 return a.file < b.file;
+						 if (a.endFrame != b.endFrame)
+							 return a.endFrame < b.endFrame;
+						 return a.channel < b.channel; });
+
+	std::unordered_set<std::string> unique;
+	std::string hex;
+	for (const BatchFrame &f : frames)
+	{
+		unique.insert(std::string(f.data.begin(), f.data.end()));
+		if (quiet)
+		{
+			continue;
+		}
+		char time[24];
+		formatTime(time, sizeof(time), f.endFrame, files[f.file].wav.sampleRate);
+		hex.clear();
+		for (uint8_t b : f.data)
+		{
+			static const char digits[] = "0123456789abcdef";
+			hex += digits[b >> 4];
+			hex += digits[b & 0x0F];
+		}
+		printf("%s\t%s\t%u\t%s\n", files[f.file].path, time, f.channel, hex.c_str());
+	}
+
+	printf("# files %zu, audio %.2f h, frames %zu, unique %zu, fcs errors %llu\n", files.size(),
+		   audioSeconds / 3600.0, frames.size(), unique.size(), (unsigned long long)fcsErrors);
+	fprintf(stderr, "# %.2f s wall, %.0fx realtime, %u threads, %llu tasks, %llu stolen\n", wallSeconds,
+			wallSeconds > 0 ? audioSeconds / wallSeconds : 0.0, poolStats.threads,
+			(unsigned long long)poolStats.tasks, (unsigned long long)poolStats.steals);
+
+	for (batch_file_t &f : files)
+	{
+		wavClose(&f.wav);
+	}
+	return status;
+}
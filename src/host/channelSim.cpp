@@ -0,0 +1,389 @@
+/**
+ * @file channelSim.cpp
+ * @date 2025-09-30
+ * @brief "sim" subcommand: stations running the firmware's channel access on a shared virtual channel.
+ *
+ * Every station is a csma.h instance with its own transmit queue, driven by the
+ * clockHal virtual clock, so hours of channel activity run in seconds and the
+ * same seed gives the same run event for event. Frames arrive at each station
+ * as a Poisson process; their airtime is TXDELAY plus the length of the
+ * hdlcEncode() output at the baud rate.
+ *
+ * The channel is a single collision domain: a station hears another one
+ * --dcd-ms after it keys up (the demodulator's DCD latency), and any two
+ * overlapping transmissions are both lost.
+ *
+ * Output: per-station counters, then channel totals, offered load G, throughput
+ * S (delivered airtime / time), latency percentiles and a digest of the event
+ * sequence for comparing runs.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#include "clockHal.h"
+#include "csma.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define SIM_MAX_STATIONS 256
+#define SIM_DEFAULT_STATIONS 10
+#define SIM_DEFAULT_RATE 2.0  // Frames per station per minute
+#define SIM_DEFAULT_HOURS 1.0
+#define SIM_DEFAULT_MIN_BYTES 40
+#define SIM_DEFAULT_MAX_BYTES 120
+#define SIM_DEFAULT_DCD_MS 20 // Flags the demodulator needs before DCD asserts
+#define SIM_DEFAULT_QUEUE 8
+#define SIM_BAUD_RATE 1200
+
+typedef struct
+{
+	uint64_t queuedUs;
+	uint64_t airUs; // Keyup and frame
+} sim_frame_t;
+
+struct SimStation
+{
+	unsigned index;
+	csma_t csma;
+	clock_timer_t arrival;
+	clock_timer_t endOfTx;
+	std::deque<sim_frame_t> queue;
+	bool transmitting;
+	bool collided;
+	uint64_t txStartUs;
+	sim_frame_t current;
+	uint32_t offered;
+	uint32_t dropped;
+	uint32_t sent;
+	uint32_t delivered;
+};
+
+struct Sim
+{
+	std::vector<SimStation> stations;
+	std::vector<SimStation *> onAir;
+	std::mt19937 rng;
+	double arrivalRatePerUs;
+	size_t minBytes;
+	size_t maxBytes;
+	size_t queueLimit;
+	uint64_t dcdDelayUs;
+	uint64_t offeredAirUs;
+	uint64_t deliveredAirUs;
+	uint64_t busyUs; // Time with at least one station keyed
+	uint64_t busySinceUs;
+	uint32_t collisions; // Transmissions lost to overlap
+	std::vector<uint64_t> latencyUs; // Queued to end of transmission, delivered frames
+	uint64_t digest;
+};
+
+static Sim *sim;
+
+/**
+ * @brief Mix an event into the run digest (FNV-1a)
+ */
+static void digestEvent(uint64_t a, uint64_t b)
+{
+	for (uint64_t v : {a, b})
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			sim->digest ^= (v >> (8 * i)) & 0xFF;
+			sim->digest *= 0x100000001B3ULL;
+		}
+	}
+}
+
+/**
+ * @brief Uniform draw in [0, 1) from the run's generator, identical on every platform
+ */
+static double uniform()
+{
+	return (sim->rng() >> 5) * (1.0 / 134217728.0);
+}
+
+/**
+ * @brief Airtime of a random frame: TXDELAY, then the encoder's line bits
+ */
+static uint64_t frameAirUs(const SimStation *s)
+{
+	size_t len = sim->minBytes + sim->rng() % (sim->maxBytes - sim->minBytes + 1);
+	uint8_t frame[HDLC_MAX_FRAME];
+	static uint8_t levels[HDLC_ENCODED_LEVELS(HDLC_MAX_FRAME, 1)];
+	for (size_t i = 0; i < len; i++)
+	{
+		frame[i] = (uint8_t)sim->rng();
+	}
+	size_t bits = hdlcEncode(frame, len, 1, levels, sizeof(levels));
+	return csmaTxDelayUs(&s->csma) + (uint64_t)bits * 1000000 / SIM_BAUD_RATE;
+}
+
+static bool channelBusy(void *ctx)
+{
+	const SimStation *s = (const SimStation *)ctx;
+	uint64_t now = clockMicros();
+	for (const SimStation *other : sim->onAir)
+	{
+		if (other != s && now >= other->txStartUs + sim->dcdDelayUs)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Access granted: key up and mark every overlap as a collision
+ */
+static void startTransmission(void *ctx)
+{
+	SimStation *s = (SimStation *)ctx;
+	uint64_t now = clockMicros();
+	s->current = s->queue.front();
+	s->queue.pop_front();
+	s->transmitting = true;
+	s->collided = false;
+	s->txStartUs = now;
+	s->sent++;
+
+	if (sim->onAir.empty())
+	{
+		sim->busySinceUs = now;
+	}
+	for (SimStation *other : sim->onAir)
+	{
+		other->collided = true;
+		s->collided = true;
+	}
+	sim->onAir.push_back(s);
+	digestEvent(now, s->index);
+	clockTimerStart(&s->endOfTx, s->current.airUs);
+}
+
+static void endTransmission(void *ctx)
+{
+	SimStation *s = (SimStation *)ctx;
+	uint64_t now = clockMicros();
+	sim->onAir.erase(std::find(sim->onAir.begin(), sim->onAir.end(), s));
+	if (sim->onAir.empty())
+	{
+		sim->busyUs += now - sim->busySinceUs;
+	}
+	s->transmitting = false;
+
+	if (s->collided)
+	{
+		sim->collisions++;
+	}
+	else
+	{
+		s->delivered++;
+		sim->deliveredAirUs += s->current.airUs;
+		sim->latencyUs.push_back(now - s->current.queuedUs);
+	}
+	digestEvent(now, s->index | (s->collided ? 0x10000 : 0));
+
+	if (!s->queue.empty())
+	{
+		csmaRequest(&s->csma);
+	}
+}
+
+/**
+ * @brief A frame from the station's client; schedule the next arrival
+ */
+static void frameArrives(void *ctx)
+{
+	SimStation *s = (SimStation *)ctx;
+	s->offered++;
+	if (s->queue.size() >= sim->queueLimit)
+	{
+		s->dropped++;
+	}
+	else
+	{
+		sim_frame_t f = {clockMicros(), frameAirUs(s)};
+		sim->offeredAirUs += f.airUs;
+		s->queue.push_back(f);
+		if (!s->transmitting)
+		{
+			csmaRequest(&s->csma);
+		}
+	}
+	clockTimerStart(&s->arrival, (uint64_t)(-log(1.0 - uniform()) / sim->arrivalRatePerUs));
+}
+
+static uint64_t percentile(std::vector<uint64_t> &v, double p)
+{
+	if (v.empty())
+	{
+		return 0;
+	}
+	size_t k = std::min(v.size() - 1, (size_t)(p * v.size()));
+	std::nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+static void simUsage()
+{
+	fprintf(stderr,
+			"usage: sim [options]\n"
+			"  --stations N     stations on the channel (default %d)\n"
+			"  --rate F         frames per station per minute (default %.1f)\n"
+			"  --bytes MIN:MAX  frame length range (default %d:%d)\n"
+			"  --hours H        simulated time (default %.1f)\n"
+			"  --txdelay N      KISS TXDELAY, 10 ms units (default %d)\n"
+			"  --persist N      KISS PERSIST, 0-255 (default %d)\n"
+			"  --slottime N     KISS SLOTTIME, 10 ms units (default %d)\n"
+			"  --dcd-ms MS      carrier detect latency (default %d)\n"
+			"  --queue N        frames a station holds before dropping (default %d)\n"
+			"  --seed N         random seed (default 1)\n"
+			"  --quiet          totals only\n",
+			SIM_DEFAULT_STATIONS, SIM_DEFAULT_RATE, SIM_DEFAULT_MIN_BYTES, SIM_DEFAULT_MAX_BYTES, SIM_DEFAULT_HOURS,
+			CSMA_DEFAULT_TXDELAY, CSMA_DEFAULT_PERSIST, CSMA_DEFAULT_SLOTTIME, SIM_DEFAULT_DCD_MS, SIM_DEFAULT_QUEUE);
+}
+
+/**
+ * @brief "sim" subcommand
+ * @param argc Argument count, argv[0] is "sim"
+ * @param argv Options
+ * @return 0 on success, 2 on a usage error
+ */
+int simMain(int argc, char **argv)
+{
+	unsigned stations = SIM_DEFAULT_STATIONS;
+	double rate = SIM_DEFAULT_RATE;
+	double hours = SIM_DEFAULT_HOURS;
+	int txDelay = CSMA_DEFAULT_TXDELAY;
+	int persist = CSMA_DEFAULT_PERSIST;
+	int slotTime = CSMA_DEFAULT_SLOTTIME;
+	unsigned dcdMs = SIM_DEFAULT_DCD_MS;
+	unsigned seed = 1;
+	bool quiet = false;
+	Sim s = {};
+	s.minBytes = SIM_DEFAULT_MIN_BYTES;
+	s.maxBytes = SIM_DEFAULT_MAX_BYTES;
+	s.queueLimit = SIM_DEFAULT_QUEUE;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--stations") == 0 && more)
+			stations = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--rate") == 0 && more)
+			rate = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--bytes") == 0 && more)
+		{
+			char *end;
+			s.minBytes = strtoul(argv[++i], &end, 10);
+			s.maxBytes = *end == ':' ? strtoul(end + 1, NULL, 10) : s.minBytes;
+		}
+		else if (strcmp(argv[i], "--hours") == 0 && more)
+			hours = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--txdelay") == 0 && more)
+			txDelay = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--persist") == 0 && more)
+			persist = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--slottime") == 0 && more)
+			slotTime = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--dcd-ms") == 0 && more)
+			dcdMs = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--queue") == 0 && more)
+			s.queueLimit = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else
+		{
+			simUsage();
+			return 2;
+		}
+	}
+	if (stations == 0 || stations > SIM_MAX_STATIONS || rate <= 0 || hours <= 0 ||
+		s.minBytes < HDLC_MIN_FRAME - 2 || s.maxBytes < s.minBytes || s.maxBytes > HDLC_MAX_FRAME - 2 ||
+		txDelay < 0 || txDelay > 255 || persist < 0 || persist > 255 || slotTime < 0 || slotTime > 255 ||
+		s.queueLimit == 0)
+	{
+		simUsage();
+		return 2;
+	}
+
+	sim = &s;
+	s.rng.seed(seed);
+	s.arrivalRatePerUs = rate / 60e6;
+	s.dcdDelayUs = (uint64_t)dcdMs * 1000;
+	s.digest = 0xCBF29CE484222325ULL;
+	s.stations.resize(stations);
+	clockReset();
+
+	for (unsigned i = 0; i < stations; i++)
+	{
+		SimStation *st = &s.stations[i];
+		st->index = i;
+		csmaInit(&st->csma, channelBusy, startTransmission, st, (uint32_t)s.rng());
+		csmaSetParam(&st->csma, KISS_CMD_TXDELAY, (uint8_t)txDelay);
+		csmaSetParam(&st->csma, KISS_CMD_PERSIST, (uint8_t)persist);
+		csmaSetParam(&st->csma, KISS_CMD_SLOTTIME, (uint8_t)slotTime);
+		clockTimerInit(&st->arrival, frameArrives, st);
+		clockTimerInit(&st->endOfTx, endTransmission, st);
+		clockTimerStart(&st->arrival, (uint64_t)(-log(1.0 - uniform()) / s.arrivalRatePerUs));
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	uint64_t durationUs = (uint64_t)(hours * 3600e6);
+	size_t events = clockAdvance(durationUs);
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	if (!s.onAir.empty())
+	{
+		s.busyUs += durationUs - s.busySinceUs; // Still keyed at the end
+	}
+
+	uint32_t offered = 0, dropped = 0, sent = 0, delivered = 0;
+	uint64_t accessUs = 0, grants = 0, busySlots = 0, deferredSlots = 0;
+	for (const SimStation &st : s.stations)
+	{
+		if (!quiet)
+		{
+			printf("station %3u: offered %6u dropped %5u sent %6u delivered %6u busy slots %7u deferred %7u "
+				   "mean access %6.0f ms\n",
+				   st.index, st.offered, st.dropped, st.sent, st.delivered, st.csma.busySlots, st.csma.deferredSlots,
+				   st.csma.grants ? st.csma.accessDelayUs / 1000.0 / st.csma.grants : 0.0);
+		}
+		offered += st.offered;
+		dropped += st.dropped;
+		sent += st.sent;
+		delivered += st.delivered;
+		accessUs += st.csma.accessDelayUs;
+		grants += st.csma.grants;
+		busySlots += st.csma.busySlots;
+		deferredSlots += st.csma.deferredSlots;
+	}
+
+	double seconds = durationUs / 1e6;
+	printf("# %u stations, %.2f h, txdelay %d, persist %d, slottime %d, dcd %u ms, seed %u\n", stations, hours,
+		   txDelay, persist, slotTime, dcdMs, seed);
+	printf("# offered %u, dropped %u, sent %u, delivered %u, collisions %u (%.1f%% of sent)\n", offered, dropped, sent,
+		   delivered, s.collisions, sent ? 100.0 * s.collisions / sent : 0.0);
+	printf("# G %.3f, S %.3f, channel busy %.1f%%, busy slots %llu, deferred slots %llu, mean access %.0f ms\n",
+		   s.offeredAirUs / 1e6 / seconds, s.deliveredAirUs / 1e6 / seconds, 100.0 * s.busyUs / durationUs,
+		   (unsigned long long)busySlots, (unsigned long long)deferredSlots, grants ? accessUs / 1000.0 / grants : 0.0);
+	printf("# latency ms p50 %.0f, p90 %.0f, p99 %.0f, max %.0f\n", percentile(s.latencyUs, 0.5) / 1000.0,
+		   percentile(s.latencyUs, 0.9) / 1000.0, percentile(s.latencyUs, 0.99) / 1000.0,
+		   percentile(s.latencyUs, 1.0) / 1000.0);
+	printf("# digest %016llx\n", (unsigned long long)s.digest);
+	fprintf(stderr, "# %zu events in %.2f s wall, %.0fx realtime\n", events, wallSeconds,
+			wallSeconds > 0 ? seconds / wallSeconds : 0.0);
+
+	clockReset();
+	sim = NULL;
+	return 0;
+}
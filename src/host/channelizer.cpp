@@ -0,0 +1,144 @@
+/**
+ * @file channelizer.cpp
+ * @date 2025-10-02
+ * @brief Polyphase DFT filter bank splitting complex baseband into evenly spaced channels.
+ *
+ * Channel k of the downconverted and filtered input, at output n (input time nD):
+ *
+ *   y_k[n] = sum_m h[m] x[nD - m] exp(-j 2 pi k (nD - m) / M)
+ *          = exp(-j 2 pi k n D / M) * sum_r v_r[n] exp(j 2 pi k r / M)
+ *
+ * with branch sums v_r[n] = sum_p h[pM + r] x[nD - pM - r]. For D = M / 2 the
+ * leading factor is (-1)^(k n).
+ */
+
+#include "channelizer.h"
+
+#include <math.h>
+
+/**
+ * @brief Design the filter bank
+ * @param c Channelizer state
+ * @param channels M, even, at least 2
+ * @param tapsPerBranch Prototype length / M; 8 to 16 is usual
+ * @return false if the parameters are out of range
+ */
+bool channelizerInit(channelizer_t *c, uint32_t channels, uint32_t tapsPerBranch)
+{
+	if (channels < 2 || channels % 2 != 0 || tapsPerBranch < 2 || tapsPerBranch > 64)
+	{
+		return false;
+	}
+	c->channels = channels;
+	c->decimation = channels / 2;
+	c->taps = channels * tapsPerBranch;
+	c->pos = 0;
+	c->phase = 0;
+	c->outputs = 0;
+
+	// Blackman-windowed sinc, cutoff at 0.45 channel spacings, unity DC gain
+	std::vector<float> h(c->taps);
+	double cutoff = 0.45 / channels;
+	double center = (c->taps - 1) / 2.0;
+	double sum = 0.0;
+	for (uint32_t i = 0; i < c->taps; i++)
+	{
+		double t = i - center;
+		double sinc = t == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+		double x = 2.0 * M_PI * i / (c->taps - 1);
+		double window = 0.42 - 0.5 * cos(x) + 0.08 * cos(2.0 * x);
+		h[i] = (float)(sinc * window);
+		sum += h[i];
+	}
+	c->prototype.resize(c->taps);
+	for (uint32_t i = 0; i < c->taps; i++)
+	{
+		c->prototype[i] = (float)(h[c->taps - 1 - i] / sum); // Reversed: lines up with the oldest-first window
+	}
+
+	c->history.assign(2 * c->taps, iq_t(0.0f, 0.0f));
+	c->twiddle.resize(channels);
+	for (uint32_t q = 0; q < channels; q++)
+	{
+		double a = 2.0 * M_PI * q / channels;
+		c->twiddle[q] = iq_t((float)cos(a), (float)sin(a));
+	}
+	return true;
+}
+
+/**
+ * @brief Push complex input samples
+ * @param c Channelizer state
+ * @param in Input samples
+ * @param count Number of input samples
+ * @param branches Receives M branch sums per output, appended
+ * @param first Receives the index of the first output produced (for channelizerBin)
+ * @return Number of outputs produced
+ */
+size_t channelizerProcess(channelizer_t *c, const iq_t *in, size_t count, std::vector<iq_t> *branches,
+						  uint64_t *first)
+{
+	const uint32_t M = c->channels;
+	const uint32_t L = c->taps;
+	size_t produced = 0;
+	*first = c->outputs;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		c->history[c->pos] = in[i];
+		c->history[c->pos + L] = in[i];
+		if (++c->pos >= L)
+		{
+			c->pos = 0;
+		}
+		if (++c->phase < c->decimation)
+		{
+			continue;
+		}
+		c->phase = 0;
+
+		// Window w[0..L-1], oldest first. Index j feeds branch r = M - 1 - (j mod M).
+		const iq_t *w = &c->history[c->pos];
+		size_t base = branches->size();
+		branches->resize(base + M);
+		iq_t *v = &(*branches)[base];
+		for (uint32_t j0 = 0; j0 < M; j0++)
+		{
+			float re = 0.0f, im = 0.0f;
+			for (uint32_t j = j0; j < L; j += M)
+			{
+				re += c->prototype[j] * w[j].real();
+				im += c->prototype[j] * w[j].imag();
+			}
+			v[M - 1 - j0] = iq_t(re, im);
+		}
+		produced++;
+		c->outputs++;
+	}
+	return produced;
+}
+
+/**
+ * @brief Compute one channel's output from one output's branch sums
+ * @param c Channelizer state
+ * @param branches M branch sums of one output
+ * @param channel Channel number k
+ * @param output Index of the output (from channelizerProcess)
+ * @return Channel sample, unit gain in the passband
+ */
+iq_t channelizerBin(const channelizer_t *c, const iq_t *branches, uint32_t channel, uint64_t output)
+{
+	const uint32_t M = c->channels;
+	iq_t acc(0.0f, 0.0f);
+	uint32_t q = 0;
+	for (uint32_t r = 0; r < M; r++)
+	{
+		acc += branches[r] * c->twiddle[q];
+		q += channel;
+		if (q >= M)
+		{
+			q -= M;
+		}
+	}
+	return (channel & output & 1) ? -acc : acc;
+}
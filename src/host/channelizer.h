@@ -0,0 +1,76 @@
+/**
+ * @file channelizer.h
+ * @date 2025-10-02
+ * @brief Polyphase DFT filter bank splitting complex baseband into evenly spaced channels.
+ *
+ * M channels spaced rate / M apart are produced at rate / (M / 2), i.e. two
+ * times oversampled, so a narrowband FM signal near a channel edge is not
+ * folded back into the channel. The prototype low-pass is shared by all
+ * channels; per output, channelizerProcess() does the M polyphase branch
+ * sums once, and channelizerBin() turns those into any one channel with an
+ * M-point DFT row. That split lets the cheap shared part run once and the
+ * per-channel part run on as many threads as there are channel groups.
+ *
+ * Channel k is centred at k * rate / M from the input centre frequency, with
+ * k = M/2..M-1 standing for the negative offsets.
+ *
+ * Functions:
+ * - channelizerInit(): Design the prototype filter for M channels.
+ * - channelizerProcess(): Push complex input, emit branch sums for each output.
+ * - channelizerBin(): One channel's output sample from a set of branch sums.
+ */
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <complex>
+#include <vector>
+
+typedef std::complex<float> iq_t;
+
+typedef struct
+{
+	uint32_t channels;			  // M, even
+	uint32_t decimation;		  // M / 2
+	uint32_t taps;				  // M * taps per branch
+	std::vector<float> prototype; // Time-reversed low-pass
+	std::vector<iq_t> history;	  // Input, stored twice for a contiguous window
+	std::vector<iq_t> twiddle;	  // exp(j * 2 * pi * q / M)
+	size_t pos;
+	uint32_t phase;
+	uint64_t outputs; // Outputs produced, selects the (-1)^(k * n) correction
+} channelizer_t;
+
+/**
+ * @brief Design the filter bank
+ * @param c Channelizer state
+ * @param channels M, even, at least 2
+ * @param tapsPerBranch Prototype length / M; 8 to 16 is usual
+ * @return false if the parameters are out of range
+ */
+bool channelizerInit(channelizer_t *c, uint32_t channels, uint32_t tapsPerBranch);
+
+/**
+ * @brief Push complex input samples
+ * @param c Channelizer state
+ * @param in Input samples
+ * @param count Number of input samples
+ * @param branches Receives M branch sums per output, appended
+ * @param first Receives the index of the first output produced (for channelizerBin)
+ * @return Number of outputs produced
+ */
+size_t channelizerProcess(channelizer_t *c, const iq_t *in, size_t count, std::vector<iq_t> *branches,
+						  uint64_t *first);
+
+/**
+ * @brief Compute one channel's output from one output's branch sums
+ * @param c Channelizer state
+ * @param branches M branch sums of one output
+ * @param channel Channel number k
+ * @param output Index of the output (from channelizerProcess)
+ * @return Channel sample, unit gain in the passband
+ */
+iq_t channelizerBin(const channelizer_t *c, const iq_t *branches, uint32_t channel, uint64_t output);
+
+#endif // CHANNELIZER_H
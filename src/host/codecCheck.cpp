@@ -0,0 +1,341 @@
+/**
+ * @file codecCheck.cpp
+ * @date 2025-10-18
+ * @brief "codec" subcommand: check the I2S codec register setup and block flow with a mock codec.
+ *
+ * - init: codecInit() writes into a recording codec_bus_t. Each chip's
+ *   transactions must follow its datasheet power-up order, restated here
+ *   register by register: the I2C address, the register and value of each
+ *   write, and the settling delays. WM8960 writes are decoded from their 9-bit
+ *   packing (register in bits 7..1 of the first byte, value bit 8 in bit 0), and
+ *   the right register of each volume pair must carry the update bit. A bus
+ *   that stops acknowledging must stop the sequence and fail it.
+ * - blocks: AFSK frames rendered at AUDIO_CODEC_SAMPLE_RATE go through the
+ *   same steps as the firmware's codec path: duplicated into stereo frames in
+ *   CODEC_FRAMES_PER_READ chunks as audioWriteBlock() does, looped back,
+ *   split into left and right as captureCodec() does, decimated to 9600 Hz and
+ *   demodulated in AUDIO_BLOCK_SAMPLES blocks. No sample may be lost and both
+ *   channels must decode every frame.
+ * Exits 1 if any check fails.
+ */
+
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "audioCodec.h"
+#include "firDecimator.h"
+#include "hdlc.h"
+#include "hostTools.h"
+
+#define CODEC_RATE 48000			// As AUDIO_CODEC_SAMPLE_RATE
+#define CODEC_RX_RATE 9600			// As AUDIO_RX_SAMPLE_RATE
+#define CODEC_DECIMATION (CODEC_RATE / CODEC_RX_RATE)
+#define CODEC_FRAMES_PER_READ 240	// As in audioHal.cpp
+#define CODEC_RX_BLOCK 96			// As AUDIO_BLOCK_SAMPLES
+#define CODEC_TONE_LEVEL 16384
+#define CODEC_PREAMBLE_FLAGS 25
+#define CODEC_FRAME_BYTES 64
+#define CODEC_TEST_FRAMES 20
+
+// One step of an init sequence: a register write and the delay after it
+typedef struct
+{
+	uint8_t reg;
+	uint16_t value;
+	uint32_t delayMs; // Settling delay expected after the write, 0 for none
+	const char *what;
+} codec_step_t;
+
+// What the mock bus saw
+typedef struct
+{
+	uint8_t address;
+	uint8_t data[2];
+	size_t len;
+	uint32_t delayMs; // Delay requested after this write
+} codec_write_t;
+
+typedef struct
+{
+	std::vector<codec_write_t> writes;
+	size_t nackAt; // Write that is not acknowledged, SIZE_MAX for none
+} codec_mock_t;
+
+// WM8960 datasheet power-up: reset, VMID and references with time to charge,
+// then the analog blocks, clocking and format, paths and volumes with the
+// update bit on the second register of each pair, and the DAC unmute last.
+static const codec_step_t wm8960Order[] = {
+	{0x0F, 0x000, 10, "reset"},
+	{0x19, 0x0FC, 100, "power 1: VMID, VREF, inputs, ADCs"},
+	{0x1A, 0x1E0, 0, "power 2: DACs, LOUT1, ROUT1"},
+	{0x2F, 0x03C, 0, "power 3: input PGAs, output mixers"},
+	{0x04, 0x000, 0, "clocking: SYSCLK = MCLK"},
+	{0x07, 0x002, 0, "interface: slave, I2S, 16 bits"},
+	{0x20, 0x108, 0, "left input to boost mixer"},
+	{0x21, 0x108, 0, "right input to boost mixer"},
+	{0x00, 0x117, 0, "left input volume"},
+	{0x01, 0x117, 0, "right input volume, IPVU"},
+	{0x15, 0x0C3, 0, "left ADC volume"},
+	{0x16, 0x1C3, 0, "right ADC volume, ADCVU"},
+	{0x22, 0x100, 0, "left DAC to left output mixer"},
+	{0x25, 0x100, 0, "right DAC to right output mixer"},
+	{0x0A, 0x0FF, 0, "left DAC volume"},
+	{0x0B, 0x1FF, 0, "right DAC volume, DACVU"},
+	{0x02, 0x079, 0, "LOUT1 volume"},
+	{0x03, 0x179, 0, "ROUT1 volume, OUT1VU"},
+	{0x05, 0x000, 0, "DAC soft mute off"},
+};
+
+// WM8960 volume pairs: the right register must set the update bit (bit 8)
+static const uint8_t wm8960UpdateRegs[] = {0x01, 0x16, 0x0B, 0x03};
+
+// ES8388 datasheet start-up: slave mode, state machines held in reset while
+// the references, powers, formats, volumes and mixers are set, then released
+// with time to settle.
+static const codec_step_t es8388Order[] = {
+	{0x08, 0x00, 0, "slave mode"},
+	{0x02, 0xF3, 0, "hold state machines in reset"},
+	{0x2B, 0x80, 0, "ADC and DAC share LRCK"},
+	{0x00, 0x05, 0, "play and record, VMID 500k"},
+	{0x01, 0x40, 0, "low power reference off"},
+	{0x03, 0x00, 0, "ADC power on"},
+	{0x04, 0x3C, 0, "DAC and outputs on"},
+	{0x09, 0x00, 0, "mic PGA 0 dB"},
+	{0x0A, 0x00, 0, "LINPUT1 and RINPUT1"},
+	{0x0C, 0x0C, 0, "ADC format: I2S, 16 bits"},
+	{0x0D, 0x02, 0, "ADC MCLK / LRCK = 256"},
+	{0x10, 0x00, 0, "left ADC volume"},
+	{0x11, 0x00, 0, "right ADC volume"},
+	{0x17, 0x18, 0, "DAC format: I2S, 16 bits"},
+	{0x18, 0x02, 0, "DAC MCLK / LRCK = 256"},
+	{0x19, 0x02, 0, "DAC unmute"},
+	{0x1A, 0x00, 0, "left DAC volume"},
+	{0x1B, 0x00, 0, "right DAC volume"},
+	{0x27, 0x90, 0, "left DAC to left mixer"},
+	{0x2A, 0x90, 0, "right DAC to right mixer"},
+	{0x2E, 0x1E, 0, "LOUT1 volume"},
+	{0x2F, 0x1E, 0, "ROUT1 volume"},
+	{0x02, 0x00, 50, "start state machines"},
+};
+
+static void codecUsage()
+{
+	fprintf(stderr, "usage: program codec\n");
+}
+
+static bool mockWrite(void *ctx, uint8_t address, const uint8_t *data, size_t len)
+{
+	codec_mock_t *mock = (codec_mock_t *)ctx;
+	if (mock->writes.size() == mock->nackAt)
+		return false;
+	codec_write_t w = {address, {0, 0}, len, 0};
+	memcpy(w.data, data, len < sizeof(w.data) ? len : sizeof(w.data));
+	mock->writes.push_back(w);
+	return true;
+}
+
+static void mockDelay(void *ctx, uint32_t ms)
+{
+	codec_mock_t *mock = (codec_mock_t *)ctx;
+	if (!mock->writes.empty())
+		mock->writes.back().delayMs += ms;
+}
+
+/**
+ * @brief Run codecInit() on the mock and compare it with the datasheet order
+ * @return Number of failed checks
+ */
+static int checkInit(codec_type_t type, const char *name, uint8_t address, const codec_step_t *order, size_t steps)
+{
+	codec_mock_t mock = {{}, SIZE_MAX};
+	const codec_bus_t bus = {mockWrite, mockDelay, &mock};
+	int failures = 0;
+	if (!codecInit(type, &bus))
+	{
+		printf("%s: FAIL codecInit() failed on a bus that acknowledges everything\n", name);
+		failures++;
+	}
+	if (mock.writes.size() != steps)
+	{
+		printf("%s: FAIL %zu writes, the datasheet sequence has %zu\n", name, mock.writes.size(), steps);
+		failures++;
+	}
+
+	for (size_t i = 0; i < mock.writes.size() && i < steps; i++)
+	{
+		const codec_write_t *w = &mock.writes[i];
+		uint8_t reg;
+		uint16_t value;
+		if (type == CODEC_WM8960)
+		{
+			reg = w->data[0] >> 1;
+			value = (uint16_t)(((w->data[0] & 0x01) << 8) | w->data[1]);
+		}
+		else
+		{
+			reg = w->data[0];
+			value = w->data[1];
+		}
+		if (w->address != address || w->len != 2 || reg != order[i].reg || value != order[i].value ||
+			w->delayMs != order[i].delayMs)
+		{
+			printf("%s: FAIL write %zu (%s): address 0x%02X reg 0x%02X value 0x%03X delay %u ms, expected 0x%02X "
+				   "0x%02X 0x%03X %u ms\n",
+				   name, i, order[i].what, w->address, reg, value, w->delayMs, address, order[i].reg, order[i].value,
+				   order[i].delayMs);
+			failures++;
+		}
+		if (type == CODEC_WM8960)
+		{
+			for (uint8_t updateReg : wm8960UpdateRegs)
+			{
+				if (reg == updateReg && !(value & 0x100))
+				{
+					printf("%s: FAIL write %zu (%s) lacks the volume update bit\n", name, i, order[i].what);
+					failures++;
+				}
+			}
+		}
+	}
+
+	// A write that is not acknowledged ends the sequence
+	codec_mock_t nack = {{}, steps / 2};
+	const codec_bus_t nackBus = {mockWrite, mockDelay, &nack};
+	if (codecInit(type, &nackBus) || nack.writes.size() != steps / 2)
+	{
+		printf("%s: FAIL went on after write %zu was not acknowledged\n", name, steps / 2);
+		failures++;
+	}
+
+	printf("%s: %zu writes to 0x%02X, %s\n", name, mock.writes.size(), address,
+		   failures ? "FAIL" : "datasheet order");
+	return failures;
+}
+
+typedef struct
+{
+	std::vector<std::vector<uint8_t>> frames;
+} codec_rx_t;
+
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	((codec_rx_t *)ctx)->frames.push_back(std::vector<uint8_t>(frame, frame + len));
+}
+
+/**
+ * @brief Loop AFSK frames through the codec block path and decode both channels
+ * @return Number of failed checks
+ */
+static int checkBlocks()
+{
+	std::mt19937 rng(1);
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, CODEC_RATE, 1200, 2200, 1200);
+	afskModulatorSetLevels(&mod, CODEC_TONE_LEVEL, CODEC_TONE_LEVEL);
+
+	// Transmit: mono samples, then stereo frames in write-sized chunks
+	std::vector<std::vector<uint8_t>> sent;
+	std::vector<int16_t> mono;
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(CODEC_FRAME_BYTES, CODEC_PREAMBLE_FLAGS));
+	std::vector<int16_t> bit(CODEC_RATE / 1200 + 2);
+	for (int f = 0; f < CODEC_TEST_FRAMES; f++)
+	{
+		std::vector<uint8_t> frame(CODEC_FRAME_BYTES);
+		for (uint8_t &b : frame)
+			b = (uint8_t)rng();
+		sent.push_back(frame);
+		size_t count = hdlcEncode(frame.data(), frame.size(), CODEC_PREAMBLE_FLAGS, levels.data(), levels.size());
+		afskModulatorReset(&mod);
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t n = afskModulatorBit(&mod, levels[i], bit.data());
+			mono.insert(mono.end(), bit.begin(), bit.begin() + n);
+		}
+		mono.insert(mono.end(), CODEC_RATE / 10, 0);
+	}
+	std::vector<int16_t> i2s;
+	for (size_t at = 0; at < mono.size(); at += CODEC_FRAMES_PER_READ)
+	{
+		size_t chunk = std::min<size_t>(CODEC_FRAMES_PER_READ, mono.size() - at);
+		for (size_t i = 0; i < chunk; i++)
+		{
+			i2s.push_back(mono[at + i]);
+			i2s.push_back(mono[at + i]);
+		}
+	}
+
+	// Receive: split each read, decimate, demodulate in blocks
+	static fir_decimator_t decimators[2];
+	static afsk_demod_t demods[2];
+	codec_rx_t received[2];
+	std::vector<int16_t> pending[2];
+	size_t split[2] = {0, 0}, decimated[2] = {0, 0};
+	afsk_profile_t profile = {1200, 2200, 1200, CODEC_RX_RATE, AFSK_FRONT_END_GOERTZEL};
+	for (uint8_t ch = 0; ch < 2; ch++)
+	{
+		firDecimatorInit(&decimators[ch], CODEC_DECIMATION, 40, 4000.0f / CODEC_RATE);
+		afskDemodInit(&demods[ch], &profile, ch, onFrame, &received[ch]);
+	}
+	int16_t raw[CODEC_FRAMES_PER_READ];
+	int16_t out[CODEC_FRAMES_PER_READ / CODEC_DECIMATION + 1];
+	for (size_t at = 0; at < i2s.size(); at += 2 * CODEC_FRAMES_PER_READ)
+	{
+		size_t frameCount = std::min<size_t>(CODEC_FRAMES_PER_READ, (i2s.size() - at) / 2);
+		for (uint8_t ch = 0; ch < 2; ch++)
+		{
+			for (size_t i = 0; i < frameCount; i++)
+				raw[i] = i2s[at + 2 * i + ch];
+			split[ch] += frameCount;
+			size_t produced = firDecimatorProcess(&decimators[ch], raw, frameCount, out);
+			decimated[ch] += produced;
+			pending[ch].insert(pending[ch].end(), out, out + produced);
+			while (pending[ch].size() >= CODEC_RX_BLOCK)
+			{
+				afskDemodProcess(&demods[ch], pending[ch].data(), CODEC_RX_BLOCK);
+				pending[ch].erase(pending[ch].begin(), pending[ch].begin() + CODEC_RX_BLOCK);
+			}
+		}
+	}
+
+	int failures = 0;
+	if (i2s.size() != 2 * mono.size())
+	{
+		printf("blocks: FAIL %zu samples written as %zu stereo frames\n", mono.size(), i2s.size() / 2);
+		failures++;
+	}
+	for (uint8_t ch = 0; ch < 2; ch++)
+	{
+		size_t matched = 0;
+		for (size_t i = 0; i < received[ch].frames.size() && i < sent.size(); i++)
+			matched += received[ch].frames[i] == sent[i];
+		bool ok = split[ch] == mono.size() && decimated[ch] == mono.size() / CODEC_DECIMATION &&
+				  received[ch].frames.size() == sent.size() && matched == sent.size();
+		printf("blocks: channel %u: %zu samples at %d Hz, %zu at %d Hz, %zu of %zu frames decoded intact%s\n", ch,
+			   split[ch], CODEC_RATE, decimated[ch], CODEC_RX_RATE, matched, sent.size(), ok ? "" : ", FAIL");
+		if (!ok)
+			failures++;
+	}
+	return failures;
+}
+
+int codecMain(int argc, char **argv)
+{
+	if (argc > 1)
+	{
+		codecUsage();
+		return 2;
+	}
+	int failures = checkInit(CODEC_WM8960, "WM8960", 0x1A, wm8960Order, sizeof(wm8960Order) / sizeof(wm8960Order[0]));
+	failures += checkInit(CODEC_ES8388, "ES8388", 0x10, es8388Order, sizeof(es8388Order) / sizeof(es8388Order[0]));
+	failures += checkBlocks();
+	if (failures > 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
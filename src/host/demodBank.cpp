@@ -0,0 +1,60 @@
+/**
+ * @file demodBank.cpp
+ * @date 2025-09-25
+ * @brief Up to SIMD_LANES AFSK demodulators driven by one vectorized correlator.
+ */
+
+#include "demodBank.h"
+
+/**
+ * @brief Configure a bank
+ * @param bank Bank state
+ * @param kernels Kernel set, NULL for simdKernelsBest()
+ * @param profiles One profile per lane, all with the same window length
+ * @param lanes Number of lanes, 1 to SIMD_LANES
+ * @param onFrame Callback for decoded frames, the port is the lane number
+ * @param ctx Passed back to onFrame
+ * @return false if the profiles are unsupported or do not share a window length
+ */
+bool demodBankInit(demod_bank_t *bank, const simd_kernels_t *kernels, const afsk_profile_t *profiles, size_t lanes,
+				   afsk_frame_cb onFrame, void *ctx)
+{
+	if (!corrLanesInit(&bank->corr, profiles, lanes))
+	{
+		return false;
+	}
+	for (size_t l = 0; l < lanes; l++)
+	{
+		afskDemodInit(&bank->lanes[l], &profiles[l], (uint8_t)l, onFrame, ctx);
+	}
+	bank->laneCount = lanes;
+	bank->kernels = kernels ? kernels : simdKernelsBest();
+	return true;
+}
+
+/**
+ * @brief Demodulate interleaved samples
+ * @param bank Bank state
+ * @param samples count rows of SIMD_LANES samples, unused lanes ignored
+ * @param count Number of rows
+ */
+void demodBankProcess(demod_bank_t *bank, const int16_t *samples, size_t count)
+{
+	while (count > 0)
+	{
+		size_t n = count < DEMOD_BANK_CHUNK ? count : DEMOD_BANK_CHUNK;
+		bank->kernels->correlate(&bank->corr, samples, n, bank->levels);
+
+		// Lane by lane keeps each demodulator's state in cache
+		for (size_t l = 0; l < bank->laneCount; l++)
+		{
+			afsk_demod_t *d = &bank->lanes[l];
+			for (size_t i = 0; i < n; i++)
+			{
+				afskDemodClock(d, (bank->levels[i] >> l) & 1);
+			}
+		}
+		samples += n * SIMD_LANES;
+		count -= n;
+	}
+}
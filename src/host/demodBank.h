@@ -0,0 +1,54 @@
+/**
+ * @file demodBank.h
+ * @date 2025-09-25
+ * @brief Up to SIMD_LANES AFSK demodulators driven by one vectorized correlator.
+ *
+ * Each lane has its own afskDemod instance for clock recovery, DCD and HDLC;
+ * only the correlator, which is most of the work, runs in the SIMD kernel.
+ * Lanes may use different tone pairs as long as the window (sample rate /
+ * baud) is the same, so one bank can decode several channels, or several
+ * decoder variants of one channel, per instruction.
+ *
+ * Functions:
+ * - demodBankInit(): Configure the lanes and pick a kernel set.
+ * - demodBankProcess(): Demodulate interleaved samples ([sample][SIMD_LANES]).
+ */
+#ifndef DEMOD_BANK_H
+#define DEMOD_BANK_H
+
+#include "afskDemod.h"
+#include "simdKernels.h"
+
+#define DEMOD_BANK_CHUNK 256 // Samples per kernel call
+
+typedef struct
+{
+	corr_lanes_t corr;
+	afsk_demod_t lanes[SIMD_LANES]; // Correlator fields unused
+	size_t laneCount;
+	const simd_kernels_t *kernels;
+	uint16_t levels[DEMOD_BANK_CHUNK];
+} demod_bank_t;
+
+/**
+ * @brief Configure a bank
+ * @param bank Bank state
+ * @param kernels Kernel set, NULL for simdKernelsBest()
+ * @param profiles One profile per lane, all with the same window length
+ * @param lanes Number of lanes, 1 to SIMD_LANES
+ * @param onFrame Callback for decoded frames, the port is the lane number
+ * @param ctx Passed back to onFrame
+ * @return false if the profiles are unsupported or do not share a window length
+ */
+bool demodBankInit(demod_bank_t *bank, const simd_kernels_t *kernels, const afsk_profile_t *profiles, size_t lanes,
+				   afsk_frame_cb onFrame, void *ctx);
+
+/**
+ * @brief Demodulate interleaved samples
+ * @param bank Bank state
+ * @param samples count rows of SIMD_LANES samples, unused lanes ignored
+ * @param count Number of rows
+ */
+void demodBankProcess(demod_bank_t *bank, const int16_t *samples, size_t count);
+
+#endif // DEMOD_BANK_H
@@ -0,0 +1,479 @@
+/**
+ * @file demodCompare.cpp
+ * @date 2025-10-13
+ * @brief "demod" subcommand: packet error rate and CPU time of the demodulator front ends and decode cascades.
+ *
+ * For every SNR of the sweep, --frames AX.25 UI frames with a sequence number
+ * are framed by hdlcEncode(), modulated by afskModulator at 9600 Hz with a
+ * random gap of noise between them and mixed with Gaussian noise. They come
+ * from DEMOD_STATIONS stations, each with its own twist (mark to space level
+ * ratio) of up to --twist dB, as radios with and without pre-emphasis give.
+ * SNR is tone power over noise power in the full 4.8 kHz band, as in the "net"
+ * channel simulator. The same audio then goes to:
+ * - one afskDemod per front end (goertzel, delay-line, zero-crossing), in
+ *   blocks of 96 samples as the firmware's decoder task
+ * - <front end>+eye: the same with an eyeMonitor attached, as RX_EYE_MONITOR
+ *   builds run every port
+ * - a demodBank of SIMD_LANES Goertzel lanes per SIMD kernel set, every lane
+ *   fed the same audio, the frames of lane 0 counted
+ * - all-variants: every decodeCascade variant running on every sample next to
+ *   the delay-line front end, bit-repair on all their bad frames
+ * - cascade-<front end>: a decodeCascade with that primary
+ * Output: packet error rate per SNR, the lowest SNR with at most 10% PER and
+ * the demodulation time per sample of one channel, the number to compare
+ * across rows; then what the eye monitor adds to each front end, and for each
+ * cascade its share of the all-variants gain and CPU and what its variants did. On the ESP32 the decoder task's busy time
+ * gives the same CPU comparison for RX_FRONT_END and RX_DECODE_CASCADE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "ax25.h"
+#include "decodeCascade.h"
+#include "demodBank.h"
+#include "eyeMonitor.h"
+#include "hdlc.h"
+#include "hostTools.h"
+
+#define DEMOD_RATE 9600			// As delivered to the firmware's demodulators
+#define DEMOD_BLOCK 96			// Samples per call, as AUDIO_BLOCK_SAMPLES
+#define DEMOD_TONE_LEVEL 16384	// Modulator peak before the SNR gain
+#define DEMOD_NOISE_RMS 1000.0f // Noise level, as in the net simulator
+#define DEMOD_PREAMBLE_FLAGS 25 // About 170 ms of TXDELAY
+#define DEMOD_GAP_MS 300		// Longest noise gap between frames
+#define DEMOD_PER_LIMIT 0.1		// PER for the sensitivity column
+#define DEMOD_STATIONS 8
+#define DEMOD_HEADER 18			 // Addresses, control, PID and the sequence number
+#define DEMOD_HISTORY_SECONDS 4 // Cascade history, longer than a frame and its replays
+#define DEMOD_DEFAULT_FRAMES 200
+#define DEMOD_DEFAULT_BYTES 64 // A typical APRS position report
+#define DEMOD_DEFAULT_TWIST 6.0
+#define DEMOD_DEFAULT_SNR_FROM 0.0
+#define DEMOD_DEFAULT_SNR_TO 20.0
+#define DEMOD_DEFAULT_SNR_STEP 2.0
+
+typedef enum
+{
+	DEMOD_SINGLE = 0, // One afskDemod
+	DEMOD_EYE,		  // One afskDemod feeding an eyeMonitor
+	DEMOD_BANK,		  // SIMD demodBank
+	DEMOD_ALL,		  // Every cascade variant on every sample
+	DEMOD_CASCADE	  // decodeCascade
+} demod_kind_t;
+
+// One row of the comparison
+typedef struct
+{
+	std::string name;
+	demod_kind_t kind;
+	afsk_front_end_t frontEnd;	   // The only or the primary one
+	const simd_kernels_t *kernels; // DEMOD_BANK
+	std::vector<double> per;	   // By SNR
+	size_t decoded;				   // Over the whole sweep
+	double seconds;				   // Demodulation time over the whole sweep
+	size_t laneSamples;			   // Samples demodulated, all lanes
+	cascade_stats_t cascade;	   // DEMOD_CASCADE, summed over the sweep
+} demod_variant_t;
+
+// Frames decoded by one row, by sequence number
+typedef struct
+{
+	std::vector<bool> seen;
+	size_t unique;
+} demod_tally_t;
+
+typedef struct
+{
+	uint8_t source[AX25_ADDRESS_LEN];
+	int16_t markLevel; // Before the SNR gain
+	int16_t spaceLevel;
+} demod_station_t;
+
+static void demodUsage()
+{
+	fprintf(stderr,
+			"usage: program demod [options]\n"
+			"  --snr FROM:TO:STEP  SNR sweep in dB (default %.0f:%.0f:%.0f)\n"
+			"  --frames N          frames per SNR (default %d)\n"
+			"  --bytes N           frame length, %d to %d (default %d)\n"
+			"  --twist DB          largest station twist, either tone louder (default %.0f)\n"
+			"  --seed N            random seed (default 1)\n",
+			DEMOD_DEFAULT_SNR_FROM, DEMOD_DEFAULT_SNR_TO, DEMOD_DEFAULT_SNR_STEP, DEMOD_DEFAULT_FRAMES,
+			DEMOD_HEADER, HDLC_MAX_FRAME - 2, DEMOD_DEFAULT_BYTES, DEMOD_DEFAULT_TWIST);
+}
+
+/**
+ * @brief Count a decoded frame once by the sequence number after its header
+ */
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	demod_tally_t *t = (demod_tally_t *)ctx;
+	if (port != 0 || len < DEMOD_HEADER)
+	{
+		return;
+	}
+	size_t id = frame[DEMOD_HEADER - 2] | (size_t)frame[DEMOD_HEADER - 1] << 8;
+	if (id < t->seen.size() && !t->seen[id])
+	{
+		t->seen[id] = true;
+		t->unique++;
+	}
+}
+
+/**
+ * @brief all-variants: bit-repair every bad frame, as the cascade would
+ */
+static void onBadFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	uint8_t copy[HDLC_MAX_FRAME];
+	ax25_frame_t parsed;
+	memcpy(copy, frame, len);
+	if (hdlcRepair(copy, len) && ax25Parse(copy, len - 2, &parsed) == AX25_OK)
+	{
+		onFrame(ctx, port, copy, len - 2);
+	}
+}
+
+static void setAddress(uint8_t *field, const char *call, uint8_t ssid, bool last)
+{
+	for (size_t i = 0; i < 6; i++)
+		field[i] = (uint8_t)((*call ? *call++ : ' ') << 1);
+	field[6] = (uint8_t)(0x60 | (ssid << 1) | (last ? 0x01 : 0x00));
+}
+
+/**
+ * @brief Stations with their callsigns and a random twist each
+ */
+static std::vector<demod_station_t> makeStations(double twistDb, std::mt19937 &rng)
+{
+	std::vector<demod_station_t> stations(DEMOD_STATIONS);
+	for (size_t i = 0; i < stations.size(); i++)
+	{
+		char call[7];
+		snprintf(call, sizeof(call), "N0ST%c", (char)('A' + i));
+		setAddress(stations[i].source, call, 0, true);
+		double twist = twistDb * (2.0 * (rng() % 1001) / 1000.0 - 1.0);
+		stations[i].markLevel = (int16_t)(DEMOD_TONE_LEVEL * pow(10.0, twist / 40.0));
+		stations[i].spaceLevel = (int16_t)(DEMOD_TONE_LEVEL * pow(10.0, -twist / 40.0));
+	}
+	return stations;
+}
+
+/**
+ * @brief Make frames of noisy AFSK at one SNR
+ */
+static std::vector<int16_t> makeAudio(double snrDb, size_t frames, size_t bytes,
+									  const std::vector<demod_station_t> &stations, std::mt19937 &rng)
+{
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, DEMOD_RATE, 1200, 2200, 1200);
+	// Tone power (peak^2 / 2) over noise power
+	float gain = (float)(DEMOD_NOISE_RMS * sqrt(2.0) * pow(10.0, snrDb / 20.0) / DEMOD_TONE_LEVEL);
+
+	std::vector<float> clean;
+	std::vector<uint8_t> frame(bytes);
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(HDLC_MAX_FRAME, DEMOD_PREAMBLE_FLAGS));
+	int16_t bit[DEMOD_RATE / 1200 + 2];
+	for (size_t id = 0; id < frames; id++)
+	{
+		const demod_station_t &s = stations[rng() % stations.size()];
+		clean.resize(clean.size() + DEMOD_RATE * (rng() % DEMOD_GAP_MS) / 1000, 0.0f);
+		setAddress(&frame[0], "APRS", 0, false);
+		memcpy(&frame[AX25_ADDRESS_LEN], s.source, AX25_ADDRESS_LEN);
+		frame[2 * AX25_ADDRESS_LEN] = AX25_CONTROL_UI;
+		frame[2 * AX25_ADDRESS_LEN + 1] = AX25_PID_NONE;
+		frame[DEMOD_HEADER - 2] = (uint8_t)id;
+		frame[DEMOD_HEADER - 1] = (uint8_t)(id >> 8);
+		for (size_t i = DEMOD_HEADER; i < bytes; i++)
+			frame[i] = (uint8_t)(' ' + rng() % 95);
+		size_t count = hdlcEncode(frame.data(), bytes, DEMOD_PREAMBLE_FLAGS, levels.data(), levels.size());
+		afskModulatorSetLevels(&mod, s.markLevel, s.spaceLevel);
+		afskModulatorReset(&mod);
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t n = afskModulatorBit(&mod, levels[i], bit);
+			for (size_t k = 0; k < n; k++)
+				clean.push_back(gain * bit[k]);
+		}
+	}
+	clean.resize(clean.size() + DEMOD_RATE * DEMOD_GAP_MS / 1000, 0.0f);
+
+	std::vector<int16_t> audio(clean.size());
+	std::normal_distribution<float> noise(0.0f, DEMOD_NOISE_RMS);
+	for (size_t i = 0; i < clean.size(); i++)
+	{
+		float v = clean[i] + noise(rng);
+		audio[i] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, v));
+	}
+	return audio;
+}
+
+/**
+ * @brief Feed audio to a callback in blocks of DEMOD_BLOCK samples
+ */
+template <typename Fn>
+static void blocks(const std::vector<int16_t> &audio, Fn fn)
+{
+	for (size_t at = 0; at < audio.size(); at += DEMOD_BLOCK)
+	{
+		fn(audio.data() + at, audio.size() - at < DEMOD_BLOCK ? audio.size() - at : DEMOD_BLOCK);
+	}
+}
+
+/**
+ * @brief Demodulate the audio with one row
+ * @return Packet error rate
+ */
+static double run(demod_variant_t *v, const std::vector<int16_t> &audio, const std::vector<int16_t> &lanes,
+				  size_t frames)
+{
+	demod_tally_t tally;
+	tally.seen.assign(frames, false);
+	tally.unique = 0;
+	afsk_profile_t profile = {1200, 2200, 1200, DEMOD_RATE, v->frontEnd};
+	std::chrono::steady_clock::time_point start;
+
+	switch (v->kind)
+	{
+	case DEMOD_SINGLE:
+	{
+		static afsk_demod_t demod;
+		afskDemodInit(&demod, &profile, 0, onFrame, &tally);
+		start = std::chrono::steady_clock::now();
+		blocks(audio, [&](const int16_t *samples, size_t n)
+			   { afskDemodProcess(&demod, samples, n); });
+		break;
+	}
+	case DEMOD_EYE:
+	{
+		static afsk_demod_t demod;
+		static eye_monitor_t eye;
+		afskDemodInit(&demod, &profile, 0, onFrame, &tally);
+		eyeMonitorReset(&eye);
+		afskDemodSetEyeMonitor(&demod, &eye);
+		start = std::chrono::steady_clock::now();
+		blocks(audio, [&](const int16_t *samples, size_t n)
+			   { afskDemodProcess(&demod, samples, n); });
+		break;
+	}
+	case DEMOD_BANK:
+	{
+		static demod_bank_t bank;
+		afsk_profile_t profiles[SIMD_LANES];
+		for (afsk_profile_t &p : profiles)
+			p = profile;
+		demodBankInit(&bank, v->kernels, profiles, SIMD_LANES, onFrame, &tally);
+		start = std::chrono::steady_clock::now();
+		demodBankProcess(&bank, lanes.data(), audio.size());
+		break;
+	}
+	case DEMOD_ALL:
+	{
+		static afsk_demod_t demods[4];
+		afsk_profile_t goertzel = {1200, 2200, 1200, DEMOD_RATE, AFSK_FRONT_END_GOERTZEL};
+		const float slicers[4] = {0.0f, 0.0f, -CASCADE_SLICER_LEVEL, CASCADE_SLICER_LEVEL};
+		for (int i = 0; i < 4; i++)
+		{
+			afskDemodInit(&demods[i], i == 0 ? &profile : &goertzel, 0, onFrame, &tally);
+			afskDemodSetSlicer(&demods[i], slicers[i]);
+			afskDemodSetErrorCallback(&demods[i], onBadFrame);
+		}
+		start = std::chrono::steady_clock::now();
+		blocks(audio, [&](const int16_t *samples, size_t n)
+			   {
+				   for (afsk_demod_t &d : demods)
+					   afskDemodProcess(&d, samples, n); });
+		break;
+	}
+	case DEMOD_CASCADE:
+	{
+		static afsk_demod_t primary;
+		static decode_cascade_t cascade;
+		static std::vector<int16_t> history(DEMOD_HISTORY_SECONDS * DEMOD_RATE);
+		cascadeInit(&cascade, &primary, &profile, 0, onFrame, &tally, history.data(), history.size());
+		start = std::chrono::steady_clock::now();
+		blocks(audio, [&](const int16_t *samples, size_t n)
+			   { cascadeProcess(&cascade, samples, n); });
+
+		const cascade_stats_t &s = cascade.stats;
+		cascade_stats_t &sum = v->cascade;
+		sum.bursts += s.bursts;
+		sum.failedBursts += s.failedBursts;
+		sum.retries += s.retries;
+		sum.skipped += s.skipped;
+		sum.overruns += s.overruns;
+		sum.recovered += s.recovered;
+		sum.primarySamples += s.primarySamples;
+		sum.replaySamples += s.replaySamples;
+		for (int i = 0; i < CASCADE_VARIANTS; i++)
+		{
+			sum.tries[i] += s.tries[i];
+			sum.successes[i] += s.successes[i];
+		}
+		break;
+	}
+	}
+	v->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	v->laneSamples += audio.size() * (v->kind == DEMOD_BANK ? SIMD_LANES : 1);
+	v->decoded += tally.unique;
+	return 1.0 - (double)tally.unique / frames;
+}
+
+static const demod_variant_t *findRow(const std::vector<demod_variant_t> &rows, demod_kind_t kind,
+									  afsk_front_end_t frontEnd)
+{
+	for (const demod_variant_t &v : rows)
+		if (v.kind == kind && v.frontEnd == frontEnd)
+			return &v;
+	return NULL;
+}
+
+/**
+ * @brief "demod" subcommand
+ * @param argc Argument count, argv[0] is "demod"
+ * @param argv Options
+ * @return 0 on success, 2 on a usage error
+ */
+int demodMain(int argc, char **argv)
+{
+	double snrFrom = DEMOD_DEFAULT_SNR_FROM, snrTo = DEMOD_DEFAULT_SNR_TO, snrStep = DEMOD_DEFAULT_SNR_STEP;
+	size_t frames = DEMOD_DEFAULT_FRAMES;
+	size_t bytes = DEMOD_DEFAULT_BYTES;
+	double twist = DEMOD_DEFAULT_TWIST;
+	unsigned seed = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--snr") == 0 && more)
+		{
+			if (sscanf(argv[++i], "%lf:%lf:%lf", &snrFrom, &snrTo, &snrStep) != 3)
+				snrStep = 0;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && more)
+			frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bytes") == 0 && more)
+			bytes = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--twist") == 0 && more)
+			twist = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			demodUsage();
+			return 2;
+		}
+	}
+	if (snrStep <= 0 || snrTo < snrFrom || frames < 1 || frames > 65536 || bytes < DEMOD_HEADER ||
+		bytes > HDLC_MAX_FRAME - 2 || twist < 0 || twist > 20)
+	{
+		demodUsage();
+		return 2;
+	}
+
+	const afsk_front_end_t frontEnds[] = {AFSK_FRONT_END_GOERTZEL, AFSK_FRONT_END_DELAY_LINE,
+										  AFSK_FRONT_END_ZERO_CROSSING};
+	std::vector<demod_variant_t> rows;
+	for (afsk_front_end_t fe : frontEnds)
+		rows.push_back({afskFrontEndName(fe), DEMOD_SINGLE, fe, NULL, {}, 0, 0.0, 0, {}});
+	for (afsk_front_end_t fe : frontEnds)
+		rows.push_back({std::string(afskFrontEndName(fe)) + "+eye", DEMOD_EYE, fe, NULL, {}, 0, 0.0, 0, {}});
+	const simd_kernels_t *kernels[8];
+	size_t kernelCount = simdKernelsAvailable(kernels, 8);
+	for (size_t k = 0; k < kernelCount; k++)
+		rows.push_back({std::string("bank-") + kernels[k]->name, DEMOD_BANK, AFSK_FRONT_END_GOERTZEL, kernels[k], {}, 0,
+						0.0, 0, {}});
+	rows.push_back({"all-variants", DEMOD_ALL, AFSK_FRONT_END_DELAY_LINE, NULL, {}, 0, 0.0, 0, {}});
+	for (afsk_front_end_t fe : frontEnds)
+		rows.push_back({std::string("cascade-") + afskFrontEndName(fe), DEMOD_CASCADE, fe, NULL, {}, 0, 0.0, 0, {}});
+
+	std::vector<double> snrs;
+	for (double snr = snrFrom; snr <= snrTo + 1e-9; snr += snrStep)
+		snrs.push_back(snr);
+
+	std::mt19937 rng(seed);
+	std::vector<demod_station_t> stations = makeStations(twist, rng);
+	double audioSeconds = 0;
+	for (double snr : snrs)
+	{
+		std::vector<int16_t> audio = makeAudio(snr, frames, bytes, stations, rng);
+		std::vector<int16_t> lanes(audio.size() * SIMD_LANES);
+		for (size_t r = 0; r < audio.size(); r++)
+			for (size_t l = 0; l < SIMD_LANES; l++)
+				lanes[r * SIMD_LANES + l] = audio[r];
+		audioSeconds += (double)audio.size() / DEMOD_RATE;
+		for (demod_variant_t &v : rows)
+			v.per.push_back(run(&v, audio, lanes, frames));
+	}
+
+	printf("PER %% by SNR (dB), %zu frames of %zu bytes per SNR from %d stations with up to %.0f dB twist, "
+		   "%.0f s of audio\n",
+		   frames, bytes, DEMOD_STATIONS, twist, audioSeconds);
+	printf("%-22s", "decoder");
+	for (double snr : snrs)
+		printf(" %5.1f", snr);
+	printf("   <=10%% at   ns/sample  relative\n");
+	double reference = rows[0].seconds / rows[0].laneSamples;
+	for (const demod_variant_t &v : rows)
+	{
+		printf("%-22s", v.name.c_str());
+		double sensitivity = NAN;
+		for (size_t i = 0; i < snrs.size(); i++)
+		{
+			printf(" %5.1f", 100.0 * v.per[i]);
+			if (isnan(sensitivity) && v.per[i] <= DEMOD_PER_LIMIT)
+				sensitivity = snrs[i];
+		}
+		double perSample = v.seconds / v.laneSamples;
+		if (isnan(sensitivity))
+			printf("   %7s", "-");
+		else
+			printf("   %5.1f dB", sensitivity);
+		printf("   %9.2f  %7.2fx\n", perSample * 1e9, perSample / reference);
+	}
+
+	// Eye monitor: the same decoder with and without it
+	printf("\neye monitor:");
+	for (afsk_front_end_t fe : frontEnds)
+	{
+		const demod_variant_t *bare = findRow(rows, DEMOD_SINGLE, fe);
+		const demod_variant_t *eye = findRow(rows, DEMOD_EYE, fe);
+		double bareNs = 1e9 * bare->seconds / bare->laneSamples;
+		double eyeNs = 1e9 * eye->seconds / eye->laneSamples;
+		printf("%s %+.2f ns/sample (%+.0f%%) on %s", fe == frontEnds[0] ? "" : ",", eyeNs - bareNs,
+			   100.0 * (eyeNs - bareNs) / bareNs, bare->name.c_str());
+	}
+	printf("\n");
+
+	// Gain: frames decoded beyond the primary alone, as a share of what all variants at once decode beyond it
+	const demod_variant_t *all = findRow(rows, DEMOD_ALL, AFSK_FRONT_END_DELAY_LINE);
+	const demod_variant_t *allPrimary = findRow(rows, DEMOD_SINGLE, AFSK_FRONT_END_DELAY_LINE);
+	for (const demod_variant_t &v : rows)
+	{
+		if (v.kind != DEMOD_CASCADE)
+			continue;
+		const demod_variant_t *primary = findRow(rows, DEMOD_SINGLE, v.frontEnd);
+		const cascade_stats_t &s = v.cascade;
+		printf("\n%s: %zu frames over %s alone", v.name.c_str(), v.decoded - primary->decoded, primary->name.c_str());
+		if (v.frontEnd == all->frontEnd && all->decoded > allPrimary->decoded)
+			printf(", %.0f%% of the all-variants gain at %.0f%% of its CPU",
+				   100.0 * (v.decoded - primary->decoded) / (all->decoded - allPrimary->decoded),
+				   100.0 * (v.seconds / v.laneSamples) / (all->seconds / all->laneSamples));
+		printf("\n  bursts %u, failed %u, retried %u (skipped %u, overrun %u), recovered %u, replayed %.1f%% of "
+			   "the audio\n ",
+			   s.bursts, s.failedBursts, s.retries, s.skipped, s.overruns, s.recovered,
+			   s.primarySamples ? 100.0 * s.replaySamples / s.primarySamples : 0.0);
+		for (int i = 0; i < CASCADE_VARIANTS; i++)
+			printf(" %s %u/%u", cascadeVariantName((cascade_variant_t)i), s.successes[i], s.tries[i]);
+		printf("\n");
+	}
+	return 0;
+}
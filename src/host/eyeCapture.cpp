@@ -0,0 +1,309 @@
+/**
+ * @file eyeCapture.cpp
+ * @date 2025-10-15
+ * @brief "eye" subcommand: eye diagram and bit timing of a recording or of simulated audio.
+ *
+ * Audio comes from a 16-bit WAV file, decimated to about 9600 Hz as in "batch",
+ * or, without a file, from --frames random frames of AFSK at --snr dB with
+ * --twist dB between the tones (positive: mark louder). It goes through one
+ * afskDemod with an eyeMonitor attached, exactly as a TNC port with the same
+ * profile would see it. The twist of the audio is measured from the short
+ * blocks that hold one tone only. Twist is the mark level relative to space in
+ * dB, for --twist and the measurement alike, the same sign as setAFSKTwist()
+ * on the TNC. Output: the summary on stdout, and the histograms as
+ * JSON (--json) and the eye as a BMP image (--bmp), the same files the TNC
+ * serves from GET /eye.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "eyeMonitor.h"
+#include "firDecimator.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "wavFile.h"
+
+#define EYE_RATE 9600			// As delivered to the firmware's demodulators
+#define EYE_BLOCK 96			// Samples per call, as AUDIO_BLOCK_SAMPLES
+#define EYE_TONE_LEVEL 16384	// Modulator peak before the SNR gain
+#define EYE_NOISE_RMS 1000.0f	// Noise level, as in the demod and net simulators
+#define EYE_PREAMBLE_FLAGS 25
+#define EYE_FRAME_BYTES 64
+#define EYE_DEFAULT_FRAMES 50
+#define EYE_DEFAULT_SNR 20.0
+#define EYE_TWIST_PURE_DB 20.0 // A twist block counts if one tone is this much stronger than the other
+
+static void eyeUsage()
+{
+	fprintf(stderr,
+			"usage: program eye [file.wav] [options]\n"
+			"  --channel N       WAV channel (default 0)\n"
+			"  --snr DB          simulated audio without a file (default %.0f)\n"
+			"  --twist DB        simulated mark level relative to space (default 0)\n"
+			"  --frames N        simulated frames (default %d)\n"
+			"  --baud 1200|300   1200/2200 Hz Bell 202 or 1600/1800 Hz HF packet (default 1200)\n"
+			"  --front-end NAME  goertzel, delay-line or zero-crossing (default goertzel)\n"
+			"  --json FILE       write the summary and histograms\n"
+			"  --bmp FILE        write the eye as an image\n"
+			"  --seed N          random seed (default 1)\n",
+			EYE_DEFAULT_SNR, EYE_DEFAULT_FRAMES);
+}
+
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	(*(size_t *)ctx)++;
+}
+
+static void writeFile(void *ctx, const void *data, size_t len)
+{
+	fwrite(data, 1, len, (FILE *)ctx);
+}
+
+/**
+ * @brief Goertzel power of one frequency over a Hann-windowed block
+ */
+static double blockPower(const int16_t *block, size_t len, uint32_t sampleRate, double freq)
+{
+	double coeff = 2.0 * cos(2.0 * M_PI * freq / sampleRate);
+	double s1 = 0.0, s2 = 0.0;
+	for (size_t i = 0; i < len; i++)
+	{
+		double w = 0.5 - 0.5 * cos(2.0 * M_PI * i / len);
+		double s0 = w * block[i] + coeff * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+	return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+/**
+ * @brief Mark level relative to space of AFSK audio, in dB
+ *
+ * Short blocks are classified by their stronger tone and each tone is averaged
+ * over its own blocks, so the share of mark and space in the bit stream
+ * (flags, stuffing, idle) does not bias the ratio as one long filter would.
+ * @return false without blocks of both tones
+ */
+static bool measureTwist(const std::vector<int16_t> &audio, const afsk_profile_t *profile, double *twistDb)
+{
+	// Shortest Hann block that resolves the tones: their distance is two bins
+	double separation = fabs((double)profile->markFreq - profile->spaceFreq);
+	size_t block = (size_t)ceil(2.0 * profile->sampleRate / separation);
+	double pure = pow(10.0, EYE_TWIST_PURE_DB / 10.0);
+	double markSum = 0.0, spaceSum = 0.0;
+	size_t markBlocks = 0, spaceBlocks = 0;
+	for (size_t at = 0; at + block <= audio.size(); at += block)
+	{
+		double mark = blockPower(&audio[at], block, profile->sampleRate, profile->markFreq);
+		double space = blockPower(&audio[at], block, profile->sampleRate, profile->spaceFreq);
+		if (mark > pure * space)
+		{
+			markSum += mark;
+			markBlocks++;
+		}
+		else if (space > pure * mark)
+		{
+			spaceSum += space;
+			spaceBlocks++;
+		}
+	}
+	if (markBlocks == 0 || spaceBlocks == 0 || markSum <= 0.0 || spaceSum <= 0.0)
+		return false;
+	*twistDb = 10.0 * log10((markSum / markBlocks) / (spaceSum / spaceBlocks));
+	return true;
+}
+
+/**
+ * @brief Simulated AFSK frames with noise
+ */
+static std::vector<int16_t> simulate(const afsk_profile_t *profile, double snrDb, double twistDb, size_t frames,
+									 unsigned seed)
+{
+	std::mt19937 rng(seed);
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, EYE_RATE, profile->markFreq, profile->spaceFreq, profile->baudRate);
+	afskModulatorSetLevels(&mod, (int16_t)(EYE_TONE_LEVEL * pow(10.0, twistDb / 40.0)),
+						   (int16_t)(EYE_TONE_LEVEL * pow(10.0, -twistDb / 40.0)));
+	float gain = (float)(EYE_NOISE_RMS * sqrt(2.0) * pow(10.0, snrDb / 20.0) / EYE_TONE_LEVEL);
+	std::normal_distribution<float> noise(0.0f, EYE_NOISE_RMS);
+
+	std::vector<int16_t> audio;
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(EYE_FRAME_BYTES, EYE_PREAMBLE_FLAGS));
+	std::vector<int16_t> bit(EYE_RATE / profile->baudRate + 2);
+	uint8_t frame[EYE_FRAME_BYTES];
+	for (size_t f = 0; f < frames; f++)
+	{
+		for (uint8_t &b : frame)
+			b = (uint8_t)rng();
+		size_t count = hdlcEncode(frame, sizeof(frame), EYE_PREAMBLE_FLAGS, levels.data(), levels.size());
+		afskModulatorReset(&mod);
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t n = afskModulatorBit(&mod, levels[i], bit.data());
+			for (size_t k = 0; k < n; k++)
+				audio.push_back((int16_t)std::max(-32768.0f, std::min(32767.0f, gain * bit[k] + noise(rng))));
+		}
+		for (size_t k = 0; k < EYE_RATE / 10; k++)
+			audio.push_back((int16_t)noise(rng));
+	}
+	return audio;
+}
+
+/**
+ * @brief Read one channel of a WAV file, decimated to about EYE_RATE
+ * @return Sample rate of audio, 0 on error
+ */
+static uint32_t readWav(const char *path, uint16_t channel, std::vector<int16_t> *audio)
+{
+	wav_file_t wav;
+	if (!wavOpen(&wav, path))
+	{
+		fprintf(stderr, "%s: %s\n", path, wav.error);
+		return 0;
+	}
+	if (channel >= wav.channels || wav.sampleRate < EYE_RATE)
+	{
+		fprintf(stderr, "%s: no channel %u or rate %u below %d Hz\n", path, channel, wav.sampleRate, EYE_RATE);
+		wavClose(&wav);
+		return 0;
+	}
+	std::vector<int16_t> input(wav.frames);
+	wavRead(&wav, channel, 0, wav.frames, input.data());
+	uint32_t decimation = wav.sampleRate / EYE_RATE;
+	uint32_t rate = (wav.sampleRate + decimation / 2) / decimation;
+	if (decimation > 1)
+	{
+		fir_decimator_t fir;
+		uint8_t taps = (uint8_t)std::min<uint32_t>(FIR_DECIMATOR_MAX_TAPS, 8 * decimation);
+		firDecimatorInit(&fir, (uint8_t)decimation, taps, 4000.0f / wav.sampleRate);
+		audio->resize(input.size() / decimation + 1);
+		audio->resize(firDecimatorProcess(&fir, input.data(), input.size(), audio->data()));
+	}
+	else
+	{
+		*audio = input;
+	}
+	wavClose(&wav);
+	return rate;
+}
+
+/**
+ * @brief "eye" subcommand
+ * @param argc Argument count, argv[0] is "eye"
+ * @param argv Options and an optional WAV file
+ * @return 0 on success, 1 if the file cannot be read, 2 on a usage error
+ */
+int eyeMain(int argc, char **argv)
+{
+	const char *path = NULL, *jsonPath = NULL, *bmpPath = NULL;
+	unsigned channel = 0, seed = 1, baud = 1200;
+	double snr = EYE_DEFAULT_SNR, twist = 0.0;
+	size_t frames = EYE_DEFAULT_FRAMES;
+	int frontEnd = AFSK_FRONT_END_GOERTZEL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--channel") == 0 && more)
+			channel = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--snr") == 0 && more)
+			snr = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--twist") == 0 && more)
+			twist = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--frames") == 0 && more)
+			frames = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--baud") == 0 && more)
+			baud = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--front-end") == 0 && more)
+		{
+			const char *name = argv[++i];
+			frontEnd = -1;
+			for (afsk_front_end_t fe : {AFSK_FRONT_END_GOERTZEL, AFSK_FRONT_END_DELAY_LINE, AFSK_FRONT_END_ZERO_CROSSING})
+				if (strcmp(name, afskFrontEndName(fe)) == 0)
+					frontEnd = fe;
+		}
+		else if (strcmp(argv[i], "--json") == 0 && more)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--bmp") == 0 && more)
+			bmpPath = argv[++i];
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0] != '-' && path == NULL)
+			path = argv[i];
+		else
+		{
+			eyeUsage();
+			return 2;
+		}
+	}
+	if (frontEnd < 0 || (baud != 1200 && baud != 300) || frames < 1)
+	{
+		eyeUsage();
+		return 2;
+	}
+
+	afsk_profile_t profile = {(uint16_t)(baud == 300 ? 1600 : 1200), (uint16_t)(baud == 300 ? 1800 : 2200),
+							  (uint16_t)baud, EYE_RATE, (afsk_front_end_t)frontEnd};
+	std::vector<int16_t> audio;
+	if (path != NULL)
+	{
+		profile.sampleRate = readWav(path, (uint16_t)channel, &audio);
+		if (profile.sampleRate == 0)
+			return 1;
+	}
+	else
+	{
+		audio = simulate(&profile, snr, twist, frames, seed);
+	}
+
+	static afsk_demod_t demod;
+	static eye_monitor_t eye;
+	size_t decoded = 0;
+	if (!afskDemodInit(&demod, &profile, 0, onFrame, &decoded))
+	{
+		fprintf(stderr, "profile not supported by the %s front end\n", afskFrontEndName(profile.frontEnd));
+		return 2;
+	}
+	eyeMonitorReset(&eye);
+	afskDemodSetEyeMonitor(&demod, &eye);
+	for (size_t at = 0; at < audio.size(); at += EYE_BLOCK)
+		afskDemodProcess(&demod, audio.data() + at, std::min<size_t>(EYE_BLOCK, audio.size() - at));
+
+	eye_summary_t s;
+	eyeMonitorSummary(&eye, &s);
+	printf("%s, %u baud, %s: %.1f s of audio, %zu frames decoded\n", path ? path : "simulated", baud,
+		   afskFrontEndName(profile.frontEnd), (double)audio.size() / profile.sampleRate, decoded);
+	printf("eye: %u samples in lock, opening %.0f%%, mark rail %+.2f, space rail %+.2f (level %g)\n", s.samples,
+		   100.0f * s.opening, s.markRail, s.spaceRail, s.level);
+	printf("timing: %u transitions, mean %+.3f bit, rms %.3f bit\n", s.transitions, s.timingMean, s.timingRms);
+	double measuredTwist;
+	if (measureTwist(audio, &profile, &measuredTwist))
+		printf("twist: mark %+.1f dB relative to space (setAFSKTwist() sign)\n", measuredTwist);
+
+	const struct
+	{
+		const char *path;
+		void (*write)(const eye_monitor_t *, eye_write_cb, void *);
+	} outputs[] = {{jsonPath, eyeMonitorJson}, {bmpPath, eyeMonitorBmp}};
+	for (const auto &o : outputs)
+	{
+		if (o.path == NULL)
+			continue;
+		FILE *f = fopen(o.path, "wb");
+		if (f == NULL)
+		{
+			perror(o.path);
+			return 1;
+		}
+		o.write(&eye, writeFile, f);
+		fclose(f);
+	}
+	return 0;
+}
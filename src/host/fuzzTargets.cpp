@@ -0,0 +1,607 @@
+/**
+ * @file fuzzTargets.cpp
+ * @date 2025-09-28
+ * @brief "fuzz" subcommand: fuzz the KISS decoder, HDLC deframer and AX.25 parser.
+ *
+ * Each target feeds one input to the same kiss.cpp, hdlc.cpp and ax25.cpp the
+ * firmware runs, and follows whatever they accept down the rest of its path:
+ * - kiss: host link. Bytes as read from Bluetooth (split at a point chosen by
+ *   the first byte), data frames through ax25Parse() and hdlcEncode(), which
+ *   must deframe back to the same frame.
+ * - hdlc: receive path. Every input byte is 8 line levels, LSB first; delivered
+ *   frames go through ax25Parse(), ax25Format() and a kissEncode()/kissInput()
+ *   round trip.
+ * - ax25: ax25Parse() and ax25Format() into a full and a short buffer.
+ * Broken invariants abort(), so sanitizers and libFuzzer report them.
+ *
+ * Seeds are real frames: built-in APRS packets, the hex column of batch or sdr
+ * output (--frames), and raw inputs from a directory (--corpus). The built-in
+ * mutator is blind apart from keeping inputs that reach the next stage; build
+ * env:native-fuzz for coverage-guided libFuzzer runs, seeded with --write-corpus.
+ * Executions per second double as a parser throughput figure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include "ax25.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define FUZZ_MAX_INPUT 4096 // Longest mutated input, a dozen HDLC frames
+#define FUZZ_MAX_CORPUS 2048 // Inputs kept per target
+#define FUZZ_SEED_FLAGS 2	// Flags before each encoded frame, the first one syncs the NRZI decoder
+
+#define FUZZ_CHECK(condition)                                                                   \
+	do                                                                                          \
+	{                                                                                           \
+		if (!(condition))                                                                       \
+		{                                                                                       \
+			fprintf(stderr, "%s:%d: fuzz check failed: %s\n", __FILE__, __LINE__, #condition); \
+			abort();                                                                            \
+		}                                                                                       \
+	} while (0)
+
+typedef struct
+{
+	uint64_t frames; // Frames the first stage delivered
+	uint64_t parsed; // ...that were valid AX.25
+} fuzz_counters_t;
+
+typedef struct
+{
+	const char *name;
+	void (*run)(const uint8_t *data, size_t len);
+	std::vector<uint8_t> (*seed)(const std::vector<uint8_t> &frame); // Real frame to target input
+	fuzz_counters_t counters;
+} fuzz_target_t;
+
+/**
+ * @brief Parse a frame that passed the first stage and check the formatter
+ */
+static bool checkAx25(const uint8_t *frame, size_t len, fuzz_counters_t *counters)
+{
+	ax25_frame_t f;
+	counters->frames++;
+	if (ax25Parse(frame, len, &f) != AX25_OK)
+	{
+		return false;
+	}
+	counters->parsed++;
+	FUZZ_CHECK(f.info >= frame && f.info + f.infoLength == frame + len);
+	FUZZ_CHECK(f.digiCount <= AX25_MAX_DIGIS && f.infoLength <= AX25_MAX_INFO);
+
+	// Worst case: every info byte as <0xNN>, 10 addresses of call, SSID and separators
+	char line[AX25_MAX_INFO * 6 + 128];
+	char shortLine[16];
+	size_t full = ax25Format(&f, line, sizeof(line));
+	FUZZ_CHECK(full < sizeof(line) && strlen(line) == full);
+	FUZZ_CHECK(ax25Format(&f, shortLine, sizeof(shortLine)) == full);
+	FUZZ_CHECK(strncmp(line, shortLine, sizeof(shortLine) - 1) == 0);
+	return true;
+}
+
+// ---- kiss: host link ----
+
+static fuzz_target_t *kissTarget;
+
+typedef struct
+{
+	std::vector<uint8_t> data;
+	uint8_t port;
+	uint8_t command;
+	size_t count;
+} kiss_capture_t;
+
+static void captureKiss(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	kiss_capture_t *c = (kiss_capture_t *)ctx;
+	c->data.assign(data, data + len);
+	c->port = port;
+	c->command = command;
+	c->count++;
+}
+
+static void captureHdlc(void *ctx, const uint8_t *frame, size_t len)
+{
+	((std::vector<uint8_t> *)ctx)->assign(frame, frame + len);
+}
+
+/**
+ * @brief A data or ACKMODE frame from the host, handled like txQueue.cpp and transmitAX25()
+ */
+static void onKissFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	FUZZ_CHECK(len <= KISS_MAX_FRAME + KISS_ACK_TAG_LEN && port < 16 && command < 16);
+	if (command == KISS_CMD_ACKMODE && len > KISS_ACK_TAG_LEN)
+	{
+		data += KISS_ACK_TAG_LEN;
+		len -= KISS_ACK_TAG_LEN;
+	}
+	else if (command != KISS_CMD_DATA)
+	{
+		return;
+	}
+	if (len > KISS_MAX_FRAME || !checkAx25(data, len, &kissTarget->counters))
+	{
+		return;
+	}
+
+	static uint8_t levels[HDLC_ENCODED_LEVELS(KISS_MAX_FRAME, FUZZ_SEED_FLAGS)];
+	size_t count = hdlcEncode(data, len, FUZZ_SEED_FLAGS, levels, sizeof(levels));
+	FUZZ_CHECK(count > 0 || len < HDLC_MIN_FRAME - 2);
+
+	std::vector<uint8_t> decoded;
+	hdlc_deframer_t h;
+	hdlcInit(&h, captureHdlc, &decoded);
+	for (size_t i = 0; i < count; i++)
+	{
+		hdlcBit(&h, levels[i]);
+	}
+	FUZZ_CHECK(count == 0 || (h.frames == 1 && decoded.size() == len && memcmp(decoded.data(), data, len) == 0));
+}
+
+static void fuzzKiss(const uint8_t *data, size_t len)
+{
+	kiss_decoder_t k;
+	kissInit(&k, onKissFrame, NULL);
+	size_t split = len ? data[0] % (len + 1) : 0;
+	size_t delivered = kissInput(&k, data, split);
+	delivered += kissInput(&k, data + split, len - split);
+	FUZZ_CHECK(delivered == k.frames && k.length <= sizeof(k.frame));
+}
+
+static std::vector<uint8_t> seedKiss(const std::vector<uint8_t> &frame)
+{
+	std::vector<uint8_t> out(KISS_MAX_ENCODED(frame.size()));
+	out.resize(kissEncode(0, KISS_CMD_DATA, frame.data(), frame.size(), out.data(), out.size()));
+	return out;
+}
+
+// ---- hdlc: receive path ----
+
+static fuzz_target_t *hdlcTarget;
+
+/**
+ * @brief A frame off the air, handled like onFrame() in afskDecode.cpp
+ */
+static void onHdlcFrame(void *ctx, const uint8_t *frame, size_t len)
+{
+	FUZZ_CHECK(len >= HDLC_MIN_FRAME - 2 && len <= HDLC_MAX_FRAME - 2);
+	checkAx25(frame, len, &hdlcTarget->counters);
+
+	uint8_t encoded[KISS_MAX_ENCODED(KISS_MAX_FRAME)];
+	size_t n = kissEncode(0, KISS_CMD_DATA, frame, len, encoded, sizeof(encoded));
+	FUZZ_CHECK(n > 0);
+
+	kiss_capture_t capture = {};
+	kiss_decoder_t k;
+	kissInit(&k, captureKiss, &capture);
+	kissInput(&k, encoded, n);
+	FUZZ_CHECK(capture.count == 1 && capture.port == 0 && capture.command == KISS_CMD_DATA);
+	FUZZ_CHECK(capture.data.size() == len && memcmp(capture.data.data(), frame, len) == 0);
+}
+
+static void fuzzHdlc(const uint8_t *data, size_t len)
+{
+	hdlc_deframer_t h;
+	hdlcInit(&h, onHdlcFrame, NULL);
+	for (size_t i = 0; i < len; i++)
+	{
+		for (int b = 0; b < 8; b++)
+		{
+			hdlcBit(&h, (data[i] >> b) & 1);
+		}
+	}
+	FUZZ_CHECK(h.length <= HDLC_MAX_FRAME);
+}
+
+static std::vector<uint8_t> seedHdlc(const std::vector<uint8_t> &frame)
+{
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(frame.size(), FUZZ_SEED_FLAGS));
+	levels.resize(hdlcEncode(frame.data(), frame.size(), FUZZ_SEED_FLAGS, levels.data(), levels.size()));
+	std::vector<uint8_t> out((levels.size() + 7) / 8, 0xFF); // Pad with mark, which idles the deframer
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		if (!levels[i])
+		{
+			out[i / 8] &= (uint8_t)~(1 << (i % 8));
+		}
+	}
+	return out;
+}
+
+// ---- ax25: parser and formatter ----
+
+static fuzz_target_t *ax25Target;
+
+static void fuzzAx25(const uint8_t *data, size_t len)
+{
+	checkAx25(data, len, &ax25Target->counters);
+}
+
+static std::vector<uint8_t> seedAx25(const std::vector<uint8_t> &frame)
+{
+	return frame;
+}
+
+static fuzz_target_t targets[] = {
+	{"kiss", fuzzKiss, seedKiss, {}},
+	{"hdlc", fuzzHdlc, seedHdlc, {}},
+	{"ax25", fuzzAx25, seedAx25, {}},
+};
+
+static void bindTargets()
+{
+	kissTarget = &targets[0];
+	hdlcTarget = &targets[1];
+	ax25Target = &targets[2];
+}
+
+// ---- seeds ----
+
+/**
+ * @brief Append an address field: shifted callsign padded with spaces, SSID byte
+ */
+static void putAddress(std::vector<uint8_t> &out, const char *call, uint8_t ssid, uint8_t flags)
+{
+	for (size_t i = 0; i < 6; i++)
+	{
+		char c = i < strlen(call) ? call[i] : ' ';
+		out.push_back((uint8_t)(c << 1));
+	}
+	out.push_back((uint8_t)(0x60 | (ssid << 1) | flags));
+}
+
+/**
+ * @brief Build an APRS UI frame, digis given as "CALL" or "CALL*"
+ */
+static std::vector<uint8_t> makeFrame(const char *source, uint8_t ssid, std::vector<const char *> digis,
+									  const std::string &info)
+{
+	std::vector<uint8_t> f;
+	putAddress(f, "APRS", 0, 0x80);
+	putAddress(f, source, ssid, digis.empty() ? 0x01 : 0x00);
+	for (size_t i = 0; i < digis.size(); i++)
+	{
+		std::string call = digis[i];
+		bool repeated = !call.empty() && call.back() == '*';
+		if (repeated)
+			call.pop_back();
+		putAddress(f, call.c_str(), 0, (repeated ? 0x80 : 0x00) | (i + 1 == digis.size() ? 0x01 : 0x00));
+	}
+	f.push_back(AX25_CONTROL_UI);
+	f.push_back(AX25_PID_NONE);
+	f.insert(f.end(), info.begin(), info.end());
+	return f;
+}
+
+static std::vector<std::vector<uint8_t>> builtinFrames()
+{
+	return {
+		makeFrame("N0CALL", 9, {"WIDE1*", "WIDE2"}, "!4903.50N/07201.75W-Test 001234"),
+		makeFrame("W4KRL", 0, {}, ">ESP32 KISS TNC"),
+		makeFrame("2E0UMR", 7, {"RELAY*", "WIDE2*", "WIDE3"}, "`(_fn\"Oj/]\xC0\xDB\x7E\xFF binary bytes"),
+		makeFrame("K1ABC", 15, {"WIDE1", "WIDE2", "WIDE3", "WIDE4", "WIDE5", "WIDE6", "WIDE7"},
+				  ":N0CALL   :message{001"),
+		makeFrame("VE3XYZ", 1, {"WIDE2"}, std::string(AX25_MAX_INFO, '~')),
+	};
+}
+
+#ifndef TNC_LIBFUZZER
+
+/**
+ * @brief Read frames from the hex column (last field) of batch or sdr output
+ */
+static bool loadFrames(const char *path, std::vector<std::vector<uint8_t>> *frames)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::string hex = line.substr(line.find_last_of('\t') + 1);
+		std::vector<uint8_t> frame;
+		for (size_t i = 0; i + 1 < hex.size(); i += 2)
+			frame.push_back((uint8_t)strtoul(hex.substr(i, 2).c_str(), NULL, 16));
+		if (!frame.empty() && frame.size() <= HDLC_MAX_FRAME - 2)
+			frames->push_back(frame);
+	}
+	return true;
+}
+
+static std::vector<uint8_t> readFile(const std::filesystem::path &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+#endif // TNC_LIBFUZZER
+
+// ---- mutator ----
+
+/**
+ * @brief Apply one to four random edits, biased towards the framing bytes
+ */
+static void mutate(std::vector<uint8_t> &in, const std::vector<std::vector<uint8_t>> &corpus, std::mt19937 &rng)
+{
+	static const uint8_t interesting[] = {KISS_FEND, KISS_FESC, KISS_TFEND, KISS_TFESC, 0x7E, 0xFF, 0x00,
+										  0x01, 0x03, 0xF0, 0x40, 0x60, 0x61, 0x80};
+	int edits = 1 + rng() % 4;
+	for (int e = 0; e < edits; e++)
+	{
+		size_t pos = in.empty() ? 0 : rng() % in.size();
+		switch (rng() % 7)
+		{
+		case 0:
+			if (!in.empty())
+				in[pos] ^= (uint8_t)(1 << (rng() % 8));
+			break;
+		case 1:
+			if (!in.empty())
+				in[pos] = (uint8_t)rng();
+			break;
+		case 2:
+			in.insert(in.begin() + pos, interesting[rng() % sizeof(interesting)]);
+			break;
+		case 3:
+			if (!in.empty())
+				in.erase(in.begin() + pos, in.begin() + pos + 1 + rng() % std::min<size_t>(16, in.size() - pos));
+			break;
+		case 4:
+			if (!in.empty())
+			{
+				size_t n = 1 + rng() % std::min<size_t>(64, in.size() - pos);
+				std::vector<uint8_t> copy(in.begin() + pos, in.begin() + pos + n);
+				in.insert(in.begin() + rng() % (in.size() + 1), copy.begin(), copy.end());
+			}
+			break;
+		case 5:
+		{
+			const std::vector<uint8_t> &other = corpus[rng() % corpus.size()];
+			size_t from = other.empty() ? 0 : rng() % other.size();
+			in.resize(pos);
+			in.insert(in.end(), other.begin() + from, other.end());
+			break;
+		}
+		default:
+			in.resize(pos);
+			break;
+		}
+	}
+	if (in.size() > FUZZ_MAX_INPUT)
+	{
+		in.resize(FUZZ_MAX_INPUT);
+	}
+}
+
+#ifndef TNC_LIBFUZZER
+
+/**
+ * @brief Fuzz one target for a time budget or a number of runs
+ * @return Executions performed
+ */
+static uint64_t fuzzTarget(fuzz_target_t *t, std::vector<std::vector<uint8_t>> corpus, double seconds,
+						   uint64_t runs, uint32_t seed, double *elapsed, uint64_t *bytes)
+{
+	typedef std::chrono::steady_clock clock;
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> input;
+	uint64_t execs = 0;
+	*bytes = 0;
+
+	// Seeds first, unmutated
+	for (const std::vector<uint8_t> &c : corpus)
+	{
+		t->run(c.data(), c.size());
+	}
+
+	auto start = clock::now();
+	for (;;)
+	{
+		if ((execs & 255) == 0 && runs == 0 &&
+			std::chrono::duration<double>(clock::now() - start).count() >= seconds)
+		{
+			break;
+		}
+		if (runs && execs >= runs)
+		{
+			break;
+		}
+
+		input = corpus[rng() % corpus.size()];
+		mutate(input, corpus, rng);
+		uint64_t parsedBefore = t->counters.parsed;
+		t->run(input.data(), input.size());
+		execs++;
+		*bytes += input.size();
+
+		// Keep inputs that still reach the parser, so mutations go deeper than the framing
+		if (t->counters.parsed != parsedBefore && corpus.size() < FUZZ_MAX_CORPUS)
+		{
+			corpus.push_back(input);
+		}
+	}
+	*elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	return execs;
+}
+
+static void usage()
+{
+	fprintf(stderr, "usage: fuzz [options]\n"
+					"  --target T        kiss, hdlc or ax25, repeatable (default all)\n"
+					"  --seconds S       time per target (default 10)\n"
+					"  --runs N          stop after N executions per target instead\n"
+					"  --seed N          mutator seed (default 1)\n"
+					"  --frames FILE     extra seed frames from batch or sdr output\n"
+					"  --corpus DIR      extra raw seed inputs for every selected target\n"
+					"  --write-corpus D  write the seeds to D/<target>/ for libFuzzer and exit\n");
+}
+
+/**
+ * @brief "fuzz" subcommand
+ * @param argc Argument count, argv[0] is "fuzz"
+ * @param argv Options
+ * @return 0 when the run completes (a failed check aborts), 2 on a usage error
+ */
+int fuzzMain(int argc, char **argv)
+{
+	std::vector<fuzz_target_t *> selected;
+	double seconds = 10.0;
+	uint64_t runs = 0;
+	uint32_t seed = 1;
+	const char *corpusDir = NULL;
+	const char *writeDir = NULL;
+	std::vector<std::vector<uint8_t>> frames = builtinFrames();
+
+	bindTargets();
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--target") == 0 && more)
+		{
+			const char *name = argv[++i];
+			fuzz_target_t *found = NULL;
+			for (fuzz_target_t &t : targets)
+				if (strcmp(t.name, name) == 0)
+					found = &t;
+			if (!found)
+			{
+				fprintf(stderr, "unknown target '%s'\n", name);
+				return 2;
+			}
+			selected.push_back(found);
+		}
+		else if (strcmp(argv[i], "--seconds") == 0 && more)
+			seconds = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--runs") == 0 && more)
+			runs = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--frames") == 0 && more)
+		{
+			const char *path = argv[++i];
+			if (!loadFrames(path, &frames))
+			{
+				fprintf(stderr, "%s: cannot read\n", path);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "--corpus") == 0 && more)
+			corpusDir = argv[++i];
+		else if (strcmp(argv[i], "--write-corpus") == 0 && more)
+			writeDir = argv[++i];
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if (selected.empty())
+	{
+		for (fuzz_target_t &t : targets)
+			selected.push_back(&t);
+	}
+
+	for (fuzz_target_t *t : selected)
+	{
+		std::vector<std::vector<uint8_t>> corpus;
+		for (const std::vector<uint8_t> &f : frames)
+			corpus.push_back(t->seed(f));
+		if (corpusDir)
+		{
+			std::error_code error;
+			for (const auto &entry : std::filesystem::directory_iterator(corpusDir, error))
+				if (entry.is_regular_file())
+					corpus.push_back(readFile(entry.path()));
+			if (error)
+			{
+				fprintf(stderr, "%s: %s\n", corpusDir, error.message().c_str());
+				return 2;
+			}
+		}
+
+		if (writeDir)
+		{
+			std::filesystem::path dir = std::filesystem::path(writeDir) / t->name;
+			std::filesystem::create_directories(dir);
+			for (size_t i = 0; i < corpus.size(); i++)
+			{
+				char name[32];
+				snprintf(name, sizeof(name), "seed-%04zu", i);
+				std::ofstream out(dir / name, std::ios::binary);
+				out.write((const char *)corpus[i].data(), corpus[i].size());
+			}
+			printf("%s: %zu seeds in %s\n", t->name, corpus.size(), dir.string().c_str());
+			continue;
+		}
+
+		double elapsed;
+		uint64_t bytes;
+		uint64_t execs = fuzzTarget(t, corpus, seconds, runs, seed, &elapsed, &bytes);
+		printf("%-5s %10llu execs  %9.0f execs/s  %7.2f MB/s  frames %llu  valid ax25 %llu\n", t->name,
+			   (unsigned long long)execs, elapsed > 0 ? execs / elapsed : 0.0, elapsed > 0 ? bytes / elapsed / 1e6 : 0.0,
+			   (unsigned long long)t->counters.frames, (unsigned long long)t->counters.parsed);
+	}
+	return 0;
+}
+
+#else // TNC_LIBFUZZER
+
+// libFuzzer entry points; the target is chosen with TNC_FUZZ_TARGET=kiss|hdlc|ax25
+static fuzz_target_t *libFuzzerTarget;
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	const char *name = getenv("TNC_FUZZ_TARGET");
+	bindTargets();
+	libFuzzerTarget = &targets[0];
+	for (fuzz_target_t &t : targets)
+		if (name && strcmp(t.name, name) == 0)
+			libFuzzerTarget = &t;
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	libFuzzerTarget->run(data, size);
+	return 0;
+}
+
+// Custom mutator: the framing-aware edits above, then libFuzzer's own
+extern "C" size_t LLVMFuzzerMutate(uint8_t *data, size_t size, size_t maxSize);
+
+extern "C" size_t LLVMFuzzerCustomMutator(uint8_t *data, size_t size, size_t maxSize, unsigned int seed)
+{
+	static std::vector<std::vector<uint8_t>> frames;
+	if (frames.empty())
+	{
+		for (const std::vector<uint8_t> &f : builtinFrames())
+			frames.push_back(libFuzzerTarget->seed(f));
+	}
+	std::mt19937 rng(seed);
+	if (rng() % 2)
+	{
+		return LLVMFuzzerMutate(data, size, maxSize);
+	}
+	std::vector<uint8_t> input(data, data + size);
+	mutate(input, frames, rng);
+	size_t n = std::min(input.size(), maxSize);
+	memcpy(data, input.data(), n);
+	return n;
+}
+
+#endif // TNC_LIBFUZZER
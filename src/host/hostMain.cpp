@@ -0,0 +1,71 @@
+/**
+ * @file hostMain.cpp
+ * @date 2025-09-18
+ * @brief Entry point of the tnc-host tool: runs the firmware's portable modules on a PC.
+ *
+ * Usage: program <subcommand> [options]
+ *
+ * env:native-fuzz links libFuzzer's main instead (TNC_LIBFUZZER), see fuzzTargets.cpp.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "hostTools.h"
+
+#ifndef TNC_LIBFUZZER
+
+typedef struct
+{
+	const char *name;
+	int (*run)(int argc, char **argv);
+	const char *help;
+} host_command_t;
+
+static const host_command_t commands[] = {
+	{"batch", batchMain, "decode WAV recordings across all cores"},
+	{"simd", simdMain, "check and benchmark the SIMD receive kernels"},
+	{"demod", demodMain, "packet error rate and CPU time of the demodulator front ends"},
+	{"sdr", sdrMain, "multi-channel APRS receiver for SDR IQ input"},
+	{"sim", simMain, "CSMA stations on a shared virtual channel, in virtual time"},
+	{"net", netMain, "TNC instances exchanging AFSK audio over a virtual RF network"},
+	{"tnc", tncMain, "KISS TNC on a pty or TCP port with looped-back audio"},
+	{"load", loadMain, "KISS load generator and latency profiler"},
+	{"fuzz", fuzzMain, "fuzz the KISS, HDLC and AX.25 input parsers"},
+	{"alloc", allocMain, "fail on heap allocations in the receive and transmit hot paths"},
+	{"inflate", inflateMain, "check and benchmark the OTA image decompressor"},
+	{"eye", eyeMain, "eye diagram and bit timing of a recording or simulated audio"},
+	{"codec", codecMain, "check the I2S codec register setup and block flow on a mock codec"},
+	{"squelch", squelchMain, "wake latency and missed preambles of the receive squelch"},
+	{"tx", txMain, "check the twist and in-band SNR of the transmitted tones"},
+};
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s <subcommand> [options]\n\n", program);
+	for (const host_command_t &c : commands)
+	{
+		fprintf(stderr, "  %-10s %s\n", c.name, c.help);
+	}
+	fprintf(stderr, "\nRun '%s <subcommand> -h' for its options.\n", program);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+	for (const host_command_t &c : commands)
+	{
+		if (strcmp(argv[1], c.name) == 0)
+		{
+			return c.run(argc - 1, argv + 1);
+		}
+	}
+	fprintf(stderr, "unknown subcommand '%s'\n", argv[1]);
+	usage(argv[0]);
+	return 2;
+}
+
+#endif // TNC_LIBFUZZER
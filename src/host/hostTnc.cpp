@@ -0,0 +1,517 @@
+/**
+ * @file hostTnc.cpp
+ * @date 2025-10-04
+ * @brief "tnc" subcommand: a KISS TNC on a pty or TCP port, built from the firmware's portable modules.
+ *
+ * Frames from the client go through the same path as on the device: kiss.h
+ * decoder, a TNC_QUEUE_FRAMES transmit queue, csma.h channel access, then
+ * hdlcEncode() and afskModulator. The audio is looped back with Gaussian noise
+ * at --snr into an afskDemod instance, whose DCD is the busy signal and whose
+ * decoded frames go back to the client, so the "load" subcommand can measure
+ * queueing, time to transmit and loopback decode time without hardware. ACKMODE
+ * frames are acknowledged when their audio has been played, like txQueue.cpp.
+ *
+ * Frames are traced through the same frameTrace.h stages as on the device,
+ * timed by the wall clock; a received frame's closing flag is the nominal time
+ * of its audio block. The stage latencies are printed at exit, and with
+ * --trace every frame's trace as it finishes.
+ *
+ * Everything runs in real time: the clockHal virtual clock follows the wall
+ * clock, and audio is processed in 10 ms blocks.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "ax25.h"
+#include "clockHal.h"
+#include "csma.h"
+#include "frameTrace.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define TNC_RATE 9600
+#define TNC_BLOCK 96 // Samples per block, 10 ms
+#define TNC_BLOCK_US 10000
+#define TNC_TONE_LEVEL 16384
+#define TNC_NOISE_RMS 1000.0f
+#define TNC_QUEUE_FRAMES 4 // As TX_QUEUE_FRAMES on the device
+#define TNC_DEFAULT_SNR 20.0
+#define TNC_READ_CHUNK 64 // As BT_READ_CHUNK on the device
+
+typedef struct
+{
+	std::vector<uint8_t> frame;
+	int32_t ackTag; // ACKMODE tag, -1 for a plain data frame
+	frame_trace_t trace;
+} tnc_frame_t;
+
+typedef struct
+{
+	int fd; // Client connection, -1 while waiting for one
+	kiss_decoder_t kiss;
+	std::deque<tnc_frame_t> queue;
+	size_t queueLimit;
+	csma_t csma;
+	afsk_modulator_t modulator;
+	afsk_demod_t demod;
+	float gain;
+	std::mt19937 noise;
+	clock_timer_t blockTimer;
+	uint64_t block;
+	std::vector<int16_t> txAudio; // Transmission being played
+	size_t txPosition;
+	int32_t txAckTag;
+	bool transmitting;
+	// Tracing
+	std::chrono::steady_clock::time_point started;
+	frame_tracer_t txTracer;
+	frame_tracer_t rxTracer;
+	frame_trace_t txTrace; // Transmission being played
+	uint32_t readUs;	   // Read that completed the frame being decoded
+	bool traceLog;
+	// Counters
+	uint32_t framesIn;
+	uint32_t queueFull;
+	uint32_t rejected; // Not an AX.25 frame, as transmitAX25() would refuse it
+	uint32_t sent;
+	uint32_t acked;
+	uint32_t decoded;
+	uint32_t writeErrors;
+	uint32_t maxQueued;
+} host_tnc_t;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int signal)
+{
+	stopRequested = 1;
+}
+
+/**
+ * @brief Wall clock for traces, microseconds since the TNC started
+ */
+static uint32_t wallUs(const host_tnc_t *t)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+																		   t->started)
+		.count();
+}
+
+/**
+ * @brief Add a finished frame to its tracer, and print it with --trace
+ */
+static void finishTrace(host_tnc_t *t, frame_tracer_t *tracer, const frame_trace_t *f)
+{
+	traceEnd(tracer, f);
+	if (t->traceLog)
+	{
+		char line[FRAME_TRACE_LINE];
+		traceFormatFrame(tracer, f, line, sizeof(line));
+		printf("%s\n", line);
+	}
+}
+
+/**
+ * @brief Write a KISS frame to the client
+ */
+static void sendToClient(host_tnc_t *t, uint8_t command, const uint8_t *data, size_t len)
+{
+	uint8_t encoded[KISS_MAX_ENCODED(KISS_MAX_FRAME)];
+	size_t n = kissEncode(0, command, data, len, encoded, sizeof(encoded));
+	if (t->fd < 0 || n == 0)
+	{
+		return;
+	}
+	for (size_t done = 0; done < n;)
+	{
+		ssize_t w = write(t->fd, encoded + done, n - done);
+		if (w <= 0)
+		{
+			t->writeErrors++;
+			return;
+		}
+		done += (size_t)w;
+	}
+}
+
+/**
+ * @brief A frame from the client: queue data and ACKMODE frames, apply parameters
+ */
+static void onClientFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	host_tnc_t *t = (host_tnc_t *)ctx;
+	if (port != 0)
+	{
+		return;
+	}
+	int32_t ackTag = -1;
+	if (command == KISS_CMD_ACKMODE && len > KISS_ACK_TAG_LEN)
+	{
+		ackTag = (data[0] << 8) | data[1];
+		data += KISS_ACK_TAG_LEN;
+		len -= KISS_ACK_TAG_LEN;
+	}
+	else if (command != KISS_CMD_DATA)
+	{
+		if (len >= 1)
+			csmaSetParam(&t->csma, command, data[0]);
+		return;
+	}
+
+	t->framesIn++;
+	ax25_frame_t parsed;
+	if (len > KISS_MAX_FRAME || ax25Parse(data, len, &parsed) != AX25_OK)
+	{
+		t->rejected++;
+		return;
+	}
+	if (t->queue.size() >= t->queueLimit)
+	{
+		t->queueFull++;
+		return;
+	}
+	tnc_frame_t f = {std::vector<uint8_t>(data, data + len), ackTag, {}};
+	traceBegin(&t->txTracer, &f.trace, port, len);
+	traceStamp(&f.trace, TRACE_TX_RECEIVED, t->readUs);
+	traceStamp(&f.trace, TRACE_TX_QUEUED, wallUs(t));
+	t->queue.push_back(f);
+	t->maxQueued = std::max(t->maxQueued, (uint32_t)t->queue.size());
+	if (!t->transmitting)
+	{
+		csmaRequest(&t->csma);
+	}
+}
+
+static void onDecoded(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	host_tnc_t *t = (host_tnc_t *)ctx;
+	t->decoded++;
+	frame_trace_t trace;
+	traceBegin(&t->rxTracer, &trace, port, len);
+	traceStamp(&trace, TRACE_RX_FLAG, (uint32_t)clockMicros()); // Due time of the block being demodulated
+	traceStamp(&trace, TRACE_RX_CRC, wallUs(t));
+	traceStamp(&trace, TRACE_RX_ROUTED, wallUs(t)); // No digipeater
+	sendToClient(t, KISS_CMD_DATA, frame, len);
+	traceStamp(&trace, TRACE_RX_WRITTEN, wallUs(t));
+	finishTrace(t, &t->rxTracer, &trace);
+}
+
+static bool channelBusy(void *ctx)
+{
+	return afskDemodDcd(&((const host_tnc_t *)ctx)->demod);
+}
+
+/**
+ * @brief Access granted: render the oldest frame; onBlock() plays it
+ */
+static void startTransmission(void *ctx)
+{
+	host_tnc_t *t = (host_tnc_t *)ctx;
+	if (t->queue.empty())
+	{
+		return;
+	}
+	tnc_frame_t f = t->queue.front();
+	t->queue.pop_front();
+	t->txTrace = f.trace;
+	traceStamp(&t->txTrace, TRACE_TX_ACCESS, wallUs(t));
+
+	uint16_t flags = (uint16_t)std::max<uint32_t>(1, (csmaTxDelayUs(&t->csma) * 1200 / 8 + 999999) / 1000000);
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(f.frame.size(), flags));
+	levels.resize(hdlcEncode(f.frame.data(), f.frame.size(), flags, levels.data(), levels.size()));
+
+	int16_t bit[TNC_RATE / 1200 + 2];
+	t->txAudio.clear();
+	afskModulatorReset(&t->modulator);
+	for (uint8_t level : levels)
+	{
+		size_t n = afskModulatorBit(&t->modulator, level, bit);
+		t->txAudio.insert(t->txAudio.end(), bit, bit + n);
+	}
+	t->txPosition = 0;
+	t->txAckTag = f.ackTag;
+	t->transmitting = true;
+	t->sent++;
+	traceStamp(&t->txTrace, TRACE_TX_PTT_ON, wallUs(t));
+}
+
+/**
+ * @brief Every 10 ms: play the next block of the transmission into the loopback receiver
+ */
+static void onBlock(void *ctx)
+{
+	host_tnc_t *t = (host_tnc_t *)ctx;
+	int16_t samples[TNC_BLOCK];
+	std::normal_distribution<float> noise(0.0f, TNC_NOISE_RMS);
+	if (t->transmitting && t->txPosition == 0)
+	{
+		traceStamp(&t->txTrace, TRACE_TX_FIRST_BIT, wallUs(t));
+	}
+	for (size_t i = 0; i < TNC_BLOCK; i++)
+	{
+		float v = noise(t->noise);
+		if (t->transmitting && t->txPosition < t->txAudio.size())
+		{
+			v += t->gain * t->txAudio[t->txPosition++];
+		}
+		samples[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, v));
+	}
+	afskDemodProcess(&t->demod, samples, TNC_BLOCK);
+
+	if (t->transmitting && t->txPosition >= t->txAudio.size())
+	{
+		t->transmitting = false;
+		traceStamp(&t->txTrace, TRACE_TX_LAST_BIT, wallUs(t));
+		traceStamp(&t->txTrace, TRACE_TX_PTT_OFF, wallUs(t));
+		finishTrace(t, &t->txTracer, &t->txTrace);
+		if (t->txAckTag >= 0)
+		{
+			uint8_t tag[KISS_ACK_TAG_LEN] = {(uint8_t)(t->txAckTag >> 8), (uint8_t)t->txAckTag};
+			sendToClient(t, KISS_CMD_ACKMODE, tag, sizeof(tag));
+			t->acked++;
+		}
+		if (!t->queue.empty())
+		{
+			csmaRequest(&t->csma);
+		}
+	}
+
+	t->block++;
+	clockTimerStart(&t->blockTimer, t->block * TNC_BLOCK_US - clockMicros());
+}
+
+/**
+ * @brief Open a pty in raw mode; the slave stays open so clients can come and go
+ * @return Master fd, -1 on failure
+ */
+static int openPty(int *slave)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("pty");
+		return -1;
+	}
+	*slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	struct termios tio;
+	if (*slave >= 0 && tcgetattr(*slave, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(*slave, TCSANOW, &tio);
+	}
+	printf("# KISS on %s\n", ptsname(master));
+	fflush(stdout);
+	return master;
+}
+
+static int listenTcp(int port)
+{
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	int on = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons((uint16_t)port);
+	if (s < 0 || bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, 1) != 0)
+	{
+		perror("listen");
+		return -1;
+	}
+	printf("# KISS on tcp 127.0.0.1:%d\n", port);
+	fflush(stdout);
+	return s;
+}
+
+static void tncUsage()
+{
+	fprintf(stderr,
+			"usage: tnc [options]\n"
+			"  --pty            serve KISS on a new pty, name printed at start (default)\n"
+			"  --listen PORT    serve KISS on 127.0.0.1:PORT, one client at a time\n"
+			"  --snr DB         loopback SNR (default %.0f)\n"
+			"  --queue N        transmit queue length (default %d)\n"
+			"  --txdelay N --persist N --slottime N   initial KISS parameters\n"
+			"  --seconds S      stop after S seconds (default: run until interrupted)\n"
+			"  --trace          print every frame's stage timestamps\n"
+			"  --seed N         noise seed (default 1)\n",
+			TNC_DEFAULT_SNR, TNC_QUEUE_FRAMES);
+}
+
+/**
+ * @brief "tnc" subcommand
+ * @param argc Argument count, argv[0] is "tnc"
+ * @param argv Options
+ * @return 0 on success, 1 if the pty or socket cannot be opened, 2 on a usage error
+ */
+int tncMain(int argc, char **argv)
+{
+	int listenPort = 0;
+	double snr = TNC_DEFAULT_SNR;
+	size_t queueLimit = TNC_QUEUE_FRAMES;
+	int txDelay = -1, persist = -1, slotTime = -1;
+	double seconds = 0;
+	unsigned seed = 1;
+	bool traceLog = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--pty") == 0)
+			listenPort = 0;
+		else if (strcmp(argv[i], "--listen") == 0 && more)
+			listenPort = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--snr") == 0 && more)
+			snr = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--queue") == 0 && more)
+			queueLimit = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--txdelay") == 0 && more)
+			txDelay = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--persist") == 0 && more)
+			persist = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--slottime") == 0 && more)
+			slotTime = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seconds") == 0 && more)
+			seconds = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--trace") == 0)
+			traceLog = true;
+		else
+		{
+			tncUsage();
+			return 2;
+		}
+	}
+	if (listenPort < 0 || listenPort > 65535 || queueLimit < 1 || txDelay > 255 || persist > 255 || slotTime > 255 ||
+		seconds < 0)
+	{
+		tncUsage();
+		return 2;
+	}
+
+	static host_tnc_t t; // Large, and its address is registered with clockHal
+	t = host_tnc_t();
+	t.fd = -1;
+	t.queueLimit = queueLimit;
+	t.gain = (float)(TNC_NOISE_RMS * sqrt(2.0) * pow(10.0, snr / 20.0) / TNC_TONE_LEVEL);
+	t.noise.seed(seed);
+	t.traceLog = traceLog;
+	traceInit(&t.txTracer, "TX", traceTxStageNames, TRACE_TX_STAGES);
+	traceInit(&t.rxTracer, "RX", traceRxStageNames, TRACE_RX_STAGES);
+	clockReset();
+	kissInit(&t.kiss, onClientFrame, &t);
+	csmaInit(&t.csma, channelBusy, startTransmission, &t, seed);
+	if (txDelay >= 0)
+		csmaSetParam(&t.csma, KISS_CMD_TXDELAY, (uint8_t)txDelay);
+	if (persist >= 0)
+		csmaSetParam(&t.csma, KISS_CMD_PERSIST, (uint8_t)persist);
+	if (slotTime >= 0)
+		csmaSetParam(&t.csma, KISS_CMD_SLOTTIME, (uint8_t)slotTime);
+	const afsk_profile_t profile = {1200, 2200, 1200, TNC_RATE};
+	afskModulatorInit(&t.modulator, TNC_RATE, 1200, 2200, 1200);
+	afskModulatorSetLevels(&t.modulator, TNC_TONE_LEVEL, TNC_TONE_LEVEL);
+	afskDemodInit(&t.demod, &profile, 0, onDecoded, &t);
+	clockTimerInit(&t.blockTimer, onBlock, &t);
+	clockTimerStart(&t.blockTimer, 0);
+
+	int slave = -1;
+	int server = listenPort ? listenTcp(listenPort) : openPty(&slave);
+	if (server < 0)
+	{
+		clockReset();
+		return 1;
+	}
+	if (!listenPort)
+	{
+		t.fd = server;
+	}
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	auto started = std::chrono::steady_clock::now();
+	t.started = started;
+	uint64_t limitUs = (uint64_t)(seconds * 1e6);
+	while (!stopRequested)
+	{
+		uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+		if (limitUs && now >= limitUs)
+		{
+			break;
+		}
+		clockAdvance(now);
+
+		struct pollfd p = {t.fd >= 0 ? t.fd : server, POLLIN, 0};
+		int waitMs = (int)((t.block * TNC_BLOCK_US > now ? t.block * TNC_BLOCK_US - now : 0) / 1000);
+		if (poll(&p, 1, waitMs) <= 0 || !(p.revents & (POLLIN | POLLHUP | POLLERR)))
+		{
+			continue;
+		}
+		if (t.fd < 0)
+		{
+			t.fd = accept(server, NULL, NULL);
+			kissInit(&t.kiss, onClientFrame, &t);
+			continue;
+		}
+		uint8_t buf[TNC_READ_CHUNK];
+		ssize_t n = read(t.fd, buf, sizeof(buf));
+		if (n > 0)
+		{
+			t.readUs = wallUs(&t);
+			kissInput(&t.kiss, buf, (size_t)n);
+		}
+		else if (listenPort)
+		{
+			close(t.fd); // Client left, wait for the next one
+			t.fd = -1;
+		}
+		else
+		{
+			usleep(TNC_BLOCK_US); // No client on the pty slave yet
+		}
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	printf("# %.1f s: frames in %u, rejected %u, queue full %u, max queued %u, sent %u, acked %u, decoded %u, "
+		   "write errors %u\n",
+		   elapsed, t.framesIn, t.rejected, t.queueFull, t.maxQueued, t.sent, t.acked, t.decoded, t.writeErrors);
+	printf("# busy slots %u, deferred slots %u, mean access %.0f ms, kiss overflows %u, bad escapes %u\n",
+		   t.csma.busySlots, t.csma.deferredSlots, t.csma.grants ? t.csma.accessDelayUs / 1000.0 / t.csma.grants : 0.0,
+		   t.kiss.overflows, t.kiss.badEscapes);
+	char line[FRAME_TRACE_LINE];
+	for (const frame_tracer_t *tracer : {&t.txTracer, &t.rxTracer})
+	{
+		for (uint8_t slot = 0; slot < tracer->stages; slot++)
+		{
+			if (traceFormatStage(tracer, slot, line, sizeof(line)) > 0)
+				printf("# %s\n", line);
+		}
+	}
+
+	if (t.fd >= 0 && t.fd != server)
+		close(t.fd);
+	close(server);
+	if (slave >= 0)
+		close(slave);
+	clockReset();
+	return 0;
+}
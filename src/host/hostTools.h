@@ -0,0 +1,45 @@
+/**
+ * @file hostTools.h
+ * @date 2025-09-18
+ * @brief Subcommands of the tnc-host tool (built by env:native).
+ *
+ * Each subcommand gets argv with its own name in argv[0] and returns the
+ * process exit code.
+ *
+ * Subcommands:
+ * - batchMain(): Decode WAV recordings in parallel and print a merged frame list.
+ * - simdMain(): Check the SIMD kernels against the scalar reference and benchmark them.
+ * - demodMain(): Compare packet error rate and CPU time of the demodulator front ends.
+ * - sdrMain(): Channelize SDR IQ and decode APRS on every channel.
+ * - simMain(): Simulate CSMA stations on a shared channel with the virtual clock.
+ * - netMain(): Run TNC instances over a virtual RF network with hidden nodes and per-link SNR.
+ * - tncMain(): Serve KISS on a pty or TCP port, transmitting into a loopback receiver.
+ * - loadMain(): Drive a TNC over serial, pty or TCP and measure queueing, transmit and loopback times.
+ * - fuzzMain(): Fuzz the KISS decoder, HDLC deframer and AX.25 parser.
+ * - allocMain(): Fail if a receive, transmit or host-link hot path allocates.
+ * - inflateMain(): Check and benchmark the OTA image decompressor on packed images.
+ * - eyeMain(): Eye diagram and bit timing of a recording or simulated audio.
+ * - codecMain(): Check the codec init sequences against the datasheet order, and the codec block path.
+ * - squelchMain(): Check the squelch wake latency and missed preambles on simulated bursts.
+ * - txMain(): Check the twist and the noise-shaped in-band SNR of the transmit waveforms.
+ */
+#ifndef HOST_TOOLS_H
+#define HOST_TOOLS_H
+
+int batchMain(int argc, char **argv);
+int simdMain(int argc, char **argv);
+int demodMain(int argc, char **argv);
+int sdrMain(int argc, char **argv);
+int simMain(int argc, char **argv);
+int netMain(int argc, char **argv);
+int tncMain(int argc, char **argv);
+int loadMain(int argc, char **argv);
+int fuzzMain(int argc, char **argv);
+int allocMain(int argc, char **argv);
+int inflateMain(int argc, char **argv);
+int eyeMain(int argc, char **argv);
+int codecMain(int argc, char **argv);
+int squelchMain(int argc, char **argv);
+int txMain(int argc, char **argv);
+
+#endif // HOST_TOOLS_H
@@ -0,0 +1,275 @@
+/**
+ * @file inflateCheck.cpp
+ * @date 2025-10-12
+ * @brief "inflate" subcommand: check and benchmark the streaming OTA decompressor.
+ *
+ * Runs gzipInflate.cpp, the code the firmware uses for compressed OTA images,
+ * on real images packed by tools/otaPack.py. For each image.bin.gz:
+ * - the reference output is image.bin next to it if there is one, otherwise a
+ *   one-shot inflate of the whole file
+ * - the image is inflated in random chunks of 1 to --chunk bytes, and once a
+ *   byte at a time, and must match the reference exactly
+ * - every truncation tried must stop short of GZIP_DONE
+ * - every corrupted copy must fail, or complete with the reference output (a
+ *   change in the file name, for example)
+ * - timed runs with --chunk-byte chunks give the inflate rate
+ * Exits 1 if any check fails.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "gzipInflate.h"
+#include "hostTools.h"
+
+#define INFLATE_DEFAULT_CHUNK 1460 // One TCP segment, as the upload arrives
+#define INFLATE_DEFAULT_REPEAT 5
+#define INFLATE_DEFAULT_CORRUPT 200
+#define INFLATE_TRUNCATIONS 50
+
+// Compares the output with the reference as it is flushed
+typedef struct
+{
+	const std::vector<uint8_t> *reference;
+	std::vector<uint8_t> *capture; // Or keeps it, for the one-shot reference
+	size_t offset;
+	bool match;
+} inflate_sink_t;
+
+static void inflateUsage()
+{
+	fprintf(stderr,
+			"usage: program inflate [options] image.bin.gz...\n"
+			"  --window-bits N  decompressor window, as OTA_INFLATE_WINDOW_BITS (default %d)\n"
+			"  --chunk N        largest input chunk (default %d)\n"
+			"  --repeat N       timed runs per image (default %d)\n"
+			"  --corrupt N      corrupted copies per image (default %d)\n"
+			"  --seed N         random seed for chunks and corruption\n",
+			GZIP_MAX_WINDOW_BITS, INFLATE_DEFAULT_CHUNK, INFLATE_DEFAULT_REPEAT, INFLATE_DEFAULT_CORRUPT);
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		return false;
+	}
+	uint8_t buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+	{
+		data.insert(data.end(), buf, buf + n);
+	}
+	fclose(f);
+	return true;
+}
+
+static bool onOutput(void *ctx, const uint8_t *data, size_t len)
+{
+	inflate_sink_t *sink = (inflate_sink_t *)ctx;
+	if (sink->capture)
+	{
+		sink->capture->insert(sink->capture->end(), data, data + len);
+		return true;
+	}
+	if (!sink->match || sink->offset + len > sink->reference->size() ||
+		memcmp(sink->reference->data() + sink->offset, data, len) != 0)
+	{
+		sink->match = false;
+	}
+	sink->offset += len;
+	return true;
+}
+
+/**
+ * @brief Inflate input in chunks of 1..maxChunk bytes, random when randomize
+ * @return Final status; sink->match tells whether the output was the reference
+ */
+static gzip_status_t inflateChunks(const std::vector<uint8_t> &input, size_t len, size_t maxChunk, bool randomize,
+								   uint8_t windowBits, std::vector<uint8_t> &window, inflate_sink_t *sink)
+{
+	gzip_inflate_t z;
+	gzipInflateInit(&z, window.data(), windowBits, onOutput, sink);
+	gzip_status_t status = GZIP_MORE;
+	size_t pos = 0;
+	while (pos < len && status == GZIP_MORE)
+	{
+		size_t n = randomize ? 1 + (size_t)rand() % maxChunk : maxChunk;
+		if (n > len - pos)
+		{
+			n = len - pos;
+		}
+		status = gzipInflateInput(&z, input.data() + pos, n);
+		pos += n;
+	}
+	if (status == GZIP_DONE && sink->offset != sink->reference->size())
+	{
+		sink->match = false;
+	}
+	return status;
+}
+
+static gzip_status_t check(const std::vector<uint8_t> &input, size_t len, size_t maxChunk, bool randomize,
+						   uint8_t windowBits, std::vector<uint8_t> &window, const std::vector<uint8_t> &reference,
+						   bool *match)
+{
+	inflate_sink_t sink = {&reference, NULL, 0, true};
+	gzip_status_t status = inflateChunks(input, len, maxChunk, randomize, windowBits, window, &sink);
+	*match = sink.match;
+	return status;
+}
+
+/**
+ * @brief Run every check on one image
+ * @return Number of failed checks
+ */
+static int checkImage(const char *path, uint8_t windowBits, size_t maxChunk, int repeat, int corrupt)
+{
+	std::vector<uint8_t> input;
+	if (!readFile(path, input))
+	{
+		fprintf(stderr, "%s: cannot read\n", path);
+		return 1;
+	}
+	std::vector<uint8_t> window((size_t)1 << windowBits);
+	int failures = 0;
+	bool match;
+
+	// Reference: the uncompressed image if it is next to the .gz, else a one-shot inflate
+	std::vector<uint8_t> reference;
+	std::string raw(path);
+	bool haveRaw = raw.size() > 3 && raw.compare(raw.size() - 3, 3, ".gz") == 0 &&
+				   readFile(raw.substr(0, raw.size() - 3).c_str(), reference);
+	if (!haveRaw)
+	{
+		inflate_sink_t sink = {&reference, &reference, 0, true};
+		gzip_status_t status = inflateChunks(input, input.size(), input.size(), false, windowBits, window, &sink);
+		if (status != GZIP_DONE)
+		{
+			printf("%s: FAIL one-shot inflate: %s\n", path, gzipInflateStatusString(status));
+			return 1;
+		}
+	}
+
+	gzip_status_t status = check(input, input.size(), maxChunk, true, windowBits, window, reference, &match);
+	if (status != GZIP_DONE || !match)
+	{
+		printf("%s: FAIL random chunks: %s%s\n", path, gzipInflateStatusString(status),
+			   status == GZIP_DONE ? ", output differs" : "");
+		if (status == GZIP_ERROR_DISTANCE)
+		{
+			printf("%s: packed with a larger window than %u bits\n", path, windowBits);
+		}
+		return 1;
+	}
+	status = check(input, input.size(), 1, false, windowBits, window, reference, &match);
+	if (status != GZIP_DONE || !match)
+	{
+		printf("%s: FAIL byte at a time: %s\n", path, gzipInflateStatusString(status));
+		failures++;
+	}
+
+	int truncated = 0;
+	for (int i = 0; i < INFLATE_TRUNCATIONS; i++)
+	{
+		size_t len = (size_t)rand() % input.size();
+		if (check(input, len, maxChunk, true, windowBits, window, reference, &match) == GZIP_DONE)
+		{
+			printf("%s: FAIL truncated to %zu bytes but complete\n", path, len);
+			truncated++;
+		}
+	}
+	failures += truncated;
+
+	int detected = 0;
+	int harmless = 0;
+	std::vector<uint8_t> damaged;
+	for (int i = 0; i < corrupt; i++)
+	{
+		damaged = input;
+		size_t at = (size_t)rand() % damaged.size();
+		damaged[at] ^= (uint8_t)(1 + rand() % 255);
+		status = check(damaged, damaged.size(), maxChunk, true, windowBits, window, reference, &match);
+		if (status != GZIP_DONE)
+		{
+			detected++;
+		}
+		else if (match)
+		{
+			harmless++;
+		}
+		else
+		{
+			printf("%s: FAIL byte %zu corrupted, wrong output accepted\n", path, at);
+			failures++;
+		}
+	}
+
+	double best = 0;
+	for (int i = 0; i < repeat; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		check(input, input.size(), maxChunk, false, windowBits, window, reference, &match);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (i == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+
+	printf("%s: %s, %zu -> %zu bytes (%.1f%%), %s, corruption %d detected %d harmless, %.1f MB/s out\n", path,
+		   failures ? "FAIL" : "OK", input.size(), reference.size(), 100.0 * input.size() / reference.size(),
+		   haveRaw ? "matches the .bin" : "no .bin to compare", detected, harmless,
+		   best > 0 ? reference.size() / best / 1e6 : 0.0);
+	return failures;
+}
+
+int inflateMain(int argc, char **argv)
+{
+	unsigned windowBits = GZIP_MAX_WINDOW_BITS;
+	size_t maxChunk = INFLATE_DEFAULT_CHUNK;
+	int repeat = INFLATE_DEFAULT_REPEAT;
+	int corrupt = INFLATE_DEFAULT_CORRUPT;
+	unsigned seed = 1;
+	std::vector<const char *> images;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--window-bits") == 0 && more)
+			windowBits = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--chunk") == 0 && more)
+			maxChunk = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--repeat") == 0 && more)
+			repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--corrupt") == 0 && more)
+			corrupt = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0] == '-')
+		{
+			inflateUsage();
+			return 2;
+		}
+		else
+			images.push_back(argv[i]);
+	}
+	if (images.empty() || maxChunk < 1 || repeat < 1 || corrupt < 0 || windowBits < GZIP_MIN_WINDOW_BITS ||
+		windowBits > GZIP_MAX_WINDOW_BITS)
+	{
+		inflateUsage();
+		return 2;
+	}
+
+	srand(seed);
+	int failures = 0;
+	for (const char *path : images)
+	{
+		failures += checkImage(path, (uint8_t)windowBits, maxChunk, repeat, corrupt);
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,514 @@
+/**
+ * @file kissLoad.cpp
+ * @date 2025-10-04
+ * @brief "load" subcommand: KISS load generator and latency profiler for a TNC.
+ *
+ * Connects to a TNC over a serial device or pty (--device) or TCP KISS (--tcp),
+ * which can be the device over Bluetooth serial or the "tnc" subcommand, and
+ * sends AX.25 UI frames at a set rate and size. Each frame carries a sequence
+ * number in its info field and, with --ackmode, in a KISS ACKMODE tag. Per frame
+ * it measures:
+ * - write: how long the write blocked, back-pressure from the link and checkBTforData()
+ * - ack: time to transmit, from the write to the ACKMODE acknowledgement
+ * - loopback: time to the TNC decoding the frame off the air, with the radio
+ *   audio looped back to the input (the "tnc" subcommand always does this)
+ * A frame with neither an ack nor a loopback within --timeout is counted as
+ * dropped; with --ackmode, an unacknowledged frame was refused by the queue.
+ *
+ * Output: counters, throughput and a doubling-bucket histogram per measurement.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "ax25.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define LOAD_DEFAULT_RATE 1.0 // Frames per second
+#define LOAD_DEFAULT_COUNT 100
+#define LOAD_DEFAULT_MIN_BYTES 40
+#define LOAD_DEFAULT_MAX_BYTES 120
+#define LOAD_DEFAULT_TIMEOUT 30.0 // Seconds to wait for the last ack or loopback
+#define LOAD_DEFAULT_BAUD 115200
+#define LOAD_DEFAULT_CALL "N0CALL"
+#define LOAD_TAG_FORMAT "{LOAD %08X %08X}" // Run nonce and sequence number, at the start of the info field
+#define LOAD_MIN_BYTES (2 * AX25_ADDRESS_LEN + 2 + 24) // Frame holding just the tag
+
+typedef struct
+{
+	uint64_t sentUs;
+	uint64_t writeUs;
+	uint64_t ackUs;		 // 0 until acknowledged
+	uint64_t loopbackUs; // 0 until decoded
+	size_t bytes;
+} load_frame_t;
+
+typedef struct
+{
+	int fd;
+	uint32_t nonce;
+	std::vector<load_frame_t> frames;
+	std::chrono::steady_clock::time_point started;
+	uint32_t unknownAcks;
+	uint32_t duplicates;
+	uint32_t otherFrames; // Decoded frames that are not ours
+} load_run_t;
+
+static load_run_t *run;
+
+static uint64_t elapsedUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - run->started)
+		.count();
+}
+
+static speed_t baudConstant(long baud)
+{
+	switch (baud)
+	{
+	case 9600:
+		return B9600;
+	case 19200:
+		return B19200;
+	case 38400:
+		return B38400;
+	case 57600:
+		return B57600;
+	case 115200:
+		return B115200;
+	case 230400:
+		return B230400;
+	case 460800:
+		return B460800;
+	case 921600:
+		return B921600;
+	default:
+		return B0;
+	}
+}
+
+/**
+ * @brief Open a serial device or pty in raw mode
+ */
+static int openDevice(const char *path, long baud)
+{
+	int fd = open(path, O_RDWR | O_NOCTTY);
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(fd, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		speed_t speed = baudConstant(baud);
+		if (speed != B0)
+		{
+			cfsetispeed(&tio, speed);
+			cfsetospeed(&tio, speed);
+		}
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+/**
+ * @brief Connect to HOST:PORT
+ */
+static int openTcp(const char *target)
+{
+	std::string host(target);
+	size_t colon = host.rfind(':');
+	if (colon == std::string::npos)
+	{
+		fprintf(stderr, "%s: expected HOST:PORT\n", target);
+		return -1;
+	}
+	std::string port = host.substr(colon + 1);
+	host.resize(colon);
+
+	struct addrinfo hints = {};
+	struct addrinfo *found = NULL;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0)
+	{
+		fprintf(stderr, "%s: cannot resolve\n", target);
+		return -1;
+	}
+	int fd = -1;
+	for (struct addrinfo *a = found; a && fd < 0; a = a->ai_next)
+	{
+		fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(found);
+	if (fd < 0)
+	{
+		perror(target);
+	}
+	return fd;
+}
+
+static void putAddress(std::vector<uint8_t> &out, const char *call, uint8_t ssid, bool last)
+{
+	size_t n = strlen(call);
+	for (size_t i = 0; i < 6; i++)
+	{
+		out.push_back((uint8_t)((i < n ? call[i] : ' ') << 1));
+	}
+	out.push_back((uint8_t)(0x60 | (ssid << 1) | (last ? 0x01 : 0x00)));
+}
+
+/**
+ * @brief Sequence number of one of our frames, -1 for anything else
+ */
+static int64_t frameSequence(const uint8_t *frame, size_t len)
+{
+	ax25_frame_t f;
+	unsigned nonce, sequence;
+	char tag[32];
+	if (ax25Parse(frame, len, &f) != AX25_OK)
+	{
+		return -1;
+	}
+	size_t n = std::min(f.infoLength, sizeof(tag) - 1);
+	memcpy(tag, f.info, n);
+	tag[n] = '\0';
+	if (sscanf(tag, "{LOAD %8X %8X}", &nonce, &sequence) != 2 || nonce != run->nonce ||
+		sequence >= run->frames.size())
+	{
+		return -1;
+	}
+	return sequence;
+}
+
+/**
+ * @brief A frame from the TNC: an ACKMODE acknowledgement or a decoded frame
+ */
+static void onTncFrame(void *ctx, uint8_t port, uint8_t command, const uint8_t *data, size_t len)
+{
+	uint64_t now = elapsedUs();
+	if (command == KISS_CMD_ACKMODE && len == KISS_ACK_TAG_LEN)
+	{
+		uint16_t tag = (uint16_t)((data[0] << 8) | data[1]);
+		// Tags wrap at 65536 frames; the oldest unacknowledged frame with this tag is the one
+		for (size_t i = tag; i < run->frames.size(); i += 0x10000)
+		{
+			if (run->frames[i].ackUs == 0)
+			{
+				run->frames[i].ackUs = now;
+				return;
+			}
+		}
+		run->unknownAcks++;
+	}
+	else if (command == KISS_CMD_DATA)
+	{
+		int64_t sequence = frameSequence(data, len);
+		if (sequence < 0)
+		{
+			run->otherFrames++;
+			return;
+		}
+		load_frame_t &f = run->frames[sequence];
+		if (f.loopbackUs)
+			run->duplicates++;
+		else
+			f.loopbackUs = now;
+	}
+}
+
+/**
+ * @brief Read whatever the TNC has sent, waiting up to timeoutMs for the first byte
+ * @return false once the connection is closed
+ */
+static bool pump(kiss_decoder_t *k, int timeoutMs)
+{
+	struct pollfd p = {run->fd, POLLIN, 0};
+	while (poll(&p, 1, timeoutMs) > 0)
+	{
+		uint8_t buf[512];
+		ssize_t n = read(run->fd, buf, sizeof(buf));
+		if (n <= 0)
+		{
+			return false;
+		}
+		kissInput(k, buf, (size_t)n);
+		timeoutMs = 0;
+	}
+	return true;
+}
+
+static bool writeAll(const uint8_t *data, size_t len)
+{
+	for (size_t done = 0; done < len;)
+	{
+		ssize_t w = write(run->fd, data + done, len - done);
+		if (w <= 0)
+		{
+			return false;
+		}
+		done += (size_t)w;
+	}
+	return true;
+}
+
+static uint64_t percentile(std::vector<uint64_t> &v, double p)
+{
+	if (v.empty())
+		return 0;
+	size_t k = std::min(v.size() - 1, (size_t)(p * v.size()));
+	std::nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+/**
+ * @brief Percentiles and doubling buckets from 1 ms of one measurement
+ */
+static void printHistogram(const char *name, std::vector<uint64_t> v)
+{
+	printf("# %s ms: n %zu", name, v.size());
+	if (v.empty())
+	{
+		printf("\n");
+		return;
+	}
+	printf(", p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n", percentile(v, 0.5) / 1000.0, percentile(v, 0.9) / 1000.0,
+		   percentile(v, 0.99) / 1000.0, percentile(v, 1.0) / 1000.0);
+	std::sort(v.begin(), v.end());
+	size_t done = 0;
+	for (uint64_t upper = 1000; done < v.size(); upper *= 2)
+	{
+		size_t inBucket = std::upper_bound(v.begin(), v.end(), upper) - v.begin() - done;
+		if (inBucket || done)
+		{
+			printf("#   <= %7llu ms %7zu %5.1f%%\n", (unsigned long long)(upper / 1000), inBucket,
+				   100.0 * inBucket / v.size());
+		}
+		done += inBucket;
+	}
+}
+
+static void loadUsage()
+{
+	fprintf(stderr,
+			"usage: load (--device PATH | --tcp HOST:PORT) [options]\n"
+			"  --baud N         serial speed (default %d)\n"
+			"  --rate F         frames per second (default %.1f)\n"
+			"  --poisson        exponential gaps instead of a fixed interval\n"
+			"  --burst N        frames written back to back at each send time (default 1)\n"
+			"  --count N        frames to send (default %d)\n"
+			"  --bytes MIN:MAX  AX.25 frame length range (default %d:%d)\n"
+			"  --ackmode        send KISS ACKMODE frames and time the acknowledgements\n"
+			"  --call CALL      source callsign (default %s)\n"
+			"  --timeout S      wait for outstanding acks and loopbacks (default %.0f)\n"
+			"  --seed N         random seed (default: time)\n",
+			LOAD_DEFAULT_BAUD, LOAD_DEFAULT_RATE, LOAD_DEFAULT_COUNT, LOAD_DEFAULT_MIN_BYTES, LOAD_DEFAULT_MAX_BYTES,
+			LOAD_DEFAULT_CALL, LOAD_DEFAULT_TIMEOUT);
+}
+
+/**
+ * @brief "load" subcommand
+ * @param argc Argument count, argv[0] is "load"
+ * @param argv Options
+ * @return 0 on success, 1 if the TNC cannot be reached or the link drops, 2 on a usage error
+ */
+int loadMain(int argc, char **argv)
+{
+	const char *device = NULL;
+	const char *tcp = NULL;
+	long baud = LOAD_DEFAULT_BAUD;
+	double rate = LOAD_DEFAULT_RATE;
+	bool poisson = false;
+	unsigned burst = 1;
+	size_t count = LOAD_DEFAULT_COUNT;
+	size_t minBytes = LOAD_DEFAULT_MIN_BYTES;
+	size_t maxBytes = LOAD_DEFAULT_MAX_BYTES;
+	bool ackmode = false;
+	const char *call = LOAD_DEFAULT_CALL;
+	double timeout = LOAD_DEFAULT_TIMEOUT;
+	unsigned seed = (unsigned)time(NULL);
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--device") == 0 && more)
+			device = argv[++i];
+		else if (strcmp(argv[i], "--tcp") == 0 && more)
+			tcp = argv[++i];
+		else if (strcmp(argv[i], "--baud") == 0 && more)
+			baud = atol(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && more)
+			rate = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--poisson") == 0)
+			poisson = true;
+		else if (strcmp(argv[i], "--burst") == 0 && more)
+			burst = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--count") == 0 && more)
+			count = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bytes") == 0 && more)
+		{
+			char *end;
+			minBytes = strtoul(argv[++i], &end, 10);
+			maxBytes = *end == ':' ? strtoul(end + 1, NULL, 10) : minBytes;
+		}
+		else if (strcmp(argv[i], "--ackmode") == 0)
+			ackmode = true;
+		else if (strcmp(argv[i], "--call") == 0 && more)
+			call = argv[++i];
+		else if (strcmp(argv[i], "--timeout") == 0 && more)
+			timeout = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			loadUsage();
+			return 2;
+		}
+	}
+	// Two addresses, control, PID and the tag
+	if ((device == NULL) == (tcp == NULL) || rate <= 0 || burst < 1 || count < 1 || minBytes < LOAD_MIN_BYTES ||
+		maxBytes < minBytes || maxBytes > KISS_MAX_FRAME || strlen(call) < 1 || strlen(call) > 6 || timeout < 0)
+	{
+		loadUsage();
+		return 2;
+	}
+	if (device && baudConstant(baud) == B0)
+	{
+		fprintf(stderr, "unsupported baud rate %ld\n", baud);
+		return 2;
+	}
+
+	load_run_t r = {};
+	run = &r;
+	std::mt19937 rng(seed);
+	r.nonce = (uint32_t)rng();
+	r.fd = device ? openDevice(device, baud) : openTcp(tcp);
+	if (r.fd < 0)
+	{
+		run = NULL;
+		return 1;
+	}
+	r.frames.reserve(count);
+	kiss_decoder_t k;
+	kissInit(&k, onTncFrame, NULL);
+	r.started = std::chrono::steady_clock::now();
+
+	bool linkUp = true;
+	double nextSendUs = 0;
+	std::vector<uint8_t> encoded(KISS_MAX_ENCODED(KISS_MAX_FRAME + KISS_ACK_TAG_LEN));
+	while (linkUp && r.frames.size() < count)
+	{
+		uint64_t now = elapsedUs();
+		if (now < nextSendUs)
+		{
+			linkUp = pump(&k, (int)((nextSendUs - now + 999) / 1000));
+			continue;
+		}
+		for (unsigned b = 0; b < burst && r.frames.size() < count && linkUp; b++)
+		{
+			uint32_t sequence = (uint32_t)r.frames.size();
+			size_t bytes = minBytes + rng() % (maxBytes - minBytes + 1);
+			std::vector<uint8_t> payload;
+			if (ackmode)
+			{
+				payload.push_back((uint8_t)(sequence >> 8));
+				payload.push_back((uint8_t)sequence);
+			}
+			size_t start = payload.size();
+			putAddress(payload, "APRS", 0, false);
+			putAddress(payload, call, 0, true);
+			payload.push_back(AX25_CONTROL_UI);
+			payload.push_back(AX25_PID_NONE);
+			char tag[32];
+			int n = snprintf(tag, sizeof(tag), LOAD_TAG_FORMAT, r.nonce, sequence);
+			payload.insert(payload.end(), tag, tag + n);
+			while (payload.size() - start < bytes)
+			{
+				payload.push_back((uint8_t)('a' + rng() % 26));
+			}
+
+			size_t len = kissEncode(0, ackmode ? KISS_CMD_ACKMODE : KISS_CMD_DATA, payload.data(), payload.size(),
+									encoded.data(), encoded.size());
+			load_frame_t f = {elapsedUs(), 0, 0, 0, bytes};
+			linkUp = writeAll(encoded.data(), len);
+			f.writeUs = elapsedUs() - f.sentUs;
+			r.frames.push_back(f);
+		}
+		double gapUs = 1e6 / rate;
+		nextSendUs += poisson ? -log(1.0 - (rng() >> 5) * (1.0 / 134217728.0)) * gapUs : gapUs;
+	}
+
+	// Wait for the stragglers
+	uint64_t deadline = elapsedUs() + (uint64_t)(timeout * 1e6);
+	while (linkUp && elapsedUs() < deadline)
+	{
+		bool outstanding = false;
+		for (const load_frame_t &f : r.frames)
+			outstanding = outstanding || (ackmode && !f.ackUs) || !f.loopbackUs;
+		if (!outstanding)
+			break;
+		linkUp = pump(&k, 100);
+	}
+	close(r.fd);
+
+	std::vector<uint64_t> writes, acks, loopbacks;
+	uint64_t ackedBytes = 0, lastAckUs = 0;
+	size_t dropped = 0;
+	for (const load_frame_t &f : r.frames)
+	{
+		writes.push_back(f.writeUs);
+		if (f.ackUs)
+		{
+			acks.push_back(f.ackUs - f.sentUs);
+			ackedBytes += f.bytes;
+			lastAckUs = std::max(lastAckUs, f.ackUs);
+		}
+		if (f.loopbackUs)
+			loopbacks.push_back(f.loopbackUs - f.sentUs);
+		if (!f.ackUs && !f.loopbackUs)
+			dropped++;
+	}
+	double sendSeconds = r.frames.empty() ? 0 : (r.frames.back().sentUs + 1) / 1e6;
+	printf("# sent %zu frames in %.1f s (%.2f/s offered), acked %zu, looped back %zu, dropped %zu (%.1f%%)\n",
+		   r.frames.size(), sendSeconds, sendSeconds > 0 ? r.frames.size() / sendSeconds : 0.0, acks.size(),
+		   loopbacks.size(), dropped, r.frames.empty() ? 0.0 : 100.0 * dropped / r.frames.size());
+	if (ackmode)
+	{
+		printf("# acked throughput %.2f frames/s, %.1f B/s\n", lastAckUs ? acks.size() / (lastAckUs / 1e6) : 0.0,
+			   lastAckUs ? ackedBytes / (lastAckUs / 1e6) : 0.0);
+	}
+	printf("# unknown acks %u, duplicate loopbacks %u, other frames %u, kiss overflows %u, bad escapes %u\n",
+		   r.unknownAcks, r.duplicates, r.otherFrames, k.overflows, k.badEscapes);
+	printHistogram("write", writes);
+	if (ackmode)
+		printHistogram("ack", acks);
+	printHistogram("loopback", loopbacks);
+
+	run = NULL;
+	if (!linkUp)
+	{
+		fprintf(stderr, "link closed\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,849 @@
+/**
+ * @file netSim.cpp
+ * @date 2025-10-02
+ * @brief "net" subcommand: TNC instances exchanging real AFSK audio over a virtual RF network.
+ *
+ * Each station runs the firmware's transmit and receive chain in virtual time
+ * (clockHal.h): csma.h channel access, hdlcEncode() and afskModulator on
+ * transmit, and an afskDemod instance whose DCD is the CSMA busy signal on
+ * receive. Every 10 ms block, each receiver gets the sum of the transmissions it
+ * can hear, each at its link SNR and delay, plus its own Gaussian noise. Hidden
+ * nodes, capture, DCD latency and near-miss collisions come out of the audio
+ * instead of being modelled. Receivers are half duplex, and skip demodulation
+ * while nothing is audible and DCD is down, like RX_SQUELCH_GATED.
+ *
+ * Network file (--net), one statement per line, '#' starts a comment:
+ *   station NAME [digi]             NAME is a callsign, A-Z and 0-9, up to 6 characters
+ *   link A B SNR_DB [DELAY_US]      A and B hear each other; pairs without a link are hidden
+ *   path A B SNR_DB [DELAY_US]      one-way: B hears A
+ *   traffic NAME RATE [MIN:MAX]     Poisson client, RATE frames per minute, frame bytes
+ *   send TIME_S NAME [BYTES]        one scripted frame
+ *   params NAME TXDELAY PERSIST SLOTTIME   KISS units, per station
+ * Without --net, --stations N stations form a full mesh at --snr with --rate traffic.
+ * --front-end selects the demodulator front end of every station.
+ *
+ * Digipeaters run digipeater.h with the station name as callsign; frames carry
+ * a WIDE1-1 path when the network has any. Output: per-station and
+ * per-link counters, reception and collision totals, channel throughput and a
+ * latency histogram from queueing at the origin to decoding at each station.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "ax25.h"
+#include "clockHal.h"
+#include "csma.h"
+#include "digipeater.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "kiss.h"
+
+#define NET_RATE 9600		// Audio sample rate, as delivered to the firmware's demodulators
+#define NET_BLOCK 96		// Samples per block, 10 ms
+#define NET_BLOCK_US 10000
+#define NET_TONE_LEVEL 16384 // Modulator peak before link gain
+#define NET_NOISE_RMS 1000.0f
+#define NET_MAX_STATIONS 64
+#define NET_DEFAULT_STATIONS 6
+#define NET_DEFAULT_SNR 20.0
+#define NET_DEFAULT_RATE 1.0
+#define NET_DEFAULT_HOURS 0.25
+#define NET_DEFAULT_MIN_BYTES 40
+#define NET_DEFAULT_MAX_BYTES 120
+#define NET_ID_FORMAT "#%08X " // Origin frame id at the start of the info field
+
+typedef struct
+{
+	bool audible;
+	float gain;		 // Applied to the modulator output, sets the SNR against NET_NOISE_RMS
+	uint32_t delay;	 // Samples
+} net_link_t;
+
+typedef struct
+{
+	uint32_t id; // Origin frame id, kept by digipeaters
+	uint64_t queuedUs;
+	std::vector<uint8_t> frame;
+} net_frame_t;
+
+typedef struct
+{
+	unsigned station;
+	uint32_t id;
+	uint64_t startSample;
+	std::vector<int16_t> audio;
+} net_tx_t;
+
+typedef struct
+{
+	double atSeconds;
+	unsigned station;
+	size_t bytes;
+} net_send_t;
+
+struct NetStation
+{
+	std::string name;
+	unsigned index;
+	bool digi;
+	double rate; // Frames per minute from the client
+	int params[3]; // TXDELAY, PERSIST, SLOTTIME from the network file, -1 for the default
+	size_t minBytes;
+	size_t maxBytes;
+	csma_t csma;
+	clock_timer_t arrival;
+	clock_timer_t endOfTx;
+	std::deque<net_frame_t> queue;
+	bool transmitting;
+	afsk_modulator_t modulator;
+	afsk_demod_t demod;
+	std::mt19937 noise;
+	std::vector<net_link_t> from; // Indexed by transmitting station
+	std::unordered_set<uint32_t> heard;
+	digi_t digipeater;
+	uint32_t originated;
+	uint32_t transmissions;
+	uint32_t decoded;
+	uint32_t duplicates;
+	uint32_t demodBlocks;
+	std::vector<uint32_t> decodedFrom; // Receptions per transmitting station
+};
+
+struct Net
+{
+	std::vector<NetStation> stations;
+	std::vector<net_tx_t> onAir;
+	std::vector<net_send_t> script;
+	std::vector<clock_timer_t> scriptTimers;
+	std::mt19937 rng;
+	clock_timer_t blockTimer;
+	uint64_t block;
+	uint32_t nextId;
+	std::vector<uint64_t> originQueuedUs; // By frame id
+	std::vector<uint32_t> originStation;
+	std::vector<uint64_t> latencyUs;
+	std::vector<uint32_t> sentFrom; // Transmissions per station, for per-link rates
+	std::vector<uint32_t> expected; // Receptions expected per link: [from * n + to]
+	std::vector<uint32_t> overlapped; // ...of those, with another audible transmission overlapping
+	std::vector<uint32_t> received;
+	uint64_t busyUs;
+	uint64_t deliveredBytes;
+	uint64_t digest;
+};
+
+static Net *net;
+
+static void digestEvent(uint64_t a, uint64_t b)
+{
+	for (uint64_t v : {a, b})
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			net->digest ^= (v >> (8 * i)) & 0xFF;
+			net->digest *= 0x100000001B3ULL;
+		}
+	}
+}
+
+static double uniform()
+{
+	return (net->rng() >> 5) * (1.0 / 134217728.0);
+}
+
+static uint64_t nowSample()
+{
+	return (clockMicros() * NET_RATE + 999999) / 1000000;
+}
+
+/**
+ * @brief Append an AX.25 address field
+ */
+static void putAddress(std::vector<uint8_t> &out, const char *call, uint8_t ssid, uint8_t flags)
+{
+	size_t n = strlen(call);
+	for (size_t i = 0; i < 6; i++)
+	{
+		out.push_back((uint8_t)((i < n ? call[i] : ' ') << 1));
+	}
+	out.push_back((uint8_t)(0x60 | (ssid << 1) | flags));
+}
+
+/**
+ * @brief APRS UI frame from a station: APRS,WIDE1-1 when there are digipeaters, id-tagged info
+ */
+static std::vector<uint8_t> makeFrame(const NetStation *s, uint32_t id, size_t bytes, bool viaDigi)
+{
+	std::vector<uint8_t> f;
+	putAddress(f, "APRS", 0, 0x80);
+	putAddress(f, s->name.c_str(), 0, viaDigi ? 0x00 : 0x01);
+	if (viaDigi)
+	{
+		putAddress(f, "WIDE1", 1, 0x01);
+	}
+	f.push_back(AX25_CONTROL_UI);
+	f.push_back(AX25_PID_NONE);
+
+	char tag[16];
+	int n = snprintf(tag, sizeof(tag), NET_ID_FORMAT, id);
+	f.insert(f.end(), tag, tag + n);
+	while (f.size() < bytes)
+	{
+		f.push_back((uint8_t)('a' + net->rng() % 26));
+	}
+	return f;
+}
+
+static bool anyDigi()
+{
+	for (const NetStation &s : net->stations)
+	{
+		if (s.digi)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Put a new frame from a station's client in its queue
+ */
+static void originate(NetStation *s, size_t bytes)
+{
+	net_frame_t f;
+	f.id = net->nextId++;
+	f.queuedUs = clockMicros();
+	f.frame = makeFrame(s, f.id, bytes, anyDigi());
+	net->originQueuedUs.push_back(f.queuedUs);
+	net->originStation.push_back(s->index);
+	s->queue.push_back(f);
+	s->originated++;
+	s->heard.insert(f.id);
+	if (!s->transmitting)
+	{
+		csmaRequest(&s->csma);
+	}
+}
+
+static void clientArrival(void *ctx)
+{
+	NetStation *s = (NetStation *)ctx;
+	originate(s, s->minBytes + net->rng() % (s->maxBytes - s->minBytes + 1));
+	clockTimerStart(&s->arrival, (uint64_t)(-log(1.0 - uniform()) * 60e6 / s->rate));
+}
+
+static void scriptedSend(void *ctx)
+{
+	const net_send_t *send = (const net_send_t *)ctx;
+	originate(&net->stations[send->station], send->bytes);
+}
+
+/**
+ * @brief Decoded frame at a station: latency, per-link counts, digipeating
+ */
+static void onDecoded(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	NetStation *r = (NetStation *)ctx;
+	ax25_frame_t f;
+	unsigned id;
+	if (ax25Parse(frame, len, &f) != AX25_OK || f.infoLength < 10 ||
+		sscanf((const char *)f.info, "#%8X", &id) != 1 || id >= net->nextId)
+	{
+		return;
+	}
+
+	// The audible transmitter of this id that ended most recently sent it
+	for (const net_tx_t &tx : net->onAir)
+	{
+		if (tx.id == id && r->from[tx.station].audible)
+		{
+			r->decodedFrom[tx.station]++;
+			net->received[tx.station * net->stations.size() + r->index]++;
+			break;
+		}
+	}
+
+	r->decoded++;
+	if (!r->heard.insert(id).second)
+	{
+		r->duplicates++;
+		return;
+	}
+	net->latencyUs.push_back(clockMicros() - net->originQueuedUs[id]);
+	net->deliveredBytes += len;
+	digestEvent(clockMicros(), ((uint64_t)r->index << 32) | id);
+
+	uint8_t repeat[KISS_MAX_FRAME];
+	size_t repeatLength = r->digi ? digiProcess(&r->digipeater, frame, len, repeat, sizeof(repeat)) : 0;
+	if (repeatLength > 0)
+	{
+		net_frame_t copy = {id, clockMicros(), std::vector<uint8_t>(repeat, repeat + repeatLength)};
+		r->queue.push_back(copy);
+		if (!r->transmitting)
+		{
+			csmaRequest(&r->csma);
+		}
+	}
+}
+
+static bool channelBusy(void *ctx)
+{
+	return afskDemodDcd(&((const NetStation *)ctx)->demod);
+}
+
+/**
+ * @brief Access granted: render the frame to audio and put it on the air
+ */
+static void startTransmission(void *ctx)
+{
+	NetStation *s = (NetStation *)ctx;
+	net_frame_t f = s->queue.front();
+	s->queue.pop_front();
+
+	uint16_t flags = (uint16_t)std::max<uint32_t>(1, (csmaTxDelayUs(&s->csma) * 1200 / 8 + 999999) / 1000000);
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(f.frame.size(), flags));
+	levels.resize(hdlcEncode(f.frame.data(), f.frame.size(), flags, levels.data(), levels.size()));
+
+	net_tx_t tx;
+	tx.station = s->index;
+	tx.id = f.id;
+	tx.startSample = nowSample();
+	int16_t bit[NET_RATE / 1200 + 2];
+	afskModulatorReset(&s->modulator);
+	for (uint8_t level : levels)
+	{
+		size_t n = afskModulatorBit(&s->modulator, level, bit);
+		tx.audio.insert(tx.audio.end(), bit, bit + n);
+	}
+
+	// Every station that hears this one expects it; note which already hear someone else
+	size_t n = net->stations.size();
+	for (NetStation &r : net->stations)
+	{
+		if (&r == s || !r.from[s->index].audible)
+			continue;
+		net->expected[s->index * n + r.index]++;
+		for (const net_tx_t &other : net->onAir)
+		{
+			uint64_t otherEnd = other.startSample + other.audio.size() + r.from[other.station].delay;
+			if (other.station != s->index && r.from[other.station].audible && otherEnd > tx.startSample)
+			{
+				net->overlapped[s->index * n + r.index]++;
+				break;
+			}
+		}
+	}
+	for (const net_tx_t &other : net->onAir)
+	{
+		// The earlier transmission is now overlapped too wherever both are heard
+		for (NetStation &r : net->stations)
+		{
+			uint64_t otherEnd = other.startSample + other.audio.size() + r.from[other.station].delay;
+			if (&r != s && r.index != other.station && r.from[other.station].audible && r.from[s->index].audible &&
+				otherEnd > tx.startSample)
+			{
+				net->overlapped[other.station * n + r.index]++;
+			}
+		}
+	}
+
+	s->transmitting = true;
+	s->transmissions++;
+	net->sentFrom[s->index]++;
+	digestEvent(clockMicros(), s->index);
+	clockTimerStart(&s->endOfTx, ((uint64_t)tx.audio.size() * 1000000 + NET_RATE - 1) / NET_RATE);
+	net->onAir.push_back(std::move(tx));
+}
+
+static void endTransmission(void *ctx)
+{
+	NetStation *s = (NetStation *)ctx;
+	s->transmitting = false;
+	if (!s->queue.empty())
+	{
+		csmaRequest(&s->csma);
+	}
+}
+
+/**
+ * @brief Every 10 ms: mix what each receiver hears and run its demodulator
+ */
+static void onBlock(void *ctx)
+{
+	uint64_t first = net->block * NET_BLOCK;
+	float mix[NET_BLOCK];
+	int16_t samples[NET_BLOCK];
+	bool anyOnAir = false;
+
+	for (NetStation &r : net->stations)
+	{
+		if (r.transmitting)
+		{
+			anyOnAir = true;
+			continue; // Half duplex
+		}
+		bool audible = false;
+		std::fill(mix, mix + NET_BLOCK, 0.0f);
+		for (const net_tx_t &tx : net->onAir)
+		{
+			const net_link_t &link = r.from[tx.station];
+			if (!link.audible)
+				continue;
+			uint64_t start = tx.startSample + link.delay;
+			uint64_t end = start + tx.audio.size();
+			if (end <= first || start >= first + NET_BLOCK)
+				continue;
+			audible = true;
+			for (size_t i = 0; i < NET_BLOCK; i++)
+			{
+				uint64_t t = first + i;
+				if (t >= start && t < end)
+					mix[i] += link.gain * tx.audio[t - start];
+			}
+		}
+		if (!audible && !afskDemodDcd(&r.demod))
+		{
+			continue;
+		}
+
+		std::normal_distribution<float> noise(0.0f, NET_NOISE_RMS);
+		for (size_t i = 0; i < NET_BLOCK; i++)
+		{
+			float v = mix[i] + noise(r.noise);
+			samples[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, v));
+		}
+		afskDemodProcess(&r.demod, samples, NET_BLOCK);
+		r.demodBlocks++;
+	}
+	for (const net_tx_t &tx : net->onAir)
+	{
+		if (tx.startSample < first + NET_BLOCK && tx.startSample + tx.audio.size() > first)
+			anyOnAir = true;
+	}
+	if (anyOnAir)
+	{
+		net->busyUs += NET_BLOCK_US;
+	}
+
+	// Drop transmissions every receiver has finished with
+	uint32_t maxDelay = 0;
+	for (const NetStation &r : net->stations)
+		for (const net_link_t &l : r.from)
+			maxDelay = std::max(maxDelay, l.delay);
+	uint64_t next = first + NET_BLOCK;
+	net->onAir.erase(std::remove_if(net->onAir.begin(), net->onAir.end(), [&](const net_tx_t &tx)
+									{ return tx.startSample + tx.audio.size() + maxDelay + NET_BLOCK < next; }),
+					 net->onAir.end());
+
+	net->block++;
+	clockTimerStart(&net->blockTimer, net->block * NET_BLOCK_US - clockMicros());
+}
+
+static int findStation(const std::string &name)
+{
+	for (const NetStation &s : net->stations)
+		if (s.name == name)
+			return (int)s.index;
+	return -1;
+}
+
+static NetStation *addStation(const std::string &name)
+{
+	bool valid = !name.empty() && name.size() <= 6;
+	for (char c : name)
+		valid = valid && ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'));
+	if (!valid || findStation(name) >= 0 || net->stations.size() >= NET_MAX_STATIONS)
+	{
+		return NULL;
+	}
+	NetStation s = {};
+	s.name = name;
+	s.index = (unsigned)net->stations.size();
+	s.params[0] = s.params[1] = s.params[2] = -1;
+	net->stations.push_back(std::move(s));
+	return &net->stations.back();
+}
+
+static void setLink(unsigned from, unsigned to, double snrDb, uint32_t delayUs)
+{
+	// Tone power (peak^2 / 2) over noise power
+	net_link_t &l = net->stations[to].from[from];
+	l.audible = true;
+	l.gain = (float)(NET_NOISE_RMS * sqrt(2.0) * pow(10.0, snrDb / 20.0) / NET_TONE_LEVEL);
+	l.delay = (uint32_t)((uint64_t)delayUs * NET_RATE / 1000000);
+}
+
+/**
+ * @brief Read a network file; stations first, so links can be checked by name
+ */
+static bool loadNet(const char *path, double defaultRate, size_t minBytes, size_t maxBytes)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		fprintf(stderr, "%s: cannot read\n", path);
+		return false;
+	}
+	std::vector<std::pair<int, std::string>> lines;
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string keyword, name;
+		if (!(words >> keyword))
+			continue;
+		if (keyword == "station")
+		{
+			std::string option;
+			NetStation *s = (words >> name) ? addStation(name) : NULL;
+			if (!s)
+			{
+				fprintf(stderr, "%s:%d: bad or duplicate station\n", path, number);
+				return false;
+			}
+			s->digi = (words >> option) && option == "digi";
+			s->minBytes = minBytes;
+			s->maxBytes = maxBytes;
+		}
+		else
+			lines.push_back({number, line});
+	}
+	for (NetStation &s : net->stations)
+		s.from.assign(net->stations.size(), net_link_t{false, 0.0f, 0});
+
+	for (const auto &entry : lines)
+	{
+		std::istringstream words(entry.second);
+		std::string keyword, a, b;
+		words >> keyword;
+		bool ok = false;
+		if (keyword == "link" || keyword == "path")
+		{
+			double snr;
+			uint32_t delay = 0;
+			if (words >> a >> b >> snr)
+			{
+				words >> delay;
+				int from = findStation(a), to = findStation(b);
+				ok = from >= 0 && to >= 0 && from != to;
+				if (ok)
+				{
+					setLink(from, to, snr, delay);
+					if (keyword == "link")
+						setLink(to, from, snr, delay);
+				}
+			}
+		}
+		else if (keyword == "traffic")
+		{
+			double rate = defaultRate;
+			std::string range;
+			if (words >> a >> rate)
+			{
+				int s = findStation(a);
+				ok = s >= 0 && rate > 0;
+				if (ok)
+				{
+					NetStation &st = net->stations[s];
+					st.rate = rate;
+					if (words >> range)
+					{
+						char *end;
+						st.minBytes = strtoul(range.c_str(), &end, 10);
+						st.maxBytes = *end == ':' ? strtoul(end + 1, NULL, 10) : st.minBytes;
+						ok = st.minBytes >= 30 && st.maxBytes >= st.minBytes && st.maxBytes <= KISS_MAX_FRAME;
+					}
+				}
+			}
+		}
+		else if (keyword == "send")
+		{
+			net_send_t send = {0, 0, minBytes};
+			if (words >> send.atSeconds >> a)
+			{
+				words >> send.bytes;
+				int s = findStation(a);
+				ok = s >= 0 && send.atSeconds >= 0 && send.bytes >= 30 && send.bytes <= KISS_MAX_FRAME;
+				send.station = (unsigned)s;
+				if (ok)
+					net->script.push_back(send);
+			}
+		}
+		else if (keyword == "params")
+		{
+			int txDelay, persist, slotTime;
+			if (words >> a >> txDelay >> persist >> slotTime)
+			{
+				int s = findStation(a);
+				ok = s >= 0 && txDelay >= 0 && txDelay < 256 && persist >= 0 && persist < 256 && slotTime >= 0 &&
+					 slotTime < 256;
+				if (ok)
+				{
+					int *params = net->stations[s].params;
+					params[0] = txDelay;
+					params[1] = persist;
+					params[2] = slotTime;
+				}
+			}
+		}
+		if (!ok)
+		{
+			fprintf(stderr, "%s:%d: cannot parse '%s'\n", path, entry.first, entry.second.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint64_t percentile(std::vector<uint64_t> &v, double p)
+{
+	if (v.empty())
+		return 0;
+	size_t k = std::min(v.size() - 1, (size_t)(p * v.size()));
+	std::nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+static void netUsage()
+{
+	fprintf(stderr,
+			"usage: net [options]\n"
+			"  --net FILE       network and traffic description (see netSim.cpp)\n"
+			"  --stations N     full mesh of N stations without --net (default %d)\n"
+			"  --snr DB         link SNR of the full mesh (default %.0f)\n"
+			"  --rate F         frames per station per minute without --net (default %.1f)\n"
+			"  --bytes MIN:MAX  frame length range (default %d:%d)\n"
+			"  --hours H        simulated time (default %.2f)\n"
+			"  --txdelay N --persist N --slottime N   KISS parameters for every station\n"
+			"  --front-end NAME demodulator: goertzel, delay-line or zero-crossing (default goertzel)\n"
+			"  --seed N         random seed (default 1)\n"
+			"  --quiet          totals only\n",
+			NET_DEFAULT_STATIONS, NET_DEFAULT_SNR, NET_DEFAULT_RATE, NET_DEFAULT_MIN_BYTES, NET_DEFAULT_MAX_BYTES,
+			NET_DEFAULT_HOURS);
+}
+
+/**
+ * @brief "net" subcommand
+ * @param argc Argument count, argv[0] is "net"
+ * @param argv Options
+ * @return 0 on success, 1 if the network file is invalid, 2 on a usage error
+ */
+int netMain(int argc, char **argv)
+{
+	const char *netPath = NULL;
+	unsigned stations = NET_DEFAULT_STATIONS;
+	double snr = NET_DEFAULT_SNR;
+	double rate = NET_DEFAULT_RATE;
+	double hours = NET_DEFAULT_HOURS;
+	size_t minBytes = NET_DEFAULT_MIN_BYTES;
+	size_t maxBytes = NET_DEFAULT_MAX_BYTES;
+	int txDelay = -1, persist = -1, slotTime = -1;
+	unsigned seed = 1;
+	bool quiet = false;
+	int frontEnd = AFSK_FRONT_END_GOERTZEL; // -1 for an unknown name
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--net") == 0 && more)
+			netPath = argv[++i];
+		else if (strcmp(argv[i], "--stations") == 0 && more)
+			stations = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--snr") == 0 && more)
+			snr = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--rate") == 0 && more)
+			rate = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--bytes") == 0 && more)
+		{
+			char *end;
+			minBytes = strtoul(argv[++i], &end, 10);
+			maxBytes = *end == ':' ? strtoul(end + 1, NULL, 10) : minBytes;
+		}
+		else if (strcmp(argv[i], "--hours") == 0 && more)
+			hours = strtod(argv[++i], NULL);
+		else if (strcmp(argv[i], "--txdelay") == 0 && more)
+			txDelay = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--persist") == 0 && more)
+			persist = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--slottime") == 0 && more)
+			slotTime = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--front-end") == 0 && more)
+		{
+			const char *name = argv[++i];
+			frontEnd = -1;
+			for (afsk_front_end_t fe : {AFSK_FRONT_END_GOERTZEL, AFSK_FRONT_END_DELAY_LINE, AFSK_FRONT_END_ZERO_CROSSING})
+				if (strcmp(name, afskFrontEndName(fe)) == 0)
+					frontEnd = fe;
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else
+		{
+			netUsage();
+			return 2;
+		}
+	}
+	if (stations < 2 || stations > NET_MAX_STATIONS || rate <= 0 || hours <= 0 || minBytes < 30 ||
+		maxBytes < minBytes || maxBytes > KISS_MAX_FRAME || txDelay > 255 || persist > 255 || slotTime > 255 ||
+		frontEnd < 0)
+	{
+		netUsage();
+		return 2;
+	}
+
+	Net n = {};
+	net = &n;
+	n.rng.seed(seed);
+	n.digest = 0xCBF29CE484222325ULL;
+	clockReset();
+
+	if (netPath)
+	{
+		if (!loadNet(netPath, rate, minBytes, maxBytes))
+		{
+			net = NULL;
+			return 1;
+		}
+	}
+	else
+	{
+		for (unsigned i = 0; i < stations; i++)
+		{
+			char name[8];
+			snprintf(name, sizeof(name), "ST%u", i);
+			NetStation *s = addStation(name);
+			s->rate = rate;
+			s->minBytes = minBytes;
+			s->maxBytes = maxBytes;
+		}
+		for (NetStation &s : n.stations)
+			s.from.assign(n.stations.size(), net_link_t{false, 0.0f, 0});
+		for (unsigned a = 0; a < stations; a++)
+			for (unsigned b = 0; b < stations; b++)
+				if (a != b)
+					setLink(a, b, snr, 0);
+	}
+
+	size_t count = n.stations.size();
+	n.sentFrom.assign(count, 0);
+	n.expected.assign(count * count, 0);
+	n.overlapped.assign(count * count, 0);
+	n.received.assign(count * count, 0);
+	const afsk_profile_t profile = {1200, 2200, 1200, NET_RATE, (afsk_front_end_t)frontEnd};
+	for (NetStation &s : n.stations)
+	{
+		// Command line parameters apply to every station, the network file's per station override them
+		const uint8_t commands[3] = {KISS_CMD_TXDELAY, KISS_CMD_PERSIST, KISS_CMD_SLOTTIME};
+		const int global[3] = {txDelay, persist, slotTime};
+		csmaInit(&s.csma, channelBusy, startTransmission, &s, (uint32_t)n.rng());
+		for (int i = 0; i < 3; i++)
+		{
+			int value = s.params[i] >= 0 ? s.params[i] : global[i];
+			if (value >= 0)
+				csmaSetParam(&s.csma, commands[i], (uint8_t)value);
+		}
+
+		digiInit(&s.digipeater, s.name.c_str(), 0, 2);
+		afskModulatorInit(&s.modulator, NET_RATE, 1200, 2200, 1200);
+		afskModulatorSetLevels(&s.modulator, NET_TONE_LEVEL, NET_TONE_LEVEL);
+		afskDemodInit(&s.demod, &profile, 0, onDecoded, &s);
+		s.noise.seed((uint32_t)n.rng());
+		s.decodedFrom.assign(count, 0);
+		clockTimerInit(&s.arrival, clientArrival, &s);
+		clockTimerInit(&s.endOfTx, endTransmission, &s);
+		if (s.rate > 0)
+			clockTimerStart(&s.arrival, (uint64_t)(-log(1.0 - uniform()) * 60e6 / s.rate));
+	}
+	n.scriptTimers.resize(n.script.size());
+	for (size_t i = 0; i < n.script.size(); i++)
+	{
+		clockTimerInit(&n.scriptTimers[i], scriptedSend, &n.script[i]);
+		clockTimerStart(&n.scriptTimers[i], (uint64_t)(n.script[i].atSeconds * 1e6));
+	}
+	clockTimerInit(&n.blockTimer, onBlock, NULL);
+	clockTimerStart(&n.blockTimer, 0);
+
+	auto started = std::chrono::steady_clock::now();
+	uint64_t durationUs = (uint64_t)(hours * 3600e6);
+	size_t events = clockAdvance(durationUs);
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	double seconds = durationUs / 1e6;
+
+	uint64_t expected = 0, overlapped = 0, received = 0;
+	for (size_t i = 0; i < count * count; i++)
+	{
+		expected += n.expected[i];
+		overlapped += n.overlapped[i];
+		received += n.received[i];
+	}
+	uint64_t originated = 0, reach = 0;
+	for (const NetStation &s : n.stations)
+	{
+		originated += s.originated;
+		reach += s.heard.size() - s.originated; // Other stations' frames heard, directly or via a digi
+	}
+
+	if (!quiet)
+	{
+		for (const NetStation &s : n.stations)
+		{
+			printf("%-6s%s originated %5u sent %5u decoded %5u (dup %u), queued %zu, busy slots %u, deferred %u, "
+				   "mean access %.0f ms, demod %.0f%% of blocks\n",
+				   s.name.c_str(), s.digi ? "*" : " ", s.originated, s.transmissions, s.decoded, s.duplicates,
+				   s.queue.size(), s.csma.busySlots, s.csma.deferredSlots,
+				   s.csma.grants ? s.csma.accessDelayUs / 1000.0 / s.csma.grants : 0.0,
+				   n.block ? 100.0 * s.demodBlocks / n.block : 0.0);
+		}
+		printf("links (from > to: received/expected, overlapped):\n");
+		for (size_t a = 0; a < count; a++)
+			for (size_t b = 0; b < count; b++)
+				if (n.expected[a * count + b])
+					printf("  %s > %s: %u/%u, %u\n", n.stations[a].name.c_str(), n.stations[b].name.c_str(),
+						   n.received[a * count + b], n.expected[a * count + b], n.overlapped[a * count + b]);
+	}
+
+	printf("# %zu stations, %.2f h, seed %u\n", count, hours, seed);
+	printf("# frames originated %llu, reach %.1f%% of other stations, channel busy %.1f%%, throughput %.1f B/s\n",
+		   (unsigned long long)originated, originated && count > 1 ? 100.0 * reach / (originated * (count - 1)) : 0.0,
+		   100.0 * n.busyUs / durationUs, n.deliveredBytes / seconds);
+	printf("# receptions expected %llu, decoded %llu (%.1f%%), overlapped %llu (%.1f%%)\n", (unsigned long long)expected,
+		   (unsigned long long)received, expected ? 100.0 * received / expected : 0.0, (unsigned long long)overlapped,
+		   expected ? 100.0 * overlapped / expected : 0.0);
+	printf("# latency ms p50 %.0f, p90 %.0f, p99 %.0f, max %.0f\n", percentile(n.latencyUs, 0.5) / 1000.0,
+		   percentile(n.latencyUs, 0.9) / 1000.0, percentile(n.latencyUs, 0.99) / 1000.0,
+		   percentile(n.latencyUs, 1.0) / 1000.0);
+
+	// Latency histogram, doubling buckets from 250 ms
+	uint64_t upper = 250000;
+	size_t done = 0;
+	std::sort(n.latencyUs.begin(), n.latencyUs.end());
+	while (done < n.latencyUs.size())
+	{
+		size_t inBucket = std::upper_bound(n.latencyUs.begin(), n.latencyUs.end(), upper) - n.latencyUs.begin() - done;
+		printf("#   <= %6llu ms %7zu %5.1f%%\n", (unsigned long long)(upper / 1000), inBucket,
+			   100.0 * inBucket / n.latencyUs.size());
+		done += inBucket;
+		upper *= 2;
+	}
+	printf("# digest %016llx\n", (unsigned long long)n.digest);
+	fprintf(stderr, "# %zu events in %.2f s wall, %.0fx realtime\n", events, wallSeconds,
+			wallSeconds > 0 ? seconds / wallSeconds : 0.0);
+
+	clockReset();
+	net = NULL;
+	return 0;
+}
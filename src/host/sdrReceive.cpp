@@ -0,0 +1,506 @@
+/**
+ * @file sdrReceive.cpp
+ * @date 2025-10-02
+ * @brief "sdr" subcommand: multi-channel APRS receiver on complex baseband from an SDR.
+ *
+ * Input is interleaved IQ (rtl_sdr's cu8, cs16 or cf32) from a file or stdin.
+ * The polyphase channelizer splits it into M = rate / spacing NBFM channels at
+ * two samples per spacing. Each selected channel is FM-demodulated, decimated
+ * by 2 with FIR lanes and decoded by demodBank lanes; 16 channels share one
+ * bank, and banks run in parallel on the work pool. At 240 kS/s and 12 kHz
+ * spacing that is 20 channels of 24 kS/s IQ and 12 kHz audio.
+ *
+ * Frames are printed per input block in (time, frequency) order, so the output
+ * is the same for any thread count. --synth generates a test signal with AFSK
+ * on every selected channel instead of reading input, and reports channels
+ * per core for benchmarking.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "afskModulator.h"
+#include "channelizer.h"
+#include "demodBank.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "workPool.h"
+
+#define SDR_DEFAULT_RATE 240000
+#define SDR_DEFAULT_SPACING 12000
+#define SDR_TAPS_PER_BRANCH 12
+#define SDR_BLOCK_SECONDS 0.5	 // Input per processing round
+#define SDR_DEMOD_CHUNK 120		 // Audio rows per demodulator call, sets the time resolution
+#define SDR_FM_SCALE (32767.0f / (float)M_PI) // Discriminator radians to 16-bit audio, no clipping
+#define SDR_SYNTH_DEVIATION 3000.0			  // Hz, typical for 12.5 kHz channel APRS
+#define SDR_SYNTH_AMPLITUDE 1200.0			  // Per channel, cs16 units
+#define SDR_SYNTH_NOISE 60.0				  // Per I/Q component, cs16 units
+
+typedef enum
+{
+	IQ_CU8 = 0, // rtl_sdr: unsigned 8-bit, 127.5 = 0
+	IQ_CS16,	// Signed 16-bit little-endian
+	IQ_CF32		// 32-bit float
+} iq_format_t;
+
+// One decoded frame
+struct SdrFrame
+{
+	uint64_t sample; // Input sample at the end of the demodulator chunk
+	int64_t freq;	 // Channel centre (Hz)
+	std::vector<uint8_t> data;
+};
+
+// Up to SIMD_LANES channels decoded together
+struct SdrBank
+{
+	uint32_t bins[SIMD_LANES];
+	int64_t freq[SIMD_LANES];
+	size_t lanes = 0;
+	iq_t previous[SIMD_LANES] = {};
+	fir_lanes_t fir;
+	demod_bank_t demod;
+	uint64_t chunkEndSample = 0;
+	std::vector<SdrFrame> frames; // Found in the current block
+	std::vector<int16_t> audio;	  // Scratch, [row][SIMD_LANES]
+	std::vector<int16_t> decimated;
+};
+
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	SdrBank *b = (SdrBank *)ctx;
+	SdrFrame f;
+	f.sample = b->chunkEndSample;
+	f.freq = b->freq[port];
+	f.data.assign(frame, frame + len);
+	b->frames.push_back(std::move(f));
+}
+
+/**
+ * @brief FM-demodulate, decimate and decode one block of a bank's channels
+ */
+static void processBank(SdrBank *b, const channelizer_t *c, const std::vector<iq_t> &branches, size_t outputs,
+						uint64_t firstOutput)
+{
+	b->audio.assign(outputs * SIMD_LANES, 0);
+	for (size_t l = 0; l < b->lanes; l++)
+	{
+		iq_t previous = b->previous[l];
+		for (size_t n = 0; n < outputs; n++)
+		{
+			iq_t y = channelizerBin(c, &branches[n * c->channels], b->bins[l], firstOutput + n);
+			iq_t d = y * std::conj(previous);
+			previous = y;
+			b->audio[n * SIMD_LANES + l] = (int16_t)lrintf(atan2f(d.imag(), d.real()) * SDR_FM_SCALE);
+		}
+		b->previous[l] = previous;
+	}
+
+	b->decimated.resize((outputs / b->fir.factor + 1) * SIMD_LANES);
+	size_t rows = b->demod.kernels->firDecimate(&b->fir, b->audio.data(), outputs, b->decimated.data());
+
+	// Chunked so frame times resolve to SDR_DEMOD_CHUNK audio samples
+	uint64_t inputPerRow = (uint64_t)c->decimation * b->fir.factor;
+	uint64_t firstRow = (firstOutput + outputs) / b->fir.factor - rows;
+	for (size_t r = 0; r < rows; r += SDR_DEMOD_CHUNK)
+	{
+		size_t n = std::min<size_t>(SDR_DEMOD_CHUNK, rows - r);
+		b->chunkEndSample = (firstRow + r + n) * inputPerRow;
+		demodBankProcess(&b->demod, &b->decimated[r * SIMD_LANES], n);
+	}
+}
+
+/**
+ * @brief Convert raw IQ bytes to complex floats in [-1, 1)
+ */
+static size_t convertIq(iq_format_t format, const uint8_t *raw, size_t bytes, std::vector<iq_t> *out)
+{
+	out->clear();
+	switch (format)
+	{
+	case IQ_CU8:
+		for (size_t i = 0; i + 2 <= bytes; i += 2)
+			out->push_back(iq_t((raw[i] - 127.5f) / 128.0f, (raw[i + 1] - 127.5f) / 128.0f));
+		break;
+	case IQ_CS16:
+		for (size_t i = 0; i + 4 <= bytes; i += 4)
+		{
+			int16_t re = (int16_t)(raw[i] | (raw[i + 1] << 8));
+			int16_t im = (int16_t)(raw[i + 2] | (raw[i + 3] << 8));
+			out->push_back(iq_t(re / 32768.0f, im / 32768.0f));
+		}
+		break;
+	case IQ_CF32:
+		for (size_t i = 0; i + 8 <= bytes; i += 8)
+		{
+			float v[2];
+			memcpy(v, raw + i, sizeof(v));
+			out->push_back(iq_t(v[0], v[1]));
+		}
+		break;
+	}
+	return out->size();
+}
+
+static size_t bytesPerSample(iq_format_t format)
+{
+	return format == IQ_CU8 ? 2 : format == IQ_CS16 ? 4 : 8;
+}
+
+/**
+ * @brief Channel offset in Hz of bin k (bins above M/2 are negative offsets)
+ */
+static int64_t binOffset(uint32_t k, uint32_t channels, uint32_t spacing)
+{
+	return (int64_t)(k < channels / 2 ? (int64_t)k : (int64_t)k - channels) * spacing;
+}
+
+/**
+ * @brief Generate cs16 IQ with random AFSK frames FM-modulated onto each bin
+ * @return Number of frames sent
+ */
+static size_t synthesize(std::vector<uint8_t> *raw, double seconds, uint32_t rate, uint32_t spacing, uint32_t channels,
+						 const std::vector<uint32_t> &bins)
+{
+	size_t samples = (size_t)(seconds * rate);
+	std::vector<double> re(samples, 0.0), im(samples, 0.0);
+	std::mt19937 rng(7);
+	size_t sent = 0;
+	std::vector<int16_t> bit(rate / 1200 + 2);
+
+	for (uint32_t k : bins)
+	{
+		afsk_modulator_t mod;
+		afskModulatorInit(&mod, rate, 1200, 2200, 1200);
+		afskModulatorSetLevels(&mod, 16384, 16384);
+		double offset = (double)binOffset(k, channels, spacing);
+		double phase = rng() * 1e-3;
+		size_t pos = rng() % rate;
+		bool level = true;
+
+		while (true)
+		{
+			std::vector<uint8_t> frame(30 + rng() % 150);
+			for (uint8_t &b : frame)
+				b = (uint8_t)rng();
+			uint16_t fcs = ax25Fcs(frame.data(), frame.size());
+			frame.push_back(fcs & 0xFF);
+			frame.push_back(fcs >> 8);
+
+			std::vector<uint8_t> bits;
+			for (int f = 0; f < 24; f++)
+				for (int i = 0; i < 8; i++)
+					bits.push_back((0x7E >> i) & 1);
+			int ones = 0;
+			for (uint8_t b : frame)
+				for (int i = 0; i < 8; i++)
+				{
+					int v = (b >> i) & 1;
+					bits.push_back(v);
+					ones = v ? ones + 1 : 0;
+					if (ones == 5)
+					{
+						bits.push_back(0);
+						ones = 0;
+					}
+				}
+			for (int f = 0; f < 2; f++)
+				for (int i = 0; i < 8; i++)
+					bits.push_back((0x7E >> i) & 1);
+			if (pos + bits.size() * bit.size() >= samples)
+			{
+				break;
+			}
+
+			for (uint8_t v : bits)
+			{
+				if (!v)
+					level = !level;
+				size_t n = afskModulatorBit(&mod, level, bit.data());
+				for (size_t i = 0; i < n; i++, pos++)
+				{
+					phase += 2.0 * M_PI * (offset + SDR_SYNTH_DEVIATION * bit[i] / 16384.0) / rate;
+					re[pos] += SDR_SYNTH_AMPLITUDE * cos(phase);
+					im[pos] += SDR_SYNTH_AMPLITUDE * sin(phase);
+				}
+			}
+			sent++;
+			pos += rate / 5 + rng() % rate; // Idle carrier-off gap
+		}
+	}
+
+	std::normal_distribution<double> noise(0.0, SDR_SYNTH_NOISE);
+	raw->resize(samples * 4);
+	for (size_t i = 0; i < samples; i++)
+	{
+		int16_t v[2] = {(int16_t)std::max(-32768.0, std::min(32767.0, re[i] + noise(rng))),
+						(int16_t)std::max(-32768.0, std::min(32767.0, im[i] + noise(rng)))};
+		memcpy(&(*raw)[i * 4], v, sizeof(v));
+	}
+	return sent;
+}
+
+static void sdrUsage()
+{
+	fprintf(stderr,
+			"usage: sdr [options] file|-\n"
+			"       sdr [options] --synth seconds [--save file.cs16]\n"
+			"  -r RATE        input sample rate (default %d)\n"
+			"  -f FORMAT      cu8 (rtl_sdr), cs16 or cf32 (default cu8)\n"
+			"  --spacing HZ   channel spacing, rate / spacing must be even (default %d)\n"
+			"  --center HZ    tuned frequency, for labels and --freq\n"
+			"  --freq HZ      decode this channel, repeatable (default: all channels)\n"
+			"  -j N           worker threads (default: all hardware threads)\n"
+			"  --synth S      decode S seconds of generated AFSK on every channel, for benchmarking\n"
+			"  --save FILE    with --synth, also write the generated cs16 IQ\n",
+			SDR_DEFAULT_RATE, SDR_DEFAULT_SPACING);
+}
+
+/**
+ * @brief Multi-channel APRS receiver on complex baseband
+ * @param argc Argument count, argv[0] is "sdr"
+ * @param argv Options and input
+ * @return 0 on success, 1 on an input error, 2 on a usage error
+ */
+int sdrMain(int argc, char **argv)
+{
+	uint32_t rate = SDR_DEFAULT_RATE;
+	uint32_t spacing = SDR_DEFAULT_SPACING;
+	int64_t center = 0;
+	iq_format_t format = IQ_CU8;
+	unsigned threads = 0;
+	double synthSeconds = 0;
+	const char *savePath = NULL;
+	const char *inputPath = NULL;
+	std::vector<int64_t> freqs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *a = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (strcmp(a, "-r") == 0 && hasValue)
+			rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(a, "-f") == 0 && hasValue)
+		{
+			const char *f = argv[++i];
+			if (strcmp(f, "cu8") == 0)
+				format = IQ_CU8;
+			else if (strcmp(f, "cs16") == 0)
+				format = IQ_CS16;
+			else if (strcmp(f, "cf32") == 0)
+				format = IQ_CF32;
+			else
+			{
+				sdrUsage();
+				return 2;
+			}
+		}
+		else if (strcmp(a, "--spacing") == 0 && hasValue)
+			spacing = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(a, "--center") == 0 && hasValue)
+			center = strtoll(argv[++i], NULL, 10);
+		else if (strcmp(a, "--freq") == 0 && hasValue)
+			freqs.push_back(strtoll(argv[++i], NULL, 10));
+		else if (strcmp(a, "-j") == 0 && hasValue)
+			threads = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(a, "--synth") == 0 && hasValue)
+			synthSeconds = strtod(argv[++i], NULL);
+		else if (strcmp(a, "--save") == 0 && hasValue)
+			savePath = argv[++i];
+		else if ((a[0] != '-' || strcmp(a, "-") == 0) && !inputPath)
+			inputPath = a;
+		else
+		{
+			sdrUsage();
+			return 2;
+		}
+	}
+	if ((synthSeconds <= 0) == (inputPath == NULL) || spacing == 0 || rate % spacing != 0)
+	{
+		sdrUsage();
+		return 2;
+	}
+
+	channelizer_t channelizer;
+	uint32_t channels = rate / spacing;
+	if (!channelizerInit(&channelizer, channels, SDR_TAPS_PER_BRANCH))
+	{
+		fprintf(stderr, "rate / spacing = %u, must be even\n", channels);
+		return 2;
+	}
+	uint32_t channelRate = rate / channelizer.decimation;
+
+	// Channel selection: nearest bin to each --freq, or every bin
+	std::vector<uint32_t> bins;
+	for (int64_t f : freqs)
+	{
+		int64_t offset = f - center;
+		int64_t k = (int64_t)llround((double)offset / spacing);
+		if (k < -(int64_t)channels / 2 || k >= (int64_t)channels / 2)
+		{
+			fprintf(stderr, "%lld Hz is outside the %u Hz input band\n", (long long)f, rate);
+			return 2;
+		}
+		if (llabs(offset - k * (int64_t)spacing) > (int64_t)spacing / 8)
+		{
+			fprintf(stderr, "warning: %lld Hz is %lld Hz off the channel grid\n", (long long)f,
+					(long long)(offset - k * (int64_t)spacing));
+		}
+		bins.push_back((uint32_t)((k + channels) % channels));
+	}
+	if (bins.empty())
+	{
+		for (uint32_t k = 0; k < channels; k++)
+			bins.push_back(k);
+	}
+
+	// Audio FIR halves the channel rate; profile shared by all lanes
+	fir_decimator_t audioFir;
+	if (!firDecimatorInit(&audioFir, 2, 24, 4000.0f / channelRate))
+	{
+		fprintf(stderr, "channel rate %u Hz too low for 1200 bd AFSK\n", channelRate);
+		return 2;
+	}
+	afsk_profile_t profile = {1200, 2200, 1200, channelRate / 2};
+	afsk_profile_t profiles[SIMD_LANES];
+	for (afsk_profile_t &p : profiles)
+		p = profile;
+
+	std::vector<std::unique_ptr<SdrBank>> banks;
+	for (size_t i = 0; i < bins.size(); i += SIMD_LANES)
+	{
+		std::unique_ptr<SdrBank> b(new SdrBank());
+		b->lanes = std::min<size_t>(SIMD_LANES, bins.size() - i);
+		for (size_t l = 0; l < b->lanes; l++)
+		{
+			b->bins[l] = bins[i + l];
+			b->freq[l] = center + binOffset(bins[i + l], channels, spacing);
+		}
+		firLanesInit(&b->fir, &audioFir);
+		if (!demodBankInit(&b->demod, NULL, profiles, b->lanes, onFrame, b.get()))
+		{
+			fprintf(stderr, "channel rate %u Hz not supported by the demodulator\n", channelRate);
+			return 2;
+		}
+		banks.push_back(std::move(b));
+	}
+
+	// Input source
+	FILE *in = NULL;
+	std::vector<uint8_t> synth;
+	size_t synthPos = 0, sent = 0;
+	if (synthSeconds > 0)
+	{
+		format = IQ_CS16;
+		sent = synthesize(&synth, synthSeconds, rate, spacing, channels, bins);
+		if (savePath)
+		{
+			FILE *f = fopen(savePath, "wb");
+			if (!f || fwrite(synth.data(), 1, synth.size(), f) != synth.size())
+			{
+				fprintf(stderr, "%s: write failed\n", savePath);
+			}
+			if (f)
+				fclose(f);
+		}
+	}
+	else
+	{
+		in = strcmp(inputPath, "-") == 0 ? stdin : fopen(inputPath, "rb");
+		if (!in)
+		{
+			fprintf(stderr, "%s: cannot open\n", inputPath);
+			return 1;
+		}
+	}
+
+	fprintf(stderr, "# %u channels of %u Hz at %u S/s, decoding %zu on %s kernels\n", channels, spacing, channelRate,
+			bins.size(), banks[0]->demod.kernels->name);
+
+	size_t blockSamples = (size_t)(SDR_BLOCK_SECONDS * rate);
+	size_t sampleBytes = bytesPerSample(format);
+	std::vector<uint8_t> raw(blockSamples * sampleBytes);
+	std::vector<iq_t> iq;
+	std::vector<iq_t> branches;
+	uint64_t totalSamples = 0;
+	size_t decoded = 0;
+	work_pool_stats_t poolStats = {};
+	auto started = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		size_t bytes;
+		if (in)
+		{
+			bytes = fread(raw.data(), 1, raw.size(), in);
+		}
+		else
+		{
+			bytes = std::min(raw.size(), synth.size() - synthPos);
+			memcpy(raw.data(), synth.data() + synthPos, bytes);
+			synthPos += bytes;
+		}
+		if (bytes < sampleBytes)
+		{
+			break;
+		}
+		convertIq(format, raw.data(), bytes, &iq);
+		totalSamples += iq.size();
+
+		branches.clear();
+		uint64_t firstOutput;
+		size_t outputs = channelizerProcess(&channelizer, iq.data(), iq.size(), &branches, &firstOutput);
+		workPoolRun(
+			banks.size(), threads, [&](size_t t, unsigned)
+			{ processBank(banks[t].get(), &channelizer, branches, outputs, firstOutput); },
+			&poolStats);
+
+		// Merge this block's frames in a fixed order
+		std::vector<SdrFrame> frames;
+		for (auto &b : banks)
+		{
+			for (SdrFrame &f : b->frames)
+				frames.push_back(std::move(f));
+			b->frames.clear();
+		}
+		std::stable_sort(frames.begin(), frames.end(), [](const SdrFrame &a, const SdrFrame &b)
+						 { return a.sample != b.sample ? a.sample < b.sample : a.freq < b.freq; });
+		for (const SdrFrame &f : frames)
+		{
+			std::string hex;
+			for (uint8_t v : f.data)
+			{
+				static const char digits[] = "0123456789abcdef";
+				hex += digits[v >> 4];
+				hex += digits[v & 0x0F];
+			}
+			printf("%.3f\t%lld\t%s\n", (double)f.sample / rate, (long long)f.freq, hex.c_str());
+		}
+		decoded += frames.size();
+		fflush(stdout);
+	}
+	if (in && in != stdin)
+	{
+		fclose(in);
+	}
+
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	double seconds = (double)totalSamples / rate;
+	double realtime = wall > 0 ? seconds / wall : 0;
+	printf("# %.1f s of IQ, %zu channels, %zu frames", seconds, bins.size(), decoded);
+	if (synthSeconds > 0)
+	{
+		printf(" of %zu sent", sent);
+	}
+	printf("\n");
+	fprintf(stderr, "# %.2f s wall, %.1fx realtime on %u threads, %.0f channels per core in real time\n", wall,
+			realtime, poolStats.threads, poolStats.threads ? bins.size() * realtime / poolStats.threads : 0.0);
+	return 0;
+}
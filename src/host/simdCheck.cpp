@@ -0,0 +1,324 @@
+/**
+ * @file simdCheck.cpp
+ * @date 2025-09-25
+ * @brief "simd" subcommand: verify the SIMD kernels against the scalar reference and benchmark them.
+ *
+ * Every kernel set the CPU supports is run on 16 lanes of noisy AFSK:
+ * - correlator: phases, sums and history must match scalar exactly after every
+ *   sample; a differing mark/space bit is accepted only at a near-tie of the
+ *   two energies (float contraction), and counted.
+ * - FIR: outputs and state must match exactly.
+ * - bank: a demod_bank_t must decode the same frames as 16 separate afskDemod.
+ * Then each kernel is timed, reported as lanes of 9600 Hz audio one core keeps
+ * up with. Exit code 1 if any check fails.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "afskModulator.h"
+#include "demodBank.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "simdKernels.h"
+
+#define CHECK_RATE 9600
+#define CHECK_SECONDS 20   // Audio per lane for the checks
+#define TIE_TOLERANCE 1e-6 // Relative energy difference treated as a tie
+
+/**
+ * @brief Make seconds of 1200 bd AFSK frames in noise for each lane, interleaved
+ */
+static std::vector<int16_t> makeLanes(const afsk_profile_t *profiles, double seconds, uint32_t seed)
+{
+	size_t rows = (size_t)(seconds * CHECK_RATE);
+	std::vector<int16_t> out(rows * SIMD_LANES);
+	std::mt19937 rng(seed);
+	int16_t bitSamples[AFSK_DEMOD_MAX_WINDOW + 2];
+
+	for (int l = 0; l < SIMD_LANES; l++)
+	{
+		afsk_modulator_t mod;
+		afskModulatorInit(&mod, CHECK_RATE, profiles[l].markFreq, profiles[l].spaceFreq, profiles[l].baudRate);
+		afskModulatorSetLevels(&mod, 12000, 12000);
+		std::normal_distribution<float> noise(0.0f, 1500.0f + 400.0f * l); // About 12 to 22 dB SNR
+
+		size_t pos = rng() % 2000;
+		bool level = true;
+		while (pos + 4000 < rows)
+		{
+			// Flags, a random frame with its FCS, closing flag; NRZI with bit stuffing
+			std::vector<uint8_t> frame(20 + rng() % 100);
+			for (uint8_t &b : frame)
+				b = (uint8_t)rng();
+			uint16_t fcs = ax25Fcs(frame.data(), frame.size());
+			frame.push_back(fcs & 0xFF);
+			frame.push_back(fcs >> 8);
+
+			std::vector<uint8_t> bits;
+			for (int f = 0; f < 16; f++)
+				for (int i = 0; i < 8; i++)
+					bits.push_back((0x7E >> i) & 1);
+			int ones = 0;
+			for (uint8_t b : frame)
+				for (int i = 0; i < 8; i++)
+				{
+					int bit = (b >> i) & 1;
+					bits.push_back(bit);
+					ones = bit ? ones + 1 : 0;
+					if (ones == 5)
+					{
+						bits.push_back(0);
+						ones = 0;
+					}
+				}
+			for (int i = 0; i < 8; i++)
+				bits.push_back((0x7E >> i) & 1);
+
+			for (uint8_t bit : bits)
+			{
+				if (!bit)
+					level = !level;
+				size_t n = afskModulatorBit(&mod, level, bitSamples);
+				for (size_t i = 0; i < n && pos < rows; i++)
+					out[pos++ * SIMD_LANES + l] = bitSamples[i];
+			}
+			pos += 500 + rng() % 3000;
+		}
+		for (size_t r = 0; r < rows; r++)
+		{
+			float v = out[r * SIMD_LANES + l] + noise(rng);
+			out[r * SIMD_LANES + l] = (int16_t)fmaxf(-32768.0f, fminf(32767.0f, v));
+		}
+	}
+	return out;
+}
+
+/**
+ * @brief Lane profiles: 1200/2200 variants with detuned tones, same window
+ */
+static void makeProfiles(afsk_profile_t *profiles)
+{
+	for (int l = 0; l < SIMD_LANES; l++)
+	{
+		int detune = (l % 4) * 10 - 15; // -15, -5, +5, +15 Hz
+		profiles[l] = {(uint16_t)(1200 + detune), (uint16_t)(2200 + detune), 1200, CHECK_RATE};
+	}
+}
+
+static double energy(int32_t i, int32_t q)
+{
+	return (double)i * i + (double)q * q;
+}
+
+/**
+ * @brief Correlator: exact state, levels equal except at ties
+ */
+static bool checkCorrelator(const simd_kernels_t *k, const afsk_profile_t *profiles, const std::vector<int16_t> &in,
+							size_t *ties)
+{
+	corr_lanes_t ref, test;
+	corrLanesInit(&ref, profiles, SIMD_LANES);
+	corrLanesInit(&test, profiles, SIMD_LANES);
+	size_t rows = in.size() / SIMD_LANES;
+	*ties = 0;
+
+	for (size_t r = 0; r < rows; r++)
+	{
+		uint16_t a, b;
+		simdKernelsByName("scalar")->correlate(&ref, &in[r * SIMD_LANES], 1, &a);
+		k->correlate(&test, &in[r * SIMD_LANES], 1, &b);
+		if (memcmp(&ref, &test, sizeof(ref)) != 0)
+		{
+			printf("  correlator state differs at sample %zu\n", r);
+			return false;
+		}
+		for (uint16_t diff = a ^ b; diff; diff &= diff - 1)
+		{
+			int l = __builtin_ctz(diff);
+			double m = energy(ref.markI[l], ref.markQ[l]);
+			double s = energy(ref.spaceI[l], ref.spaceQ[l]);
+			if (fabs(m - s) > TIE_TOLERANCE * (m + s))
+			{
+				printf("  level differs at sample %zu lane %d (mark %.0f, space %.0f)\n", r, l, m, s);
+				return false;
+			}
+			(*ties)++;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief FIR: outputs and state bit-exact, checked for every length from 1 to 64 taps
+ */
+static bool checkFir(const simd_kernels_t *k, const std::vector<int16_t> &in)
+{
+	size_t rows = in.size() / SIMD_LANES;
+	std::vector<int16_t> a(in.size()), b(in.size());
+	for (uint8_t taps = 1; taps <= FIR_DECIMATOR_MAX_TAPS; taps++)
+	{
+		fir_decimator_t design;
+		uint8_t factor = 1 + taps % 5;
+		firDecimatorInit(&design, factor, taps, 0.4f / factor);
+		fir_lanes_t ref, test;
+		firLanesInit(&ref, &design);
+		firLanesInit(&test, &design);
+
+		size_t chunk = 1 + taps * 7 % 300; // Odd chunk sizes exercise the decimation phase
+		for (size_t r = 0; r < rows; r += chunk)
+		{
+			size_t n = rows - r < chunk ? rows - r : chunk;
+			size_t na = simdKernelsByName("scalar")->firDecimate(&ref, &in[r * SIMD_LANES], n, a.data());
+			size_t nb = k->firDecimate(&test, &in[r * SIMD_LANES], n, b.data());
+			if (na != nb || memcmp(a.data(), b.data(), na * SIMD_LANES * sizeof(int16_t)) != 0 ||
+				memcmp(&ref, &test, sizeof(ref)) != 0)
+			{
+				printf("  FIR output differs (%u taps, factor %u, row %zu)\n", taps, factor, r);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Decoded frames per lane, as text
+struct FrameLog
+{
+	std::vector<std::string> frames[SIMD_LANES];
+};
+
+static void logFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	((FrameLog *)ctx)->frames[port].push_back(std::string((const char *)frame, len));
+}
+
+/**
+ * @brief Bank against one afskDemod per lane
+ */
+static bool checkBank(const simd_kernels_t *k, const afsk_profile_t *profiles, const std::vector<int16_t> &in,
+					  size_t *decoded)
+{
+	size_t rows = in.size() / SIMD_LANES;
+	FrameLog reference, bankLog;
+
+	std::vector<int16_t> lane(rows);
+	for (int l = 0; l < SIMD_LANES; l++)
+	{
+		afsk_demod_t d;
+		afskDemodInit(&d, &profiles[l], (uint8_t)l, logFrame, &reference);
+		for (size_t r = 0; r < rows; r++)
+			lane[r] = in[r * SIMD_LANES + l];
+		afskDemodProcess(&d, lane.data(), rows);
+	}
+
+	static demod_bank_t bank; // Large, keep it off the stack
+	demodBankInit(&bank, k, profiles, SIMD_LANES, logFrame, &bankLog);
+	demodBankProcess(&bank, in.data(), rows);
+
+	*decoded = 0;
+	for (int l = 0; l < SIMD_LANES; l++)
+	{
+		*decoded += bankLog.frames[l].size();
+		if (bankLog.frames[l] != reference.frames[l])
+		{
+			printf("  lane %d: bank decoded %zu frames, afskDemod %zu\n", l, bankLog.frames[l].size(),
+				   reference.frames[l].size());
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Time a kernel, return lane-samples per second
+ */
+template <typename Fn>
+static double rate(size_t laneSamples, Fn fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return s > 0 ? laneSamples / s : 0.0;
+}
+
+/**
+ * @brief Verify and benchmark the SIMD kernels
+ * @param argc Argument count, argv[0] is "simd"
+ * @param argv Options
+ * @return 0 if all checks pass, 1 on a mismatch, 2 on a usage error
+ */
+int simdMain(int argc, char **argv)
+{
+	double benchSeconds = 60.0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			benchSeconds = strtod(argv[++i], NULL);
+		}
+		else
+		{
+			fprintf(stderr, "usage: simd [--seconds S]\n  --seconds S  audio per lane for the benchmark (default 60)\n");
+			return 2;
+		}
+	}
+
+	afsk_profile_t profiles[SIMD_LANES];
+	makeProfiles(profiles);
+	std::vector<int16_t> check = makeLanes(profiles, CHECK_SECONDS, 1);
+	std::vector<int16_t> bench = makeLanes(profiles, benchSeconds, 2);
+	size_t benchRows = bench.size() / SIMD_LANES;
+	std::vector<int16_t> firOut(bench.size());
+
+	const simd_kernels_t *kernels[4];
+	size_t count = simdKernelsAvailable(kernels, 4);
+	int status = 0;
+	printf("kernel    correlator   FIR         bank (lanes of %u Hz realtime per core)\n", CHECK_RATE);
+	for (size_t i = 0; i < count; i++)
+	{
+		const simd_kernels_t *k = kernels[i];
+		size_t ties = 0, decoded = 0;
+		bool ok = checkCorrelator(k, profiles, check, &ties) && checkFir(k, check) &&
+				  checkBank(k, profiles, check, &decoded);
+		if (!ok)
+		{
+			printf("%-8s  FAILED\n", k->name);
+			status = 1;
+			continue;
+		}
+
+		static corr_lanes_t corr;
+		static fir_lanes_t fir;
+		static demod_bank_t bank;
+		static uint16_t levels[DEMOD_BANK_CHUNK];
+		fir_decimator_t design;
+		firDecimatorInit(&design, 3, 24, 4000.0f / (3 * CHECK_RATE)); // The firmware's ADC decimator
+		corrLanesInit(&corr, profiles, SIMD_LANES);
+		firLanesInit(&fir, &design);
+		demodBankInit(&bank, k, profiles, SIMD_LANES, NULL, NULL);
+
+		size_t laneSamples = benchRows * SIMD_LANES;
+		double corrRate = rate(laneSamples, [&]
+							   {
+								   for (size_t r = 0; r < benchRows; r += DEMOD_BANK_CHUNK)
+								   {
+									   size_t n = benchRows - r < DEMOD_BANK_CHUNK ? benchRows - r : DEMOD_BANK_CHUNK;
+									   k->correlate(&corr, &bench[r * SIMD_LANES], n, levels);
+								   } });
+		double firRate = rate(laneSamples, [&]
+							  { k->firDecimate(&fir, bench.data(), benchRows, firOut.data()); });
+		double bankRate = rate(laneSamples, [&]
+							   { demodBankProcess(&bank, bench.data(), benchRows); });
+
+		// FIR input runs at 3x the demodulator rate
+		printf("%-8s  %9.0f   %9.0f   %9.0f   ok (%zu frames, %zu level ties)\n", k->name, corrRate / CHECK_RATE,
+			   firRate / (3 * CHECK_RATE), bankRate / CHECK_RATE, decoded, ties);
+	}
+	return status;
+}
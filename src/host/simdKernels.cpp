@@ -0,0 +1,530 @@
+/**
+ * @file simdKernels.cpp
+ * @date 2025-09-25
+ * @brief Lane-parallel receive kernels (scalar, SSE4.1, AVX2, NEON) for the host tools.
+ *
+ * x86 kernels are compiled with function target attributes, so the tool runs
+ * on any x86-64 CPU and picks the widest kernel at run time.
+ */
+
+#include "simdKernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__aarch64__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define TRIG_TABLE_BITS 8 // As afskDemod
+#define TRIG_TABLE_SIZE (1 << TRIG_TABLE_BITS)
+
+// Q15 tables built exactly like afskDemod's; 32-bit copies for gathers
+struct TrigTables
+{
+	int16_t cos16[TRIG_TABLE_SIZE];
+	int16_t sin16[TRIG_TABLE_SIZE];
+	int32_t cos32[TRIG_TABLE_SIZE];
+	int32_t sin32[TRIG_TABLE_SIZE];
+
+	TrigTables()
+	{
+		for (int i = 0; i < TRIG_TABLE_SIZE; i++)
+		{
+			float angle = 2.0f * (float)M_PI * i / TRIG_TABLE_SIZE;
+			cos16[i] = (int16_t)lroundf(32767.0f * cosf(angle));
+			sin16[i] = (int16_t)lroundf(32767.0f * sinf(angle));
+			cos32[i] = cos16[i];
+			sin32[i] = sin16[i];
+		}
+	}
+};
+
+static const TrigTables &trig()
+{
+	static const TrigTables tables; // Thread-safe one-time init
+	return tables;
+}
+
+/**
+ * @brief Set up correlator lanes from per-lane demodulator profiles
+ * @param c Lane state
+ * @param profiles One profile per used lane, all with the same window length
+ * @param lanes Number of used lanes, the rest correlate silence
+ * @return false if the profiles do not share a window length or are not AFSK_FRONT_END_GOERTZEL
+ */
+bool corrLanesInit(corr_lanes_t *c, const afsk_profile_t *profiles, size_t lanes)
+{
+	if (lanes == 0 || lanes > SIMD_LANES)
+	{
+		return false;
+	}
+	memset(c, 0, sizeof(*c));
+	trig();
+
+	// Let afskDemodInit derive window and steps so lanes match it exactly
+	afsk_demod_t d;
+	for (size_t l = 0; l < lanes; l++)
+	{
+		if (profiles[l].frontEnd != AFSK_FRONT_END_GOERTZEL || !afskDemodInit(&d, &profiles[l], 0, NULL, NULL) ||
+			(l > 0 && d.window != c->window))
+		{
+			return false;
+		}
+		c->window = d.window;
+		c->markStep[l] = d.markStep;
+		c->spaceStep[l] = d.spaceStep;
+	}
+	return true;
+}
+
+/**
+ * @brief Set up FIR lanes with the taps of a designed decimator
+ * @param f Lane state
+ * @param design Decimator from firDecimatorInit()
+ */
+void firLanesInit(fir_lanes_t *f, const fir_decimator_t *design)
+{
+	memset(f, 0, sizeof(*f));
+	memcpy(f->taps, design->taps, sizeof(f->taps));
+	f->numTaps = design->numTaps;
+	f->factor = design->factor;
+}
+
+/**
+ * @brief Store one input row in the doubled FIR history, true when an output is due
+ */
+static inline bool firPush(fir_lanes_t *f, const int16_t *row)
+{
+	memcpy(f->history[f->pos], row, sizeof(f->history[0]));
+	memcpy(f->history[f->pos + f->numTaps], row, sizeof(f->history[0]));
+	if (++f->pos >= f->numTaps)
+	{
+		f->pos = 0;
+	}
+	if (++f->phase < f->factor)
+	{
+		return false;
+	}
+	f->phase = 0;
+	return true;
+}
+
+// ---------------------------------------------------------------- scalar
+
+static void correlateScalar(corr_lanes_t *c, const int16_t *in, size_t count, uint16_t *levels)
+{
+	const TrigTables &t = trig();
+	for (size_t n = 0; n < count; n++)
+	{
+		const int16_t *x = in + n * SIMD_LANES;
+		int16_t(*h)[SIMD_LANES] = c->history[c->pos];
+		uint16_t mask = 0;
+		for (int l = 0; l < SIMD_LANES; l++)
+		{
+			uint8_t mi = c->markPhase[l] >> (32 - TRIG_TABLE_BITS);
+			uint8_t si = c->spacePhase[l] >> (32 - TRIG_TABLE_BITS);
+			c->markPhase[l] += c->markStep[l];
+			c->spacePhase[l] += c->spaceStep[l];
+
+			int32_t v = x[l];
+			int32_t p0 = (v * t.cos16[mi]) >> 15;
+			int32_t p1 = (v * t.sin16[mi]) >> 15;
+			int32_t p2 = (v * t.cos16[si]) >> 15;
+			int32_t p3 = (v * t.sin16[si]) >> 15;
+			c->markI[l] += p0 - h[0][l];
+			c->markQ[l] += p1 - h[1][l];
+			c->spaceI[l] += p2 - h[2][l];
+			c->spaceQ[l] += p3 - h[3][l];
+			h[0][l] = (int16_t)p0;
+			h[1][l] = (int16_t)p1;
+			h[2][l] = (int16_t)p2;
+			h[3][l] = (int16_t)p3;
+
+			float mI = (float)c->markI[l], mQ = (float)c->markQ[l];
+			float sI = (float)c->spaceI[l], sQ = (float)c->spaceQ[l];
+			if (mI * mI + mQ * mQ > sI * sI + sQ * sQ)
+			{
+				mask |= 1u << l;
+			}
+		}
+		if (++c->pos >= c->window)
+		{
+			c->pos = 0;
+		}
+		levels[n] = mask;
+	}
+}
+
+static size_t firDecimateScalar(fir_lanes_t *f, const int16_t *in, size_t count, int16_t *out)
+{
+	size_t produced = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!firPush(f, in + i * SIMD_LANES))
+		{
+			continue;
+		}
+		int16_t *row = out + produced++ * SIMD_LANES;
+		for (int l = 0; l < SIMD_LANES; l++)
+		{
+			int32_t acc = 0;
+			for (uint8_t t = 0; t < f->numTaps; t++)
+			{
+				acc += (int32_t)f->taps[t] * f->history[f->pos + t][l];
+			}
+			acc = (acc + (1 << 14)) >> 15;
+			row[l] = (int16_t)(acc > INT16_MAX ? INT16_MAX : acc < INT16_MIN ? INT16_MIN : acc);
+		}
+	}
+	return produced;
+}
+
+static const simd_kernels_t scalarKernels = {"scalar", correlateScalar, firDecimateScalar};
+
+#ifdef SIMD_X86
+/**
+ * @brief Pack two taps into one 32-bit word for pmaddwd, first tap in the low half
+ */
+static inline int32_t tapPair(int16_t first, int16_t second)
+{
+	return (int32_t)((uint32_t)(uint16_t)first | ((uint32_t)(uint16_t)second << 16));
+}
+
+// ---------------------------------------------------------------- SSE4.1
+
+TARGET_SSE41 static inline __m128i slide4(int32_t *sum, int16_t *history, __m128i product)
+{
+	__m128i old = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)history));
+	__m128i s = _mm_add_epi32(_mm_load_si128((const __m128i *)sum), _mm_sub_epi32(product, old));
+	_mm_store_si128((__m128i *)sum, s);
+	_mm_storel_epi64((__m128i *)history, _mm_packs_epi32(product, product)); // Products fit in 16 bits
+	return s;
+}
+
+TARGET_SSE41 static inline __m128 energy4(__m128i i, __m128i q)
+{
+	__m128 fi = _mm_cvtepi32_ps(i);
+	__m128 fq = _mm_cvtepi32_ps(q);
+	return _mm_add_ps(_mm_mul_ps(fi, fi), _mm_mul_ps(fq, fq));
+}
+
+TARGET_SSE41 static void correlateSse41(corr_lanes_t *c, const int16_t *in, size_t count, uint16_t *levels)
+{
+	const TrigTables &t = trig();
+	alignas(16) int32_t cm[SIMD_LANES], sm[SIMD_LANES], cs[SIMD_LANES], ss[SIMD_LANES];
+	for (size_t n = 0; n < count; n++)
+	{
+		// No gather before AVX2: look the oscillators up in scalar code
+		for (int l = 0; l < SIMD_LANES; l++)
+		{
+			uint8_t mi = c->markPhase[l] >> (32 - TRIG_TABLE_BITS);
+			uint8_t si = c->spacePhase[l] >> (32 - TRIG_TABLE_BITS);
+			c->markPhase[l] += c->markStep[l];
+			c->spacePhase[l] += c->spaceStep[l];
+			cm[l] = t.cos32[mi];
+			sm[l] = t.sin32[mi];
+			cs[l] = t.cos32[si];
+			ss[l] = t.sin32[si];
+		}
+
+		int16_t(*h)[SIMD_LANES] = c->history[c->pos];
+		unsigned mask = 0;
+		for (int q = 0; q < SIMD_LANES; q += 4)
+		{
+			__m128i x = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(in + n * SIMD_LANES + q)));
+			__m128i p0 = _mm_srai_epi32(_mm_mullo_epi32(x, _mm_load_si128((const __m128i *)&cm[q])), 15);
+			__m128i p1 = _mm_srai_epi32(_mm_mullo_epi32(x, _mm_load_si128((const __m128i *)&sm[q])), 15);
+			__m128i p2 = _mm_srai_epi32(_mm_mullo_epi32(x, _mm_load_si128((const __m128i *)&cs[q])), 15);
+			__m128i p3 = _mm_srai_epi32(_mm_mullo_epi32(x, _mm_load_si128((const __m128i *)&ss[q])), 15);
+			__m128i mI = slide4(&c->markI[q], &h[0][q], p0);
+			__m128i mQ = slide4(&c->markQ[q], &h[1][q], p1);
+			__m128i sI = slide4(&c->spaceI[q], &h[2][q], p2);
+			__m128i sQ = slide4(&c->spaceQ[q], &h[3][q], p3);
+			mask |= (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(energy4(mI, mQ), energy4(sI, sQ))) << q;
+		}
+		if (++c->pos >= c->window)
+		{
+			c->pos = 0;
+		}
+		levels[n] = (uint16_t)mask;
+	}
+}
+
+TARGET_SSE41 static size_t firDecimateSse41(fir_lanes_t *f, const int16_t *in, size_t count, int16_t *out)
+{
+	const __m128i round = _mm_set1_epi32(1 << 14);
+	size_t produced = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!firPush(f, in + i * SIMD_LANES))
+		{
+			continue;
+		}
+
+		// Two taps per madd: (x[t] * tap[t] + x[t+1] * tap[t+1]) per lane, exact in 32 bits
+		__m128i acc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+		const int16_t(*window)[SIMD_LANES] = &f->history[f->pos];
+		for (uint8_t t = 0; t < f->numTaps; t += 2)
+		{
+			int16_t second = t + 1 < f->numTaps ? f->taps[t + 1] : 0;
+			__m128i taps = _mm_set1_epi32(tapPair(f->taps[t], second));
+			for (int v = 0; v < 2; v++)
+			{
+				__m128i a = _mm_load_si128((const __m128i *)&window[t][8 * v]);
+				__m128i b = t + 1 < f->numTaps ? _mm_load_si128((const __m128i *)&window[t + 1][8 * v]) : _mm_setzero_si128();
+				acc[2 * v] = _mm_add_epi32(acc[2 * v], _mm_madd_epi16(_mm_unpacklo_epi16(a, b), taps));
+				acc[2 * v + 1] = _mm_add_epi32(acc[2 * v + 1], _mm_madd_epi16(_mm_unpackhi_epi16(a, b), taps));
+			}
+		}
+		int16_t *row = out + produced++ * SIMD_LANES;
+		for (int v = 0; v < 2; v++)
+		{
+			__m128i lo = _mm_srai_epi32(_mm_add_epi32(acc[2 * v], round), 15);
+			__m128i hi = _mm_srai_epi32(_mm_add_epi32(acc[2 * v + 1], round), 15);
+			_mm_storeu_si128((__m128i *)&row[8 * v], _mm_packs_epi32(lo, hi)); // Saturates like the scalar clamp
+		}
+	}
+	return produced;
+}
+
+static const simd_kernels_t sse41Kernels = {"sse4.1", correlateSse41, firDecimateSse41};
+
+// ---------------------------------------------------------------- AVX2
+
+TARGET_AVX2 static inline __m256i slide8(int32_t *sum, int16_t *history, __m256i product)
+{
+	__m256i old = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)history));
+	__m256i s = _mm256_add_epi32(_mm256_load_si256((const __m256i *)sum), _mm256_sub_epi32(product, old));
+	_mm256_store_si256((__m256i *)sum, s);
+	__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(product, product), 0x08);
+	_mm_storeu_si128((__m128i *)history, _mm256_castsi256_si128(packed));
+	return s;
+}
+
+TARGET_AVX2 static inline __m256 energy8(__m256i i, __m256i q)
+{
+	__m256 fi = _mm256_cvtepi32_ps(i);
+	__m256 fq = _mm256_cvtepi32_ps(q);
+	return _mm256_add_ps(_mm256_mul_ps(fi, fi), _mm256_mul_ps(fq, fq)); // No FMA, as the scalar reference
+}
+
+TARGET_AVX2 static void correlateAvx2(corr_lanes_t *c, const int16_t *in, size_t count, uint16_t *levels)
+{
+	const TrigTables &t = trig();
+	for (size_t n = 0; n < count; n++)
+	{
+		int16_t(*h)[SIMD_LANES] = c->history[c->pos];
+		unsigned mask = 0;
+		for (int q = 0; q < SIMD_LANES; q += 8)
+		{
+			__m256i mp = _mm256_load_si256((const __m256i *)&c->markPhase[q]);
+			__m256i sp = _mm256_load_si256((const __m256i *)&c->spacePhase[q]);
+			_mm256_store_si256((__m256i *)&c->markPhase[q], _mm256_add_epi32(mp, _mm256_load_si256((const __m256i *)&c->markStep[q])));
+			_mm256_store_si256((__m256i *)&c->spacePhase[q], _mm256_add_epi32(sp, _mm256_load_si256((const __m256i *)&c->spaceStep[q])));
+			__m256i mi = _mm256_srli_epi32(mp, 32 - TRIG_TABLE_BITS);
+			__m256i si = _mm256_srli_epi32(sp, 32 - TRIG_TABLE_BITS);
+
+			__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + n * SIMD_LANES + q)));
+			__m256i p0 = _mm256_srai_epi32(_mm256_mullo_epi32(x, _mm256_i32gather_epi32(t.cos32, mi, 4)), 15);
+			__m256i p1 = _mm256_srai_epi32(_mm256_mullo_epi32(x, _mm256_i32gather_epi32(t.sin32, mi, 4)), 15);
+			__m256i p2 = _mm256_srai_epi32(_mm256_mullo_epi32(x, _mm256_i32gather_epi32(t.cos32, si, 4)), 15);
+			__m256i p3 = _mm256_srai_epi32(_mm256_mullo_epi32(x, _mm256_i32gather_epi32(t.sin32, si, 4)), 15);
+			__m256i mI = slide8(&c->markI[q], &h[0][q], p0);
+			__m256i mQ = slide8(&c->markQ[q], &h[1][q], p1);
+			__m256i sI = slide8(&c->spaceI[q], &h[2][q], p2);
+			__m256i sQ = slide8(&c->spaceQ[q], &h[3][q], p3);
+			mask |= (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(energy8(mI, mQ), energy8(sI, sQ), _CMP_GT_OQ)) << q;
+		}
+		if (++c->pos >= c->window)
+		{
+			c->pos = 0;
+		}
+		levels[n] = (uint16_t)mask;
+	}
+}
+
+TARGET_AVX2 static size_t firDecimateAvx2(fir_lanes_t *f, const int16_t *in, size_t count, int16_t *out)
+{
+	const __m256i round = _mm256_set1_epi32(1 << 14);
+	size_t produced = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!firPush(f, in + i * SIMD_LANES))
+		{
+			continue;
+		}
+
+		// unpacklo/hi work per 128-bit half, so lo holds lanes 0-3 and 8-11, hi 4-7 and 12-15
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+		const int16_t(*window)[SIMD_LANES] = &f->history[f->pos];
+		for (uint8_t t = 0; t < f->numTaps; t += 2)
+		{
+			int16_t second = t + 1 < f->numTaps ? f->taps[t + 1] : 0;
+			__m256i taps = _mm256_set1_epi32(tapPair(f->taps[t], second));
+			__m256i a = _mm256_load_si256((const __m256i *)window[t]);
+			__m256i b = t + 1 < f->numTaps ? _mm256_load_si256((const __m256i *)window[t + 1]) : _mm256_setzero_si256();
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), taps));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), taps));
+		}
+		lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+		hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+		_mm256_storeu_si256((__m256i *)(out + produced++ * SIMD_LANES), _mm256_packs_epi32(lo, hi)); // Back in lane order
+	}
+	return produced;
+}
+
+static const simd_kernels_t avx2Kernels = {"avx2", correlateAvx2, firDecimateAvx2};
+#endif // SIMD_X86
+
+#ifdef SIMD_NEON
+// ---------------------------------------------------------------- NEON
+
+static inline int32x4_t slide4(int32_t *sum, int16_t *history, int32x4_t product)
+{
+	int32x4_t s = vaddq_s32(vld1q_s32(sum), vsubq_s32(product, vmovl_s16(vld1_s16(history))));
+	vst1q_s32(sum, s);
+	vst1_s16(history, vmovn_s32(product));
+	return s;
+}
+
+static inline float32x4_t energy4(int32x4_t i, int32x4_t q)
+{
+	float32x4_t fi = vcvtq_f32_s32(i);
+	float32x4_t fq = vcvtq_f32_s32(q);
+	return vaddq_f32(vmulq_f32(fi, fi), vmulq_f32(fq, fq));
+}
+
+static void correlateNeon(corr_lanes_t *c, const int16_t *in, size_t count, uint16_t *levels)
+{
+	const TrigTables &t = trig();
+	static const uint32_t bitValues[4] = {1, 2, 4, 8};
+	const uint32x4_t bits = vld1q_u32(bitValues);
+	alignas(16) int32_t cm[SIMD_LANES], sm[SIMD_LANES], cs[SIMD_LANES], ss[SIMD_LANES];
+	for (size_t n = 0; n < count; n++)
+	{
+		for (int l = 0; l < SIMD_LANES; l++)
+		{
+			uint8_t mi = c->markPhase[l] >> (32 - TRIG_TABLE_BITS);
+			uint8_t si = c->spacePhase[l] >> (32 - TRIG_TABLE_BITS);
+			c->markPhase[l] += c->markStep[l];
+			c->spacePhase[l] += c->spaceStep[l];
+			cm[l] = t.cos32[mi];
+			sm[l] = t.sin32[mi];
+			cs[l] = t.cos32[si];
+			ss[l] = t.sin32[si];
+		}
+
+		int16_t(*h)[SIMD_LANES] = c->history[c->pos];
+		unsigned mask = 0;
+		for (int q = 0; q < SIMD_LANES; q += 4)
+		{
+			int32x4_t x = vmovl_s16(vld1_s16(in + n * SIMD_LANES + q));
+			int32x4_t mI = slide4(&c->markI[q], &h[0][q], vshrq_n_s32(vmulq_s32(x, vld1q_s32(&cm[q])), 15));
+			int32x4_t mQ = slide4(&c->markQ[q], &h[1][q], vshrq_n_s32(vmulq_s32(x, vld1q_s32(&sm[q])), 15));
+			int32x4_t sI = slide4(&c->spaceI[q], &h[2][q], vshrq_n_s32(vmulq_s32(x, vld1q_s32(&cs[q])), 15));
+			int32x4_t sQ = slide4(&c->spaceQ[q], &h[3][q], vshrq_n_s32(vmulq_s32(x, vld1q_s32(&ss[q])), 15));
+			uint32x4_t gt = vcgtq_f32(energy4(mI, mQ), energy4(sI, sQ));
+			mask |= vaddvq_u32(vandq_u32(gt, bits)) << q;
+		}
+		if (++c->pos >= c->window)
+		{
+			c->pos = 0;
+		}
+		levels[n] = (uint16_t)mask;
+	}
+}
+
+static size_t firDecimateNeon(fir_lanes_t *f, const int16_t *in, size_t count, int16_t *out)
+{
+	size_t produced = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!firPush(f, in + i * SIMD_LANES))
+		{
+			continue;
+		}
+		int32x4_t acc[4] = {vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0)};
+		const int16_t(*window)[SIMD_LANES] = &f->history[f->pos];
+		for (uint8_t t = 0; t < f->numTaps; t++)
+		{
+			for (int v = 0; v < 4; v++)
+			{
+				acc[v] = vmlal_n_s16(acc[v], vld1_s16(&window[t][4 * v]), f->taps[t]);
+			}
+		}
+		int16_t *row = out + produced++ * SIMD_LANES;
+		for (int v = 0; v < 4; v++)
+		{
+			vst1_s16(&row[4 * v], vqmovn_s32(vrshrq_n_s32(acc[v], 15))); // Round half up and saturate
+		}
+	}
+	return produced;
+}
+
+static const simd_kernels_t neonKernels = {"neon", correlateNeon, firDecimateNeon};
+#endif // SIMD_NEON
+
+// ---------------------------------------------------------------- dispatch
+
+/**
+ * @brief List the kernel sets the CPU supports
+ * @param list Destination, scalar first
+ * @param max Size of list
+ * @return Number of entries written
+ */
+size_t simdKernelsAvailable(const simd_kernels_t **list, size_t max)
+{
+	size_t n = 0;
+	if (n < max)
+		list[n++] = &scalarKernels;
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (n < max && __builtin_cpu_supports("sse4.1"))
+		list[n++] = &sse41Kernels;
+	if (n < max && __builtin_cpu_supports("avx2"))
+		list[n++] = &avx2Kernels;
+#endif
+#ifdef SIMD_NEON
+	if (n < max)
+		list[n++] = &neonKernels; // Always present on AArch64
+#endif
+	return n;
+}
+
+/**
+ * @brief Get the fastest kernel set the CPU supports
+ * @return Kernel set, never NULL
+ */
+const simd_kernels_t *simdKernelsBest()
+{
+	const simd_kernels_t *list[4];
+	size_t n = simdKernelsAvailable(list, 4);
+	return list[n - 1];
+}
+
+/**
+ * @brief Get a kernel set by name
+ * @param name "scalar", "sse4.1", "avx2" or "neon"
+ * @return Kernel set, NULL if unknown or not supported by this CPU
+ */
+const simd_kernels_t *simdKernelsByName(const char *name)
+{
+	const simd_kernels_t *list[4];
+	size_t n = simdKernelsAvailable(list, 4);
+	for (size_t i = 0; i < n; i++)
+	{
+		if (strcmp(list[i]->name, name) == 0)
+		{
+			return list[i];
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file simdKernels.h
+ * @date 2025-09-25
+ * @brief Lane-parallel receive kernels (scalar, SSE4.1, AVX2, NEON) for the host tools.
+ *
+ * The kernels run the afskDemod correlator and the firDecimator filter on
+ * SIMD_LANES independent streams at once. Inputs and outputs are interleaved
+ * sample-major ([sample][lane]) so one vector load picks up one sample of 8 or
+ * 16 lanes. Lanes can carry different radio channels or different decoder
+ * variants (tone pairs) of the same channel; unused lanes are fed zeros.
+ *
+ * The scalar kernel is the reference and follows afskDemod and firDecimator
+ * operation for operation. Integer state (phases, sums, history, filter
+ * output) is bit-exact in every kernel. The mark/space decision compares
+ * float energies, which can flip on exact ties when a compiler contracts
+ * multiply-adds differently, so it is checked against the scalar kernel with
+ * a tie tolerance ("simd" subcommand).
+ *
+ * Functions:
+ * - simdKernelsBest(): Fastest kernel set the CPU supports.
+ * - simdKernelsByName(): Kernel set by name, if supported ("scalar", "sse4.1", "avx2", "neon").
+ * - simdKernelsAvailable(): All kernel sets the CPU supports, scalar first.
+ * - corrLanesInit() / firLanesInit(): Set up lane state.
+ */
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "afskDemod.h"
+#include "firDecimator.h"
+
+#define SIMD_LANES 16 // Lanes per kernel call, 2 AVX2 or 4 SSE/NEON vectors of 32-bit state
+
+// Correlator state for SIMD_LANES lanes sharing one window length
+typedef struct
+{
+	alignas(32) uint32_t markPhase[SIMD_LANES];
+	alignas(32) uint32_t spacePhase[SIMD_LANES];
+	alignas(32) uint32_t markStep[SIMD_LANES];
+	alignas(32) uint32_t spaceStep[SIMD_LANES];
+	alignas(32) int32_t markI[SIMD_LANES];
+	alignas(32) int32_t markQ[SIMD_LANES];
+	alignas(32) int32_t spaceI[SIMD_LANES];
+	alignas(32) int32_t spaceQ[SIMD_LANES];
+	alignas(32) int16_t history[AFSK_DEMOD_MAX_WINDOW][4][SIMD_LANES]; // Products leaving the window
+	uint8_t window;
+	uint8_t pos;
+} corr_lanes_t;
+
+// Decimating FIR state for SIMD_LANES lanes sharing one filter
+typedef struct
+{
+	alignas(32) int16_t history[2 * FIR_DECIMATOR_MAX_TAPS][SIMD_LANES]; // Stored twice, as in firDecimator
+	int16_t taps[FIR_DECIMATOR_MAX_TAPS];
+	uint8_t numTaps;
+	uint8_t factor;
+	uint8_t phase;
+	uint8_t pos;
+} fir_lanes_t;
+
+typedef struct
+{
+	const char *name;
+
+	/**
+	 * Correlate count samples per lane. levels[n] bit l is set when lane l has
+	 * more mark than space energy after sample n.
+	 */
+	void (*correlate)(corr_lanes_t *c, const int16_t *in, size_t count, uint16_t *levels);
+
+	/**
+	 * Filter and decimate count samples per lane into out ([output][lane]),
+	 * at least count / factor + 1 rows. Returns the number of rows written.
+	 */
+	size_t (*firDecimate)(fir_lanes_t *f, const int16_t *in, size_t count, int16_t *out);
+} simd_kernels_t;
+
+/**
+ * @brief Get the fastest kernel set the CPU supports
+ * @return Kernel set, never NULL
+ */
+const simd_kernels_t *simdKernelsBest();
+
+/**
+ * @brief Get a kernel set by name
+ * @param name "scalar", "sse4.1", "avx2" or "neon"
+ * @return Kernel set, NULL if unknown or not supported by this CPU
+ */
+const simd_kernels_t *simdKernelsByName(const char *name);
+
+/**
+ * @brief List the kernel sets the CPU supports
+ * @param list Destination, scalar first
+ * @param max Size of list
+ * @return Number of entries written
+ */
+size_t simdKernelsAvailable(const simd_kernels_t **list, size_t max);
+
+/**
+ * @brief Set up correlator lanes from per-lane demodulator profiles
+ * @param c Lane state
+ * @param profiles One profile per used lane, all with the same window length
+ * @param lanes Number of used lanes, the rest correlate silence
+ * @return false if the profiles do not share a window length or are not AFSK_FRONT_END_GOERTZEL
+ */
+bool corrLanesInit(corr_lanes_t *c, const afsk_profile_t *profiles, size_t lanes);
+
+/**
+ * @brief Set up FIR lanes with the taps of a designed decimator
+ * @param f Lane state
+ * @param design Decimator from firDecimatorInit()
+ */
+void firLanesInit(fir_lanes_t *f, const fir_decimator_t *design);
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,263 @@
+/**
+ * @file squelchCheck.cpp
+ * @date 2025-10-18
+ * @brief "squelch" subcommand: wake latency and missed preambles of the receive squelch.
+ *
+ * Synthesizes --bursts AFSK frames, each with --flags preamble flags, at each
+ * --snr, separated by noise gaps longer than the hang time. The audio goes in
+ * AUDIO_BLOCK_SAMPLES blocks through squelchProcess() with the firmware's
+ * RX_SQUELCH_* settings. Two demodulators follow, one fed every block and one
+ * gated as in RX_SQUELCH_GATED: only while the squelch is open, starting with
+ * the block that opens it. Checks at each SNR:
+ * - every burst wakes the squelch, within --max-wake-ms of its first flag
+ * - the gated demodulator decodes every frame the ungated one decodes, so no
+ *   preamble is missed
+ * The time the squelch spends open on noise alone is printed as well; it is
+ * the share of idle time at full clock. Exits 1 if any check fails.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "afskDemod.h"
+#include "afskModulator.h"
+#include "hdlc.h"
+#include "hostTools.h"
+#include "squelch.h"
+
+#define SQ_RATE 9600			 // As AUDIO_RX_SAMPLE_RATE
+#define SQ_BLOCK 96				 // As AUDIO_BLOCK_SAMPLES
+#define SQ_DECIMATION 3			 // As RX_SQUELCH_DECIMATION
+#define SQ_OPEN_DB 6.0f			 // As RX_SQUELCH_OPEN_DB
+#define SQ_CLOSE_DB 3.0f		 // As RX_SQUELCH_CLOSE_DB
+#define SQ_HANG_BLOCKS 20		 // As RX_SQUELCH_HANG_BLOCKS
+#define SQ_MIN_LEVEL 64			 // As RX_SQUELCH_MIN_LEVEL
+#define SQ_TONE_LEVEL 16384		 // Modulator peak before the SNR gain
+#define SQ_NOISE_RMS 1000.0f	 // Noise level, as in the demod and eye simulators
+#define SQ_FRAME_BYTES 64
+#define SQ_DEFAULT_FLAGS 32		 // As AFSK_TXDELAY_FLAGS
+#define SQ_DEFAULT_BURSTS 50
+#define SQ_DEFAULT_MAX_WAKE_MS 20 // Two blocks, three flags at 1200 baud
+#define SQ_SETTLE_MS 1000		 // Noise before the first burst, for the floor to settle
+#define SQ_GAP_MS 500			 // Shortest noise gap, past the hang time
+
+// Where the squelch should open
+typedef struct
+{
+	size_t start; // First preamble sample
+	size_t end;	  // Sample after the closing flag
+} sq_burst_t;
+
+static void squelchUsage()
+{
+	fprintf(stderr,
+			"usage: program squelch [options]\n"
+			"  --snr DB          signal to noise ratio, repeatable (default 8, 12 and 20)\n"
+			"  --flags N         preamble flags per frame (default %d)\n"
+			"  --bursts N        frames per SNR (default %d)\n"
+			"  --max-wake-ms MS  longest wake latency allowed (default %d)\n"
+			"  --seed N          random seed (default 1)\n",
+			SQ_DEFAULT_FLAGS, SQ_DEFAULT_BURSTS, SQ_DEFAULT_MAX_WAKE_MS);
+}
+
+// Frames one demodulator decoded, by the block holding their closing flag
+typedef struct
+{
+	size_t block;
+	std::vector<size_t> frameBlocks;
+} sq_rx_t;
+
+static void onFrame(void *ctx, uint8_t port, const uint8_t *frame, size_t len)
+{
+	sq_rx_t *rx = (sq_rx_t *)ctx;
+	rx->frameBlocks.push_back(rx->block);
+}
+
+/**
+ * @brief Mark the bursts a demodulator decoded
+ */
+static std::vector<bool> decodedBursts(const sq_rx_t *rx, const std::vector<sq_burst_t> &where)
+{
+	std::vector<bool> decoded(where.size());
+	for (size_t block : rx->frameBlocks)
+	{
+		// The latest burst started by this block; gaps are far longer than the decode delay
+		size_t b = where.size();
+		while (b > 0 && where[b - 1].start >= (block + 1) * SQ_BLOCK)
+			b--;
+		if (b > 0)
+			decoded[b - 1] = true;
+	}
+	return decoded;
+}
+
+/**
+ * @brief Bursts of AFSK frames in noise, with where each burst is
+ */
+static std::vector<int16_t> simulate(double snrDb, uint16_t flags, size_t bursts, unsigned seed,
+									 std::vector<sq_burst_t> *where)
+{
+	std::mt19937 rng(seed);
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, SQ_RATE, 1200, 2200, 1200);
+	float gain = (float)(SQ_NOISE_RMS * sqrt(2.0) * pow(10.0, snrDb / 20.0) / SQ_TONE_LEVEL);
+	std::normal_distribution<float> noise(0.0f, SQ_NOISE_RMS);
+
+	std::vector<int16_t> audio;
+	std::vector<uint8_t> levels(HDLC_ENCODED_LEVELS(SQ_FRAME_BYTES, flags));
+	std::vector<int16_t> bit(SQ_RATE / 1200 + 2);
+	uint8_t frame[SQ_FRAME_BYTES];
+	for (size_t k = 0; k < (size_t)SQ_RATE * SQ_SETTLE_MS / 1000; k++)
+		audio.push_back((int16_t)noise(rng));
+	for (size_t b = 0; b < bursts; b++)
+	{
+		for (uint8_t &v : frame)
+			v = (uint8_t)rng();
+		size_t count = hdlcEncode(frame, sizeof(frame), flags, levels.data(), levels.size());
+		afskModulatorReset(&mod);
+		sq_burst_t burst = {audio.size(), 0};
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t n = afskModulatorBit(&mod, levels[i], bit.data());
+			for (size_t k = 0; k < n; k++)
+				audio.push_back((int16_t)std::max(-32768.0f, std::min(32767.0f, gain * bit[k] + noise(rng))));
+		}
+		burst.end = audio.size();
+		where->push_back(burst);
+		size_t gap = (size_t)SQ_RATE * SQ_GAP_MS / 1000 + rng() % SQ_RATE;
+		for (size_t k = 0; k < gap; k++)
+			audio.push_back((int16_t)noise(rng));
+	}
+	return audio;
+}
+
+/**
+ * @brief Run one SNR through the squelch and both demodulators
+ * @return true if every burst woke the squelch in time and no frame was lost to it
+ */
+static bool checkSnr(double snrDb, uint16_t flags, size_t bursts, uint32_t maxWakeMs, unsigned seed)
+{
+	std::vector<sq_burst_t> where;
+	std::vector<int16_t> audio = simulate(snrDb, flags, bursts, seed, &where);
+
+	squelch_t sq;
+	squelchInit(&sq, SQ_DECIMATION, SQ_OPEN_DB, SQ_CLOSE_DB, SQ_HANG_BLOCKS, SQ_MIN_LEVEL);
+	afsk_profile_t profile = {1200, 2200, 1200, SQ_RATE, AFSK_FRONT_END_GOERTZEL};
+	static afsk_demod_t always, gated;
+	sq_rx_t alwaysRx = {0, {}}, gatedRx = {0, {}};
+	afskDemodInit(&always, &profile, 0, onFrame, &alwaysRx);
+	afskDemodInit(&gated, &profile, 0, onFrame, &gatedRx);
+
+	size_t blocks = audio.size() / SQ_BLOCK;
+	std::vector<bool> open(blocks);
+	for (size_t i = 0; i < blocks; i++)
+	{
+		const int16_t *block = &audio[i * SQ_BLOCK];
+		alwaysRx.block = gatedRx.block = i;
+		open[i] = squelchProcess(&sq, block, SQ_BLOCK);
+		afskDemodProcess(&always, block, SQ_BLOCK);
+		if (open[i])
+			afskDemodProcess(&gated, block, SQ_BLOCK);
+	}
+
+	// Wake: the end of the first open block holding part of the burst
+	size_t woken = 0, late = 0;
+	double worstWakeMs = 0.0, totalWakeMs = 0.0;
+	std::vector<bool> idle(blocks, true); // Noise only, past the hang time of a burst
+	for (const sq_burst_t &burst : where)
+	{
+		size_t first = burst.start / SQ_BLOCK;
+		size_t last = (burst.end - 1) / SQ_BLOCK;
+		for (size_t i = first; i <= last + SQ_HANG_BLOCKS && i < blocks; i++)
+			idle[i] = false;
+		for (size_t i = first; i <= last && i < blocks; i++)
+		{
+			if (open[i])
+			{
+				double wakeMs = 1000.0 * (double)((i + 1) * SQ_BLOCK - burst.start) / SQ_RATE;
+				worstWakeMs = std::max(worstWakeMs, wakeMs);
+				totalWakeMs += wakeMs;
+				woken++;
+				late += wakeMs > maxWakeMs;
+				break;
+			}
+		}
+	}
+	size_t noiseBlocks = 0, noiseOpen = 0;
+	for (size_t i = 0; i < blocks; i++)
+	{
+		if (idle[i] && i * SQ_BLOCK >= (size_t)SQ_RATE * SQ_SETTLE_MS / 1000)
+		{
+			noiseBlocks++;
+			noiseOpen += open[i];
+		}
+	}
+
+	// Missed preamble: a frame the ungated demodulator has and the gated one lost
+	std::vector<bool> alwaysDecoded = decodedBursts(&alwaysRx, where);
+	std::vector<bool> gatedDecoded = decodedBursts(&gatedRx, where);
+	size_t decoded = 0, missed = 0;
+	for (size_t b = 0; b < where.size(); b++)
+	{
+		decoded += alwaysDecoded[b];
+		missed += alwaysDecoded[b] && !gatedDecoded[b];
+	}
+
+	bool ok = woken == bursts && late == 0 && missed == 0;
+	printf("snr %4.1f dB: woke %zu of %zu bursts, wake mean %.1f ms worst %.1f ms (%.1f flags), "
+		   "%zu missed preambles in %zu frames, open %.1f%% of noise%s\n",
+		   snrDb, woken, bursts, woken ? totalWakeMs / woken : 0.0, worstWakeMs, worstWakeMs * 1200.0 / 8000.0,
+		   missed, decoded, noiseBlocks ? 100.0 * noiseOpen / noiseBlocks : 0.0, ok ? "" : "  FAIL");
+	return ok;
+}
+
+int squelchMain(int argc, char **argv)
+{
+	std::vector<double> snrs;
+	unsigned flags = SQ_DEFAULT_FLAGS, seed = 1;
+	size_t bursts = SQ_DEFAULT_BURSTS;
+	uint32_t maxWakeMs = SQ_DEFAULT_MAX_WAKE_MS;
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--snr") == 0 && more)
+			snrs.push_back(strtod(argv[++i], NULL));
+		else if (strcmp(argv[i], "--flags") == 0 && more)
+			flags = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--bursts") == 0 && more)
+			bursts = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--max-wake-ms") == 0 && more)
+			maxWakeMs = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && more)
+			seed = (unsigned)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			squelchUsage();
+			return 2;
+		}
+	}
+	if (flags < 1 || flags > 1000 || bursts < 1)
+	{
+		squelchUsage();
+		return 2;
+	}
+	if (snrs.empty())
+		snrs = {8.0, 12.0, 20.0};
+
+	int failures = 0;
+	for (double snr : snrs)
+	{
+		if (!checkSnr(snr, (uint16_t)flags, bursts, maxWakeMs, seed))
+			failures++;
+	}
+	if (failures > 0)
+	{
+		printf("%d SNRs failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file txCheck.cpp
+ * @date 2025-10-18
+ * @brief "tx" subcommand: spectral checks of the AFSK transmit waveforms.
+ *
+ * Renders the tones with the code the encoder runs on the TNC and measures them:
+ * - twist: for each --twist setting, the tone levels from afskTwistLevels(),
+ *   rendered as the wave tables of the timer-driven outputs, each played at its
+ *   own sample rate, and by the block renderer at the codec rate. A Goertzel
+ *   filter at each tone over whole cycles gives the mark level relative to
+ *   space, which must be the setting within TX_TWIST_TOLERANCE_DB.
+ * - shaper: each tone's wave table through noiseShaperStep() at every shaping
+ *   order, for the 8-bit DAC and sigma-delta and the 10-bit PWM outputs, at the
+ *   timer's sample rate. The in-band SNR is the tone power over the power of
+ *   the quantization error between 300 and 3000 Hz, from Hann-windowed DFTs.
+ *   Second-order shaping must beat plain rounding.
+ * Exits 1 if any check fails.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "afskModulator.h"
+#include "hostTools.h"
+#include "noiseShaper.h"
+
+#define TX_MARK_FREQ 1200
+#define TX_SPACE_FREQ 2200
+#define TX_BAUD 1200
+#define TX_SAMPLES_PER_CYCLE 32 // As AFSK_SAMPLES_PER_CYCLE
+#define TX_PEAK 26214			// AFSK_AMPLITUDE 0.8 of full scale
+#define TX_BLOCK_RATE 48000		// As AUDIO_CODEC_SAMPLE_RATE
+#define TX_TABLE_CYCLES 100		// Table cycles rendered per tone
+#define TX_TWIST_TOLERANCE_DB 0.05
+#define TX_BAND_LOW 300	   // Audio band of the in-band SNR (Hz)
+#define TX_BAND_HIGH 3000
+#define TX_SNR_BIN_HZ 5	   // DFT resolution of the SNR measurement
+#define TX_SNR_SEGMENTS 10 // DFTs averaged per measurement
+
+static void txUsage()
+{
+	fprintf(stderr,
+			"usage: program tx [options]\n"
+			"  --twist DB  mark level relative to space to check, repeatable\n"
+			"              (default -12, -5.3, 0, 5.3 and 12 dB)\n"
+			"  --bits N    output resolution of the shaper SNR, repeatable\n"
+			"              (default 8 for DAC and sigma-delta, 10 for PWM)\n");
+}
+
+/**
+ * @brief Peak amplitude of one frequency, the audio holding whole cycles of it
+ */
+static double toneLevel(const std::vector<int16_t> &audio, double sampleRate, double freq)
+{
+	double coeff = 2.0 * cos(2.0 * M_PI * freq / sampleRate);
+	double s1 = 0.0, s2 = 0.0;
+	for (int16_t sample : audio)
+	{
+		double s0 = sample + coeff * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+	return 2.0 * sqrt(s1 * s1 + s2 * s2 - coeff * s1 * s2) / audio.size();
+}
+
+/**
+ * @brief Level of a wave table tone, played as the timer ISR does
+ */
+static double tableLevel(int16_t level, uint16_t freq)
+{
+	int16_t table[TX_SAMPLES_PER_CYCLE];
+	afskToneTable(table, TX_SAMPLES_PER_CYCLE, level);
+	std::vector<int16_t> audio;
+	for (int c = 0; c < TX_TABLE_CYCLES; c++)
+		audio.insert(audio.end(), table, table + TX_SAMPLES_PER_CYCLE);
+	return toneLevel(audio, (double)freq * TX_SAMPLES_PER_CYCLE, freq);
+}
+
+/**
+ * @brief Level of one second of a tone from the block renderer
+ */
+static double blockLevel(afsk_modulator_t *mod, bool mark)
+{
+	std::vector<int16_t> audio;
+	std::vector<int16_t> bit(TX_BLOCK_RATE / TX_BAUD + 1);
+	afskModulatorReset(mod);
+	for (int i = 0; i < TX_BAUD; i++)
+	{
+		size_t n = afskModulatorBit(mod, mark, bit.data());
+		audio.insert(audio.end(), bit.begin(), bit.begin() + n);
+	}
+	return toneLevel(audio, TX_BLOCK_RATE, mark ? TX_MARK_FREQ : TX_SPACE_FREQ);
+}
+
+/**
+ * @brief Check the measured twist of both renderers at one setting
+ * @return true if both are within tolerance
+ */
+static bool checkTwist(float twistDb)
+{
+	int16_t markLevel, spaceLevel;
+	afskTwistLevels(TX_PEAK, twistDb, &markLevel, &spaceLevel);
+
+	double tables = 20.0 * log10(tableLevel(markLevel, TX_MARK_FREQ) / tableLevel(spaceLevel, TX_SPACE_FREQ));
+
+	afsk_modulator_t mod;
+	afskModulatorInit(&mod, TX_BLOCK_RATE, TX_MARK_FREQ, TX_SPACE_FREQ, TX_BAUD);
+	afskModulatorSetLevels(&mod, markLevel, spaceLevel);
+	double blocks = 20.0 * log10(blockLevel(&mod, true) / blockLevel(&mod, false));
+
+	bool ok = fabs(tables - twistDb) <= TX_TWIST_TOLERANCE_DB && fabs(blocks - twistDb) <= TX_TWIST_TOLERANCE_DB;
+	printf("twist %+5.1f dB: levels mark %5d space %5d, measured tables %+6.2f dB, blocks %+6.2f dB%s\n", twistDb,
+		   markLevel, spaceLevel, tables, blocks, ok ? "" : "  FAIL");
+	return ok;
+}
+
+/**
+ * @brief In-band SNR of one tone's wave table through the noise shaper
+ * @return SNR in dB
+ */
+static double shapedSnr(uint8_t bits, uint8_t order, uint16_t freq)
+{
+	int16_t table[TX_SAMPLES_PER_CYCLE];
+	afskToneTable(table, TX_SAMPLES_PER_CYCLE, TX_PEAK);
+	noise_shaper_t ns;
+	noiseShaperInit(&ns, bits, order);
+
+	double sampleRate = (double)freq * TX_SAMPLES_PER_CYCLE;
+	size_t n = (size_t)(sampleRate / TX_SNR_BIN_HZ);
+	std::vector<double> error(n), window(n);
+	double windowPower = 0.0;
+	for (size_t i = 0; i < n; i++)
+	{
+		window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / n);
+		windowPower += window[i] * window[i];
+	}
+
+	double noise = 0.0;
+	size_t at = 0;
+	for (int segment = 0; segment < TX_SNR_SEGMENTS; segment++)
+	{
+		for (size_t i = 0; i < n; i++, at++)
+		{
+			int16_t sample = table[at % TX_SAMPLES_PER_CYCLE];
+			int32_t output = ((int32_t)noiseShaperStep(&ns, sample) << ns.shift) - 32768;
+			error[i] = window[i] * (output - sample);
+		}
+		// Both sides of the spectrum: twice the positive bins
+		for (size_t k = TX_BAND_LOW / TX_SNR_BIN_HZ; k <= TX_BAND_HIGH / TX_SNR_BIN_HZ; k++)
+		{
+			double coeff = 2.0 * cos(2.0 * M_PI * k / n);
+			double s1 = 0.0, s2 = 0.0;
+			for (size_t i = 0; i < n; i++)
+			{
+				double s0 = error[i] + coeff * s1 - s2;
+				s2 = s1;
+				s1 = s0;
+			}
+			noise += 2.0 * (s1 * s1 + s2 * s2 - coeff * s1 * s2) / (n * windowPower);
+		}
+	}
+	noise /= TX_SNR_SEGMENTS;
+	double signal = (double)TX_PEAK * TX_PEAK / 2.0;
+	return 10.0 * log10(signal / noise);
+}
+
+/**
+ * @brief Print the in-band SNR of every shaping order at one output resolution
+ * @return true if second-order shaping beats plain rounding on both tones
+ */
+static bool checkShaper(uint8_t bits)
+{
+	double rounded[2] = {0.0, 0.0};
+	bool ok = true;
+	for (uint8_t order = 0; order <= NOISE_SHAPER_MAX_ORDER; order++)
+	{
+		double snr[2];
+		for (int tone = 0; tone < 2; tone++)
+		{
+			snr[tone] = shapedSnr(bits, order, tone == 0 ? TX_MARK_FREQ : TX_SPACE_FREQ);
+			if (order == 0)
+				rounded[tone] = snr[tone];
+			else if (order == NOISE_SHAPER_MAX_ORDER && snr[tone] <= rounded[tone])
+				ok = false;
+		}
+		printf("shaper %2u bits order %u: in-band SNR mark %5.1f dB, space %5.1f dB%s\n", bits, order, snr[0], snr[1],
+			   order == NOISE_SHAPER_MAX_ORDER && !ok ? "  FAIL" : "");
+	}
+	return ok;
+}
+
+int txMain(int argc, char **argv)
+{
+	std::vector<float> twists;
+	std::vector<uint8_t> outputBits;
+	for (int i = 1; i < argc; i++)
+	{
+		bool more = i + 1 < argc;
+		if (strcmp(argv[i], "--twist") == 0 && more)
+			twists.push_back(strtof(argv[++i], NULL));
+		else if (strcmp(argv[i], "--bits") == 0 && more)
+		{
+			unsigned bits = (unsigned)strtoul(argv[++i], NULL, 10);
+			if (bits < 1 || bits > 16)
+			{
+				txUsage();
+				return 2;
+			}
+			outputBits.push_back((uint8_t)bits);
+		}
+		else
+		{
+			txUsage();
+			return 2;
+		}
+	}
+	if (twists.empty())
+		twists = {-12.0f, -5.3f, 0.0f, 5.3f, 12.0f};
+	if (outputBits.empty())
+		outputBits = {8, 10};
+
+	int failures = 0;
+	for (float twist : twists)
+	{
+		if (!checkTwist(twist))
+			failures++;
+	}
+	for (uint8_t bits : outputBits)
+	{
+		if (!checkShaper(bits))
+			failures++;
+	}
+	if (failures > 0)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
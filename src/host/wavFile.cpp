@@ -0,0 +1,212 @@
+/**
+ * @file wavFile.cpp
+ * @date 2025-09-18
+ * @brief Read-only memory-mapped WAV files for the host tools.
+ */
+
+#include "wavFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WAV_USE_MMAP 0 // Read the whole file instead
+#else
+#define WAV_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/**
+ * @brief Little-endian field readers, WAV headers are not aligned
+ */
+static uint16_t le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Map or load the file contents
+ */
+static bool mapFile(wav_file_t *wav, const char *path)
+{
+#if WAV_USE_MMAP
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		wav->error = "cannot open file";
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		wav->error = "cannot read file size";
+		return false;
+	}
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		wav->error = "mmap failed";
+		return false;
+	}
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	wav->map = (const uint8_t *)map;
+	wav->mapSize = (size_t)st.st_size;
+	return true;
+#else
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		wav->error = "cannot open file";
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buffer = size > 0 ? (uint8_t *)malloc((size_t)size) : NULL;
+	if (!buffer || fread(buffer, 1, (size_t)size, f) != (size_t)size)
+	{
+		free(buffer);
+		fclose(f);
+		wav->error = "cannot read file";
+		return false;
+	}
+	fclose(f);
+	wav->map = buffer;
+	wav->mapSize = (size_t)size;
+	return true;
+#endif
+}
+
+/**
+ * @brief Map a WAV file and parse its header
+ * @param wav File state
+ * @param path File to open
+ * @return true on success, false with wav->error set
+ */
+bool wavOpen(wav_file_t *wav, const char *path)
+{
+	memset(wav, 0, sizeof(*wav));
+	if (!mapFile(wav, path))
+	{
+		return false;
+	}
+
+	const uint8_t *p = wav->map;
+	size_t size = wav->mapSize;
+	if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0)
+	{
+		wavClose(wav);
+		wav->error = "not a RIFF/WAVE file";
+		return false;
+	}
+
+	// Walk the chunks; fmt must come before data
+	bool haveFormat = false;
+	size_t offset = 12;
+	while (offset + 8 <= size)
+	{
+		const uint8_t *chunk = p + offset;
+		uint32_t chunkSize = le32(chunk + 4);
+		size_t body = offset + 8;
+		size_t available = size - body;
+
+		if (memcmp(chunk, "fmt ", 4) == 0)
+		{
+			if (chunkSize < 16 || available < 16)
+			{
+				break;
+			}
+			uint16_t format = le16(p + body);
+			if (format == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 26 && available >= 26)
+			{
+				format = le16(p + body + 24); // First two bytes of the sub-format GUID
+			}
+			wav->channels = le16(p + body + 2);
+			wav->sampleRate = le32(p + body + 4);
+			uint16_t bits = le16(p + body + 14);
+			if (format != WAVE_FORMAT_PCM || bits != 16 || wav->channels == 0 || wav->sampleRate == 0)
+			{
+				wavClose(wav);
+				wav->error = "only 16-bit PCM is supported";
+				return false;
+			}
+			haveFormat = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0 && haveFormat)
+		{
+			// Recorders that were killed leave the size at 0 or past the end
+			size_t dataSize = chunkSize < available && chunkSize != 0 ? chunkSize : available;
+			wav->data = p + body;
+			wav->frames = dataSize / (2u * wav->channels);
+			return true;
+		}
+
+		offset = body + chunkSize + (chunkSize & 1); // Chunks are word aligned
+	}
+
+	wavClose(wav);
+	wav->error = "no fmt/data chunk";
+	return false;
+}
+
+/**
+ * @brief Copy one channel of a frame range
+ * @param wav Open file
+ * @param channel Channel to extract
+ * @param first First frame
+ * @param count Frames to copy, clipped to the end of the file
+ * @param out Destination for count samples
+ * @return Number of samples copied
+ */
+size_t wavRead(const wav_file_t *wav, uint16_t channel, size_t first, size_t count, int16_t *out)
+{
+	if (channel >= wav->channels || first >= wav->frames)
+	{
+		return 0;
+	}
+	if (count > wav->frames - first)
+	{
+		count = wav->frames - first;
+	}
+
+	const uint8_t *p = wav->data + (first * wav->channels + channel) * 2;
+	size_t stride = 2u * wav->channels;
+	for (size_t i = 0; i < count; i++, p += stride)
+	{
+		out[i] = (int16_t)le16(p);
+	}
+	return count;
+}
+
+/**
+ * @brief Unmap a file opened with wavOpen()
+ * @param wav File state
+ */
+void wavClose(wav_file_t *wav)
+{
+	if (wav->map)
+	{
+#if WAV_USE_MMAP
+		munmap((void *)wav->map, wav->mapSize);
+#else
+		free((void *)wav->map);
+#endif
+	}
+	const char *error = wav->error;
+	memset(wav, 0, sizeof(*wav));
+	wav->error = error;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file wavFile.h
+ * @date 2025-09-18
+ * @brief Read-only memory-mapped WAV files for the host tools.
+ *
+ * Only 16-bit PCM is accepted (plain or WAVE_FORMAT_EXTENSIBLE), which is what
+ * recording software and SDR programs write by default. The sample data stays in
+ * the page cache and is shared by every thread reading the file.
+ *
+ * Functions:
+ * - wavOpen(): Map a file and parse its header.
+ * - wavRead(): Copy and de-interleave one channel of a frame range.
+ * - wavClose(): Unmap the file.
+ */
+#ifndef WAV_FILE_H
+#define WAV_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+	const uint8_t *map; // Whole file
+	size_t mapSize;
+	const uint8_t *data; // First sample, may be unaligned
+	size_t frames;		 // Samples per channel
+	uint32_t sampleRate;
+	uint16_t channels;
+	const char *error; // Reason wavOpen() failed
+} wav_file_t;
+
+/**
+ * @brief Map a WAV file and parse its header
+ * @param wav File state
+ * @param path File to open
+ * @return true on success, false with wav->error set
+ */
+bool wavOpen(wav_file_t *wav, const char *path);
+
+/**
+ * @brief Copy one channel of a frame range
+ * @param wav Open file
+ * @param channel Channel to extract
+ * @param first First frame
+ * @param count Frames to copy, clipped to the end of the file
+ * @param out Destination for count samples
+ * @return Number of samples copied
+ */
+size_t wavRead(const wav_file_t *wav, uint16_t channel, size_t first, size_t count, int16_t *out);
+
+/**
+ * @brief Unmap a file opened with wavOpen()
+ * @param wav File state
+ */
+void wavClose(wav_file_t *wav);
+
+#endif // WAV_FILE_H
@@ -0,0 +1,140 @@
+/**
+ * @file workPool.cpp
+ * @date 2025-09-18
+ * @brief Work-stealing thread pool for the host tools.
+ */
+
+#include "workPool.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Per-worker task deque: the owner pops the front, thieves take the back
+struct WorkQueue
+{
+	std::mutex lock;
+	std::deque<size_t> tasks;
+	std::atomic<size_t> left{0}; // tasks.size(), readable without the lock
+};
+
+/**
+ * @brief Take the next own task, or steal one
+ */
+static bool nextTask(std::vector<WorkQueue> &queues, unsigned self, size_t *task, bool *stolen)
+{
+	{
+		std::lock_guard<std::mutex> guard(queues[self].lock);
+		if (!queues[self].tasks.empty())
+		{
+			*task = queues[self].tasks.front();
+			queues[self].tasks.pop_front();
+			queues[self].left--;
+			*stolen = false;
+			return true;
+		}
+	}
+
+	// Pick the victim with the most work left, an estimate is enough
+	for (;;)
+	{
+		unsigned victim = self;
+		size_t most = 0;
+		for (unsigned i = 0; i < queues.size(); i++)
+		{
+			size_t left = queues[i].left;
+			if (i != self && left > most)
+			{
+				most = left;
+				victim = i;
+			}
+		}
+		if (victim == self)
+		{
+			return false; // Everyone is empty, tasks never get added back
+		}
+
+		std::lock_guard<std::mutex> guard(queues[victim].lock);
+		if (!queues[victim].tasks.empty())
+		{
+			*task = queues[victim].tasks.back();
+			queues[victim].tasks.pop_back();
+			queues[victim].left--;
+			*stolen = true;
+			return true;
+		}
+	}
+}
+
+/**
+ * @brief Run every task in [0, count) on a pool of threads
+ * @param count Number of tasks
+ * @param threads Worker threads, 0 for workPoolDefaultThreads()
+ * @param task Task body, called concurrently from several threads
+ * @param stats Scheduling counters, may be NULL
+ */
+void workPoolRun(size_t count, unsigned threads, const work_task_fn &task, work_pool_stats_t *stats)
+{
+	if (threads == 0)
+	{
+		threads = workPoolDefaultThreads();
+	}
+	if (threads > count && count > 0)
+	{
+		threads = (unsigned)count;
+	}
+
+	// Deal contiguous runs so neighbouring chunks of a file stay on one worker
+	std::vector<WorkQueue> queues(threads);
+	for (size_t i = 0; i < count; i++)
+	{
+		WorkQueue &q = queues[(size_t)((uint64_t)i * threads / count)];
+		q.tasks.push_back(i);
+		q.left++;
+	}
+
+	std::atomic<uint64_t> steals(0);
+	auto worker = [&](unsigned self)
+	{
+		size_t t;
+		bool stolen;
+		while (nextTask(queues, self, &t, &stolen))
+		{
+			if (stolen)
+			{
+				steals++;
+			}
+			task(t, self);
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads; i++)
+	{
+		pool.emplace_back(worker, i);
+	}
+	worker(0); // The calling thread is worker 0
+	for (std::thread &t : pool)
+	{
+		t.join();
+	}
+
+	if (stats)
+	{
+		stats->threads = threads;
+		stats->tasks = count;
+		stats->steals = steals;
+	}
+}
+
+/**
+ * @brief Get the number of hardware threads
+ * @return At least 1
+ */
+unsigned workPoolDefaultThreads()
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
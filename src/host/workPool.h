@@ -0,0 +1,48 @@
+/**
+ * @file workPool.h
+ * @date 2025-09-18
+ * @brief Work-stealing thread pool for the host tools.
+ *
+ * Tasks are numbered 0..count-1 and handed out in contiguous runs, one run per
+ * worker, so each worker walks its share of the input in order. A worker that
+ * runs dry steals the last task of the busiest-looking victim, which keeps all
+ * cores busy when files or chunks differ in length.
+ *
+ * Functions:
+ * - workPoolRun(): Run a task function over a task range and wait for it.
+ * - workPoolDefaultThreads(): Number of hardware threads.
+ */
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// Scheduling counters from one workPoolRun()
+typedef struct
+{
+	unsigned threads;
+	uint64_t tasks;
+	uint64_t steals; // Tasks run by a worker other than the one they were dealt to
+} work_pool_stats_t;
+
+// Task body: task number and the worker (0..threads-1) running it
+typedef std::function<void(size_t task, unsigned worker)> work_task_fn;
+
+/**
+ * @brief Run every task in [0, count) on a pool of threads
+ * @param count Number of tasks
+ * @param threads Worker threads, 0 for workPoolDefaultThreads()
+ * @param task Task body, called concurrently from several threads
+ * @param stats Scheduling counters, may be NULL
+ */
+void workPoolRun(size_t count, unsigned threads, const work_task_fn &task, work_pool_stats_t *stats);
+
+/**
+ * @brief Get the number of hardware threads
+ * @return At least 1
+ */
+unsigned workPoolDefaultThreads();
+
+#endif // WORK_POOL_H
@@ -0,0 +1,151 @@
+/**
+ * @file kiss.cpp
+ * @date 2025-09-22
+ * @brief KISS framing between the TNC and the host application.
+ */
+
+#include "kiss.h"
+
+/**
+ * @brief Reset a decoder
+ * @param k Decoder state
+ * @param onFrame Callback for complete frames
+ * @param ctx Passed back to onFrame
+ */
+void kissInit(kiss_decoder_t *k, kiss_frame_cb onFrame, void *ctx)
+{
+	k->length = 0;
+	k->escape = false;
+	k->discard = false;
+	k->frames = 0;
+	k->overflows = 0;
+	k->badEscapes = 0;
+	k->onFrame = onFrame;
+	k->ctx = ctx;
+}
+
+/**
+ * @brief Deliver the frame collected since the last FEND, if any
+ */
+static bool endFrame(kiss_decoder_t *k)
+{
+	bool delivered = false;
+	if (!k->discard && k->length > 0)
+	{
+		k->frames++;
+		if (k->onFrame)
+		{
+			uint8_t command = k->frame[0];
+			k->onFrame(k->ctx, command >> 4, command & 0x0F, k->frame + 1, k->length - 1);
+		}
+		delivered = true;
+	}
+	k->length = 0;
+	k->escape = false;
+	k->discard = false;
+	return delivered;
+}
+
+/**
+ * @brief Feed bytes received from the host
+ *
+ * FEND delimits frames; back-to-back FENDs are idle fill and deliver nothing.
+ * A frame that overflows or contains a bad escape is dropped as a whole.
+ *
+ * @param k Decoder state
+ * @param data Received bytes, any split across calls
+ * @param len Number of bytes
+ * @return Number of frames delivered by this call
+ */
+size_t kissInput(kiss_decoder_t *k, const uint8_t *data, size_t len)
+{
+	size_t delivered = 0;
+	for (size_t i = 0; i < len; i++)
+	{
+		uint8_t byte = data[i];
+		if (byte == KISS_FEND)
+		{
+			delivered += endFrame(k);
+			continue;
+		}
+		if (k->discard)
+		{
+			continue;
+		}
+
+		if (k->escape)
+		{
+			k->escape = false;
+			if (byte == KISS_TFEND)
+			{
+				byte = KISS_FEND;
+			}
+			else if (byte == KISS_TFESC)
+			{
+				byte = KISS_FESC;
+			}
+			else
+			{
+				k->badEscapes++;
+				k->discard = true;
+				continue;
+			}
+		}
+		else if (byte == KISS_FESC)
+		{
+			k->escape = true;
+			continue;
+		}
+
+		if (k->length >= sizeof(k->frame))
+		{
+			k->overflows++;
+			k->discard = true;
+			continue;
+		}
+		k->frame[k->length++] = byte;
+	}
+	return delivered;
+}
+
+/**
+ * @brief Frame a packet for the host
+ * @param port KISS port, 0-15
+ * @param command Command, KISS_CMD_DATA for received frames
+ * @param data Payload
+ * @param len Payload length
+ * @param out Output buffer
+ * @param outSize Size of out, KISS_MAX_ENCODED(len) always fits
+ * @return Bytes written, 0 if out is too small
+ */
+size_t kissEncode(uint8_t port, uint8_t command, const uint8_t *data, size_t len, uint8_t *out, size_t outSize)
+{
+	size_t n = 0;
+	if (outSize < 3)
+	{
+		return 0;
+	}
+	out[n++] = KISS_FEND;
+	out[n++] = (uint8_t)(((port & 0x0F) << 4) | (command & 0x0F));
+
+	for (size_t i = 0; i < len; i++)
+	{
+		uint8_t byte = data[i];
+		bool special = byte == KISS_FEND || byte == KISS_FESC;
+		if (n + (special ? 2 : 1) + 1 > outSize)
+		{
+			return 0;
+		}
+		if (special)
+		{
+			out[n++] = KISS_FESC;
+			out[n++] = byte == KISS_FEND ? KISS_TFEND : KISS_TFESC;
+		}
+		else
+		{
+			out[n++] = byte;
+		}
+	}
+	out[n++] = KISS_FEND;
+	return n;
+}
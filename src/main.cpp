@@ -42,45 +42,111 @@
  */
 
 #include <Arduino.h>        // Include the Arduino core for ESP32
-#include "configuration.h"  // Include configuration settings
-#include "btFunctions.h"    // Include Bluetooth functions
+#include <esp_bt.h>         // Release unused Bluetooth controller memory
+#include "configuration.h"  // Include configuration settings and the build profile
 #include "afskEncoder.h"    // Include modern AFSK encoder functions
 #include "afskDecode.h"     // Include AFSK demodulation functions
+#include "audioHal.h"       // Include sample-block audio backends
+#include "clockHal.h"       // Include the timer service for channel access
+#include "memMonitor.h"     // Include the heap, stack and pool monitor
+#include "deadlineMonitor.h" // Include the real-time deadline and overrun counters
+#include "allocTrap.h"      // Include the hot-path allocation counters (env:alloc-trap)
+#include "txQueue.h"        // Include the CSMA transmit queue
+#if FEATURE_BT_CLASSIC
+#include "btFunctions.h"    // Include Bluetooth functions
+#endif
+#if FEATURE_WIFI
 #include "wifiConnection.h" // Include WiFi connection functions
-#include "ArduinoOTA.h"     // Include OTA update functions
+#endif
+#if FEATURE_OTA
+#include "otaUpdate.h"      // Include the background OTA update task
+#endif
+#if FEATURE_REPLAY
+#include "audioReplay.h"    // Include the decoder self-test from a stored recording
+#endif
+
+static_assert(TX_TWIST_DB >= -AFSK_TWIST_MAX_DB && TX_TWIST_DB <= AFSK_TWIST_MAX_DB,
+              "TX_TWIST_DB must be within AFSK_TWIST_MAX_DB");
 
 // Test pattern selection - change this to select different test patterns
 typedef enum {
   TEST_CONTINUOUS_MARK,     // Constant 1200 Hz (all 1s)
   TEST_CONTINUOUS_SPACE,    // Constant 2200 Hz (all 0s)
   TEST_ALTERNATING,         // Alternating 1200/2200 Hz (1,0,1,0...)
-  TEST_SLOW_ALTERNATING     // Slow alternating (1 second mark, 1 second space)
+  TEST_SLOW_ALTERNATING,    // Slow alternating (1 second mark, 1 second space)
+  TEST_FLASH_STRESS         // Alternating while another task writes NVS, checks sample timing
 } test_pattern_t;
 
-#define ENABLE_AFSK_TEST  
+#define ENABLE_AFSK_TEST 0 // 1 bypasses the TNC and sends CURRENT_TEST_PATTERN
 #define CURRENT_TEST_PATTERN TEST_CONTINUOUS_SPACE  // <-- Change this line to select test pattern
 
+#include <Preferences.h> // NVS writes for TEST_FLASH_STRESS
+
+static volatile uint32_t flashWrites = 0;
+
+/**
+ * @brief Keep the flash busy for TEST_FLASH_STRESS
+ *
+ * Each NVS write disables the flash cache on both cores; the sector erases
+ * when a page fills hold it off for tens of milliseconds.
+ */
+static void flashStressTask(void *param) {
+  Preferences prefs;
+  prefs.begin("flashstress", false);
+  uint8_t block[256];
+  for (;;) {
+    memset(block, (uint8_t)flashWrites, sizeof(block));
+    prefs.putBytes("block", block, sizeof(block));
+    flashWrites++;
+    vTaskDelay(1);
+  }
+}
+
 /**
  * @brief Initializes the ESP32 KISS TNC.
  *
  * This function sets up the necessary components for the KISS TNC:
  * - Initializes USB Serial communication for debugging.
- * - Sets up Bluetooth Serial communication.
+ * - Releases Bluetooth controller memory the build profile does not use.
+ * - Sets up Bluetooth Serial, WiFi and OTA when compiled in (FEATURE_*).
+ * - Starts the audio backend (internal ADC/DAC or I2S codec).
  * - Configures AFSK modulation settings.
- * - Initializes the Goertzel filter for AFSK demodulation.
+ * - Starts one AFSK decoder task per radio port.
+ * - Starts the CSMA transmit queue and the memory monitor.
+ * - Replays the self-test recording when REPLAY_ON_BOOT is set.
+ * - Reports the build profile, boot time and free heap for tools/profileReport.py.
  */
 void setup()
 {
   Serial.begin(115200); // USB Serial for debugging
-  delay(1000); // Allow serial to initialize
+  delay(BOOT_SERIAL_DELAY_MS); // Allow a serial monitor to attach
   
   Serial.println("\n=== ESP32 KISS TNC Starting ===");
-  
+
+#if !FEATURE_BT_CLASSIC && !FEATURE_BLE
+  esp_bt_mem_release(ESP_BT_MODE_BTDM); // No Bluetooth at all: return the controller's RAM to the heap
+#elif !FEATURE_BLE
+  esp_bt_controller_mem_release(ESP_BT_MODE_BLE); // Classic only, before the controller starts
+#endif
+#if FEATURE_BT_CLASSIC
   setupBluetooth();     // Initialize Bluetooth Serial
+#endif
+#if FEATURE_WIFI
   wifiBegin();          // Setup WiFi
   wifiConnect();        // Connect to WiFi
-  ArduinoOTA.begin();   // Initialize OTA updates
-  
+#endif
+#if FEATURE_OTA
+  otaBegin();           // Start the background OTA update task
+#endif
+
+  if (!audioBegin(AUDIO_BACKEND, RX_CHANNEL_COUNT)) {
+    Serial.println("Audio backend failed to start");
+  }
+  if (audioHasBlockOutput()) {
+    setAFSKOutput(AFSK_OUTPUT_BLOCK, TX_PIN, 0); // Codec renders 16-bit blocks
+  }
+
+  setAFSKTwist(TX_TWIST_DB); // Tables are generated with it below
   // Initialize the new function-based AFSK encoder
   afsk_status_t status = setupAFSKEncoder();
   if (status == AFSK_SUCCESS) {
@@ -90,7 +156,18 @@ void setup()
     Serial.println(getAFSKStatusString(status));
   }
   
-  setupAFSKdecoder();   // Initialize Goertzel filter for AFSK demodulation
+  setupAFSKdecoder();   // Start one demodulator task per radio port
+  txQueueBegin();       // Channel access for frames from the host
+  memMonitorBegin();    // Heap, stack and pool watermarks, leak alarms
+#if FEATURE_REPLAY && REPLAY_ON_BOOT
+  audioReplayStart(REPLAY_EXPECTED_FRAMES, -1); // Report on Serial in a few seconds
+#endif
+
+  // One line per boot, parsed by tools/profileReport.py
+  Serial.printf("Boot: %lu ms, heap free %u, largest block %u, features%s%s%s%s%s%s\n", millis(),
+                ESP.getFreeHeap(), ESP.getMaxAllocHeap(), FEATURE_BT_CLASSIC ? " bt" : "",
+                FEATURE_BLE ? " ble" : "", FEATURE_WIFI ? " wifi" : "", FEATURE_OTA ? " ota" : "",
+                FEATURE_DIGIPEATER ? " digi" : "", FEATURE_REPLAY ? " replay" : "");
 }
 
 /**
@@ -117,6 +194,10 @@ void runAFSKTest() {
       case TEST_SLOW_ALTERNATING:
         Serial.println("Test: SLOW ALTERNATING (1 sec mark, 1 sec space)");
         break;
+      case TEST_FLASH_STRESS:
+        Serial.println("Test: FLASH STRESS (alternating during NVS writes)");
+        xTaskCreatePinnedToCore(flashStressTask, "flashStress", 3072, NULL, 1, NULL, 0);
+        break;
     }
     Serial.println("*** ALL OTHER PROCESSES BYPASSED ***");
     testStarted = true;
@@ -143,6 +224,7 @@ void runAFSKTest() {
         break;
         
       case TEST_ALTERNATING:
+      case TEST_FLASH_STRESS:
         for (int i = 0; i < BITS_PER_TRANSMISSION; i++) {
           testBits[i] = i % 2; // Alternating 0,1,0,1...
         }
@@ -167,6 +249,22 @@ void runAFSKTest() {
       }
       break;
       
+    case TEST_FLASH_STRESS:
+      // Back to back, so every flash write lands in a transmission
+      {
+        resetAFSKTimingStats();
+        uint32_t writesBefore = flashWrites;
+        afsk_status_t status = afskSend(testBits, BITS_PER_TRANSMISSION);
+        afsk_timing_stats_t t;
+        getAFSKTimingStats(&t);
+        uint32_t avgNs = t.samples ? (uint32_t)(t.totalLatencyTicks * 1000 / AFSK_TIMER_TICKS_PER_US / t.samples) : 0;
+        Serial.printf("%s: %lu flash writes, %lu samples, %lu late, latency avg %lu ns max %lu ns, %s\n",
+                      t.lateSamples == 0 && status == AFSK_SUCCESS ? "PASS" : "FAIL", flashWrites - writesBefore,
+                      t.samples, t.lateSamples, avgNs, t.maxLatencyTicks * 1000 / AFSK_TIMER_TICKS_PER_US,
+                      getAFSKStatusString(status));
+      }
+      break;
+
     case TEST_SLOW_ALTERNATING:
       // Send 1 second of mark, then 1 second of space
       if (millis() - lastTransmission > 1000) {
@@ -194,12 +292,14 @@ void runAFSKTest() {
  * @brief Main loop function for handling KISS frames and AFSK processing.
  *
  * This function continuously checks for incoming KISS frames on the
- * Bluetooth Serial interface. When data is available, it reads the frame and
- * transmits it using AFSK modulation. Additionally, it processes any incoming audio
- * signals by calling receiveAFSK().
+ * Bluetooth Serial interface. Data frames are queued and transmitted using AFSK
+ * modulation once the channel is clear. Incoming audio is decoded by the per-port
+ * decoder tasks started in setupAFSKdecoder().
  *
- * - Checks Bluetooth Serial for available KISS frames and transmits them via AFSK.
- * - Continuously processes incoming audio for AFSK reception.
+ * - Checks Bluetooth Serial for available KISS frames and queues them for transmission.
+ * - Queues frames for the digipeater when FEATURE_DIGIPEATER is set.
+ * - Runs due clockHal timers, which drive the CSMA slot timing.
+ * - Prints receive power, CPU, transmit and memory statistics every 10 minutes.
  */
 void loop()
 {
@@ -209,9 +309,26 @@ void loop()
     delay(10); // Small delay to prevent watchdog reset
   } else {
     // Normal operation mode
+#if FEATURE_WIFI
     wifiConnect();       // Reconnect to Wi-Fi if disconnected
-    ArduinoOTA.handle(); // Check for OTA updates
+#endif
+#if FEATURE_BT_CLASSIC
     checkBTforData(); // Check Bluetooth Serial for incoming data
-    receiveAFSK();    // Decode AFSK
+#endif
+    pollDigipeater(); // Frames the digipeater repeats join the transmit queue
+    clockRunTimers(); // Channel access slots and other timed work
+
+    static unsigned long lastStats = 0;
+    if (millis() - lastStats > 600000) { // Receive power report every 10 minutes
+      printReceivePowerStats();
+      printTxQueueStats();
+      printMemStats();
+      printDeadlineStats();
+      printAllocTrapStats();
+#if FEATURE_OTA
+      printOtaStats();
+#endif
+      lastStats = millis();
+    }
   }
 }
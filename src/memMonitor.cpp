@@ -0,0 +1,279 @@
+/**
+ * @file memMonitor.cpp
+ * @date 2025-10-08
+ * @brief Heap, stack and pool watermark monitor with leak and fragmentation alarms.
+ */
+
+#include "memMonitor.h"
+#include "audioHal.h" // AUDIO_MAX_READERS: one afskRx task per reader
+
+// Tasks whose stacks are watched; names that do not exist in this build are skipped
+static const char *const watchedTasks[] = {"loopTask", "afskRx0", "afskRx1", "afskRx2", "afskRx3", "audioCapture",
+										   "memMonitor", "otaUpdate", "BTC_TASK", "wifi", "tiT"};
+static_assert(sizeof(watchedTasks) / sizeof(watchedTasks[0]) <= MEM_MAX_TASKS, "Too many watched tasks");
+static_assert(AUDIO_MAX_READERS == 4, "Watch an afskRx task for every decoder port");
+
+typedef struct
+{
+	mem_pool_cb usage;
+	void *ctx;
+} mem_pool_t;
+
+static mem_pool_t pools[MEM_MAX_POOLS];
+static mem_stats_t stats; // Guarded by statsLock
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t monitorTask = NULL;
+
+// Baseline trend, only touched by the monitor task
+static uint32_t baselines[MEM_TREND_POINTS];
+static uint8_t baselineNext = 0;
+static uint8_t baselineCount = 0;
+static uint32_t intervalMax = 0;
+static uint32_t intervalStartMs = 0;
+
+/**
+ * @brief Least-squares slope of the baselines, oldest first, in bytes per hour
+ */
+static int32_t baselineSlope()
+{
+	if (baselineCount < 2)
+	{
+		return 0;
+	}
+	uint8_t oldest = (baselineNext + MEM_TREND_POINTS - baselineCount) % MEM_TREND_POINTS;
+	float meanX = (baselineCount - 1) / 2.0f;
+	float meanY = 0.0f;
+	for (uint8_t i = 0; i < baselineCount; i++)
+	{
+		meanY += baselines[(oldest + i) % MEM_TREND_POINTS];
+	}
+	meanY /= baselineCount;
+
+	float covariance = 0.0f;
+	float variance = 0.0f;
+	for (uint8_t i = 0; i < baselineCount; i++)
+	{
+		float dx = i - meanX;
+		covariance += dx * (baselines[(oldest + i) % MEM_TREND_POINTS] - meanY);
+		variance += dx * dx;
+	}
+	return (int32_t)(covariance / variance * (3600000.0f / MEM_TREND_INTERVAL_MS));
+}
+
+/**
+ * @brief Name of the lowest set alarm bit
+ */
+static const char *alarmName(uint8_t bit)
+{
+	switch (bit)
+	{
+	case MEM_ALARM_LEAK:
+		return "leak trend";
+	case MEM_ALARM_FRAGMENTED:
+		return "fragmented heap";
+	case MEM_ALARM_LOW_HEAP:
+		return "low heap";
+	case MEM_ALARM_STACK:
+		return "stack margin";
+	case MEM_ALARM_POOL:
+		return "pool exhausted";
+	default:
+		return "?";
+	}
+}
+
+/**
+ * @brief One sample: heap, trend, stacks and pools, then the alarms
+ */
+static void sample(mem_stats_t *s)
+{
+	s->samples++;
+	s->freeHeap = ESP.getFreeHeap();
+	s->minFreeHeap = ESP.getMinFreeHeap();
+	s->largestBlock = ESP.getMaxAllocHeap();
+	if (s->samples == 1 || s->largestBlock < s->minLargestBlock)
+	{
+		s->minLargestBlock = s->largestBlock;
+	}
+
+	uint32_t now = millis();
+	if (s->freeHeap > intervalMax)
+	{
+		intervalMax = s->freeHeap;
+	}
+	if (now - intervalStartMs >= MEM_TREND_INTERVAL_MS)
+	{
+		baselines[baselineNext] = intervalMax;
+		baselineNext = (baselineNext + 1) % MEM_TREND_POINTS;
+		if (baselineCount < MEM_TREND_POINTS)
+		{
+			baselineCount++;
+		}
+		intervalMax = 0;
+		intervalStartMs = now;
+	}
+	s->trendPoints = baselineCount;
+	s->trendBph = baselineCount == MEM_TREND_POINTS ? baselineSlope() : 0;
+
+	uint8_t alarms = 0;
+	s->taskCount = 0;
+	for (const char *name : watchedTasks)
+	{
+		TaskHandle_t task = xTaskGetHandle(name);
+		if (task == NULL)
+		{
+			continue;
+		}
+		mem_task_stats_t *t = &s->tasks[s->taskCount++];
+		t->name = name;
+		t->stackFree = uxTaskGetStackHighWaterMark(task); // Bytes on the ESP32
+		if (t->stackFree < MEM_STACK_MARGIN)
+		{
+			alarms |= MEM_ALARM_STACK;
+		}
+	}
+
+	for (uint8_t i = 0; i < s->poolCount; i++)
+	{
+		mem_pool_stats_t *p = &s->pools[i];
+		pools[i].usage(pools[i].ctx, &p->used, &p->capacity);
+		if (p->used > p->peak)
+		{
+			p->peak = p->used;
+		}
+		if (p->capacity > 0 && p->used >= p->capacity)
+		{
+			p->exhaustedSamples++;
+			alarms |= MEM_ALARM_POOL;
+		}
+	}
+
+	if (s->trendBph < -MEM_LEAK_ALARM_BPH)
+	{
+		alarms |= MEM_ALARM_LEAK;
+	}
+	if (s->largestBlock < MEM_MIN_LARGEST_BLOCK || s->largestBlock < MEM_FRAG_ALARM_RATIO * s->freeHeap)
+	{
+		alarms |= MEM_ALARM_FRAGMENTED;
+	}
+	if (s->freeHeap < MEM_LOW_HEAP)
+	{
+		alarms |= MEM_ALARM_LOW_HEAP;
+	}
+
+	uint8_t raised = alarms & ~s->alarms;
+	s->alarms = alarms;
+	for (uint8_t bit = 1; raised != 0; bit <<= 1)
+	{
+		if (raised & bit)
+		{
+			s->alarmsRaised++;
+			raised &= ~bit;
+			Serial.printf("MEM ALARM: %s (free %lu, largest %lu, trend %ld B/h)\n", alarmName(bit), s->freeHeap,
+						  s->largestBlock, s->trendBph);
+		}
+	}
+}
+
+static void monitorLoop(void *arg)
+{
+	mem_stats_t work;
+	intervalStartMs = millis();
+	for (;;)
+	{
+		portENTER_CRITICAL(&statsLock);
+		work = stats; // Picks up pools registered since the last sample
+		portEXIT_CRITICAL(&statsLock);
+
+		sample(&work);
+
+		portENTER_CRITICAL(&statsLock);
+		work.poolCount = stats.poolCount;
+		for (uint8_t i = 0; i < stats.poolCount; i++)
+		{
+			work.pools[i].name = stats.pools[i].name;
+		}
+		stats = work;
+		portEXIT_CRITICAL(&statsLock);
+
+		vTaskDelay(pdMS_TO_TICKS(MEM_SAMPLE_MS));
+	}
+}
+
+/**
+ * @brief Start the monitor task. Call at the end of setup().
+ */
+void memMonitorBegin()
+{
+	if (monitorTask != NULL)
+	{
+		return;
+	}
+	xTaskCreatePinnedToCore(monitorLoop, "memMonitor", MEM_TASK_STACK, NULL, MEM_TASK_PRIORITY, &monitorTask,
+							tskNO_AFFINITY);
+}
+
+/**
+ * @brief Register a pool or queue whose fill level is sampled.
+ *
+ * @param name Shown in the stats; must stay valid.
+ * @param usage Called from the monitor task with the current and total capacity.
+ * @param ctx Passed back to usage.
+ * @return false once MEM_MAX_POOLS are registered.
+ */
+bool memMonitorWatchPool(const char *name, mem_pool_cb usage, void *ctx)
+{
+	bool added = false;
+	portENTER_CRITICAL(&statsLock);
+	if (stats.poolCount < MEM_MAX_POOLS)
+	{
+		pools[stats.poolCount].usage = usage;
+		pools[stats.poolCount].ctx = ctx;
+		mem_pool_stats_t *p = &stats.pools[stats.poolCount];
+		memset(p, 0, sizeof(*p));
+		p->name = name;
+		stats.poolCount++;
+		added = true;
+	}
+	portEXIT_CRITICAL(&statsLock);
+	return added;
+}
+
+/**
+ * @brief Copy the latest sample, trend and alarms.
+ */
+void getMemStats(mem_stats_t *out)
+{
+	portENTER_CRITICAL(&statsLock);
+	*out = stats;
+	portEXIT_CRITICAL(&statsLock);
+}
+
+/**
+ * @brief Print heap, trend, stacks, pools and alarms to Serial.
+ */
+void printMemStats()
+{
+	mem_stats_t s;
+	getMemStats(&s);
+	Serial.printf("MEM: free %lu (min %lu), largest block %lu (min %lu), trend %ld B/h over %u points, alarms raised %lu\n",
+				  s.freeHeap, s.minFreeHeap, s.largestBlock, s.minLargestBlock, s.trendBph, s.trendPoints,
+				  s.alarmsRaised);
+	for (uint8_t bit = 1; bit != 0 && bit <= MEM_ALARM_POOL; bit <<= 1)
+	{
+		if (s.alarms & bit)
+		{
+			Serial.printf("MEM: active alarm: %s\n", alarmName(bit));
+		}
+	}
+	for (uint8_t i = 0; i < s.taskCount; i++)
+	{
+		Serial.printf("MEM: task %s, %lu bytes of stack never used\n", s.tasks[i].name, s.tasks[i].stackFree);
+	}
+	for (uint8_t i = 0; i < s.poolCount; i++)
+	{
+		const mem_pool_stats_t *p = &s.pools[i];
+		Serial.printf("MEM: pool %s, %lu/%lu used, peak %lu, full in %lu samples\n", p->name, p->used, p->capacity,
+					  p->peak, p->exhaustedSamples);
+	}
+}
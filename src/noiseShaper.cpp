@@ -0,0 +1,41 @@
+/**
+ * @file noiseShaper.cpp
+ * @date 2025-09-02
+ * @brief Error-feedback noise shaping quantizer setup.
+ *
+ * The per-sample noiseShaperStep() lives in noiseShaper.h so it can be inlined
+ * into the TX timer ISR.
+ */
+
+#include "noiseShaper.h"
+
+/**
+ * @brief Configure a noise shaper
+ * @param ns Shaper state
+ * @param outputBits Resolution of the output device (1 to 16)
+ * @param order Shaping order (0 to NOISE_SHAPER_MAX_ORDER)
+ * @return true on success, false if the parameters are out of range
+ */
+bool noiseShaperInit(noise_shaper_t *ns, uint8_t outputBits, uint8_t order)
+{
+	if (!ns || outputBits < 1 || outputBits > 16 || order > NOISE_SHAPER_MAX_ORDER)
+	{
+		return false;
+	}
+
+	ns->shift = 16 - outputBits;
+	ns->maxCode = (1 << outputBits) - 1;
+	ns->order = order;
+	noiseShaperReset(ns);
+	return true;
+}
+
+/**
+ * @brief Clear the error history
+ * @param ns Shaper state
+ */
+void noiseShaperReset(noise_shaper_t *ns)
+{
+	ns->e1 = 0;
+	ns->e2 = 0;
+}
@@ -0,0 +1,485 @@
+/**
+ * @file otaUpdate.cpp
+ * @date 2025-10-11
+ * @brief Background ArduinoOTA updates that keep the TNC on the air until the reboot.
+ *
+ * The progress callback runs in the update task between network chunks, so
+ * it can block to hold off or throttle the transfer. Both the ArduinoOTA and
+ * the HTTP upload paths go through it. The same HTTP server also answers
+ * GET /eye with a receive port's eye diagram.
+ */
+
+#include "otaUpdate.h"
+#include "configuration.h"
+
+#if FEATURE_OTA
+#include <ArduinoOTA.h>
+#include <Update.h>
+#include <WebServer.h>
+#include <WiFi.h>
+#include <esp_ota_ops.h>
+#include "afskDecode.h"
+#include "afskEncoder.h"
+#include "eyeMonitor.h"
+#include "gzipInflate.h"
+
+#define EYE_SEND_CHUNK 1436 // One TCP segment of chunked body
+
+static TaskHandle_t otaTask = NULL;
+static ota_stats_t stats;
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t rateBytesPerSecond = OTA_RATE_BYTES_PER_S;
+static uint32_t startMs;	 // Update task only
+static uint32_t nextPercent; // Next progress line
+
+// HTTP upload, update task only
+static WebServer server(OTA_HTTP_PORT);
+static gzip_inflate_t *inflater = NULL; // With its window, for a gzip image
+static uint32_t imageSize;				// From the size argument, 0 if not given
+static const char *uploadError = NULL;
+static bool uploadStarted = false;
+
+/**
+ * @brief Keep the Arduino core from marking a new image valid at boot
+ *
+ * Overrides the weak hook in the core; the update task decides after OTA_CONFIRM_MS.
+ */
+extern "C" bool verifyRollbackLater()
+{
+	return true;
+}
+
+static bool channelBusy()
+{
+	return getReceiveDcd() || isAFSKTransmitting();
+}
+
+static void setState(ota_state_t state)
+{
+	portENTER_CRITICAL(&statsLock);
+	stats.state = state;
+	portEXIT_CRITICAL(&statsLock);
+}
+
+static void startStats()
+{
+	portENTER_CRITICAL(&statsLock);
+	stats.state = OTA_STATE_RECEIVING;
+	stats.received = 0;
+	stats.transferred = 0;
+	stats.size = 0;
+	stats.dcdPauseMs = 0;
+	stats.throttleMs = 0;
+	portEXIT_CRITICAL(&statsLock);
+}
+
+static void countUpdate(bool ok)
+{
+	portENTER_CRITICAL(&statsLock);
+	if (ok)
+	{
+		stats.updates++;
+	}
+	else
+	{
+		stats.errors++;
+		stats.state = OTA_STATE_IDLE;
+	}
+	portEXIT_CRITICAL(&statsLock);
+}
+
+/**
+ * @brief Hold off for DCD and throttle, between two chunks of the image
+ * @param progress Image bytes written to flash
+ * @param total Image size, 0 if not known
+ */
+static void onProgress(unsigned int progress, unsigned int total)
+{
+	if (progress == 0)
+	{
+		startMs = millis();
+		nextPercent = OTA_PROGRESS_STEP_PERCENT;
+		return;
+	}
+
+	uint32_t pauseStart = millis();
+	while (channelBusy() && millis() - pauseStart < OTA_DCD_PAUSE_MAX_MS)
+	{
+		vTaskDelay(pdMS_TO_TICKS(OTA_DCD_POLL_MS));
+	}
+	uint32_t paused = millis() - pauseStart;
+
+	uint32_t throttled = 0;
+	uint32_t rate = rateBytesPerSecond;
+	if (rate > 0)
+	{
+		uint32_t dueMs = (uint32_t)((uint64_t)progress * 1000 / rate);
+		uint32_t elapsed = millis() - startMs;
+		if (elapsed < dueMs)
+		{
+			throttled = dueMs - elapsed;
+			vTaskDelay(pdMS_TO_TICKS(throttled));
+		}
+	}
+
+	portENTER_CRITICAL(&statsLock);
+	stats.received = progress;
+	stats.size = total;
+	stats.dcdPauseMs += paused;
+	stats.throttleMs += throttled;
+	portEXIT_CRITICAL(&statsLock);
+
+	uint32_t percent = total ? (uint32_t)((uint64_t)progress * 100 / total) : 0;
+	if (total && percent >= nextPercent)
+	{
+		Serial.printf("OTA: %lu%%, %u of %u bytes\n", percent, progress, total);
+		nextPercent = percent - percent % OTA_PROGRESS_STEP_PERCENT + OTA_PROGRESS_STEP_PERCENT;
+	}
+}
+
+/**
+ * @brief Decide whether a freshly updated image stays
+ *
+ * The image must bring up WiFi, so it can take the next update, and the
+ * receive tasks within OTA_CONFIRM_MS of boot. Returns only if it stays.
+ */
+static void confirmImage()
+{
+	const esp_partition_t *running = esp_ota_get_running_partition();
+	esp_ota_img_states_t state;
+	if (esp_ota_get_state_partition(running, &state) != ESP_OK || state != ESP_OTA_IMG_PENDING_VERIFY)
+	{
+		return; // Flashed over USB, or already confirmed
+	}
+
+	Serial.printf("OTA: new image in %s, confirming for %u s\n", running->label, OTA_CONFIRM_MS / 1000);
+	bool wifiSeen = false;
+	while (millis() < OTA_CONFIRM_MS)
+	{
+		wifiSeen |= WiFi.isConnected();
+		vTaskDelay(pdMS_TO_TICKS(OTA_POLL_MS));
+	}
+	if (!wifiSeen || xTaskGetHandle("afskRx0") == NULL)
+	{
+		Serial.printf("OTA: image failed its checks (wifi %d), rolling back\n", wifiSeen);
+		esp_ota_mark_app_invalid_rollback_and_reboot(); // Returns only if there is no image to go back to
+		Serial.println("OTA: no rollback image, keeping this one");
+	}
+	esp_ota_mark_app_valid_cancel_rollback();
+	Serial.println("OTA: image confirmed");
+}
+
+/**
+ * @brief Wait for a quiet channel, bounded, then restart into the new image
+ */
+static void rebootWhenQuiet()
+{
+	setState(OTA_STATE_REBOOTING);
+	uint32_t waitStart = millis();
+	while (channelBusy() && millis() - waitStart < OTA_REBOOT_WAIT_MS)
+	{
+		vTaskDelay(pdMS_TO_TICKS(OTA_DCD_POLL_MS));
+	}
+	Serial.println("OTA: rebooting into the new image");
+	Serial.flush();
+	ESP.restart();
+}
+
+static bool writeImage(void *ctx, const uint8_t *data, size_t len)
+{
+	if (Update.write((uint8_t *)data, len) != len)
+	{
+		return false;
+	}
+	onProgress(Update.progress(), imageSize);
+	return true;
+}
+
+static void failUpload(const char *error)
+{
+	uploadError = error;
+	Update.abort();
+	free(inflater);
+	inflater = NULL;
+	countUpdate(false);
+	Serial.printf("OTA: upload failed, %s\n", error);
+}
+
+/**
+ * @brief Open the update partition, and the inflater for a gzip image
+ */
+static void beginUpload(const uint8_t *data, size_t len)
+{
+	uploadStarted = true;
+	if (stats.state != OTA_STATE_IDLE)
+	{
+		uploadError = "busy, or the running image is not confirmed yet";
+		return;
+	}
+	String md5 = server.arg("md5");
+	if (md5.length() != 32)
+	{
+		uploadError = "md5 of the uncompressed image required";
+		return;
+	}
+	imageSize = server.arg("size").toInt();
+	startStats();
+
+	bool compressed = len >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+	if (compressed)
+	{
+		inflater = (gzip_inflate_t *)malloc(sizeof(gzip_inflate_t) + (1UL << OTA_INFLATE_WINDOW_BITS));
+		if (inflater == NULL)
+		{
+			failUpload("no memory for the inflate window");
+			return;
+		}
+		gzipInflateInit(inflater, (uint8_t *)(inflater + 1), OTA_INFLATE_WINDOW_BITS, writeImage, NULL);
+	}
+	if (!Update.begin(imageSize ? imageSize : UPDATE_SIZE_UNKNOWN, U_FLASH))
+	{
+		failUpload(Update.errorString());
+		return;
+	}
+	Update.setMD5(md5.c_str());
+	onProgress(0, imageSize);
+	Serial.printf("OTA: receiving %s image over HTTP\n", compressed ? "gzip" : "plain");
+}
+
+/**
+ * @brief Stream an HTTP upload into the update partition
+ *
+ * POST /update?md5=<hex>&size=<bytes> with the image as a multipart file, as
+ * sent by tools/otaPack.py. The md5 and size are those of the uncompressed
+ * image; Update.end() checks the MD5 after gzipInflate has checked its CRC-32.
+ */
+static void onUpload()
+{
+	HTTPUpload &upload = server.upload();
+	if (upload.status == UPLOAD_FILE_START)
+	{
+		uploadError = NULL;
+		uploadStarted = false;
+		return;
+	}
+	if (upload.status == UPLOAD_FILE_WRITE && !uploadStarted)
+	{
+		beginUpload(upload.buf, upload.currentSize);
+	}
+	if (uploadError != NULL)
+	{
+		return;
+	}
+
+	if (upload.status == UPLOAD_FILE_WRITE)
+	{
+		portENTER_CRITICAL(&statsLock);
+		stats.transferred += upload.currentSize;
+		portEXIT_CRITICAL(&statsLock);
+		if (inflater)
+		{
+			gzip_status_t status = gzipInflateInput(inflater, upload.buf, upload.currentSize);
+			if (status != GZIP_MORE && status != GZIP_DONE)
+			{
+				failUpload(gzipInflateStatusString(status));
+			}
+		}
+		else if (!writeImage(NULL, upload.buf, upload.currentSize))
+		{
+			failUpload(Update.errorString());
+		}
+	}
+	else if (upload.status == UPLOAD_FILE_END)
+	{
+		if (!uploadStarted)
+		{
+			uploadError = "empty upload";
+		}
+		else if (inflater && inflater->status != GZIP_DONE)
+		{
+			failUpload("gzip stream ends early");
+		}
+		else if (!Update.end(true))
+		{
+			failUpload(Update.errorString());
+		}
+		else
+		{
+			free(inflater);
+			inflater = NULL;
+			countUpdate(true);
+			Serial.println("OTA: image verified");
+		}
+	}
+	else if (upload.status == UPLOAD_FILE_ABORTED)
+	{
+		failUpload("upload aborted");
+	}
+}
+
+static void onUploadDone()
+{
+	server.sendHeader("Connection", "close");
+	if (uploadError != NULL)
+	{
+		server.send(500, "text/plain", uploadError);
+		return;
+	}
+	server.send(200, "text/plain", "OK, rebooting when the channel is quiet\n");
+}
+
+// Collects the eye monitor's small writes into TCP-sized chunks
+typedef struct
+{
+	char data[EYE_SEND_CHUNK];
+	size_t length;
+} eye_send_buffer_t;
+
+static void flushEye(eye_send_buffer_t *b)
+{
+	if (b->length > 0)
+	{
+		server.sendContent(b->data, b->length);
+		b->length = 0;
+	}
+}
+
+static void sendEye(void *ctx, const void *data, size_t len)
+{
+	eye_send_buffer_t *b = (eye_send_buffer_t *)ctx;
+	const char *p = (const char *)data;
+	while (len > 0)
+	{
+		size_t n = sizeof(b->data) - b->length < len ? sizeof(b->data) - b->length : len;
+		memcpy(b->data + b->length, p, n);
+		b->length += n;
+		p += n;
+		len -= n;
+		if (b->length == sizeof(b->data))
+		{
+			flushEye(b);
+		}
+	}
+}
+
+/**
+ * @brief GET /eye?port=N[&format=bmp][&reset=1]: eye diagram of a receive port as JSON or BMP
+ *
+ * With reset, the port starts a new diagram after this one is sent.
+ */
+static void onEye()
+{
+	uint8_t port = (uint8_t)server.arg("port").toInt(); // 0 when absent
+	const eye_monitor_t *eye = getReceiveEye(port);
+	server.sendHeader("Connection", "close");
+	if (eye == NULL)
+	{
+		server.send(404, "text/plain", "No eye monitor on that port\n");
+		return;
+	}
+	bool bmp = server.arg("format") == "bmp";
+	server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+	server.send(200, bmp ? "image/bmp" : "application/json", "");
+	static eye_send_buffer_t buffer; // Update task only, too big for its stack next to handle()
+	buffer.length = 0;
+	if (bmp)
+	{
+		eyeMonitorBmp(eye, sendEye, &buffer);
+	}
+	else
+	{
+		eyeMonitorJson(eye, sendEye, &buffer);
+	}
+	flushEye(&buffer);
+	server.sendContent(""); // Last chunk
+	if (server.hasArg("reset"))
+	{
+		resetReceiveEye(port);
+	}
+}
+
+static void otaLoop(void *param)
+{
+	confirmImage();
+
+	ArduinoOTA.setRebootOnSuccess(false); // The task reboots once the channel is quiet
+	ArduinoOTA.onStart([]()
+					   {
+					   startStats();
+					   Serial.printf("OTA: receiving %s\n", ArduinoOTA.getCommand() == U_FLASH ? "sketch" : "filesystem"); });
+	ArduinoOTA.onProgress([](unsigned int progress, unsigned int total)
+						  {
+						  portENTER_CRITICAL(&statsLock);
+						  stats.transferred = progress;
+						  portEXIT_CRITICAL(&statsLock);
+						  onProgress(progress, total); });
+	ArduinoOTA.onEnd([]()
+					 {
+					 countUpdate(true);
+					 Serial.println("OTA: image verified"); });
+	ArduinoOTA.onError([](ota_error_t error)
+					   {
+					   countUpdate(false);
+					   Serial.printf("OTA: error %u\n", error); });
+	ArduinoOTA.begin();
+	server.on("/update", HTTP_POST, onUploadDone, onUpload);
+	server.on("/eye", HTTP_GET, onEye);
+	server.begin();
+	setState(OTA_STATE_IDLE);
+	Serial.printf("OTA Ready, HTTP uploads on port %u\n", OTA_HTTP_PORT);
+
+	for (;;)
+	{
+		ArduinoOTA.handle(); // Returns after a whole update
+		server.handleClient(); // Likewise for an upload
+		if (stats.updates > 0)
+		{
+			rebootWhenQuiet();
+		}
+		vTaskDelay(pdMS_TO_TICKS(OTA_POLL_MS));
+	}
+}
+
+/**
+ * @brief Start the update task. Call in setup() after wifiBegin().
+ */
+void otaBegin()
+{
+	if (otaTask != NULL)
+	{
+		return;
+	}
+	xTaskCreatePinnedToCore(otaLoop, "otaUpdate", OTA_TASK_STACK, NULL, OTA_TASK_PRIORITY, &otaTask, tskNO_AFFINITY);
+}
+
+/**
+ * @brief Change the transfer throttle, also during an update
+ * @param bytesPerSecond Average image rate, 0 for no limit
+ */
+void otaSetRate(uint32_t bytesPerSecond)
+{
+	rateBytesPerSecond = bytesPerSecond;
+}
+
+void getOtaStats(ota_stats_t *out)
+{
+	portENTER_CRITICAL(&statsLock);
+	*out = stats;
+	portEXIT_CRITICAL(&statsLock);
+}
+
+/**
+ * @brief Print the update state and the hold-off counters to Serial.
+ */
+void printOtaStats()
+{
+	static const char *const stateNames[] = {"confirming", "idle", "receiving", "rebooting"};
+	ota_stats_t s;
+	getOtaStats(&s);
+	Serial.printf("OTA: %s, %lu updates, %lu errors, last %lu/%lu bytes in %lu sent, held %lu ms for DCD, %lu ms "
+				  "throttled\n",
+				  stateNames[s.state], s.updates, s.errors, s.received, s.size, s.transferred, s.dcdPauseMs,
+				  s.throttleMs);
+}
+
+#endif // FEATURE_OTA
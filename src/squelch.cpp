@@ -0,0 +1,115 @@
+/**
+ * @file squelch.cpp
+ * @date 2025-09-08
+ * @brief Cheap audio energy detector used to gate the AFSK demodulator.
+ */
+
+#include "squelch.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define SQUELCH_FLOOR_SHIFT 4	   // Floor tracking speed while closed, 1/16 per block
+#define SQUELCH_OPEN_FLOOR_SHIFT 12 // Floor creep while open, recovers from a stuck carrier
+
+/**
+ * @brief Convert a level ratio in dB to Q8
+ */
+static uint16_t dbToQ8(float db)
+{
+	float ratio = powf(10.0f, db / 20.0f) * 256.0f;
+	return ratio > 65535.0f ? 65535 : (uint16_t)ratio;
+}
+
+/**
+ * @brief Configure a squelch detector
+ * @param sq Detector state
+ * @param decimation Use every n-th sample (1 = all)
+ * @param openDb Level above the noise floor that opens the squelch
+ * @param closeDb Level above the noise floor below which the squelch closes
+ * @param hangBlocks Blocks below the close level before closing
+ * @param minLevel Lowest noise floor, in 16-bit sample units
+ */
+void squelchInit(squelch_t *sq, uint8_t decimation, float openDb, float closeDb,
+				 uint16_t hangBlocks, uint16_t minLevel)
+{
+	sq->dc = 0;
+	sq->floorLevel = 0; // Taken from the first block
+	sq->level = 0;
+	sq->minLevel = minLevel;
+	sq->openRatioQ8 = dbToQ8(openDb);
+	sq->closeRatioQ8 = dbToQ8(closeDb);
+	sq->hangBlocks = hangBlocks;
+	sq->hangLeft = 0;
+	sq->decimation = decimation ? decimation : 1;
+	sq->open = false;
+}
+
+/**
+ * @brief Measure a block and update the squelch state
+ * @param sq Detector state
+ * @param samples Signed 16-bit samples
+ * @param count Number of samples
+ * @return true if the squelch is open after this block
+ */
+bool squelchProcess(squelch_t *sq, const int16_t *samples, size_t count)
+{
+	uint32_t sum = 0;
+	uint32_t n = 0;
+	for (size_t i = 0; i < count; i += sq->decimation)
+	{
+		int32_t x = samples[i];
+		sq->dc += (x * 16 - sq->dc) >> 6;
+		sum += (uint32_t)abs(x - (sq->dc >> 4));
+		n++;
+	}
+	if (n == 0)
+	{
+		return sq->open;
+	}
+	sq->level = sum / n;
+	if (sq->floorLevel == 0)
+	{
+		sq->floorLevel = sq->level > sq->minLevel ? sq->level : sq->minLevel;
+		return sq->open;
+	}
+
+	uint32_t floorLevel = sq->floorLevel > sq->minLevel ? sq->floorLevel : sq->minLevel;
+	uint64_t scaled = (uint64_t)sq->level << 8;
+
+	if (!sq->open)
+	{
+		if (scaled > (uint64_t)floorLevel * sq->openRatioQ8)
+		{
+			sq->open = true;
+			sq->hangLeft = sq->hangBlocks;
+		}
+		else
+		{
+			int32_t delta = (int32_t)sq->level - (int32_t)sq->floorLevel;
+			sq->floorLevel += delta / (1 << SQUELCH_FLOOR_SHIFT);
+		}
+	}
+	else
+	{
+		int32_t delta = (int32_t)sq->level - (int32_t)sq->floorLevel;
+		sq->floorLevel += delta / (1 << SQUELCH_OPEN_FLOOR_SHIFT);
+
+		if (scaled < (uint64_t)floorLevel * sq->closeRatioQ8)
+		{
+			if (sq->hangLeft == 0)
+			{
+				sq->open = false;
+			}
+			else
+			{
+				sq->hangLeft--;
+			}
+		}
+		else
+		{
+			sq->hangLeft = sq->hangBlocks;
+		}
+	}
+	return sq->open;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file txQueue.cpp
+ * @date 2025-09-30
+ * @brief Transmit queue with p-persistent channel access for frames from the host.
+ */
+
+#include "txQueue.h"
+
+#include "afskDecode.h"	 // Receive DCD is the channel busy signal
+#include "afskEncoder.h" // transmitAX25()
+#include "allocTrap.h"
+#include "configuration.h"
+#include "csma.h"
+#include "deadlineMonitor.h"
+#include "frameTrace.h"
+#include "kiss.h"
+#include "memMonitor.h"
+
+typedef struct
+{
+	uint8_t data[KISS_MAX_FRAME];
+	size_t length;
+	int32_t ackTag; // ACKMODE tag, -1 for a plain data frame
+	frame_trace_t trace;
+} tx_frame_t;
+
+static tx_frame_t frames[TX_QUEUE_FRAMES];
+static uint8_t head = 0;  // Next frame to send
+static uint8_t count = 0; // Frames queued
+static uint32_t overflows = 0;
+static uint32_t failures = 0;
+static csma_t access;
+static frame_tracer_t txTrace; // loop() only: host frames, the queue and the encoder all run there
+
+static bool channelBusy(void *ctx)
+{
+	return getReceiveDcd();
+}
+
+/**
+ * @brief Stamp the encoder's PTT and bit times, then add the frame to the histograms
+ */
+static void traceTransmission(frame_trace_t *trace)
+{
+	afsk_tx_times_t t;
+	getAFSKTxTimes(&t);
+	const struct
+	{
+		uint8_t stage;
+		uint32_t us;
+	} steps[] = {{TRACE_TX_PTT_ON, t.pttOnUs},
+				 {TRACE_TX_FIRST_BIT, t.firstBitUs},
+				 {TRACE_TX_LAST_BIT, t.lastBitUs},
+				 {TRACE_TX_PTT_OFF, t.pttOffUs}};
+	for (const auto &step : steps)
+	{
+		if (step.us != 0)
+		{
+			traceStamp(trace, step.stage, step.us);
+		}
+	}
+	traceEnd(&txTrace, trace);
+#if FRAME_TRACE_LOG
+	char line[FRAME_TRACE_LINE];
+	traceFormatFrame(&txTrace, trace, line, sizeof(line));
+	Serial.println(line);
+#endif
+}
+
+/**
+ * @brief Access granted: send the oldest frame, then ask again for the next one
+ */
+static void transmitNext(void *ctx)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	tx_frame_t *f = &frames[head];
+	traceStamp(&f->trace, TRACE_TX_ACCESS, micros());
+	setAFSKTxDelay(csmaTxDelayUs(&access) / 1000);
+	allocTrapEnter("kissToDac");
+	if (transmitAX25(f->data, f->length) != AFSK_SUCCESS)
+	{
+		failures++;
+	}
+	else if (f->ackTag >= 0)
+	{
+		sendKISSack(0, (uint16_t)f->ackTag);
+	}
+	allocTrapLeave();
+	traceTransmission(&f->trace);
+	head = (head + 1) % TX_QUEUE_FRAMES;
+	count--;
+
+	if (count > 0)
+	{
+		csmaRequest(&access);
+	}
+}
+
+static void queueUsage(void *ctx, uint32_t *used, uint32_t *capacity)
+{
+	*used = count;
+	*capacity = TX_QUEUE_FRAMES;
+}
+
+/**
+ * @brief Seed the access procedure. Call in setup() after the encoder and decoder.
+ */
+void txQueueBegin()
+{
+	csmaInit(&access, channelBusy, transmitNext, NULL, esp_random());
+	traceInit(&txTrace, "TX", traceTxStageNames, TRACE_TX_STAGES);
+	setAFSKTxDelay(csmaTxDelayUs(&access) / 1000);
+	memMonitorWatchPool("txQueue", queueUsage, NULL);
+}
+
+/**
+ * @brief Copy a frame to the tail of the queue and ask for the channel
+ */
+static bool enqueue(const uint8_t *frame, size_t len, int32_t ackTag, uint32_t receivedUs)
+{
+	if (len > KISS_MAX_FRAME || count == TX_QUEUE_FRAMES)
+	{
+		overflows++;
+		if (count == TX_QUEUE_FRAMES)
+		{
+			deadlineMiss(DEADLINE_QUEUE, 0, "txQueue, frame bytes", len);
+		}
+		return false;
+	}
+	tx_frame_t *f = &frames[(head + count) % TX_QUEUE_FRAMES];
+	memcpy(f->data, frame, len);
+	f->length = len;
+	f->ackTag = ackTag;
+	traceBegin(&txTrace, &f->trace, 0, len);
+	traceStamp(&f->trace, TRACE_TX_RECEIVED, receivedUs);
+	traceStamp(&f->trace, TRACE_TX_QUEUED, micros());
+	count++;
+	csmaRequest(&access);
+	return true;
+}
+
+/**
+ * @brief Queue an AX.25 frame for transmission.
+ *
+ * @param frame AX.25 frame without FCS, copied into the queue.
+ * @param len Frame length, at most KISS_MAX_FRAME.
+ * @param receivedUs micros() when the frame arrived, the first stage of its trace.
+ * @return false if the queue is full or the frame too long.
+ */
+bool txQueueFrame(const uint8_t *frame, size_t len, uint32_t receivedUs)
+{
+	return enqueue(frame, len, -1, receivedUs);
+}
+
+/**
+ * @brief Queue a KISS ACKMODE frame, acknowledged to the host once sent.
+ *
+ * No acknowledgement is sent for a frame that is rejected here or that
+ * transmitAX25() fails to send.
+ *
+ * @param tag ACKMODE tag, echoed back by sendKISSack().
+ * @param frame AX.25 frame without FCS, copied into the queue.
+ * @param len Frame length, at most KISS_MAX_FRAME.
+ * @param receivedUs micros() when the frame arrived, the first stage of its trace.
+ * @return false if the queue is full or the frame too long.
+ */
+bool txQueueAckFrame(uint16_t tag, const uint8_t *frame, size_t len, uint32_t receivedUs)
+{
+	return enqueue(frame, len, tag, receivedUs);
+}
+
+/**
+ * @brief Apply a KISS channel access command.
+ *
+ * @param command KISS command (low nibble of the command byte).
+ * @param value Command argument.
+ * @return false for commands that are not channel access parameters.
+ */
+bool txQueueSetParam(uint8_t command, uint8_t value)
+{
+	if (!csmaSetParam(&access, command, value))
+	{
+		return false;
+	}
+	setAFSKTxDelay(csmaTxDelayUs(&access) / 1000);
+	return true;
+}
+
+/**
+ * @brief Print access and queue counters, then the latency of each stage, to Serial.
+ *
+ * The first latency line is from KISS bytes read to PTT off, the others are
+ * from one stage to the next.
+ */
+void printTxQueueStats()
+{
+	Serial.printf("TX: sent %lu, busy slots %lu, deferred slots %lu, mean access %.0f ms, queue full %lu, failed %lu\n",
+				  access.grants, access.busySlots, access.deferredSlots,
+				  access.grants ? access.accessDelayUs / 1000.0 / access.grants : 0.0, overflows, failures);
+	Serial.printf("TX: txdelay %u ms, persist %u, slottime %u ms, %s duplex\n", access.txDelay * 10,
+				  access.persist, access.slotTime * 10, access.fullDuplex ? "full" : "half");
+	char line[FRAME_TRACE_LINE];
+	for (uint8_t slot = 0; slot < TRACE_TX_STAGES; slot++)
+	{
+		if (traceFormatStage(&txTrace, slot, line, sizeof(line)) > 0)
+		{
+			Serial.println(line);
+		}
+	}
+}
@@ -4,66 +4,32 @@
  * @brief Implements Wi-Fi connection and OTA update functionality for the magloop-controller project.
  *
  * This file provides functions to initialize Wi-Fi connectivity, configure static IP,
- * handle built-in LED status indication, and enable Arduino OTA (Over-The-Air) updates.
- * It uses the ESP32 WiFi and ArduinoOTA libraries, and relies on configuration parameters
+ * and handle built-in LED status indication. OTA updates are in otaUpdate.cpp.
+ * It uses the ESP32 WiFi library, and relies on configuration parameters
  * defined in "configuration.h" for SSID, password, and network settings.
  *
  * Features:
  * - Wi-Fi connection with status LED feedback.
  * - Static IP configuration.
  * - Built-in LED control and toggling.
- * - Arduino OTA update support with progress and error reporting.
  *
  * Dependencies:
  * - Arduino.h
  * - WiFi.h
- * - ArduinoOTA.h
  * - configuration.h
  *
+ * Compiled only when FEATURE_WIFI is set.
+ *
  * @author Karl Berger
  * @date 2025-05-20
  */
 #include "wifiConnection.h" // Wi-Fi connection header
 
 #include <Arduino.h>	   // for PlatformIO
-#include <WiFi.h>		   // for WiFi
-#include <ArduinoOTA.h>	   // for OTA updates
-#include "configuration.h" // for SSID, password, static IP
+#include "configuration.h" // for SSID, password, static IP, FEATURE_*
 
-/**
- * @brief Initializes and configures Over-The-Air (OTA) update functionality.
- *
- * This function sets up the ArduinoOTA library, registering event handlers for OTA start,
- * end, progress, and error events. It enables the device to receive firmware or filesystem
- * updates wirelessly. Upon successful initialization, a message is printed to the serial console.
- *
- * Event handlers:
- * - onStart: Prints the type of update being started ("sketch" or "filesystem").
- * - onEnd: Prints a message when the update is complete.
- * - onProgress: Prints the update progress as a percentage.
- * - onError: Prints an error message corresponding to the OTA error encountered.
- */
-void otaBegin()
-{
-	ArduinoOTA.begin();
-	ArduinoOTA.onStart([]()
-					   {
-    String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-    Serial.println("Start updating " + type); });
-	ArduinoOTA.onEnd([]()
-					 { Serial.println("\nUpdate Complete"); });
-	ArduinoOTA.onProgress([](unsigned int progress, unsigned int total)
-						  { Serial.printf("Progress: %u%%\r", (progress * 100) / total); });
-	ArduinoOTA.onError([](ota_error_t error)
-					   {
-					   Serial.printf("Error[%u]: ", error);
-					   if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-					   else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-					   else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-					   else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-					   else if (error == OTA_END_ERROR) Serial.println("End Failed"); });
-	Serial.println("OTA Ready");
-} // otaBegin()
+#if FEATURE_WIFI
+#include <WiFi.h> // for WiFi
 
 //! Global variables
 static bool ledBuiltIn = LOW; // Built-in LED LOW = OFF, HIGH = ON
@@ -120,7 +86,8 @@ void wifiConnect()
 			Serial.print(".");
 		}
 		setLED_BUILTIN(HIGH); // Turn on the LED when connected
-		Serial.printf("\n%s: %s\n", "Connected to IP Address", WiFi.localIP().toString());
+		IPAddress ip = WiFi.localIP(); // Octets, not toString(): this runs from loop() on reconnect
+		Serial.printf("\n%s: %u.%u.%u.%u\n", "Connected to IP Address", ip[0], ip[1], ip[2], ip[3]);
 	}
 } // wifiConnect()
 
@@ -152,4 +119,6 @@ void wifiBegin()
 		Serial.println("Static IP Configuration Failed!");
 		return;
 	}
-} // wifiBegin()
\ No newline at end of file
+} // wifiBegin()
+
+#endif // FEATURE_WIFI
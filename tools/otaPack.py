@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+@file otaPack.py
+@date 2025-10-12
+@brief Compress a firmware image for OTA and optionally upload it to the TNC.
+
+Writes <image>.gz next to the image with gzip at level 9. --window-bits limits
+the back-reference window, so a firmware built with a smaller
+OTA_INFLATE_WINDOW_BITS can inflate it. Prints the sizes and the MD5 of the
+uncompressed image, which the TNC checks after inflating. With --upload, the
+image is sent to POST /update on OTA_HTTP_PORT.
+
+Usage:
+  python tools/otaPack.py .pio/build/usb/firmware.bin
+  python tools/otaPack.py .pio/build/usb/firmware.bin --upload 192.168.0.234
+  python tools/otaPack.py .pio/build/usb/firmware.bin --window-bits 13 --upload 192.168.0.234
+
+The host tool checks the result against the image: .pio/build/native/program inflate <image>.gz
+"""
+
+import argparse
+import hashlib
+import os
+import sys
+import urllib.request
+import uuid
+import zlib
+
+OTA_HTTP_PORT = 8080  # As in include/otaUpdate.h
+
+
+def pack(data, window_bits):
+    """gzip-compress data with a window of 1 << window_bits bytes"""
+    compressor = zlib.compressobj(9, zlib.DEFLATED, 16 + window_bits, 9)
+    return compressor.compress(data) + compressor.flush()
+
+
+def upload(host, port, name, payload, md5, size):
+    """Send the image as a multipart file, the way WebServer parses uploads"""
+    boundary = uuid.uuid4().hex
+    body = (
+        ("--%s\r\nContent-Disposition: form-data; name=\"image\"; filename=\"%s\"\r\n"
+         "Content-Type: application/octet-stream\r\n\r\n" % (boundary, name)).encode()
+        + payload
+        + ("\r\n--%s--\r\n" % boundary).encode()
+    )
+    url = "http://%s:%d/update?md5=%s&size=%d" % (host, port, md5, size)
+    request = urllib.request.Request(url, data=body, method="POST")
+    request.add_header("Content-Type", "multipart/form-data; boundary=%s" % boundary)
+    try:
+        with urllib.request.urlopen(request, timeout=600) as response:
+            return response.status, response.read().decode("ascii", "replace")
+    except urllib.error.HTTPError as error:
+        return error.code, error.read().decode("ascii", "replace")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image", help="firmware.bin from the PlatformIO build")
+    parser.add_argument("--window-bits", type=int, default=15, choices=range(9, 16),
+                        help="deflate window, at most the firmware's OTA_INFLATE_WINDOW_BITS (default 15)")
+    parser.add_argument("--upload", metavar="HOST", help="send the compressed image to the TNC")
+    parser.add_argument("--port", type=int, default=OTA_HTTP_PORT)
+    parser.add_argument("--plain", action="store_true", help="upload the uncompressed image instead")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        data = f.read()
+    packed = pack(data, args.window_bits)
+    with open(args.image + ".gz", "wb") as f:
+        f.write(packed)
+    md5 = hashlib.md5(data).hexdigest()
+    print("%s: %d -> %d bytes (%.1f%%), %d-bit window, md5 %s"
+          % (args.image, len(data), len(packed), 100.0 * len(packed) / len(data), args.window_bits, md5))
+
+    if args.upload:
+        payload = data if args.plain else packed
+        status, text = upload(args.upload, args.port, os.path.basename(args.image), payload, md5, len(data))
+        print("%s: HTTP %d %s" % (args.upload, status, text.strip()))
+        if status != 200:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+@file profileReport.py
+@date 2025-10-06
+@brief Flash, static RAM and boot time of each build profile in platformio.ini.
+
+Builds every environment given on the command line and takes flash and static
+RAM use from the PlatformIO size summary. With --port, it also flashes each
+one, resets the board and waits for the "Boot:" line that setup() prints. That
+line gives the milliseconds since reset and the free heap after setup. The
+result is a Markdown table.
+
+Usage:
+  python tools/profileReport.py usb bt digi
+  python tools/profileReport.py usb bt digi --port /dev/ttyUSB0
+
+Needs PlatformIO on the PATH; --port also needs pyserial.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+BOOT_LINE = re.compile(r"Boot: (\d+) ms, heap free (\d+), largest block (\d+), features(.*)")
+SIZE_LINE = re.compile(r"^(RAM|Flash):.*used (\d+) bytes from (\d+) bytes", re.MULTILINE)
+BOOT_TIMEOUT_S = 20
+
+
+def run(command):
+    """Run a command, stopping the report if it fails"""
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout)
+        sys.exit("%s failed" % " ".join(command))
+    return result.stdout
+
+
+def build(env):
+    """Build an environment; returns {"RAM": (used, total), "Flash": (used, total)} in bytes"""
+    output = run(["pio", "run", "-e", env])
+    return {m.group(1): (int(m.group(2)), int(m.group(3))) for m in SIZE_LINE.finditer(output)}
+
+
+def boot_report(env, port):
+    """Flash the image, reset the board and wait for the Boot: line"""
+    import serial  # Only needed with --port
+
+    run(["pio", "run", "-e", env, "-t", "upload", "--upload-port", port])
+    with serial.Serial(port, 115200, timeout=0.5) as link:
+        link.dtr = False
+        link.rts = True  # Hold EN low
+        time.sleep(0.1)
+        link.reset_input_buffer()
+        link.rts = False
+        deadline = time.time() + BOOT_TIMEOUT_S
+        while time.time() < deadline:
+            line = link.readline().decode("ascii", "replace")
+            match = BOOT_LINE.search(line)
+            if match:
+                return int(match.group(1)), int(match.group(2)), int(match.group(3)), match.group(4).strip()
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flash, static RAM and boot time of build profiles")
+    parser.add_argument("envs", nargs="+", help="platformio.ini environments, e.g. usb bt digi")
+    parser.add_argument("--port", help="serial port of a board to flash and time the boot on")
+    args = parser.parse_args()
+
+    os.chdir(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+    rows = []
+    for env in args.envs:
+        print("building %s" % env, file=sys.stderr)
+        sizes = build(env)
+        boot = boot_report(env, args.port) if args.port else None
+        rows.append((env, sizes, boot))
+
+    print("| profile | flash KiB | of partition | static RAM KiB | boot ms | heap free KiB | largest block KiB | features |")
+    print("|---|---:|---:|---:|---:|---:|---:|---|")
+    for env, sizes, boot in rows:
+        flash, partition = sizes.get("Flash", (0, 0))
+        ram = sizes.get("RAM", (0, 0))[0]
+        if boot:
+            ms, heap, block, features = boot
+            boot_columns = "%d | %.1f | %.1f | %s" % (ms, heap / 1024, block / 1024, features)
+        else:
+            boot_columns = "- | - | - | -"
+        print("| %s | %.1f | %.0f%% | %.1f | %s |" % (env, flash / 1024, 100.0 * flash / partition if partition else 0,
+                                                     ram / 1024, boot_columns))
+
+
+if __name__ == "__main__":
+    main()